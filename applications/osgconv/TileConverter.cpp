@@ -0,0 +1,899 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <osg/Endian>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Notify>
+#include <osg/OperationThread>
+#include <osg/PagedLOD>
+#include <osg/Timer>
+#include <osg/TriangleFunctor>
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/fstream>
+
+#include <osgUtil/MeshOptimizers>
+#include <osgUtil/Simplifier>
+#include <osgUtil/SmoothingVisitor>
+
+#include <OpenThreads/Atomic>
+
+#include "TileConverter.h"
+
+namespace
+{
+
+/** Writes primitives, each made up of a fixed number of vertices, to a temporary file a chunk at a time.*/
+class PrimitiveWriter
+{
+    public :
+        PrimitiveWriter( unsigned int verticesPerPrimitive, unsigned int chunkSize ):
+            _verticesPerPrimitive(verticesPerPrimitive),
+            _chunkSize(chunkSize*verticesPerPrimitive),
+            _numPrimitives(0) {}
+
+        ~PrimitiveWriter() { close(); }
+
+        bool open( const std::string& fileName )
+        {
+            _fout.open( fileName.c_str(), std::ios::out | std::ios::binary );
+            return _fout.good();
+        }
+
+        void write( const osg::Vec3* vertices )
+        {
+            for(unsigned int i=0; i<_verticesPerPrimitive; ++i)
+            {
+                _buffer.push_back(vertices[i]);
+                _bb.expandBy(vertices[i]);
+            }
+            ++_numPrimitives;
+
+            if (_buffer.size()>=_chunkSize) flush();
+        }
+
+        bool close()
+        {
+            if (!_fout.is_open()) return true;
+
+            flush();
+            bool result = _fout.good();
+            _fout.close();
+            return result;
+        }
+
+        unsigned long long getNumPrimitives() const { return _numPrimitives; }
+        const osg::BoundingBox& getBound() const { return _bb; }
+
+    private :
+        void flush()
+        {
+            if (!_buffer.empty()) _fout.write( reinterpret_cast<const char*>(&_buffer.front()), _buffer.size()*sizeof(osg::Vec3) );
+            _buffer.clear();
+        }
+
+        unsigned int            _verticesPerPrimitive;
+        std::size_t             _chunkSize;
+        unsigned long long      _numPrimitives;
+        std::vector<osg::Vec3>  _buffer;
+        osg::BoundingBox        _bb;
+        osgDB::ofstream         _fout;
+};
+
+/** Reads back the primitives written by a PrimitiveWriter a chunk at a time.*/
+class PrimitiveReader
+{
+    public :
+        PrimitiveReader( unsigned int verticesPerPrimitive, unsigned int chunkSize ):
+            _verticesPerPrimitive(verticesPerPrimitive),
+            _chunkSize(chunkSize) {}
+
+        bool open( const std::string& fileName )
+        {
+            _fin.open( fileName.c_str(), std::ios::in | std::ios::binary );
+            return _fin.good();
+        }
+
+        /** read the next chunk of primitives into vertices, returns the number of primitives read.*/
+        unsigned int read( std::vector<osg::Vec3>& vertices )
+        {
+            vertices.resize(_chunkSize*_verticesPerPrimitive);
+            _fin.read( reinterpret_cast<char*>(&vertices.front()), vertices.size()*sizeof(osg::Vec3) );
+
+            unsigned int numPrimitives = static_cast<unsigned int>(_fin.gcount()/sizeof(osg::Vec3))/_verticesPerPrimitive;
+            vertices.resize(numPrimitives*_verticesPerPrimitive);
+            return numPrimitives;
+        }
+
+    private :
+        unsigned int            _verticesPerPrimitive;
+        unsigned int            _chunkSize;
+        osgDB::ifstream         _fin;
+};
+
+/** Streams the primitives of a source file to a PrimitiveWriter, without holding the primitives in memory.*/
+class PrimitiveSource : public osg::Referenced
+{
+    public :
+        PrimitiveSource(): _verticesPerPrimitive(3) {}
+
+        virtual bool open( const std::string& fileName ) = 0;
+
+        virtual bool read( PrimitiveWriter& writer ) = 0;
+
+        /** 3 for triangles, 1 for points, valid once the source is open.*/
+        unsigned int getVerticesPerPrimitive() const { return _verticesPerPrimitive; }
+
+        /** Origin subtracted from the positions, so they can be held as floats.*/
+        const osg::Vec3d& getOrigin() const { return _origin; }
+
+    protected :
+        virtual ~PrimitiveSource() {}
+
+        // fan triangulate a polygon, skipping it if any of its indices are out of range.
+        void writePolygon( PrimitiveWriter& writer, const std::vector<long>& polygon, const std::vector<osg::Vec3>& positions )
+        {
+            for(std::vector<long>::const_iterator itr = polygon.begin(); itr != polygon.end(); ++itr)
+            {
+                if (*itr<0 || *itr>=static_cast<long>(positions.size())) return;
+            }
+
+            osg::Vec3 triangle[3];
+            for(unsigned int i=2; i<polygon.size(); ++i)
+            {
+                triangle[0] = positions[polygon[0]];
+                triangle[1] = positions[polygon[i-1]];
+                triangle[2] = positions[polygon[i]];
+                writer.write(triangle);
+            }
+        }
+
+        unsigned int    _verticesPerPrimitive;
+        osg::Vec3d      _origin;
+};
+
+/** Wavefront OBJ, only the vertex positions are held in memory while the faces are streamed.*/
+class OBJSource : public PrimitiveSource
+{
+    public :
+        virtual bool open( const std::string& fileName )
+        {
+            _fin.open( fileName.c_str() );
+            return _fin.good();
+        }
+
+        virtual bool read( PrimitiveWriter& writer )
+        {
+            std::vector<osg::Vec3> positions;
+            std::vector<long> polygon;
+            std::string line;
+            while(std::getline(_fin, line))
+            {
+                const char* str = line.c_str();
+                while(*str==' ' || *str=='\t') ++str;
+
+                if (str[0]=='v' && (str[1]==' ' || str[1]=='\t'))
+                {
+                    const char* ptr = str+2;
+                    char* end = 0;
+                    osg::Vec3 position;
+                    for(unsigned int i=0; i<3; ++i)
+                    {
+                        position[i] = static_cast<float>(strtod(ptr, &end));
+                        ptr = end;
+                    }
+                    positions.push_back(position);
+                }
+                else if (str[0]=='f' && (str[1]==' ' || str[1]=='\t'))
+                {
+                    polygon.clear();
+                    const char* ptr = str+2;
+                    for(;;)
+                    {
+                        char* end = 0;
+                        long index = strtol(ptr, &end, 10);
+                        if (end==ptr) break;
+
+                        // negative indices are relative to the vertices read so far.
+                        polygon.push_back(index<0 ? static_cast<long>(positions.size())+index : index-1);
+
+                        // skip the texture coordinate and normal indices.
+                        ptr = end;
+                        while(*ptr!=0 && *ptr!=' ' && *ptr!='\t') ++ptr;
+                    }
+                    writePolygon(writer, polygon, positions);
+                }
+            }
+            return true;
+        }
+
+    private :
+        osgDB::ifstream _fin;
+};
+
+/** Stanford PLY in ascii or binary format. The vertex positions are held in memory while the faces are streamed,
+  * files without faces are treated as point clouds and streamed entirely.*/
+class PLYSource : public PrimitiveSource
+{
+    public :
+        PLYSource(): _ascii(false), _swap(false) {}
+
+        virtual bool open( const std::string& fileName )
+        {
+            _fin.open( fileName.c_str(), std::ios::in | std::ios::binary );
+            if (!_fin.good()) return false;
+
+            std::string line;
+            if (!std::getline(_fin, line) || line.compare(0, 3, "ply")!=0) return false;
+
+            bool hasFaces = false;
+            while(std::getline(_fin, line))
+            {
+                if (!line.empty() && line[line.size()-1]=='\r') line.erase(line.size()-1);
+
+                std::istringstream sstr(line);
+                std::string keyword;
+                sstr >> keyword;
+
+                if (keyword=="format")
+                {
+                    std::string format;
+                    sstr >> format;
+                    _ascii = format=="ascii";
+                    bool bigEndian = format=="binary_big_endian";
+                    if (!_ascii && !bigEndian && format!="binary_little_endian") return false;
+                    _swap = !_ascii && bigEndian!=(osg::getCpuByteOrder()==osg::BigEndian);
+                }
+                else if (keyword=="element")
+                {
+                    Element element;
+                    sstr >> element.name >> element.count;
+                    _elements.push_back(element);
+                    if (element.name=="face" && element.count>0) hasFaces = true;
+                }
+                else if (keyword=="property" && !_elements.empty())
+                {
+                    Property property;
+                    std::string type;
+                    sstr >> type;
+                    if (type=="list")
+                    {
+                        std::string countType;
+                        sstr >> countType >> type;
+                        property.countType = getType(countType);
+                        if (property.countType==INVALID) return false;
+                    }
+                    property.type = getType(type);
+                    if (property.type==INVALID) return false;
+                    sstr >> property.name;
+                    _elements.back().properties.push_back(property);
+                }
+                else if (keyword=="end_header")
+                {
+                    _verticesPerPrimitive = hasFaces ? 3 : 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        virtual bool read( PrimitiveWriter& writer )
+        {
+            std::vector<osg::Vec3> positions;
+            std::vector<long> polygon;
+
+            for(Elements::const_iterator eitr = _elements.begin(); eitr != _elements.end(); ++eitr)
+            {
+                const Element& element = *eitr;
+                bool isVertex = element.name=="vertex";
+                bool isFace = element.name=="face";
+
+                if (isVertex && _verticesPerPrimitive==3) positions.reserve(static_cast<std::size_t>(element.count));
+
+                for(unsigned long long i=0; i<element.count; ++i)
+                {
+                    osg::Vec3 position;
+                    for(Properties::const_iterator pitr = element.properties.begin(); pitr != element.properties.end(); ++pitr)
+                    {
+                        double value = 0.0;
+                        if (pitr->countType==INVALID)
+                        {
+                            if (!readValue(pitr->type, value)) return false;
+
+                            if (isVertex)
+                            {
+                                if (pitr->name=="x") position.x() = static_cast<float>(value);
+                                else if (pitr->name=="y") position.y() = static_cast<float>(value);
+                                else if (pitr->name=="z") position.z() = static_cast<float>(value);
+                            }
+                            continue;
+                        }
+
+                        if (!readValue(pitr->countType, value)) return false;
+
+                        bool isIndices = isFace && (pitr->name=="vertex_indices" || pitr->name=="vertex_index");
+                        if (isIndices) polygon.clear();
+
+                        unsigned int count = static_cast<unsigned int>(value);
+                        for(unsigned int c=0; c<count; ++c)
+                        {
+                            if (!readValue(pitr->type, value)) return false;
+                            if (isIndices) polygon.push_back(static_cast<long>(value));
+                        }
+
+                        if (isIndices) writePolygon(writer, polygon, positions);
+                    }
+
+                    if (isVertex)
+                    {
+                        if (_verticesPerPrimitive==3) positions.push_back(position);
+                        else writer.write(&position);
+                    }
+                }
+            }
+            return true;
+        }
+
+    private :
+        enum Type { INVALID, INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+        struct Property
+        {
+            Property(): type(INVALID), countType(INVALID) {}
+
+            std::string     name;
+            Type            type;
+            Type            countType;  // valid for list properties
+        };
+
+        typedef std::vector<Property> Properties;
+
+        struct Element
+        {
+            Element(): count(0) {}
+
+            std::string         name;
+            unsigned long long  count;
+            Properties          properties;
+        };
+
+        typedef std::vector<Element> Elements;
+
+        static Type getType( const std::string& name )
+        {
+            if (name=="char" || name=="int8") return INT8;
+            if (name=="uchar" || name=="uint8") return UINT8;
+            if (name=="short" || name=="int16") return INT16;
+            if (name=="ushort" || name=="uint16") return UINT16;
+            if (name=="int" || name=="int32") return INT32;
+            if (name=="uint" || name=="uint32") return UINT32;
+            if (name=="float" || name=="float32") return FLOAT32;
+            if (name=="double" || name=="float64") return FLOAT64;
+            return INVALID;
+        }
+
+        template<typename T>
+        double readBinary()
+        {
+            T value;
+            _fin.read( reinterpret_cast<char*>(&value), sizeof(T) );
+            if (_swap) osg::swapBytes( reinterpret_cast<char*>(&value), sizeof(T) );
+            return static_cast<double>(value);
+        }
+
+        bool readValue( Type type, double& value )
+        {
+            if (_ascii)
+            {
+                _fin >> value;
+                return !_fin.fail();
+            }
+
+            switch(type)
+            {
+                case(INT8): value = readBinary<signed char>(); break;
+                case(UINT8): value = readBinary<unsigned char>(); break;
+                case(INT16): value = readBinary<short>(); break;
+                case(UINT16): value = readBinary<unsigned short>(); break;
+                case(INT32): value = readBinary<int>(); break;
+                case(UINT32): value = readBinary<unsigned int>(); break;
+                case(FLOAT32): value = readBinary<float>(); break;
+                case(FLOAT64): value = readBinary<double>(); break;
+                default: return false;
+            }
+            return !_fin.fail();
+        }
+
+        osgDB::ifstream _fin;
+        bool            _ascii;
+        bool            _swap;
+        Elements        _elements;
+};
+
+/** ASPRS LAS point clouds, versions 1.0 to 1.4, the points are streamed a chunk of records at a time.*/
+class LASSource : public PrimitiveSource
+{
+    public :
+        LASSource( unsigned int chunkSize ):
+            _chunkSize(chunkSize),
+            _offsetToPointData(0),
+            _recordLength(0),
+            _numPoints(0)
+        {
+            _verticesPerPrimitive = 1;
+        }
+
+        virtual bool open( const std::string& fileName )
+        {
+            _fin.open( fileName.c_str(), std::ios::in | std::ios::binary );
+            if (!_fin.good()) return false;
+
+            unsigned char header[375];
+            memset(header, 0, sizeof(header));
+            _fin.read( reinterpret_cast<char*>(header), sizeof(header) );
+            if (_fin.gcount()<227 || memcmp(header, "LASF", 4)!=0) return false;
+            _fin.clear();
+
+            unsigned char versionMinor = header[25];
+            unsigned short headerSize = getLittleEndian<unsigned short>(header+94);
+            _offsetToPointData = getLittleEndian<unsigned int>(header+96);
+            unsigned char pointFormat = header[104];
+            _recordLength = getLittleEndian<unsigned short>(header+105);
+            _numPoints = getLittleEndian<unsigned int>(header+107);
+            if (versionMinor>=4 && headerSize>=375 && _numPoints==0) _numPoints = getLittleEndian<unsigned long long>(header+247);
+
+            // compressed LAZ files set the top bits of the point format.
+            if ((pointFormat & 0xc0)!=0 || _recordLength<12)
+            {
+                OSG_NOTICE<<"Error: unsupported LAS point data format "<<int(pointFormat)<<std::endl;
+                return false;
+            }
+
+            for(unsigned int i=0; i<3; ++i)
+            {
+                _scale[i] = getLittleEndian<double>(header+131+i*8);
+                _offset[i] = getLittleEndian<double>(header+155+i*8);
+            }
+
+            // the header holds the max and min of each axis in turn, use the min as the origin.
+            _origin.set( getLittleEndian<double>(header+187), getLittleEndian<double>(header+203), getLittleEndian<double>(header+219) );
+            return true;
+        }
+
+        virtual bool read( PrimitiveWriter& writer )
+        {
+            _fin.seekg( _offsetToPointData, std::ios::beg );
+
+            std::vector<unsigned char> records(static_cast<std::size_t>(_chunkSize)*_recordLength);
+            for(unsigned long long numRead = 0; numRead<_numPoints; )
+            {
+                unsigned int numRecords = static_cast<unsigned int>(osg::minimum(static_cast<unsigned long long>(_chunkSize), _numPoints-numRead));
+                _fin.read( reinterpret_cast<char*>(&records.front()), static_cast<std::streamsize>(numRecords)*_recordLength );
+                numRecords = static_cast<unsigned int>(_fin.gcount()/_recordLength);
+                if (numRecords==0) break;
+
+                for(unsigned int r=0; r<numRecords; ++r)
+                {
+                    const unsigned char* record = &records[static_cast<std::size_t>(r)*_recordLength];
+                    osg::Vec3 position;
+                    for(unsigned int i=0; i<3; ++i)
+                    {
+                        position[i] = static_cast<float>(getLittleEndian<int>(record+i*4)*_scale[i] + _offset[i] - _origin[i]);
+                    }
+                    writer.write(&position);
+                }
+                numRead += numRecords;
+            }
+            return true;
+        }
+
+    private :
+        template<typename T>
+        static T getLittleEndian( const unsigned char* data )
+        {
+            T value;
+            memcpy( &value, data, sizeof(T) );
+            if (osg::getCpuByteOrder()==osg::BigEndian) osg::swapBytes( reinterpret_cast<char*>(&value), sizeof(T) );
+            return value;
+        }
+
+        osgDB::ifstream     _fin;
+        unsigned int        _chunkSize;
+        unsigned int        _offsetToPointData;
+        unsigned short      _recordLength;
+        unsigned long long  _numPoints;
+        osg::Vec3d          _scale;
+        osg::Vec3d          _offset;
+};
+
+struct CollectTriangles
+{
+    CollectTriangles(): _vertices(0) {}
+
+    inline void operator () ( const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3& v3, bool )
+    {
+        _vertices->push_back(v1);
+        _vertices->push_back(v2);
+        _vertices->push_back(v3);
+    }
+
+    osg::Vec3Array* _vertices;
+};
+
+/** Get the geometry drawn by a tile when its children aren't paged in.*/
+osg::Geometry* getTileGeometry( osg::Node* tile )
+{
+    osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(tile);
+    osg::Geode* geode = dynamic_cast<osg::Geode*>(plod ? plod->getChild(0) : tile);
+    return (geode && geode->getNumDrawables()>0) ? geode->getDrawable(0)->asGeometry() : 0;
+}
+
+}
+
+/** Builds the tiles of a level of the octree, taking cells one at a time as done by the Optimizer.*/
+class BuildTilesOperation : public osg::Operation
+{
+    public :
+        BuildTilesOperation( TileConverter& converter, const std::vector<unsigned int>& cells, OpenThreads::Atomic& numCellsTaken, OpenThreads::Atomic& numFailed, osg::RefBlockCount* blockCount ):
+            osg::Referenced(true),
+            osg::Operation("BuildTiles", false),
+            _converter(converter),
+            _cells(cells),
+            _numCellsTaken(numCellsTaken),
+            _numFailed(numFailed),
+            _blockCount(blockCount) {}
+
+        virtual void operator () (osg::Object*)
+        {
+            for(unsigned int i = (++_numCellsTaken)-1; i<_cells.size(); i = (++_numCellsTaken)-1)
+            {
+                if (!_converter.buildTile(_cells[i])) ++_numFailed;
+            }
+
+            _blockCount->completed();
+        }
+
+    private :
+        BuildTilesOperation& operator = (const BuildTilesOperation&) { return *this; }
+
+        TileConverter&                      _converter;
+        const std::vector<unsigned int>&    _cells;
+        OpenThreads::Atomic&                _numCellsTaken;
+        OpenThreads::Atomic&                _numFailed;
+        osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+};
+
+TileConverter::TileConverter( void ):
+    _maximumPrimitivesPerTile(65536),
+    _maximumDepth(10),
+    _rangeFactor(6.0f),
+    _chunkSize(65536),
+    _verticesPerPrimitive(3)
+{
+}
+
+std::string TileConverter::getPrimitivesFileName( const Cell& cell ) const
+{
+    return _baseName+"_"+cell.name+".tmp";
+}
+
+std::string TileConverter::getTileFileName( const Cell& cell ) const
+{
+    return _baseName+"_"+cell.name+"_tile.osgb";
+}
+
+std::string TileConverter::getChildrenFileName( const Cell& cell ) const
+{
+    return _baseName+"_"+cell.name+".osgb";
+}
+
+bool TileConverter::convert( const std::string& fileName, const std::string& fileNameOut )
+{
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    std::string ext = osgDB::getLowerCaseFileExtension(fileName);
+    osg::ref_ptr<PrimitiveSource> source;
+    if (ext=="obj") source = new OBJSource;
+    else if (ext=="ply") source = new PLYSource;
+    else if (ext=="las") source = new LASSource(_chunkSize);
+    else
+    {
+        OSG_NOTICE<<"Error: tiled conversion is only supported for .obj, .ply and .las files, not '"<<fileName<<"'."<<std::endl;
+        return false;
+    }
+
+    if (!source->open(fileName))
+    {
+        OSG_NOTICE<<"Error: unable to read '"<<fileName<<"'."<<std::endl;
+        return false;
+    }
+
+    _baseName = osgDB::getNameLessExtension(fileNameOut);
+    osgDB::makeDirectoryForFile(fileNameOut);
+    _verticesPerPrimitive = source->getVerticesPerPrimitive();
+    _origin = source->getOrigin();
+    _cells.clear();
+
+    Cell root;
+    root.name = "r";
+
+    osg::BoundingBox bb;
+    {
+        PrimitiveWriter writer(_verticesPerPrimitive, _chunkSize);
+        bool result = writer.open(getPrimitivesFileName(root)) && source->read(writer);
+        result = writer.close() && result;
+
+        root.numPrimitives = writer.getNumPrimitives();
+        bb = writer.getBound();
+
+        if (!result || root.numPrimitives==0)
+        {
+            OSG_NOTICE<<"Error: no primitives read from '"<<fileName<<"'."<<std::endl;
+            remove(getPrimitivesFileName(root).c_str());
+            return false;
+        }
+    }
+
+    // release the source, and the vertex positions held by it, before the tiles are built.
+    source = 0;
+
+    OSG_NOTICE<<"Read "<<root.numPrimitives<<(_verticesPerPrimitive==3 ? " triangles" : " points")<<" from '"<<fileName<<"' in "
+              <<osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())<<"s"<<std::endl;
+
+    // make the root cell a cube, slightly larger than the bound, so that all the octants are cubes.
+    double halfSize = osg::maximum(osg::maximum(bb.xMax()-bb.xMin(), bb.yMax()-bb.yMin()), bb.zMax()-bb.zMin())*0.5005+1e-6;
+    osg::Vec3d center(bb.center());
+    root.bb.set(center-osg::Vec3d(halfSize, halfSize, halfSize), center+osg::Vec3d(halfSize, halfSize, halfSize));
+    _cells.push_back(root);
+
+    // split breadth first, so the cells of each depth are contiguous.
+    for(unsigned int i=0; i<_cells.size(); ++i)
+    {
+        if (!split(i)) return false;
+    }
+
+    unsigned int maximumDepth = _cells.back().depth;
+    OSG_NOTICE<<"Split into "<<_cells.size()<<" cells, "<<maximumDepth+1<<" levels deep"<<std::endl;
+
+    // build the tiles bottom up, so that each cell can gather the tiles of its children.
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+    unsigned int end = static_cast<unsigned int>(_cells.size());
+    for(int depth = static_cast<int>(maximumDepth); depth>=0; --depth)
+    {
+        std::vector<unsigned int> cells;
+        unsigned int begin = end;
+        while(begin>0 && _cells[begin-1].depth==static_cast<unsigned int>(depth)) cells.push_back(--begin);
+        end = begin;
+
+        unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, static_cast<unsigned int>(cells.size()));
+
+        OpenThreads::Atomic numCellsTaken;
+        OpenThreads::Atomic numFailed;
+        osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+        blockCount->reset();
+
+        for(unsigned int i=0; i<numOperations; ++i)
+        {
+            threadPool->add(new BuildTilesOperation(*this, cells, numCellsTaken, numFailed, blockCount.get()));
+        }
+
+        threadPool->runOperationsUntilCompleted(blockCount.get());
+
+        if (static_cast<unsigned int>(numFailed)>0)
+        {
+            OSG_NOTICE<<"Error: failed to build "<<static_cast<unsigned int>(numFailed)<<" tiles at level "<<depth<<"."<<std::endl;
+            return false;
+        }
+
+        OSG_NOTICE<<"Built "<<cells.size()<<" tiles at level "<<depth<<std::endl;
+    }
+
+    osg::ref_ptr<osg::Node> tile = osgDB::readRefNodeFile(getTileFileName(_cells.front()));
+    if (!tile) return false;
+    remove(getTileFileName(_cells.front()).c_str());
+
+    osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(tile.get());
+    if (plod) plod->setDatabasePath("");
+
+    osg::ref_ptr<osg::Node> root_node = tile;
+    if (_origin!=osg::Vec3d(0.0, 0.0, 0.0))
+    {
+        osg::MatrixTransform* transform = new osg::MatrixTransform(osg::Matrixd::translate(_origin));
+        transform->addChild(tile.get());
+        root_node = transform;
+    }
+
+    if (_verticesPerPrimitive==1) root_node->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+    if (!osgDB::writeNodeFile(*root_node, fileNameOut))
+    {
+        OSG_NOTICE<<"Error: unable to write '"<<fileNameOut<<"'."<<std::endl;
+        return false;
+    }
+
+    OSG_NOTICE<<"Tiles written to '"<<fileNameOut<<"' in "<<osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())<<"s"<<std::endl;
+    return true;
+}
+
+bool TileConverter::split( unsigned int cellIndex )
+{
+    Cell cell = _cells[cellIndex];
+    if (cell.numPrimitives<=_maximumPrimitivesPerTile || cell.depth>=_maximumDepth) return true;
+
+    PrimitiveReader reader(_verticesPerPrimitive, _chunkSize);
+    if (!reader.open(getPrimitivesFileName(cell))) return false;
+
+    Cell children[8];
+    PrimitiveWriter* writers[8];
+    osg::Vec3d center = cell.bb.center();
+    for(unsigned int octant=0; octant<8; ++octant)
+    {
+        Cell& child = children[octant];
+        child.name = cell.name + static_cast<char>('0'+octant);
+        child.depth = cell.depth+1;
+        child.bb.set((octant&1) ? center.x() : cell.bb.xMin(), (octant&2) ? center.y() : cell.bb.yMin(), (octant&4) ? center.z() : cell.bb.zMin(),
+                     (octant&1) ? cell.bb.xMax() : center.x(), (octant&2) ? cell.bb.yMax() : center.y(), (octant&4) ? cell.bb.zMax() : center.z());
+        writers[octant] = 0;
+    }
+
+    // place each primitive in the octant holding its centroid.
+    bool result = true;
+    std::vector<osg::Vec3> vertices;
+    while(unsigned int numPrimitives = reader.read(vertices))
+    {
+        for(unsigned int p=0; p<numPrimitives && result; ++p)
+        {
+            const osg::Vec3* primitive = &vertices[p*_verticesPerPrimitive];
+            osg::Vec3d centroid;
+            for(unsigned int v=0; v<_verticesPerPrimitive; ++v) centroid += osg::Vec3d(primitive[v]);
+            centroid /= static_cast<double>(_verticesPerPrimitive);
+
+            unsigned int octant = (centroid.x()>=center.x() ? 1 : 0) | (centroid.y()>=center.y() ? 2 : 0) | (centroid.z()>=center.z() ? 4 : 0);
+            if (!writers[octant])
+            {
+                writers[octant] = new PrimitiveWriter(_verticesPerPrimitive, _chunkSize);
+                result = writers[octant]->open(getPrimitivesFileName(children[octant]));
+            }
+            writers[octant]->write(primitive);
+        }
+    }
+
+    for(unsigned int octant=0; octant<8; ++octant)
+    {
+        if (!writers[octant]) continue;
+
+        result = writers[octant]->close() && result;
+        children[octant].numPrimitives = writers[octant]->getNumPrimitives();
+        delete writers[octant];
+
+        _cells[cellIndex].children.push_back(static_cast<unsigned int>(_cells.size()));
+        _cells.push_back(children[octant]);
+    }
+
+    remove(getPrimitivesFileName(cell).c_str());
+
+    if (!result) OSG_NOTICE<<"Error: unable to split '"<<getPrimitivesFileName(cell)<<"'."<<std::endl;
+    return result;
+}
+
+bool TileConverter::buildTile( unsigned int cellIndex )
+{
+    const Cell& cell = _cells[cellIndex];
+    GLenum mode = _verticesPerPrimitive==3 ? GL_TRIANGLES : GL_POINTS;
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Group> children;
+
+    if (cell.children.empty())
+    {
+        PrimitiveReader reader(_verticesPerPrimitive, _chunkSize);
+        if (!reader.open(getPrimitivesFileName(cell))) return false;
+
+        vertices->reserve(static_cast<std::size_t>(cell.numPrimitives)*_verticesPerPrimitive);
+        std::vector<osg::Vec3> chunk;
+        while(reader.read(chunk)>0) vertices->insert(vertices->end(), chunk.begin(), chunk.end());
+
+        remove(getPrimitivesFileName(cell).c_str());
+    }
+    else
+    {
+        // gather the children's tiles, and the primitives they draw before their own children are paged in.
+        children = new osg::Group;
+        for(std::vector<unsigned int>::const_iterator itr = cell.children.begin(); itr != cell.children.end(); ++itr)
+        {
+            const std::string fileName = getTileFileName(_cells[*itr]);
+            osg::ref_ptr<osg::Node> tile = osgDB::readRefNodeFile(fileName);
+            if (!tile) return false;
+            remove(fileName.c_str());
+
+            // the path the tile was read from isn't needed, the tiles are all written alongside each other.
+            osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(tile.get());
+            if (plod) plod->setDatabasePath("");
+
+            children->addChild(tile.get());
+
+            osg::Geometry* geometry = getTileGeometry(tile.get());
+            if (!geometry) continue;
+
+            if (mode==GL_TRIANGLES)
+            {
+                osg::TriangleFunctor<CollectTriangles> collectTriangles;
+                collectTriangles._vertices = vertices.get();
+                geometry->accept(collectTriangles);
+            }
+            else
+            {
+                const osg::Vec3Array* points = dynamic_cast<const osg::Vec3Array*>(geometry->getVertexArray());
+                if (points) vertices->insert(vertices->end(), points->begin(), points->end());
+            }
+        }
+
+        if (!osgDB::writeNodeFile(*children, getChildrenFileName(cell))) return false;
+    }
+
+    unsigned int numPrimitives = static_cast<unsigned int>(vertices->size())/_verticesPerPrimitive;
+    if (numPrimitives==0) return false;
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(new osg::DrawArrays(mode, 0, vertices->size()));
+
+    if (mode==GL_TRIANGLES)
+    {
+        if (children.valid() && numPrimitives>_maximumPrimitivesPerTile)
+        {
+            // the tiles are built concurrently, so don't partition the simplification across the threads as well.
+            osgUtil::Simplifier simplifier(static_cast<double>(_maximumPrimitivesPerTile)/static_cast<double>(numPrimitives));
+            simplifier.setSmoothing(false);
+            simplifier.setDoTriStrip(false);
+            simplifier.setPartitionSize(0);
+            simplifier.simplify(*geometry);
+        }
+
+        osgUtil::MeshOptimizationVisitor optimizer;
+        optimizer.optimize(*geometry);
+        osgUtil::SmoothingVisitor::smooth(*geometry);
+    }
+    else if (children.valid() && numPrimitives>_maximumPrimitivesPerTile)
+    {
+        // points are simplified by taking an evenly spaced subset.
+        osg::ref_ptr<osg::Vec3Array> subset = new osg::Vec3Array(_maximumPrimitivesPerTile);
+        for(unsigned int i=0; i<_maximumPrimitivesPerTile; ++i)
+        {
+            (*subset)[i] = (*vertices)[static_cast<unsigned int>(static_cast<unsigned long long>(i)*numPrimitives/_maximumPrimitivesPerTile)];
+        }
+        geometry->setVertexArray(subset.get());
+        geometry->setPrimitiveSet(0, new osg::DrawArrays(GL_POINTS, 0, subset->size()));
+    }
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+
+    osg::ref_ptr<osg::Node> tile = geode;
+    if (children.valid())
+    {
+        // page in the children once the eye is within the range factor times the radius of the tile.
+        const osg::BoundingSphere& bs = children->getBound();
+        float cutoff = bs.radius()*_rangeFactor;
+
+        osg::PagedLOD* plod = new osg::PagedLOD;
+        plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+        plod->setCenter(bs.center());
+        plod->setRadius(bs.radius());
+        plod->addChild(geode.get(), cutoff, FLT_MAX);
+        plod->setFileName(1, osgDB::getSimpleFileName(getChildrenFileName(cell)));
+        plod->setRange(1, 0.0f, cutoff);
+        tile = plod;
+    }
+
+    return osgDB::writeNodeFile(*tile, getTileFileName(cell));
+}
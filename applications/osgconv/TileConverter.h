@@ -0,0 +1,76 @@
+#ifndef _TILE_CONVERTER_H
+#define _TILE_CONVERTER_H
+
+#include <osg/Vec3d>
+#include <osg/BoundingBox>
+
+#include <string>
+#include <vector>
+
+/** Converts a source mesh or point cloud that is too large to load into memory into an octree of PagedLOD tiles.
+  * The source is streamed in chunks to a temporary file, which is split recursively into octants until each holds
+  * at most the maximum number of primitives per tile. The leaves are written out at full resolution, and each
+  * internal node is written as a PagedLOD holding the union of its children's tiles simplified down to the
+  * maximum number of primitives per tile, which pages in its children's tiles as the eye approaches. The tiles
+  * of each level are built on the osg::OperationThreadPool, so only a tile and its children's tiles per thread
+  * are held in memory at once. OBJ and PLY meshes and LAS point clouds are supported. */
+class TileConverter {
+    public :
+        TileConverter(void);
+
+        /** Set the maximum number of triangles, or points, per tile. Defaults to 65536.*/
+        void setMaximumPrimitivesPerTile( unsigned int num ) { _maximumPrimitivesPerTile = num; }
+        unsigned int getMaximumPrimitivesPerTile() const { return _maximumPrimitivesPerTile; }
+
+        /** Set the maximum depth of the octree. Defaults to 10.*/
+        void setMaximumDepth( unsigned int depth ) { _maximumDepth = depth; }
+        unsigned int getMaximumDepth() const { return _maximumDepth; }
+
+        /** Set the ratio of the distance at which a tile's children are paged in to the radius of the tile. Defaults to 6.*/
+        void setRangeFactor( float factor ) { _rangeFactor = factor; }
+        float getRangeFactor() const { return _rangeFactor; }
+
+        /** Set the number of primitives read and written at a time when streaming. Defaults to 65536.*/
+        void setChunkSize( unsigned int num ) { _chunkSize = num; }
+        unsigned int getChunkSize() const { return _chunkSize; }
+
+        /** Convert fileName to a root file fileNameOut, with the tiles written as .osgb files alongside it.*/
+        bool convert( const std::string& fileName, const std::string& fileNameOut );
+
+    private :
+        TileConverter( const TileConverter& ) {}
+        TileConverter& operator = (const TileConverter& ) { return *this; }
+
+        struct Cell
+        {
+            Cell(): depth(0), numPrimitives(0) {}
+
+            std::string                 name;
+            unsigned int                depth;
+            osg::BoundingBoxd           bb;
+            unsigned long long          numPrimitives;
+            std::vector<unsigned int>   children;
+        };
+
+        typedef std::vector<Cell> Cells;
+
+        bool split( unsigned int cellIndex );
+        bool buildTile( unsigned int cellIndex );
+
+        std::string getPrimitivesFileName( const Cell& cell ) const;
+        std::string getTileFileName( const Cell& cell ) const;
+        std::string getChildrenFileName( const Cell& cell ) const;
+
+        friend class BuildTilesOperation;
+
+        unsigned int    _maximumPrimitivesPerTile;
+        unsigned int    _maximumDepth;
+        float           _rangeFactor;
+        unsigned int    _chunkSize;
+
+        std::string     _baseName;
+        unsigned int    _verticesPerPrimitive;
+        osg::Vec3d      _origin;
+        Cells           _cells;
+};
+#endif
@@ -11,6 +11,7 @@
 #include <osg/Texture3D>
 #include <osg/BlendFunc>
 #include <osg/Timer>
+#include <osg/OperationThread>
 
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
@@ -29,6 +30,7 @@
 #include <iostream>
 
 #include "OrientationConverter.h"
+#include "TileConverter.h"
 
 typedef std::vector<std::string> FileNameList;
 
@@ -515,6 +517,20 @@ static void usage( const char *prog, const char *msg )
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --optimizer-timing - Report the time taken by each of the optimizer passes."<< std::endl;
+    osg::notify(osg::NOTICE)<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --out-of-core      - Stream a single .obj, .ply or .las infile that is too\n"
+                              "                         large to load into memory into an octree of PagedLOD\n"
+                              "                         .osgb tiles written alongside outfile. Each tile holds\n"
+                              "                         its children's tiles simplified, and the other\n"
+                              "                         conversion options are not applied."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tile-size n      - Maximum number of triangles or points per tile,\n"
+                              "                         defaults to 65536."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tile-depth n     - Maximum depth of the octree of tiles, defaults to 10."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tile-range-factor f - Ratio of the distance at which a tile's children\n"
+                              "                         are paged in to its radius, defaults to 6."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --tile-threads n   - Number of tiles built at once, defaults to the\n"
+                              "                         number of processors."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
     osg::notify( osg::NOTICE ) <<
@@ -745,6 +761,26 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    bool reportOptimizerTiming = false;
+    while(arguments.read("--optimizer-timing")) { reportOptimizerTiming = true; }
+
+    bool outOfCore = false;
+    while(arguments.read("--out-of-core")) { outOfCore = true; }
+
+    TileConverter tc;
+    unsigned int tileSize = 0;
+    while(arguments.read("--tile-size",tileSize)) { tc.setMaximumPrimitivesPerTile(tileSize); }
+
+    unsigned int tileDepth = 0;
+    while(arguments.read("--tile-depth",tileDepth)) { tc.setMaximumDepth(tileDepth); }
+
+    float tileRangeFactor = 0.0f;
+    while(arguments.read("--tile-range-factor",tileRangeFactor)) { tc.setRangeFactor(tileRangeFactor); }
+
+    // the calling thread builds tiles as well as the thread pool.
+    unsigned int tileThreads = 0;
+    while(arguments.read("--tile-threads",tileThreads)) { osg::OperationThreadPool::instance()->setNumThreads(osg::maximum(tileThreads,1u)-1); }
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -776,6 +812,16 @@ int main( int argc, char **argv )
         fileNames.pop_back();
     }
 
+    if (outOfCore)
+    {
+        if (fileNames.size()!=1)
+        {
+            usage( argv[0], "--out-of-core requires a single input file." );
+            return 1;
+        }
+        return tc.convert(fileNames.front(), fileNameOut) ? 0 : 1;
+    }
+
     osg::Timer_t startTick = osg::Timer::instance()->tick();
 
     osg::ref_ptr<osg::Node> root = osgDB::readRefNodeFiles(fileNames);
@@ -818,6 +864,17 @@ int main( int argc, char **argv )
         osgUtil::Optimizer optimizer;
         optimizer.optimize(root.get());
 
+        if (reportOptimizerTiming)
+        {
+            const osgUtil::Optimizer::PassTimings& passTimings = optimizer.getPassTimings();
+            for(osgUtil::Optimizer::PassTimings::const_iterator itr = passTimings.begin();
+                itr != passTimings.end();
+                ++itr)
+            {
+                osg::notify(osg::NOTICE)<<"Optimizer pass "<<itr->_name<<" took "<<itr->_time<<"ms"<<std::endl;
+            }
+        }
+
         if( do_convert )
             root = oc.convert( root.get() );
 
@@ -333,11 +333,17 @@ int main(int argc, char** argv)
     }
 
     bool useDisplacementMappingTechnique = arguments.read("--dm");
-    if (useDisplacementMappingTechnique)
+    bool useGeometryPool = arguments.read("--geometry-pool");
+    if (useDisplacementMappingTechnique || useGeometryPool)
     {
         osgDB::Registry::instance()->setReadFileCallback(new CleanTechniqueReadFileCallback());
     }
 
+    bool initializeTilesAsynchronously = arguments.read("--async-tiles");
+
+    unsigned int maximumNumTilesUpdatedPerFrame = 0;
+    while(arguments.read("--tiles-per-frame", maximumNumTilesUpdatedPerFrame)) {}
+
     bool setDatabaseThreadAffinity = false;
     unsigned int cpuNum = 0;
     while(arguments.read("--db-affinity", cpuNum)) { setDatabaseThreadAffinity = true; }
@@ -378,12 +384,20 @@ int main(int argc, char** argv)
     terrain->setSampleRatio(sampleRatio);
     terrain->setVerticalScale(verticalScale);
     terrain->setBlendingPolicy(blendingPolicy);
+    terrain->setInitializeTilesAsynchronously(initializeTilesAsynchronously);
+    terrain->setMaximumNumTilesUpdatedPerFrame(maximumNumTilesUpdatedPerFrame);
 
 
     if (useDisplacementMappingTechnique)
     {
         terrain->setTerrainTechniquePrototype(new osgTerrain::DisplacementMappingTechnique());
     }
+    else if (useGeometryPool)
+    {
+        osg::ref_ptr<osgTerrain::GeometryTechnique> geometryTechnique = new osgTerrain::GeometryTechnique;
+        geometryTechnique->setUseGeometryPool(true);
+        terrain->setTerrainTechniquePrototype(geometryTechnique.get());
+    }
 
 
     // register our custom handler for adjust Terrain settings
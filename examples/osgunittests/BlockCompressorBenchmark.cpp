@@ -0,0 +1,99 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "BlockCompressorBenchmark.h"
+
+#include <osg/Image>
+#include <osg/Timer>
+#include <osg/OperationThread>
+#include <osgDB/BlockCompressor>
+
+#include <iostream>
+#include <math.h>
+
+// creates an RGBA image with smooth gradients, edges and a little noise, roughly like a photographic texture.
+static osg::Image* createTestImage(unsigned int size)
+{
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    unsigned int seed = 1;
+    for(unsigned int t=0; t<size; ++t)
+    {
+        unsigned char* ptr = image->data(0, t);
+        for(unsigned int s=0; s<size; ++s)
+        {
+            seed = seed*1103515245u+12345u;
+            int noise = int((seed>>16)&15)-8;
+
+            float x = float(s)/float(size);
+            float y = float(t)/float(size);
+            bool checker = ((s/32)+(t/32))%2==0;
+
+            int r = int(128.0f+100.0f*sinf(x*12.0f+y*3.0f))+noise;
+            int g = int(255.0f*y)+(checker ? 20 : -20)+noise;
+            int b = int(128.0f+100.0f*cosf(y*9.0f-x*5.0f))+noise;
+            int a = int(255.0f*x);
+
+            *(ptr++) = (unsigned char)osg::clampBetween(r, 0, 255);
+            *(ptr++) = (unsigned char)osg::clampBetween(g, 0, 255);
+            *(ptr++) = (unsigned char)osg::clampBetween(b, 0, 255);
+            *(ptr++) = (unsigned char)osg::clampBetween(a, 0, 255);
+        }
+    }
+    return image.release();
+}
+
+static void runCompress(const char* description, osgDB::BlockCompressor* compressor, const osg::Image* source, osg::Texture::InternalFormatMode mode, osgDB::ImageProcessor::CompressionQuality quality, unsigned int numPasses)
+{
+    double totalTime = 0.0;
+    unsigned int sizeInBytes = 0;
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        osg::ref_ptr<osg::Image> image = new osg::Image(*source, osg::CopyOp::DEEP_COPY_ALL);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        compressor->compress(*image, mode, true, false, osgDB::ImageProcessor::USE_CPU, quality);
+        totalTime += osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        sizeInBytes = image->getTotalSizeInBytesIncludingMipmaps();
+    }
+
+    double numPixels = double(source->s())*double(source->t())*4.0/3.0;
+    std::cout<<description<<"\t"<<totalTime*1000.0/numPasses<<" ms\t"<<numPixels*numPasses/totalTime*1e-6<<" M pixels/s\t"
+             <<sizeInBytes/1024<<"KB including mipmaps"<<std::endl;
+}
+
+void runBlockCompressorBenchmark(unsigned int imageSize, unsigned int numPasses)
+{
+    osg::ref_ptr<osg::Image> source = createTestImage(imageSize);
+    osg::ref_ptr<osgDB::BlockCompressor> compressor = new osgDB::BlockCompressor;
+
+    std::cout<<"****  BlockCompressor benchmark, "<<imageSize<<"x"<<imageSize<<" RGBA image, "<<numPasses<<" passes, "
+             <<osg::OperationThreadPool::instance()->getNumThreads()<<" pool threads  ****"<<std::endl;
+    std::cout<<"uncompressed\t"<<source->getTotalSizeInBytes()*4/3/1024<<"KB including mipmaps"<<std::endl;
+
+    runCompress("DXT1  fastest", compressor.get(), source.get(), osg::Texture::USE_S3TC_DXT1_COMPRESSION, osgDB::ImageProcessor::FASTEST, numPasses);
+    runCompress("DXT1  normal ", compressor.get(), source.get(), osg::Texture::USE_S3TC_DXT1_COMPRESSION, osgDB::ImageProcessor::NORMAL, numPasses);
+    runCompress("DXT1  highest", compressor.get(), source.get(), osg::Texture::USE_S3TC_DXT1_COMPRESSION, osgDB::ImageProcessor::HIGHEST, numPasses);
+    runCompress("DXT5  normal ", compressor.get(), source.get(), osg::Texture::USE_S3TC_DXT5_COMPRESSION, osgDB::ImageProcessor::NORMAL, numPasses);
+    runCompress("RGTC2 normal ", compressor.get(), source.get(), osg::Texture::USE_RGTC2_COMPRESSION, osgDB::ImageProcessor::NORMAL, numPasses);
+    runCompress("BPTC  normal ", compressor.get(), source.get(), osg::Texture::USE_BPTC_COMPRESSION, osgDB::ImageProcessor::NORMAL, numPasses);
+    runCompress("ETC1  normal ", compressor.get(), source.get(), osg::Texture::USE_ETC_COMPRESSION, osgDB::ImageProcessor::NORMAL, numPasses);
+    runCompress("ETC2  normal ", compressor.get(), source.get(), osg::Texture::USE_ETC2_COMPRESSION, osgDB::ImageProcessor::NORMAL, numPasses);
+}
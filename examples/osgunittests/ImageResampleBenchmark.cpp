@@ -0,0 +1,166 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "ImageResampleBenchmark.h"
+
+#include <osg/GLU>
+#include <osg/Image>
+#include <osg/Timer>
+#include <osg/OperationThread>
+
+#include <iostream>
+#include <math.h>
+
+// creates an image with smooth gradients, edges and a little noise, with 8 bit or float components.
+static osg::Image* createTestImage(unsigned int size, GLenum dataType)
+{
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(size, size, 1, GL_RGBA, dataType);
+
+    unsigned int seed = 1;
+    for(unsigned int t=0; t<size; ++t)
+    {
+        for(unsigned int s=0; s<size; ++s)
+        {
+            seed = seed*1103515245u+12345u;
+            float noise = float(int((seed>>16)&15)-8)/255.0f;
+
+            float x = float(s)/float(size);
+            float y = float(t)/float(size);
+            bool checker = ((s/32)+(t/32))%2==0;
+
+            float rgba[4];
+            rgba[0] = 0.5f+0.4f*sinf(x*12.0f+y*3.0f)+noise;
+            rgba[1] = y+(checker ? 0.08f : -0.08f)+noise;
+            rgba[2] = 0.5f+0.4f*cosf(y*9.0f-x*5.0f)+noise;
+            rgba[3] = x;
+
+            for(unsigned int c=0; c<4; ++c)
+            {
+                float value = osg::clampBetween(rgba[c], 0.0f, 1.0f);
+                if (dataType==GL_FLOAT) reinterpret_cast<float*>(image->data(s, t))[c] = value;
+                else image->data(s, t)[c] = (unsigned char)(value*255.0f+0.5f);
+            }
+        }
+    }
+    return image.release();
+}
+
+static void reportTime(const char* description, double totalTime, unsigned int numPasses, double numPixels)
+{
+    std::cout<<description<<"\t"<<totalTime*1000.0/numPasses<<" ms\t"<<numPixels*numPasses/totalTime*1e-6<<" M pixels/s"<<std::endl;
+}
+
+static void runScale(const char* description, const osg::Image* source, int size, bool useGLU, osg::Image::ResampleFilter filter, unsigned int numPasses)
+{
+    unsigned int rowStep = osg::Image::computeRowWidthInBytes(size, source->getPixelFormat(), source->getDataType(), source->getPacking());
+    std::vector<unsigned char> data(rowStep*size);
+
+    double totalTime = 0.0;
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        if (useGLU)
+        {
+            osg::PixelStorageModes psm;
+            psm.pack_alignment = source->getPacking();
+            psm.unpack_alignment = source->getPacking();
+            osg::gluScaleImage(&psm, source->getPixelFormat(), source->s(), source->t(), source->getDataType(), source->data(),
+                          size, size, source->getDataType(), &data[0]);
+        }
+        else
+        {
+            osg::Image::resampleImageData(source->getPixelFormat(), source->getDataType(), source->s(), source->t(), source->data(), source->getRowStepInBytes(),
+                                          size, size, &data[0], rowStep, filter);
+        }
+        totalTime += osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+    }
+
+    reportTime(description, totalTime, numPasses, double(size)*double(size));
+}
+
+static void runMipmaps(const char* description, const osg::Image* source, bool useGLU, osg::Image::ResampleFilter filter, unsigned int numPasses)
+{
+    double totalTime = 0.0;
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        osg::ref_ptr<osg::Image> image = new osg::Image(*source, osg::CopyOp::DEEP_COPY_ALL);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        if (useGLU)
+        {
+            // the GLU path of osg::Texture, each level scaled from the one above it.
+            std::vector<unsigned char> previous(image->data(), image->data()+image->getTotalSizeInBytes());
+            int width = image->s();
+            int height = image->t();
+            while (width>1 || height>1)
+            {
+                int newWidth = osg::maximum(width/2, 1);
+                int newHeight = osg::maximum(height/2, 1);
+                std::vector<unsigned char> level(osg::Image::computeImageSizeInBytes(newWidth, newHeight, 1, image->getPixelFormat(), image->getDataType(), image->getPacking()));
+
+                osg::PixelStorageModes psm;
+                psm.pack_alignment = image->getPacking();
+                psm.unpack_alignment = image->getPacking();
+                osg::gluScaleImage(&psm, image->getPixelFormat(), width, height, image->getDataType(), &previous[0],
+                              newWidth, newHeight, image->getDataType(), &level[0]);
+
+                previous.swap(level);
+                width = newWidth;
+                height = newHeight;
+            }
+        }
+        else
+        {
+            image->generateMipmaps(filter);
+        }
+        totalTime += osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+    }
+
+    reportTime(description, totalTime, numPasses, double(source->s())*double(source->t())/3.0);
+}
+
+static void runBenchmarks(const char* typeName, GLenum dataType, unsigned int imageSize, unsigned int numPasses)
+{
+    osg::ref_ptr<osg::Image> source = createTestImage(imageSize, dataType);
+
+    // scale down to 3/4, as when rescaling a non power of two image, and up by 3/2.
+    int smaller = imageSize*3/4;
+    int larger = imageSize*3/2;
+
+    std::cout<<typeName<<" RGBA"<<std::endl;
+    runScale("scale 3/4 GLU          ", source.get(), smaller, true, osg::Image::BOX_FILTER, numPasses);
+    runScale("scale 3/4 box          ", source.get(), smaller, false, osg::Image::BOX_FILTER, numPasses);
+    runScale("scale 3/4 Kaiser       ", source.get(), smaller, false, osg::Image::KAISER_FILTER, numPasses);
+    runScale("scale 3/4 Lanczos      ", source.get(), smaller, false, osg::Image::LANCZOS_FILTER, numPasses);
+    runScale("scale 3/2 GLU          ", source.get(), larger, true, osg::Image::BOX_FILTER, numPasses);
+    runScale("scale 3/2 box          ", source.get(), larger, false, osg::Image::BOX_FILTER, numPasses);
+    runScale("scale 3/2 Lanczos      ", source.get(), larger, false, osg::Image::LANCZOS_FILTER, numPasses);
+    runMipmaps("mipmaps GLU            ", source.get(), true, osg::Image::BOX_FILTER, numPasses);
+    runMipmaps("mipmaps box            ", source.get(), false, osg::Image::BOX_FILTER, numPasses);
+    runMipmaps("mipmaps Kaiser         ", source.get(), false, osg::Image::KAISER_FILTER, numPasses);
+}
+
+void runImageResampleBenchmark(unsigned int imageSize, unsigned int numPasses)
+{
+    std::cout<<"****  Image resample benchmark, "<<imageSize<<"x"<<imageSize<<" images, "<<numPasses<<" passes, "
+             <<osg::OperationThreadPool::instance()->getNumThreads()<<" pool threads  ****"<<std::endl;
+
+    runBenchmarks("8 bit", GL_UNSIGNED_BYTE, imageSize, numPasses);
+    runBenchmarks("float", GL_FLOAT, imageSize, numPasses);
+}
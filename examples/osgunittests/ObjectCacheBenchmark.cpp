@@ -0,0 +1,175 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "ObjectCacheBenchmark.h"
+
+#include <osg/Group>
+#include <osg/Timer>
+#include <osgDB/ObjectCache>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Barrier>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+static const unsigned int s_numExtensions = 8;
+static const unsigned int s_numFileNames = 4096;
+
+// a ReaderWriter that only registers extensions, so lookups find it without loading any plugins.
+class BenchmarkReaderWriter : public osgDB::ReaderWriter
+{
+public:
+
+    BenchmarkReaderWriter(unsigned int index)
+    {
+        std::ostringstream ext;
+        ext<<"bench"<<index;
+        supportsExtension(ext.str(), "Object cache benchmark");
+    }
+
+    virtual const char* className() const { return "Object cache benchmark"; }
+};
+
+// looks up the ReaderWriter for, and then the cached object of, a sequence of file names as a DatabasePager thread
+// reading tiles would, adding the object to the cache when it isn't found.
+class LookupThread : public OpenThreads::Thread
+{
+public:
+
+    LookupThread(osgDB::ObjectCache* objectCache, const osgDB::Options* options, const std::vector<std::string>& fileNames, unsigned int seed, unsigned int numLookups, OpenThreads::Barrier& startBarrier, OpenThreads::Barrier& endBarrier):
+        _objectCache(objectCache),
+        _options(options),
+        _fileNames(fileNames),
+        _seed(seed),
+        _numLookups(numLookups),
+        _startBarrier(startBarrier),
+        _endBarrier(endBarrier) {}
+
+    virtual void run()
+    {
+        osgDB::Registry* registry = osgDB::Registry::instance();
+
+        _startBarrier.block();
+
+        unsigned int random = _seed;
+        for(unsigned int i=0; i<_numLookups; ++i)
+        {
+            random = random*1664525u + 1013904223u;
+            const std::string& fileName = _fileNames[(random>>8) % _fileNames.size()];
+
+            if (!registry->getReaderWriterForExtension(fileName.substr(fileName.size()-6))) continue;
+
+            if (!_objectCache->getRefFromObjectCache(fileName, _options).valid()) _objectCache->addEntryToObjectCache(fileName, new osg::Group, 0.0, _options);
+        }
+
+        _endBarrier.block();
+    }
+
+protected:
+
+    LookupThread& operator = (const LookupThread&) { return *this; }
+
+    osgDB::ObjectCache*                 _objectCache;
+    const osgDB::Options*               _options;
+    const std::vector<std::string>&     _fileNames;
+    unsigned int                        _seed;
+    unsigned int                        _numLookups;
+    OpenThreads::Barrier&               _startBarrier;
+    OpenThreads::Barrier&               _endBarrier;
+};
+
+static void runLookups(const std::string& description, osgDB::ObjectCache* objectCache, const std::vector<std::string>& fileNames, unsigned int numThreads, unsigned int numLookups)
+{
+    OpenThreads::Barrier startBarrier(numThreads+1);
+    OpenThreads::Barrier endBarrier(numThreads+1);
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+
+    std::vector<LookupThread*> threads;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        threads.push_back(new LookupThread(objectCache, options.get(), fileNames, i*7919+1, numLookups, startBarrier, endBarrier));
+        threads.back()->startThread();
+    }
+
+    startBarrier.block();
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    endBarrier.block();
+    double totalTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    osgDB::ObjectCache::CacheStats cacheStats;
+    objectCache->getCacheStats(cacheStats);
+
+    double numTotalLookups = double(numThreads)*double(numLookups);
+    std::cout<<description<<"\t"<<totalTime*1e9/numTotalLookups<<" ns per lookup\t"<<numTotalLookups/totalTime*1e-6<<" M lookups/s\t"
+             <<cacheStats.numHits<<" hits, "<<cacheStats.numMisses<<" misses, "<<cacheStats.numEvictions<<" evictions, "
+             <<cacheStats.numObjects<<" objects of "<<cacheStats.sizeInBytes/1024<<"KB cached"<<std::endl;
+}
+
+void runObjectCacheBenchmark(unsigned int numThreads, unsigned int numLookups)
+{
+    osgDB::Registry* registry = osgDB::Registry::instance();
+
+    std::vector< osg::ref_ptr<BenchmarkReaderWriter> > readerWriters;
+    for(unsigned int i=0; i<s_numExtensions; ++i)
+    {
+        readerWriters.push_back(new BenchmarkReaderWriter(i));
+        registry->addReaderWriter(readerWriters.back().get());
+    }
+
+    std::vector<std::string> fileNames;
+    for(unsigned int i=0; i<s_numFileNames; ++i)
+    {
+        std::ostringstream fileName;
+        fileName<<"tiles/L"<<(i%16)<<"_X"<<(i/16)<<"_Y"<<(i*31%257)<<".bench"<<(i%s_numExtensions);
+        fileNames.push_back(fileName.str());
+    }
+
+    std::cout<<"****  ObjectCache benchmark, "<<numThreads<<" threads, "<<numLookups<<" lookups per thread  ****"<<std::endl;
+
+    osg::ref_ptr<osgDB::ObjectCache> singleShardCache = new osgDB::ObjectCache(1);
+    runLookups("1 shard", singleShardCache.get(), fileNames, numThreads, numLookups);
+
+    osg::ref_ptr<osgDB::ObjectCache> shardedCache = new osgDB::ObjectCache;
+    std::ostringstream description;
+    description<<shardedCache->getNumShards()<<" shards";
+    runLookups(description.str(), shardedCache.get(), fileNames, numThreads, numLookups);
+
+    osg::ref_ptr<osgDB::ObjectCache> limitedCache = new osgDB::ObjectCache;
+    limitedCache->setMaximumNumObjects(s_numFileNames/4);
+    runLookups(description.str()+", LRU", limitedCache.get(), fileNames, numThreads, numLookups);
+
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    osg::ref_ptr<osgDB::ObjectCache> budgetedCache = new osgDB::ObjectCache;
+    budgetedCache->setMaximumSizeInBytes(budgetedCache->computeSizeInBytes(group.get())*s_numFileNames/4);
+    runLookups(description.str()+", budget", budgetedCache.get(), fileNames, numThreads, numLookups);
+
+    for(unsigned int i=0; i<s_numExtensions; ++i)
+    {
+        registry->removeReaderWriter(readerWriters[i].get());
+    }
+}
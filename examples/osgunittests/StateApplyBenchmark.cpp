@@ -0,0 +1,168 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "StateApplyBenchmark.h"
+
+#include <osg/GraphicsContext>
+#include <osg/State>
+#include <osg/StateSet>
+#include <osg/BlendFunc>
+#include <osg/ColorMask>
+#include <osg/CullFace>
+#include <osg/Depth>
+#include <osg/FrontFace>
+#include <osg/LineWidth>
+#include <osg/PolygonOffset>
+#include <osg/Timer>
+
+#include <iostream>
+#include <vector>
+
+typedef std::vector< osg::ref_ptr<osg::StateSet> > StateSetList;
+
+static const GLenum s_modes[] =
+{
+    GL_BLEND,
+    GL_CULL_FACE,
+    GL_DEPTH_TEST,
+    GL_DITHER,
+    GL_POLYGON_OFFSET_FILL,
+    GL_SCISSOR_TEST,
+    GL_STENCIL_TEST,
+    GL_SAMPLE_ALPHA_TO_COVERAGE
+};
+
+static const unsigned int s_numModes = sizeof(s_modes)/sizeof(GLenum);
+
+// the state shared by all the StateSets, as would be pushed by the parents of a subgraph.
+static osg::StateSet* createBaseStateSet()
+{
+    osg::StateSet* stateset = new osg::StateSet;
+    for(unsigned int i=0; i<s_numModes; ++i)
+    {
+        stateset->setMode(s_modes[i], (i%2)==0 ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+    }
+    stateset->setAttribute(new osg::Depth(osg::Depth::LEQUAL));
+    stateset->setAttribute(new osg::FrontFace(osg::FrontFace::COUNTER_CLOCKWISE));
+    stateset->setAttribute(new osg::ColorMask(true, true, true, true));
+    return stateset;
+}
+
+// distinct StateSets that each set a different selection of modes and their own attribute instances.
+static void createDistinctStateSets(unsigned int numStateSets, StateSetList& statesets)
+{
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        osg::StateSet* stateset = new osg::StateSet;
+        for(unsigned int m=0; m<4; ++m)
+        {
+            stateset->setMode(s_modes[(i+m*3)%s_numModes], ((i>>m)&1) ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+        }
+        stateset->setAttribute(new osg::PolygonOffset(static_cast<float>(i%7), static_cast<float>(i%5)));
+        stateset->setAttribute(new osg::LineWidth(1.0f+static_cast<float>(i%3)));
+        stateset->setAttribute(new osg::CullFace((i%2)==0 ? osg::CullFace::BACK : osg::CullFace::FRONT));
+        statesets.push_back(stateset);
+    }
+}
+
+// StateSets that share all of their state apart from a single attribute, as siblings typically do.
+static void createSiblingStateSets(unsigned int numStateSets, StateSetList& statesets)
+{
+    osg::ref_ptr<osg::BlendFunc> blendFunc = new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    osg::ref_ptr<osg::CullFace> cullFace = new osg::CullFace(osg::CullFace::BACK);
+    osg::ref_ptr<osg::LineWidth> lineWidth = new osg::LineWidth(2.0f);
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        osg::StateSet* stateset = new osg::StateSet;
+        stateset->setMode(GL_BLEND, osg::StateAttribute::ON);
+        stateset->setMode(GL_CULL_FACE, osg::StateAttribute::ON);
+        stateset->setAttribute(blendFunc.get());
+        stateset->setAttribute(cullFace.get());
+        stateset->setAttribute(lineWidth.get());
+        stateset->setAttribute(new osg::PolygonOffset(static_cast<float>(i%7), 1.0f));
+        statesets.push_back(stateset);
+    }
+}
+
+static double timeApply(osg::State& state, osg::StateSet* base, const StateSetList& statesets, unsigned int numPasses, bool sameStateSet)
+{
+    state.pushStateSet(base);
+    state.apply();
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        for(StateSetList::const_iterator itr = statesets.begin();
+            itr != statesets.end();
+            ++itr)
+        {
+            state.apply(sameStateSet ? statesets.front().get() : itr->get());
+        }
+    }
+    double totalTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    state.popAllStateSets();
+    state.apply();
+
+    return totalTime/static_cast<double>(numPasses*statesets.size());
+}
+
+static void reportApply(osg::State& state, osg::StateSet* base, const StateSetList& statesets, unsigned int numPasses, bool sameStateSet, const char* description)
+{
+    state.setUseIncrementalStateSetApply(false);
+    double fullTime = timeApply(state, base, statesets, numPasses, sameStateSet);
+
+    state.setUseIncrementalStateSetApply(true);
+    double incrementalTime = timeApply(state, base, statesets, numPasses, sameStateSet);
+
+    std::cout<<description<<"\tfull apply "<<fullTime*1e9<<" ns\tincremental apply "<<incrementalTime*1e9<<" ns per StateSet"<<std::endl;
+}
+
+void runStateApplyBenchmark(unsigned int numStateSets, unsigned int numPasses)
+{
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+    traits->width = 64;
+    traits->height = 64;
+    traits->pbuffer = true;
+
+    osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if (!gc || !gc->realize() || !gc->makeCurrent())
+    {
+        std::cout<<"StateSet apply benchmark requires a graphics context, unable to create a pbuffer."<<std::endl;
+        return;
+    }
+
+    osg::State& state = *(gc->getState());
+    state.initializeExtensionProcs();
+
+    osg::ref_ptr<osg::StateSet> base = createBaseStateSet();
+
+    std::cout<<"****  StateSet apply benchmark, "<<numStateSets<<" StateSets, "<<numPasses<<" passes  ****"<<std::endl;
+
+    StateSetList distinct;
+    createDistinctStateSets(numStateSets, distinct);
+    reportApply(state, base.get(), distinct, numPasses, false, "distinct StateSets");
+    reportApply(state, base.get(), distinct, numPasses, true, "identical StateSet ");
+
+    StateSetList siblings;
+    createSiblingStateSets(numStateSets, siblings);
+    reportApply(state, base.get(), siblings, numPasses, false, "sibling StateSets ");
+
+    gc->releaseContext();
+    gc->close();
+}
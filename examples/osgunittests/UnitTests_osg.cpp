@@ -20,6 +20,9 @@
 
 #include <osg/Matrixd>
 #include <osg/Matrixf>
+#include <osg/MeshletGeometry>
+#include <osg/MultiDrawIndirectGeometry>
+#include <osg/TriangleIndexFunctor>
 #include <osg/Vec3d>
 #include <osg/Vec3>
 #include <sstream>
@@ -380,5 +383,243 @@ OSGUTX_END_TESTSUITE
 
 OSGUTX_AUTOREGISTER_TESTSUITE_AT(Matrix, root.osg)
 
+///////////////////////////////////////////////////////////////////////////////
+// 
+//  MultiDrawIndirectGeometry Tests
+//
+class MultiDrawIndirectGeometryTestFixture
+{
+public:
+
+    MultiDrawIndirectGeometryTestFixture();
+
+    void testCommandGeneration(const osgUtx::TestContext& ctx);
+    void testDrawIDs(const osgUtx::TestContext& ctx);
+    void testIncompatibleGeometry(const osgUtx::TestContext& ctx);
+    void testDrawEnabled(const osgUtx::TestContext& ctx);
+
+private:
+
+    // a quad drawn with DrawElementsUShort and a triangle drawn with DrawArrays
+    ref_ptr<Geometry> _quad;
+    ref_ptr<Geometry> _triangle;
+
+};
+
+MultiDrawIndirectGeometryTestFixture::MultiDrawIndirectGeometryTestFixture()
+{
+    _quad = new Geometry;
+    ref_ptr<Vec3Array> quadVertices = new Vec3Array;
+    quadVertices->push_back(Vec3(0.0f, 0.0f, 0.0f));
+    quadVertices->push_back(Vec3(1.0f, 0.0f, 0.0f));
+    quadVertices->push_back(Vec3(1.0f, 1.0f, 0.0f));
+    quadVertices->push_back(Vec3(0.0f, 1.0f, 0.0f));
+    _quad->setVertexArray(quadVertices.get());
+    ref_ptr<DrawElementsUShort> quadElements = new DrawElementsUShort(GL_TRIANGLES);
+    quadElements->push_back(0); quadElements->push_back(1); quadElements->push_back(2);
+    quadElements->push_back(0); quadElements->push_back(2); quadElements->push_back(3);
+    _quad->addPrimitiveSet(quadElements.get());
+
+    _triangle = new Geometry;
+    ref_ptr<Vec3Array> triangleVertices = new Vec3Array;
+    triangleVertices->push_back(Vec3(2.0f, 0.0f, 0.0f));
+    triangleVertices->push_back(Vec3(3.0f, 0.0f, 0.0f));
+    triangleVertices->push_back(Vec3(3.0f, 1.0f, 0.0f));
+    _triangle->setVertexArray(triangleVertices.get());
+    _triangle->addPrimitiveSet(new DrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+void MultiDrawIndirectGeometryTestFixture::testCommandGeneration(const osgUtx::TestContext&)
+{
+    ref_ptr<MultiDrawIndirectGeometry> mdig = new MultiDrawIndirectGeometry;
+    OSGUTX_TEST_F( mdig->addGeometry(*_quad) )
+    OSGUTX_TEST_F( mdig->addGeometry(*_triangle) )
+    OSGUTX_TEST_F( mdig->getNumDraws()==2 )
+    OSGUTX_TEST_F( mdig->getVertexArray()->getNumElements()==7 )
+
+    const DrawElementsIndirectCommandArray& commands = *mdig->getCommands();
+    OSGUTX_TEST_F( commands.size()==2 )
+    OSGUTX_TEST_F( commands[0]==DrawElementsIndirectCommand(6, 0, 0) )
+    OSGUTX_TEST_F( commands[1]==DrawElementsIndirectCommand(3, 6, 1) )
+    OSGUTX_TEST_F( commands.getTotalDataSize()==2*5*sizeof(GLuint) )
+
+    // the triangle's indices are rebased after the quad's vertices.
+    const DrawElementsUInt& elements = *mdig->getElements();
+    OSGUTX_TEST_F( elements.size()==9 )
+    OSGUTX_TEST_F( elements[5]==3 && elements[6]==4 && elements[7]==5 && elements[8]==6 )
+}
+
+void MultiDrawIndirectGeometryTestFixture::testDrawIDs(const osgUtx::TestContext&)
+{
+    ref_ptr<MultiDrawIndirectGeometry> mdig = new MultiDrawIndirectGeometry;
+    mdig->addGeometry(*_quad);
+    mdig->addGeometry(*_triangle);
+
+    const UIntArray* drawIDs = dynamic_cast<const UIntArray*>(mdig->getVertexAttribArray(mdig->getDrawIDAttributeIndex()));
+    OSGUTX_TEST_F( drawIDs!=0 && drawIDs->size()==7 )
+    OSGUTX_TEST_F( drawIDs && (*drawIDs)[3]==0 && (*drawIDs)[4]==1 )
+    OSGUTX_TEST_F( mdig->getDrawID(3)==0 && mdig->getDrawID(4)==1 && mdig->getDrawFirstVertex(1)==4 )
+
+    ref_ptr<MultiDrawIndirectGeometry> noDrawIDs = new MultiDrawIndirectGeometry;
+    noDrawIDs->setDrawIDAttributeIndex(MultiDrawIndirectGeometry::NO_DRAW_ID_ATTRIBUTE);
+    noDrawIDs->addGeometry(*_quad);
+    OSGUTX_TEST_F( noDrawIDs->getVertexAttribArrayList().empty() )
+}
+
+void MultiDrawIndirectGeometryTestFixture::testIncompatibleGeometry(const osgUtx::TestContext&)
+{
+    ref_ptr<MultiDrawIndirectGeometry> mdig = new MultiDrawIndirectGeometry;
+    mdig->addGeometry(*_quad);
+
+    ref_ptr<Geometry> lines = new Geometry(*_triangle);
+    lines->setPrimitiveSetList(Geometry::PrimitiveSetList());
+    lines->addPrimitiveSet(new DrawArrays(GL_LINES, 0, 2));
+    OSGUTX_TEST_F( !mdig->addGeometry(*lines) )
+
+    ref_ptr<Geometry> normals = new Geometry(*_triangle);
+    normals->setNormalArray(new Vec3Array(3), Array::BIND_PER_VERTEX);
+    OSGUTX_TEST_F( !mdig->isCompatible(*normals) )
+
+    OSGUTX_TEST_F( mdig->getNumDraws()==1 && mdig->getCommands()->size()==1 )
+}
+
+void MultiDrawIndirectGeometryTestFixture::testDrawEnabled(const osgUtx::TestContext&)
+{
+    ref_ptr<MultiDrawIndirectGeometry> mdig = new MultiDrawIndirectGeometry;
+    mdig->addGeometry(*_quad);
+    mdig->addGeometry(*_triangle);
+
+    unsigned int modifiedCount = mdig->getCommands()->getModifiedCount();
+    mdig->setDrawEnabled(1, false);
+    OSGUTX_TEST_F( !mdig->getDrawEnabled(1) && mdig->getDrawEnabled(0) )
+    OSGUTX_TEST_F( (*mdig->getCommands())[1].instanceCount==0 )
+    OSGUTX_TEST_F( mdig->getCommands()->getModifiedCount()!=modifiedCount )
+}
+
+OSGUTX_BEGIN_TESTSUITE(MultiDrawIndirectGeometry)
+    OSGUTX_ADD_TESTCASE(MultiDrawIndirectGeometryTestFixture, testCommandGeneration)
+    OSGUTX_ADD_TESTCASE(MultiDrawIndirectGeometryTestFixture, testDrawIDs)
+    OSGUTX_ADD_TESTCASE(MultiDrawIndirectGeometryTestFixture, testIncompatibleGeometry)
+    OSGUTX_ADD_TESTCASE(MultiDrawIndirectGeometryTestFixture, testDrawEnabled)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(MultiDrawIndirectGeometry, root.osg)
+
+///////////////////////////////////////////////////////////////////////////////
+// 
+//  MeshletGeometry Tests
+//
+class MeshletGeometryTestFixture
+{
+public:
+
+    MeshletGeometryTestFixture();
+
+    void testSelection(const osgUtx::TestContext& ctx);
+    void testFrustumCulling(const osgUtx::TestContext& ctx);
+    void testPrimitiveFunctors(const osgUtx::TestContext& ctx);
+
+private:
+
+    // two level 0 meshlets, one triangle each, and the single level 1 meshlet that replaces them.
+    ref_ptr<MeshletGeometry> _geometry;
+    Matrix _projection;
+
+};
+
+MeshletGeometryTestFixture::MeshletGeometryTestFixture()
+{
+    _geometry = new MeshletGeometry;
+    ref_ptr<Vec3Array> vertices = new Vec3Array;
+    vertices->push_back(Vec3(-1.0f, -1.0f, 0.0f));
+    vertices->push_back(Vec3(1.0f, -1.0f, 0.0f));
+    vertices->push_back(Vec3(1.0f, 1.0f, 0.0f));
+    vertices->push_back(Vec3(-1.0f, 1.0f, 0.0f));
+    _geometry->setVertexArray(vertices.get());
+
+    ref_ptr<DrawElementsUInt> elements = new DrawElementsUInt(GL_TRIANGLES);
+    elements->push_back(0); elements->push_back(1); elements->push_back(2);
+    elements->push_back(0); elements->push_back(2); elements->push_back(3);
+    elements->push_back(0); elements->push_back(1); elements->push_back(3);
+    _geometry->addPrimitiveSet(elements.get());
+
+    BoundingSphere lodBound(Vec3(0.0f, 0.0f, 0.0f), 1.5f);
+    MeshletGeometry::Meshlets meshlets(3);
+    for(unsigned int i=0; i<3; ++i)
+    {
+        meshlets[i].firstIndex = i*3;
+        meshlets[i].numIndices = 3;
+        meshlets[i].numVertices = 3;
+        meshlets[i].bound = lodBound;
+    }
+    meshlets[0].lodBound = meshlets[1].lodBound = lodBound;
+    meshlets[0].parentError = meshlets[1].parentError = 0.1f;
+    meshlets[0].parentLodBound = meshlets[1].parentLodBound = lodBound;
+    meshlets[2].level = 1;
+    meshlets[2].error = 0.1f;
+    meshlets[2].lodBound = lodBound;
+    _geometry->setMeshlets(meshlets);
+
+    _projection = Matrix::perspective(45.0, 1.0, 0.1, 10000.0);
+}
+
+void MeshletGeometryTestFixture::testSelection(const osgUtx::TestContext&)
+{
+    // near the eye the finer meshlets are drawn, as a single run of indices.
+    MeshletGeometry::IndexRanges ranges;
+    OSGUTX_TEST_F( _geometry->select(Matrix::translate(0.0, 0.0, -10.0), _projection, 1024.0, 1.0f, ranges)==2 )
+    OSGUTX_TEST_F( ranges.size()==2 && ranges[0]==0 && ranges[1]==6 )
+
+    // far away the parent's projected error is within the threshold so it replaces them.
+    ranges.clear();
+    OSGUTX_TEST_F( _geometry->select(Matrix::translate(0.0, 0.0, -1000.0), _projection, 1024.0, 1.0f, ranges)==1 )
+    OSGUTX_TEST_F( ranges.size()==2 && ranges[0]==6 && ranges[1]==3 )
+
+    // scaling the LOD distances or the error threshold switches to the parent nearer the eye.
+    ranges.clear();
+    OSGUTX_TEST_F( _geometry->select(Matrix::translate(0.0, 0.0, -10.0), _projection, 1024.0, 100.0f, ranges)==1 )
+    _geometry->setErrorThreshold(100.0f);
+    ranges.clear();
+    OSGUTX_TEST_F( _geometry->select(Matrix::translate(0.0, 0.0, -10.0), _projection, 1024.0, 1.0f, ranges)==1 )
+    _geometry->setErrorThreshold(1.0f);
+}
+
+void MeshletGeometryTestFixture::testFrustumCulling(const osgUtx::TestContext&)
+{
+    MeshletGeometry::IndexRanges ranges;
+    OSGUTX_TEST_F( _geometry->select(Matrix::translate(0.0, 0.0, 10.0), _projection, 1024.0, 1.0f, ranges)==0 )
+    OSGUTX_TEST_F( _geometry->select(Matrix::translate(100.0, 0.0, -10.0), _projection, 1024.0, 1.0f, ranges)==0 )
+    OSGUTX_TEST_F( ranges.empty() )
+}
+
+namespace
+{
+    struct CountTriangles
+    {
+        CountTriangles(): count(0) {}
+        void operator() (unsigned int, unsigned int, unsigned int) { ++count; }
+        unsigned int count;
+    };
+}
+
+void MeshletGeometryTestFixture::testPrimitiveFunctors(const osgUtx::TestContext&)
+{
+    // intersections and statistics only see the finest level.
+    OSGUTX_TEST_F( _geometry->getNumFinestIndices()==6 )
+
+    TriangleIndexFunctor<CountTriangles> counter;
+    _geometry->accept(counter);
+    OSGUTX_TEST_F( counter.count==2 )
+}
+
+OSGUTX_BEGIN_TESTSUITE(MeshletGeometry)
+    OSGUTX_ADD_TESTCASE(MeshletGeometryTestFixture, testSelection)
+    OSGUTX_ADD_TESTCASE(MeshletGeometryTestFixture, testFrustumCulling)
+    OSGUTX_ADD_TESTCASE(MeshletGeometryTestFixture, testPrimitiveFunctors)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(MeshletGeometry, root.osg)
+
+
 
 }
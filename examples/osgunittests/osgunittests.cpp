@@ -30,6 +30,10 @@
 #include "UnitTestFramework.h"
 #include "performance.h"
 #include "MultiThreadRead.h"
+#include "StateApplyBenchmark.h"
+#include "ObjectCacheBenchmark.h"
+#include "BlockCompressorBenchmark.h"
+#include "ImageResampleBenchmark.h"
 
 #include <iostream>
 
@@ -573,6 +577,10 @@ int main( int argc, char** argv )
     arguments.getApplicationUsage()->addCommandLineOption("matrix","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("performance","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("read-threads <numthreads>","Run multi-thread reading test.");
+    arguments.getApplicationUsage()->addCommandLineOption("state-apply <numstatesets> <numpasses>","Run StateSet apply benchmark, comparing full and incremental apply.");
+    arguments.getApplicationUsage()->addCommandLineOption("object-cache <numthreads> <numlookups>","Run ReaderWriter and ObjectCache lookup contention benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("block-compressor <imagesize> <numpasses>","Run BlockCompressor image compression benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("image-resample <imagesize> <numpasses>","Run Image scaling and mipmap generation benchmark, comparing GLU with the Image resampler.");
 
 
     if (arguments.argc()<=1)
@@ -599,6 +607,26 @@ int main( int argc, char** argv )
     int numReadThreads = 0;
     while (arguments.read("read-threads", numReadThreads)) {}
 
+    int numStateApplyStateSets = 0;
+    int numStateApplyPasses = 10;
+    while (arguments.read("state-apply", numStateApplyStateSets, numStateApplyPasses)) {}
+    while (arguments.read("state-apply", numStateApplyStateSets)) {}
+
+    int numObjectCacheThreads = 0;
+    int numObjectCacheLookups = 1000000;
+    while (arguments.read("object-cache", numObjectCacheThreads, numObjectCacheLookups)) {}
+    while (arguments.read("object-cache", numObjectCacheThreads)) {}
+
+    int blockCompressorImageSize = 0;
+    int numBlockCompressorPasses = 4;
+    while (arguments.read("block-compressor", blockCompressorImageSize, numBlockCompressorPasses)) {}
+    while (arguments.read("block-compressor", blockCompressorImageSize)) {}
+
+    int imageResampleImageSize = 0;
+    int numImageResamplePasses = 4;
+    while (arguments.read("image-resample", imageResampleImageSize, numImageResamplePasses)) {}
+    while (arguments.read("image-resample", imageResampleImageSize)) {}
+
     bool printPolytopeTest = false;
     while (arguments.read("polytope")) printPolytopeTest = true;
 
@@ -687,6 +715,30 @@ int main( int argc, char** argv )
         return 0;
     }
 
+    if (numStateApplyStateSets>0)
+    {
+        runStateApplyBenchmark(numStateApplyStateSets, numStateApplyPasses);
+        return 0;
+    }
+
+    if (numObjectCacheThreads>0)
+    {
+        runObjectCacheBenchmark(numObjectCacheThreads, numObjectCacheLookups);
+        return 0;
+    }
+
+    if (blockCompressorImageSize>0)
+    {
+        runBlockCompressorBenchmark(blockCompressorImageSize, numBlockCompressorPasses);
+        return 0;
+    }
+
+    if (imageResampleImageSize>0)
+    {
+        runImageResampleBenchmark(imageResampleImageSize, numImageResamplePasses);
+        return 0;
+    }
+
 
     if (printPolytopeTest)
     {
@@ -35,6 +35,10 @@
     #define CHECK_CONSISTENCY
 #endif
 
+#ifndef GL_DRAW_INDIRECT_BUFFER
+    #define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
 using namespace osg;
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1555,4 +1559,23 @@ ShaderStorageBufferObject::~ShaderStorageBufferObject()
 {
 }
 
+//////////////////////////////////////////////////////////////////////////////////
+//
+//  DrawIndirectBufferObject
+//
+DrawIndirectBufferObject::DrawIndirectBufferObject()
+{
+    setTarget(GL_DRAW_INDIRECT_BUFFER);
+    setUsage(GL_STATIC_DRAW);
+}
+
+DrawIndirectBufferObject::DrawIndirectBufferObject(const DrawIndirectBufferObject& dibo, const CopyOp& copyop)
+    : BufferObject(dibo, copyop)
+{
+}
+
+DrawIndirectBufferObject::~DrawIndirectBufferObject()
+{
+}
+
 
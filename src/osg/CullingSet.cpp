@@ -64,6 +64,36 @@ void CullingSet::popOccludersCurrentMask(NodePath& nodePath)
     }
 }
 
+unsigned int CullingSet::isCulled(const BoundingSphere* spheres, unsigned int numSpheres, Polytope::ClippingMask* resultMasks)
+{
+    unsigned int numCulled = 0;
+    if (_mask&VIEW_FRUSTUM_CULLING)
+    {
+        numCulled = numSpheres - _frustum.contains(spheres, numSpheres, resultMasks);
+    }
+    else
+    {
+        // no frustum test so leave the current mask in place for the subsequent traversal.
+        Polytope::ClippingMask currentMask = _frustum.getCurrentMask();
+        for(unsigned int i=0; i<numSpheres; ++i) resultMasks[i] = currentMask;
+    }
+
+    if (_mask&SMALL_FEATURE_CULLING)
+    {
+        for(unsigned int i=0; i<numSpheres; ++i)
+        {
+            if (resultMasks[i]!=Polytope::OUTSIDE_CLIPPING_SET &&
+                ((spheres[i].center()*_pixelSizeVector)*_smallFeatureCullingPixelSize)>spheres[i].radius())
+            {
+                resultMasks[i] = Polytope::OUTSIDE_CLIPPING_SET;
+                ++numCulled;
+            }
+        }
+    }
+
+    return numCulled;
+}
+
 osg::Vec4 CullingSet::computePixelSizeVector(const Viewport& W, const Matrix& P, const Matrix& M)
 {
     // pre adjust P00,P20,P23,P33 by multiplying them by the viewport window matrix.
@@ -26,6 +26,7 @@
 #include <osg/Texture2DArray>
 #include <osg/TextureCubeMap>
 #include <osg/Light>
+#include <osg/OperationThread>
 
 #include <algorithm>
 #include <string.h>
@@ -33,9 +34,550 @@
 
 #include "dxtctool.h"
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define OSG_IMAGE_RESAMPLE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSG_IMAGE_RESAMPLE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define OSG_IMAGE_RESAMPLE_NEON
+#endif
+
 using namespace osg;
 using namespace std;
 
+// resampling of images with 8 bit and float components, used by Image::scaleImage(), Image::generateMipmaps() and Texture.
+namespace
+{
+
+inline float sinc(float x)
+{
+    if (fabsf(x)<1e-6f) return 1.0f;
+    x *= osg::PIf;
+    return sinf(x)/x;
+}
+
+// zeroth order modified Bessel function of the first kind, used by the Kaiser window.
+inline float besselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    float halfX = x*0.5f;
+    for(int k=1; k<32; ++k)
+    {
+        term *= (halfX/float(k))*(halfX/float(k));
+        sum += term;
+        if (term<sum*1e-7f) break;
+    }
+    return sum;
+}
+
+float evaluateFilter(osg::Image::ResampleFilter filter, float x)
+{
+    x = fabsf(x);
+    switch(filter)
+    {
+        case(osg::Image::KAISER_FILTER):
+        {
+            // Kaiser windowed sinc with a radius of 3 and an alpha of 4.
+            const float radius = 3.0f;
+            const float alpha = 4.0f;
+            if (x>=radius) return 0.0f;
+            float t = x/radius;
+            return sinc(x)*besselI0(alpha*sqrtf(1.0f-t*t))/besselI0(alpha);
+        }
+        case(osg::Image::LANCZOS_FILTER):
+        {
+            // Lanczos windowed sinc with a radius of 3.
+            if (x>=3.0f) return 0.0f;
+            return sinc(x)*sinc(x/3.0f);
+        }
+        default:
+        {
+            // tent filter, box filtering is computed from the coverage of each source texel.
+            return x<1.0f ? 1.0f-x : 0.0f;
+        }
+    }
+}
+
+float getFilterRadius(osg::Image::ResampleFilter filter)
+{
+    return filter==osg::Image::BOX_FILTER ? 1.0f : 3.0f;
+}
+
+// the source texels, and their weights, contributing to each destination texel along one axis, padded with zero
+// weights so that every destination texel has the same number of taps.
+struct Contributions
+{
+    Contributions(osg::Image::ResampleFilter filter, int srcSize, int dstSize)
+    {
+        float scale = float(srcSize)/float(dstSize);
+        bool boxFilter = filter==osg::Image::BOX_FILTER && scale>1.0f;
+
+        // minification widens the filter to the size of a destination texel to avoid aliasing.
+        float filterScale = osg::maximum(scale, 1.0f);
+        float support = boxFilter ? scale*0.5f+0.5f : getFilterRadius(filter)*filterScale;
+
+        numTaps = static_cast<int>(ceilf(support*2.0f))+1;
+        indices.resize(dstSize*numTaps, 0);
+        weights.resize(dstSize*numTaps, 0.0f);
+
+        for(int d=0; d<dstSize; ++d)
+        {
+            float center = (float(d)+0.5f)*scale;
+            int first = static_cast<int>(floorf(center-support));
+
+            int* tapIndices = &indices[d*numTaps];
+            float* tapWeights = &weights[d*numTaps];
+
+            float total = 0.0f;
+            int n = 0;
+            for(int i=first; i<first+numTaps; ++i)
+            {
+                float weight;
+                if (boxFilter)
+                {
+                    // the coverage of the source texel by the destination texel.
+                    float low = osg::maximum(float(i), center-scale*0.5f);
+                    float high = osg::minimum(float(i+1), center+scale*0.5f);
+                    weight = osg::maximum(high-low, 0.0f);
+                }
+                else
+                {
+                    weight = evaluateFilter(filter, (float(i)+0.5f-center)/filterScale);
+                }
+
+                if (weight==0.0f) continue;
+
+                // clamp to the edges, merging taps outside the image into the edge texel.
+                int index = osg::clampBetween(i, 0, srcSize-1);
+                if (n>0 && tapIndices[n-1]==index)
+                {
+                    tapWeights[n-1] += weight;
+                }
+                else
+                {
+                    tapIndices[n] = index;
+                    tapWeights[n] = weight;
+                    ++n;
+                }
+                total += weight;
+            }
+
+            if (n==0)
+            {
+                tapIndices[0] = osg::clampBetween(static_cast<int>(center), 0, srcSize-1);
+                tapWeights[0] = 1.0f;
+                n = 1;
+                total = 1.0f;
+            }
+
+            for(int k=0; k<n; ++k) tapWeights[k] /= total;
+
+            // pad with zero weights on the last tap so that loads stay within the image.
+            for(int k=n; k<numTaps; ++k) tapIndices[k] = tapIndices[n-1];
+        }
+    }
+
+    int numTaps;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+inline float toFloat(unsigned char value) { return float(value); }
+inline float toFloat(float value) { return value; }
+
+// filter a source row horizontally into a row of floats.
+template<typename T>
+void filterRow(const T* src, int numComponents, const Contributions& contributions, int dstWidth, float* dst)
+{
+    const int numTaps = contributions.numTaps;
+    const int* indices = &contributions.indices.front();
+    const float* weights = &contributions.weights.front();
+
+    for(int d=0; d<dstWidth; ++d, indices+=numTaps, weights+=numTaps, dst+=numComponents)
+    {
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for(int k=0; k<numTaps; ++k)
+        {
+            const T* texel = src + indices[k]*numComponents;
+            for(int c=0; c<numComponents; ++c) sum[c] += weights[k]*toFloat(texel[c]);
+        }
+        for(int c=0; c<numComponents; ++c) dst[c] = sum[c];
+    }
+}
+
+#if defined(OSG_IMAGE_RESAMPLE_AVX) || defined(OSG_IMAGE_RESAMPLE_SSE)
+
+template<>
+void filterRow(const unsigned char* src, int numComponents, const Contributions& contributions, int dstWidth, float* dst)
+{
+    if (numComponents!=4)
+    {
+        filterRow<unsigned char>(src, numComponents, contributions, dstWidth, dst);
+        return;
+    }
+
+    const int numTaps = contributions.numTaps;
+    const int* indices = &contributions.indices.front();
+    const float* weights = &contributions.weights.front();
+    const __m128i zero = _mm_setzero_si128();
+
+    for(int d=0; d<dstWidth; ++d, indices+=numTaps, weights+=numTaps, dst+=4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for(int k=0; k<numTaps; ++k)
+        {
+            int texel;
+            memcpy(&texel, src + indices[k]*4, 4);
+            __m128i components = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(texel), zero), zero);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_cvtepi32_ps(components)));
+        }
+        _mm_storeu_ps(dst, sum);
+    }
+}
+
+template<>
+void filterRow(const float* src, int numComponents, const Contributions& contributions, int dstWidth, float* dst)
+{
+    if (numComponents!=4)
+    {
+        filterRow<float>(src, numComponents, contributions, dstWidth, dst);
+        return;
+    }
+
+    const int numTaps = contributions.numTaps;
+    const int* indices = &contributions.indices.front();
+    const float* weights = &contributions.weights.front();
+
+    for(int d=0; d<dstWidth; ++d, indices+=numTaps, weights+=numTaps, dst+=4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for(int k=0; k<numTaps; ++k)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src + indices[k]*4)));
+        }
+        _mm_storeu_ps(dst, sum);
+    }
+}
+
+#elif defined(OSG_IMAGE_RESAMPLE_NEON)
+
+template<>
+void filterRow(const unsigned char* src, int numComponents, const Contributions& contributions, int dstWidth, float* dst)
+{
+    if (numComponents!=4)
+    {
+        filterRow<unsigned char>(src, numComponents, contributions, dstWidth, dst);
+        return;
+    }
+
+    const int numTaps = contributions.numTaps;
+    const int* indices = &contributions.indices.front();
+    const float* weights = &contributions.weights.front();
+
+    for(int d=0; d<dstWidth; ++d, indices+=numTaps, weights+=numTaps, dst+=4)
+    {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for(int k=0; k<numTaps; ++k)
+        {
+            const unsigned char* texel = src + indices[k]*4;
+            uint32_t components[4] = { texel[0], texel[1], texel[2], texel[3] };
+            sum = vmlaq_n_f32(sum, vcvtq_f32_u32(vld1q_u32(components)), weights[k]);
+        }
+        vst1q_f32(dst, sum);
+    }
+}
+
+template<>
+void filterRow(const float* src, int numComponents, const Contributions& contributions, int dstWidth, float* dst)
+{
+    if (numComponents!=4)
+    {
+        filterRow<float>(src, numComponents, contributions, dstWidth, dst);
+        return;
+    }
+
+    const int numTaps = contributions.numTaps;
+    const int* indices = &contributions.indices.front();
+    const float* weights = &contributions.weights.front();
+
+    for(int d=0; d<dstWidth; ++d, indices+=numTaps, weights+=numTaps, dst+=4)
+    {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for(int k=0; k<numTaps; ++k)
+        {
+            sum = vmlaq_n_f32(sum, vld1q_f32(src + indices[k]*4), weights[k]);
+        }
+        vst1q_f32(dst, sum);
+    }
+}
+
+#endif
+
+// accumulate a weighted row of floats, dst = dst + weight*src.
+void accumulateRow(const float* src, float weight, int num, float* dst)
+{
+    int i = 0;
+#if defined(OSG_IMAGE_RESAMPLE_AVX)
+    __m256 w = _mm256_set1_ps(weight);
+    for(; i+8<=num; i+=8)
+    {
+        _mm256_storeu_ps(dst+i, _mm256_add_ps(_mm256_loadu_ps(dst+i), _mm256_mul_ps(w, _mm256_loadu_ps(src+i))));
+    }
+#elif defined(OSG_IMAGE_RESAMPLE_SSE)
+    __m128 w = _mm_set1_ps(weight);
+    for(; i+4<=num; i+=4)
+    {
+        _mm_storeu_ps(dst+i, _mm_add_ps(_mm_loadu_ps(dst+i), _mm_mul_ps(w, _mm_loadu_ps(src+i))));
+    }
+#elif defined(OSG_IMAGE_RESAMPLE_NEON)
+    for(; i+4<=num; i+=4)
+    {
+        vst1q_f32(dst+i, vmlaq_n_f32(vld1q_f32(dst+i), vld1q_f32(src+i), weight));
+    }
+#endif
+    for(; i<num; ++i) dst[i] += weight*src[i];
+}
+
+// write a row of floats, rounding and clamping to the 8 bit range.
+void storeRow(const float* src, int num, unsigned char* dst)
+{
+    int i = 0;
+#if defined(OSG_IMAGE_RESAMPLE_AVX) || defined(OSG_IMAGE_RESAMPLE_SSE)
+    for(; i+8<=num; i+=8)
+    {
+        // saturating packs clamp to [0,255].
+        __m128i low = _mm_cvtps_epi32(_mm_loadu_ps(src+i));
+        __m128i high = _mm_cvtps_epi32(_mm_loadu_ps(src+i+4));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst+i), _mm_packus_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128()));
+    }
+#elif defined(OSG_IMAGE_RESAMPLE_NEON)
+    float32x4_t half = vdupq_n_f32(0.5f);
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    for(; i+8<=num; i+=8)
+    {
+        uint32x4_t low = vcvtq_u32_f32(vaddq_f32(vmaxq_f32(vld1q_f32(src+i), zero), half));
+        uint32x4_t high = vcvtq_u32_f32(vaddq_f32(vmaxq_f32(vld1q_f32(src+i+4), zero), half));
+        vst1_u8(dst+i, vqmovn_u16(vcombine_u16(vqmovn_u32(low), vqmovn_u32(high))));
+    }
+#endif
+    for(; i<num; ++i) dst[i] = static_cast<unsigned char>(osg::clampBetween(static_cast<int>(floorf(src[i]+0.5f)), 0, 255));
+}
+
+void storeRow(const float* src, int num, float* dst)
+{
+    memcpy(dst, src, num*sizeof(float));
+}
+
+struct ResampleParameters
+{
+    int numComponents;
+    int srcWidth, srcHeight;
+    const unsigned char* srcData;
+    unsigned int srcRowStep;
+    int dstWidth, dstHeight;
+    unsigned char* dstData;
+    unsigned int dstRowStep;
+};
+
+// resample a band of destination rows, filtering the source rows it needs horizontally and then vertically.
+template<typename T>
+void resampleRows(const ResampleParameters& p, const Contributions& horizontal, const Contributions& vertical, int dstBegin, int dstEnd, std::vector<float>& rows, std::vector<float>& accumulator)
+{
+    const int rowSize = p.dstWidth*p.numComponents;
+
+    int srcBegin = p.srcHeight;
+    int srcEnd = 0;
+    for(int d=dstBegin; d<dstEnd; ++d)
+    {
+        for(int k=0; k<vertical.numTaps; ++k)
+        {
+            int index = vertical.indices[d*vertical.numTaps+k];
+            srcBegin = osg::minimum(srcBegin, index);
+            srcEnd = osg::maximum(srcEnd, index+1);
+        }
+    }
+
+    rows.resize((srcEnd-srcBegin)*rowSize);
+    accumulator.resize(rowSize);
+
+    for(int s=srcBegin; s<srcEnd; ++s)
+    {
+        const T* src = reinterpret_cast<const T*>(p.srcData + s*p.srcRowStep);
+        filterRow<T>(src, p.numComponents, horizontal, p.dstWidth, &rows[(s-srcBegin)*rowSize]);
+    }
+
+    for(int d=dstBegin; d<dstEnd; ++d)
+    {
+        const int* indices = &vertical.indices[d*vertical.numTaps];
+        const float* weights = &vertical.weights[d*vertical.numTaps];
+
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        for(int k=0; k<vertical.numTaps; ++k)
+        {
+            if (weights[k]!=0.0f) accumulateRow(&rows[(indices[k]-srcBegin)*rowSize], weights[k], rowSize, &accumulator.front());
+        }
+
+        storeRow(&accumulator.front(), rowSize, reinterpret_cast<T*>(p.dstData + d*p.dstRowStep));
+    }
+}
+
+// halve an image with dimensions that are even, or 1, by averaging 2x2 texels, the common case of mipmap generation.
+void halveRows(const ResampleParameters& p, int dstBegin, int dstEnd, const unsigned char*)
+{
+    const int C = p.numComponents;
+    const int stepS = p.srcWidth>1 ? C : 0;
+    const int rowSize = p.srcWidth*C;
+    std::vector<unsigned short> sums(rowSize);
+
+    for(int d=dstBegin; d<dstEnd; ++d)
+    {
+        const unsigned char* row0 = p.srcData + (d*2)*p.srcRowStep;
+        const unsigned char* row1 = p.srcHeight>1 ? row0 + p.srcRowStep : row0;
+
+        int i = 0;
+#if defined(OSG_IMAGE_RESAMPLE_AVX) || defined(OSG_IMAGE_RESAMPLE_SSE)
+        const __m128i zero = _mm_setzero_si128();
+        for(; i+16<=rowSize; i+=16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0+i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1+i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&sums[i]), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&sums[i+8]), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+        }
+#elif defined(OSG_IMAGE_RESAMPLE_NEON)
+        for(; i+16<=rowSize; i+=16)
+        {
+            uint8x16_t a = vld1q_u8(row0+i);
+            uint8x16_t b = vld1q_u8(row1+i);
+            vst1q_u16(&sums[i], vaddl_u8(vget_low_u8(a), vget_low_u8(b)));
+            vst1q_u16(&sums[i+8], vaddl_u8(vget_high_u8(a), vget_high_u8(b)));
+        }
+#endif
+        for(; i<rowSize; ++i) sums[i] = row0[i]+row1[i];
+
+        unsigned char* dst = p.dstData + d*p.dstRowStep;
+        const unsigned short* sum = &sums.front();
+        for(int s=0; s<p.dstWidth; ++s, sum+=stepS+C, dst+=C)
+        {
+            for(int c=0; c<C; ++c) dst[c] = static_cast<unsigned char>((sum[c]+sum[c+stepS]+2)>>2);
+        }
+    }
+}
+
+void halveRows(const ResampleParameters& p, int dstBegin, int dstEnd, const float*)
+{
+    const int C = p.numComponents;
+    const int stepS = p.srcWidth>1 ? C : 0;
+
+    for(int d=dstBegin; d<dstEnd; ++d)
+    {
+        const float* row0 = reinterpret_cast<const float*>(p.srcData + (d*2)*p.srcRowStep);
+        const float* row1 = p.srcHeight>1 ? reinterpret_cast<const float*>(p.srcData + (d*2+1)*p.srcRowStep) : row0;
+        float* dst = reinterpret_cast<float*>(p.dstData + d*p.dstRowStep);
+
+        for(int s=0; s<p.dstWidth; ++s, row0+=stepS+C, row1+=stepS+C, dst+=C)
+        {
+            for(int c=0; c<C; ++c) dst[c] = (row0[c]+row0[c+stepS]+row1[c]+row1[c+stepS])*0.25f;
+        }
+    }
+}
+
+struct Resampler
+{
+    Resampler(const ResampleParameters& parameters, osg::Image::ResampleFilter filter, bool isFloat):
+        _parameters(parameters),
+        _isFloat(isFloat),
+        _halve(filter==osg::Image::BOX_FILTER &&
+               (parameters.srcWidth==parameters.dstWidth*2 || (parameters.srcWidth==1 && parameters.dstWidth==1)) &&
+               (parameters.srcHeight==parameters.dstHeight*2 || (parameters.srcHeight==1 && parameters.dstHeight==1))),
+        _horizontal(filter, _halve ? 1 : parameters.srcWidth, _halve ? 1 : parameters.dstWidth),
+        _vertical(filter, _halve ? 1 : parameters.srcHeight, _halve ? 1 : parameters.dstHeight) {}
+
+    void resample(int dstBegin, int dstEnd, std::vector<float>& rows, std::vector<float>& accumulator) const
+    {
+        if (_halve)
+        {
+            if (_isFloat) halveRows(_parameters, dstBegin, dstEnd, static_cast<const float*>(0));
+            else halveRows(_parameters, dstBegin, dstEnd, static_cast<const unsigned char*>(0));
+        }
+        else
+        {
+            if (_isFloat) resampleRows<float>(_parameters, _horizontal, _vertical, dstBegin, dstEnd, rows, accumulator);
+            else resampleRows<unsigned char>(_parameters, _horizontal, _vertical, dstBegin, dstEnd, rows, accumulator);
+        }
+    }
+
+    ResampleParameters  _parameters;
+    bool                _isFloat;
+    bool                _halve;
+    Contributions       _horizontal;
+    Contributions       _vertical;
+};
+
+const int s_numRowsPerBand = 16;
+
+struct ResampleBandsOperation : public osg::Operation
+{
+    ResampleBandsOperation(const Resampler& resampler, OpenThreads::Atomic& numBandsTaken, osg::RefBlockCount* blockCount):
+        osg::Operation("ResampleBands", false),
+        _resampler(resampler),
+        _numBandsTaken(numBandsTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        int numRows = _resampler._parameters.dstHeight;
+        std::vector<float> rows, accumulator;
+        for(int band=(++_numBandsTaken)-1; band*s_numRowsPerBand<numRows; band=(++_numBandsTaken)-1)
+        {
+            _resampler.resample(band*s_numRowsPerBand, osg::minimum((band+1)*s_numRowsPerBand, numRows), rows, accumulator);
+        }
+        _blockCount->completed();
+    }
+
+    const Resampler&                    _resampler;
+    OpenThreads::Atomic&                _numBandsTaken;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+
+protected:
+
+    ResampleBandsOperation& operator = (const ResampleBandsOperation&) { return *this; }
+};
+
+void resample(const ResampleParameters& parameters, osg::Image::ResampleFilter filter, bool isFloat)
+{
+    Resampler resampler(parameters, filter, isFloat);
+
+    // small images aren't worth handing to the thread pool.
+    int numBands = (parameters.dstHeight+s_numRowsPerBand-1)/s_numRowsPerBand;
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+    if (numBands<2 || parameters.dstWidth*parameters.dstHeight<=65536 || threadPool->getNumThreads()==0)
+    {
+        std::vector<float> rows, accumulator;
+        resampler.resample(0, parameters.dstHeight, rows, accumulator);
+        return;
+    }
+
+    unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, static_cast<unsigned int>(numBands));
+
+    OpenThreads::Atomic numBandsTaken;
+    osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+    blockCount->reset();
+
+    for(unsigned int i=0; i<numOperations; ++i)
+    {
+        threadPool->add(new ResampleBandsOperation(resampler, numBandsTaken, blockCount.get()));
+    }
+
+    threadPool->runOperationsUntilCompleted(blockCount.get());
+}
+
+}
+
 void Image::UpdateCallback::operator () (osg::StateAttribute* attr, osg::NodeVisitor* nv)
 {
     osg::Texture* texture = attr ? attr->asTexture() : 0;
@@ -494,6 +1036,8 @@ unsigned int Image::computeNumComponents(GLenum pixelFormat)
         case(GL_COMPRESSED_RED_RGTC1_EXT):   return 1;
         case(GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT): return 2;
         case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT): return 2;
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB): return 4;
+        case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB): return 4;
         case(GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG): return 3;
         case(GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG): return 3;
         case(GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG): return 4;
@@ -625,6 +1169,8 @@ unsigned int Image::computePixelSizeInBits(GLenum format,GLenum type)
         case(GL_COMPRESSED_RED_RGTC1_EXT):   return 4;
         case(GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT): return 8;
         case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT): return 8;
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB): return 8;
+        case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB): return 8;
         case(GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG): return 4;
         case(GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG): return 2;
         case(GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG): return 4;
@@ -746,6 +1292,8 @@ unsigned int Image::computeBlockSize(GLenum pixelFormat, GLenum packing)
             break;
         case(GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT):
         case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT):
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB):
+        case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB):
             return osg::maximum(16u,packing); // block size of 16
 
         case(GL_COMPRESSED_RGB8_ETC2):
@@ -805,6 +1353,22 @@ unsigned int Image::computeImageSizeInBytes(int width,int height, int depth, GLe
         height = (height + 3) & ~3;
     }
 
+    // BPTC, ETC1 and ETC2/EAC formats are also stored in 4x4 blocks
+    // GL_COMPRESSED_RGBA_BPTC_UNORM_ARB               0x8E8C
+    // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB         0x8E8D
+    // GL_COMPRESSED_R11_EAC                           0x9270
+    // ...
+    // GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC             0x9279
+    if( pixelFormat == GL_COMPRESSED_RGBA_BPTC_UNORM_ARB ||
+        pixelFormat == GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB ||
+        pixelFormat == GL_ETC1_RGB8_OES ||
+        (pixelFormat >= GL_COMPRESSED_R11_EAC &&
+         pixelFormat <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC) )
+    {
+        width = (width + 3) & ~3;
+        height = (height + 3) & ~3;
+    }
+
     // compute size of one row
     unsigned int size = osg::Image::computeRowWidthInBytes( width, pixelFormat, type, packing );
 
@@ -865,6 +1429,8 @@ bool Image::isCompressed() const
         case(GL_COMPRESSED_RED_RGTC1_EXT):
         case(GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT):
         case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT):
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB):
+        case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB):
         case(GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG):
         case(GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG):
         case(GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG):
@@ -1317,7 +1883,7 @@ void Image::swap(osg::Image& rhs)
 }
 
 
-void Image::scaleImage(int s,int t,int r, GLenum newDataType)
+void Image::scaleImage(int s,int t,int r, GLenum newDataType, ResampleFilter filter)
 {
     if (_s==s && _t==t && _r==r) return;
 
@@ -1333,6 +1899,18 @@ void Image::scaleImage(int s,int t,int r, GLenum newDataType)
         return;
     }
 
+    if (newDataType==_dataType && isResampleSupported(_pixelFormat, _dataType))
+    {
+        unsigned int newRowStep = computeRowWidthInBytes(s,_pixelFormat,_dataType,_packing);
+        unsigned char* newData = new unsigned char [newRowStep*t];
+
+        resampleImageData(_pixelFormat, _dataType, _s, _t, _data, getRowStepInBytes(), s, t, newData, newRowStep, filter);
+
+        // setImage() releases the old data and any mipmaps, which no longer match, and notifies the dimension changed callbacks.
+        setImage(s, t, 1, _internalTextureFormat, _pixelFormat, _dataType, newData, USE_NEW_DELETE, _packing);
+        return;
+    }
+
     unsigned int newTotalSize = computeRowWidthInBytes(s,_pixelFormat,newDataType,_packing)*t;
 
     // need to sort out what size to really use...
@@ -1379,6 +1957,127 @@ void Image::scaleImage(int s,int t,int r, GLenum newDataType)
     dirty();
 }
 
+bool Image::isResampleSupported(GLenum pixelFormat, GLenum type)
+{
+    if (type!=GL_UNSIGNED_BYTE && type!=GL_FLOAT) return false;
+
+    switch(pixelFormat)
+    {
+        case(GL_RED):
+        case(GL_RG):
+        case(GL_RGB):
+        case(GL_RGBA):
+        case(GL_BGR):
+        case(GL_BGRA):
+        case(GL_ALPHA):
+        case(GL_LUMINANCE):
+        case(GL_LUMINANCE_ALPHA):
+        case(GL_INTENSITY):
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Image::resampleImageData(GLenum pixelFormat, GLenum type,
+                              int srcWidth, int srcHeight, const unsigned char* srcData, unsigned int srcRowStepInBytes,
+                              int dstWidth, int dstHeight, unsigned char* dstData, unsigned int dstRowStepInBytes,
+                              ResampleFilter filter)
+{
+    if (!isResampleSupported(pixelFormat, type) || !srcData || !dstData) return false;
+    if (srcWidth<=0 || srcHeight<=0 || dstWidth<=0 || dstHeight<=0) return false;
+
+    ResampleParameters parameters;
+    parameters.numComponents = computeNumComponents(pixelFormat);
+    parameters.srcWidth = srcWidth;
+    parameters.srcHeight = srcHeight;
+    parameters.srcData = srcData;
+    parameters.srcRowStep = srcRowStepInBytes;
+    parameters.dstWidth = dstWidth;
+    parameters.dstHeight = dstHeight;
+    parameters.dstData = dstData;
+    parameters.dstRowStep = dstRowStepInBytes;
+
+    resample(parameters, filter, type==GL_FLOAT);
+    return true;
+}
+
+bool Image::generateMipmaps(ResampleFilter filter)
+{
+    if (_data==NULL || isCompressed())
+    {
+        OSG_WARN << "Error Image::generateMipmaps() did not succeed : cannot generate mipmaps for empty or compressed images."<<std::endl;
+        return false;
+    }
+
+    if (_r!=1)
+    {
+        OSG_WARN << "Error Image::generateMipmaps() did not succeed : mipmap generation of volumes not implemented."<<std::endl;
+        return false;
+    }
+
+    int numLevels = computeNumberOfMipmapLevels(_s, _t);
+
+    // lay out the levels one after another, each row padded to the packing as glTexImage2D expects.
+    MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(int i=0; i<numLevels; ++i)
+    {
+        if (i>0) mipmapOffsets.push_back(totalSize);
+
+        int width = osg::maximum(_s>>i, 1);
+        int height = osg::maximum(_t>>i, 1);
+        totalSize += computeRowWidthInBytes(width, _pixelFormat, _dataType, _packing)*height;
+    }
+
+    unsigned char* newData = new unsigned char [totalSize];
+
+    unsigned int rowStep = computeRowWidthInBytes(_s, _pixelFormat, _dataType, _packing);
+    for(int t=0; t<_t; ++t)
+    {
+        memcpy(newData + t*rowStep, data(0, t), getRowSizeInBytes());
+    }
+
+    bool resampleSupported = isResampleSupported(_pixelFormat, _dataType);
+    for(int i=1; i<numLevels; ++i)
+    {
+        int srcWidth = osg::maximum(_s>>(i-1), 1);
+        int srcHeight = osg::maximum(_t>>(i-1), 1);
+        int dstWidth = osg::maximum(_s>>i, 1);
+        int dstHeight = osg::maximum(_t>>i, 1);
+        unsigned int srcRowStep = computeRowWidthInBytes(srcWidth, _pixelFormat, _dataType, _packing);
+        unsigned int dstRowStep = computeRowWidthInBytes(dstWidth, _pixelFormat, _dataType, _packing);
+        const unsigned char* srcData = newData + (i>1 ? mipmapOffsets[i-2] : 0);
+        unsigned char* dstData = newData + mipmapOffsets[i-1];
+
+        if (resampleSupported)
+        {
+            // each level is filtered from the previous one.
+            resampleImageData(_pixelFormat, _dataType, srcWidth, srcHeight, srcData, srcRowStep, dstWidth, dstHeight, dstData, dstRowStep, filter);
+        }
+        else
+        {
+            PixelStorageModes psm;
+            psm.pack_alignment = _packing;
+            psm.unpack_alignment = _packing;
+
+            GLint status = gluScaleImage(&psm, _pixelFormat, srcWidth, srcHeight, _dataType, srcData, dstWidth, dstHeight, _dataType, dstData);
+            if (status!=0)
+            {
+                delete [] newData;
+
+                OSG_WARN << "Error Image::generateMipmaps() did not succeed : errorString = "<< gluErrorString((GLenum)status) << "." << std::endl;
+                return false;
+            }
+        }
+    }
+
+    setImage(_s, _t, _r, _internalTextureFormat, _pixelFormat, _dataType, newData, USE_NEW_DELETE, _packing);
+    setMipmapLevels(mipmapOffsets);
+
+    return true;
+}
+
 void Image::copySubImage(int s_offset, int t_offset, int r_offset, const osg::Image* source)
 {
     if (!source) return;
@@ -15,11 +15,22 @@
 #include <osg/Geode>
 #include <osg/TriangleIndexFunctor>
 #include <osg/Timer>
+#include <osg/OperationThread>
+#include <osg/ApplicationUsage>
 
 #include <osg/io_utils>
 
+#include <OpenThreads/ScopedLock>
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
 using namespace osg;
 
+static ApplicationUsageProxy KdTree_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_SPLIT_HEURISTIC <mode>","MIDPOINT | SAH - the split heuristic used when building kdtrees, SAH selects the surface area heuristic.");
+static ApplicationUsageProxy KdTree_e1(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_PARALLEL_BUILD_THRESHOLD <num>","Set the number of triangles a geometry must have for its kdtree to be built in parallel, 0 disables parallel builds.");
+
 //#define VERBOSE_OUTPUT
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,17 +40,52 @@ using namespace osg;
 struct BuildKdTree
 {
     BuildKdTree(KdTree& kdTree):
-        _kdTree(kdTree) {}
+        _kdTree(kdTree),
+        _maxNumTrianglesPerSubtree(0) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
+    typedef std::vector< osg::BoundingBox >     BoundingBoxList;
     typedef std::vector< unsigned int >           Indices;
     typedef std::vector< unsigned int >         AxisStack;
 
+    /** Leaf of the top levels of the tree left to be divided by a separate task, into its own node list.*/
+    struct Subtree
+    {
+        Subtree(int ni, const osg::BoundingBox& b, unsigned int l):
+            nodeIndex(ni), bb(b), level(l) {}
+
+        int                     nodeIndex;
+        osg::BoundingBox        bb;
+        unsigned int            level;
+        KdTree::KdNodeList      nodes;
+    };
+
+    typedef std::vector<Subtree> Subtrees;
+
     bool build(KdTree::BuildOptions& options, osg::Geometry* geometry);
 
     void computeDivisions(KdTree::BuildOptions& options);
 
-    int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
+    int divide(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
+
+    void divideSubtree(const KdTree::BuildOptions& options, Subtree& subtree);
+
+    void mergeSubtree(Subtree& subtree);
+
+    bool computeSurfaceAreaHeuristicSplit(int istart, int iend, int& axis, float& split) const;
+
+    void computeLeafBound(KdTree::KdNode& node) const;
+
+    void computeNodeBound(KdTree::KdNodeList& nodes, int nodeIndex) const;
+
+    void refitBounds(KdTree::KdNodeList& nodes, int nodeIndex) const;
+
+    static int addNode(KdTree::KdNodeList& nodes, const KdTree::KdNode& node)
+    {
+        int num = static_cast<int>(nodes.size());
+        nodes.push_back(node);
+        return num;
+    }
 
     KdTree&             _kdTree;
 
@@ -47,6 +93,11 @@ struct BuildKdTree
     AxisStack           _axisStack;
     Indices             _primitiveIndices;
     CenterList          _centers;
+    BoundingBoxList     _primitiveBoundingBoxes;
+
+    // leaves of the top levels with no more than this number of triangles are deferred to subtree tasks, 0 when building serially.
+    unsigned int        _maxNumTrianglesPerSubtree;
+    Subtrees            _subtrees;
 
 protected:
 
@@ -60,7 +111,8 @@ protected:
 struct TriangleIndicesCollector
 {
     TriangleIndicesCollector():
-        _buildKdTree(0)
+        _buildKdTree(0),
+        _storeBoundingBoxes(false)
     {
     }
 
@@ -86,14 +138,48 @@ struct TriangleIndicesCollector
 
         _buildKdTree->_centers.push_back(bb.center());
         _buildKdTree->_primitiveIndices.push_back(i);
+        if (_storeBoundingBoxes) _buildKdTree->_primitiveBoundingBoxes.push_back(bb);
 
     }
 
     BuildKdTree* _buildKdTree;
+    bool         _storeBoundingBoxes;
 
 };
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// DivideSubtreeOperation - divides one of the subtrees deferred by a parallel build
+
+struct DivideSubtreeOperation : public osg::Operation
+{
+    DivideSubtreeOperation(BuildKdTree* buildKdTree, const KdTree::BuildOptions& options, BuildKdTree::Subtree& subtree, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("DivideKdTreeSubtree", false),
+        _buildKdTree(buildKdTree),
+        _options(options),
+        _subtree(subtree),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        _buildKdTree->divideSubtree(_options, _subtree);
+
+        _blockCount->completed();
+    }
+
+    BuildKdTree*                        _buildKdTree;
+    const KdTree::BuildOptions&         _options;
+    BuildKdTree::Subtree&               _subtree;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+
+protected:
+
+    DivideSubtreeOperation& operator = (const DivideSubtreeOperation&) { return *this; }
+};
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // BuildKdTree Implementation
@@ -110,6 +196,8 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     if (vertices->size() <= options._targetNumTrianglesPerLeaf) return false;
 
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
     _bb = geometry->getBoundingBox();
     _kdTree.setVertices(vertices);
 
@@ -131,8 +219,12 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     _kdTree.getTriangles().reserve(estimatedNumTriangles);
 
+    bool useSurfaceAreaHeuristic = (options._splitHeuristic==KdTree::SURFACE_AREA_HEURISTIC);
+    if (useSurfaceAreaHeuristic) _primitiveBoundingBoxes.reserve(estimatedNumTriangles);
+
     osg::TriangleIndexFunctor<TriangleIndicesCollector> collectTriangleIndices;
     collectTriangleIndices._buildKdTree = this;
+    collectTriangleIndices._storeBoundingBoxes = useSurfaceAreaHeuristic;
     geometry->accept(collectTriangleIndices);
 
     _primitiveIndices.reserve(vertices->size());
@@ -142,8 +234,42 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     int nodeNum = _kdTree.addNode(node);
 
+    // for a parallel build only the top levels are divided here, leaving enough subtrees to keep all the pool's threads busy.
+    osg::OperationThreadPool* threadPool = 0;
+    if (options._parallelBuildThreshold>0 && _primitiveIndices.size()>=options._parallelBuildThreshold)
+    {
+        threadPool = osg::OperationThreadPool::instance().get();
+        unsigned int numSubtrees = (threadPool->getNumThreads()+1)*4;
+        _maxNumTrianglesPerSubtree = maximum(static_cast<unsigned int>(_primitiveIndices.size())/numSubtrees, options._targetNumTrianglesPerLeaf+1);
+    }
+
     osg::BoundingBox bb = _bb;
-    nodeNum = divide(options, bb, nodeNum, 0);
+    nodeNum = divide(options, _kdTree.getNodes(), bb, nodeNum, 0);
+
+    if (!_subtrees.empty())
+    {
+        osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(_subtrees.size());
+        blockCount->reset();
+
+        for(Subtrees::iterator itr = _subtrees.begin();
+            itr != _subtrees.end();
+            ++itr)
+        {
+            threadPool->add(new DivideSubtreeOperation(this, options, *itr, blockCount.get()));
+        }
+
+        threadPool->runOperationsUntilCompleted(blockCount.get());
+
+        // merge in the order the subtrees were deferred so the layout of the nodes doesn't depend on the thread scheduling.
+        for(Subtrees::iterator itr = _subtrees.begin();
+            itr != _subtrees.end();
+            ++itr)
+        {
+            mergeSubtree(*itr);
+        }
+
+        refitBounds(_kdTree.getNodes(), nodeNum);
+    }
 
     // now reorder the triangle list so that it's in order as per the primitiveIndex list.
     KdTree::TriangleList triangleList(_kdTree.getTriangles().size());
@@ -163,6 +289,22 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 //    OSG_NOTICE<<"_kdNodes.size()="<<k_kdNodes.size()<<"  estimated size = "<<estimatedSize<<std::endl;
 //    OSG_NOTICE<<"_kdLeaves.size()="<<_kdLeaves.size()<<"  estimated size = "<<estimatedSize<<std::endl<<std::endl;
 
+    if (options._statsCallback.valid())
+    {
+        KdTree::BuildStats stats;
+        stats._numTriangles = _kdTree.getTriangles().size();
+        stats._numNodes = _kdTree.getNodes().size();
+        for(KdTree::KdNodeList::const_iterator itr = _kdTree.getNodes().begin();
+            itr != _kdTree.getNodes().end();
+            ++itr)
+        {
+            if (itr->first<0) ++stats._numLeaves;
+        }
+        stats._numTasks = _subtrees.size();
+        stats._buildTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+        options._statsCallback->built(_kdTree, stats);
+    }
 
     return !_kdTree.getNodes().empty();
 }
@@ -203,44 +345,46 @@ void BuildKdTree::computeDivisions(KdTree::BuildOptions& options)
 #endif
 }
 
-int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level)
+int BuildKdTree::divide(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, osg::BoundingBox& bb, int nodeIndex, unsigned int level)
 {
-    KdTree::KdNode& node = _kdTree.getNode(nodeIndex);
+    KdTree::KdNode& node = nodes[nodeIndex];
 
     bool needToDivide = level < _axisStack.size() &&
                         (node.first<0 && static_cast<unsigned int>(node.second)>options._targetNumTrianglesPerLeaf);
 
-    if (!needToDivide)
+    // bounds of the top levels of a parallel build are computed once the deferred subtrees have been merged.
+    bool dividingTopLevels = _maxNumTrianglesPerSubtree>0 && &nodes==&_kdTree.getNodes();
+
+    if (needToDivide && dividingTopLevels && static_cast<unsigned int>(node.second)<=_maxNumTrianglesPerSubtree)
     {
-        if (node.first<0)
+        _subtrees.push_back(Subtree(nodeIndex, bb, level));
+        return nodeIndex;
+    }
+
+    int axis = 0;
+    float mid = 0.0f;
+
+    if (needToDivide)
+    {
+        if (options._splitHeuristic==KdTree::SURFACE_AREA_HEURISTIC)
         {
+            // triangles with coincident centers can't be separated so are left in a single leaf.
             int istart = -node.first-1;
-            int iend = istart+node.second-1;
+            needToDivide = computeSurfaceAreaHeuristicSplit(istart, istart+node.second-1, axis, mid);
+        }
+        else
+        {
+            axis = _axisStack[level];
+            mid = (bb._min[axis]+bb._max[axis])*0.5f;
+        }
+    }
 
+    if (!needToDivide)
+    {
+        if (node.first<0)
+        {
             // leaf is done, now compute bound on it.
-            node.bb.init();
-            for(int i=istart; i<=iend; ++i)
-            {
-                const KdTree::Triangle& tri = _kdTree.getTriangle(_primitiveIndices[i]);
-                const osg::Vec3& v0 = (*_kdTree.getVertices())[tri.p0];
-                const osg::Vec3& v1 = (*_kdTree.getVertices())[tri.p1];
-                const osg::Vec3& v2 = (*_kdTree.getVertices())[tri.p2];
-                node.bb.expandBy(v0);
-                node.bb.expandBy(v1);
-                node.bb.expandBy(v2);
-
-            }
-
-            if (node.bb.valid())
-            {
-                float epsilon = 1e-6f;
-                node.bb._min.x() -= epsilon;
-                node.bb._min.y() -= epsilon;
-                node.bb._min.z() -= epsilon;
-                node.bb._max.x() += epsilon;
-                node.bb._max.y() += epsilon;
-                node.bb._max.z() += epsilon;
-            }
+            computeLeafBound(node);
 
 #ifdef VERBOSE_OUTPUT
             if (!node.bb.valid())
@@ -260,8 +404,6 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
     }
 
-    int axis = _axisStack[level];
-
 #ifdef VERBOSE_OUTPUT
     OSG_NOTICE<<"divide("<<nodeIndex<<", "<<level<< "), axis="<<axis<<std::endl;
 #endif
@@ -275,11 +417,6 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
         //OSG_NOTICE<<"  divide leaf"<<std::endl;
 
-        float original_min = bb._min[axis];
-        float original_max = bb._max[axis];
-
-        float mid = (original_min+original_max)*0.5f;
-
         int originalLeftChildIndex = 0;
         int originalRightChildIndex = 0;
         bool insitueDivision = false;
@@ -352,8 +489,8 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
             }
             else
             {
-                originalLeftChildIndex = _kdTree.addNode(leftLeaf);
-                originalRightChildIndex = _kdTree.addNode(rightLeaf);
+                originalLeftChildIndex = addNode(nodes, leftLeaf);
+                originalRightChildIndex = addNode(nodes, rightLeaf);
             }
         }
 
@@ -362,7 +499,7 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
         bb._max[axis] = mid;
 
         //OSG_NOTICE<<"  divide leftLeaf "<<kdTree.getNode(nodeNum).first<<std::endl;
-        int leftChildIndex = originalLeftChildIndex!=0 ? divide(options, bb, originalLeftChildIndex, level+1) : 0;
+        int leftChildIndex = originalLeftChildIndex!=0 ? divide(options, nodes, bb, originalLeftChildIndex, level+1) : 0;
 
         bb._max[axis] = restore;
 
@@ -370,7 +507,7 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
         bb._min[axis] = mid;
 
         //OSG_NOTICE<<"  divide rightLeaf "<<kdTree.getNode(nodeNum).second<<std::endl;
-        int rightChildIndex = originalRightChildIndex!=0 ? divide(options, bb, originalRightChildIndex, level+1) : 0;
+        int rightChildIndex = originalRightChildIndex!=0 ? divide(options, nodes, bb, originalRightChildIndex, level+1) : 0;
 
         bb._min[axis] = restore;
 
@@ -379,37 +516,14 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
         {
             // take a second reference to node we are working on as the std::vector<> resize could
             // have invalidate the previous node ref.
-            KdTree::KdNode& newNodeRef = _kdTree.getNode(nodeIndex);
+            KdTree::KdNode& newNodeRef = nodes[nodeIndex];
 
             newNodeRef.first = leftChildIndex;
             newNodeRef.second = rightChildIndex;
 
             insitueDivision = true;
 
-            newNodeRef.bb.init();
-            if (leftChildIndex!=0) newNodeRef.bb.expandBy(_kdTree.getNode(leftChildIndex).bb);
-            if (rightChildIndex!=0) newNodeRef.bb.expandBy(_kdTree.getNode(rightChildIndex).bb);
-
-            if (!newNodeRef.bb.valid())
-            {
-                OSG_NOTICE<<"leftChildIndex="<<leftChildIndex<<" && originalLeftChildIndex="<<originalLeftChildIndex<<std::endl;
-                OSG_NOTICE<<"rightChildIndex="<<rightChildIndex<<" && originalRightChildIndex="<<originalRightChildIndex<<std::endl;
-
-                OSG_NOTICE<<"Invalid BB leftChildIndex="<<leftChildIndex<<", "<<rightChildIndex<<std::endl;
-                OSG_NOTICE<<"  bb._min ("<<newNodeRef.bb._min<<")"<<std::endl;
-                OSG_NOTICE<<"  bb._max ("<<newNodeRef.bb._max<<")"<<std::endl;
-
-                if (leftChildIndex!=0)
-                {
-                    OSG_NOTICE<<"  getNode(leftChildIndex).bb min = "<<_kdTree.getNode(leftChildIndex).bb._min<<std::endl;
-                    OSG_NOTICE<<"                                 max = "<<_kdTree.getNode(leftChildIndex).bb._max<<std::endl;
-                }
-                if (rightChildIndex!=0)
-                {
-                    OSG_NOTICE<<"  getNode(rightChildIndex).bb min = "<<_kdTree.getNode(rightChildIndex).bb._min<<std::endl;
-                    OSG_NOTICE<<"                              max = "<<_kdTree.getNode(rightChildIndex).bb._max<<std::endl;
-                }
-            }
+            if (!dividingTopLevels) computeNodeBound(nodes, nodeIndex);
         }
     }
     else
@@ -421,6 +535,203 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
 }
 
+void BuildKdTree::computeLeafBound(KdTree::KdNode& node) const
+{
+    int istart = -node.first-1;
+    int iend = istart+node.second-1;
+
+    node.bb.init();
+    for(int i=istart; i<=iend; ++i)
+    {
+        const KdTree::Triangle& tri = _kdTree.getTriangle(_primitiveIndices[i]);
+        const osg::Vec3& v0 = (*_kdTree.getVertices())[tri.p0];
+        const osg::Vec3& v1 = (*_kdTree.getVertices())[tri.p1];
+        const osg::Vec3& v2 = (*_kdTree.getVertices())[tri.p2];
+        node.bb.expandBy(v0);
+        node.bb.expandBy(v1);
+        node.bb.expandBy(v2);
+
+    }
+
+    if (node.bb.valid())
+    {
+        float epsilon = 1e-6f;
+        node.bb._min.x() -= epsilon;
+        node.bb._min.y() -= epsilon;
+        node.bb._min.z() -= epsilon;
+        node.bb._max.x() += epsilon;
+        node.bb._max.y() += epsilon;
+        node.bb._max.z() += epsilon;
+    }
+}
+
+void BuildKdTree::computeNodeBound(KdTree::KdNodeList& nodes, int nodeIndex) const
+{
+    KdTree::KdNode& node = nodes[nodeIndex];
+    int leftChildIndex = node.first;
+    int rightChildIndex = node.second;
+
+    node.bb.init();
+    if (leftChildIndex!=0) node.bb.expandBy(nodes[leftChildIndex].bb);
+    if (rightChildIndex!=0) node.bb.expandBy(nodes[rightChildIndex].bb);
+
+    if (!node.bb.valid())
+    {
+        OSG_NOTICE<<"Invalid BB leftChildIndex="<<leftChildIndex<<", "<<rightChildIndex<<std::endl;
+        OSG_NOTICE<<"  bb._min ("<<node.bb._min<<")"<<std::endl;
+        OSG_NOTICE<<"  bb._max ("<<node.bb._max<<")"<<std::endl;
+
+        if (leftChildIndex!=0)
+        {
+            OSG_NOTICE<<"  getNode(leftChildIndex).bb min = "<<nodes[leftChildIndex].bb._min<<std::endl;
+            OSG_NOTICE<<"                                 max = "<<nodes[leftChildIndex].bb._max<<std::endl;
+        }
+        if (rightChildIndex!=0)
+        {
+            OSG_NOTICE<<"  getNode(rightChildIndex).bb min = "<<nodes[rightChildIndex].bb._min<<std::endl;
+            OSG_NOTICE<<"                              max = "<<nodes[rightChildIndex].bb._max<<std::endl;
+        }
+    }
+}
+
+void BuildKdTree::refitBounds(KdTree::KdNodeList& nodes, int nodeIndex) const
+{
+    const KdTree::KdNode& node = nodes[nodeIndex];
+    if (node.first<0) return;
+
+    if (node.first!=0) refitBounds(nodes, node.first);
+    if (node.second!=0) refitBounds(nodes, node.second);
+
+    computeNodeBound(nodes, nodeIndex);
+}
+
+inline float halfSurfaceArea(const osg::BoundingBox& bb)
+{
+    float dx = bb.xMax()-bb.xMin();
+    float dy = bb.yMax()-bb.yMin();
+    float dz = bb.zMax()-bb.zMin();
+    return dx*dy + dy*dz + dz*dx;
+}
+
+bool BuildKdTree::computeSurfaceAreaHeuristicSplit(int istart, int iend, int& axis, float& split) const
+{
+    const unsigned int numBins = 16;
+
+    osg::BoundingBox centerBound;
+    for(int i=istart; i<=iend; ++i)
+    {
+        centerBound.expandBy(_centers[_primitiveIndices[i]]);
+    }
+
+    osg::Vec3 scale;
+    for(int a=0; a<3; ++a)
+    {
+        float extent = centerBound._max[a]-centerBound._min[a];
+        scale[a] = extent>0.0f ? static_cast<float>(numBins)/extent : 0.0f;
+    }
+
+    // bin the triangles along all three axes in a single pass.
+    osg::BoundingBox binBounds[3][numBins];
+    unsigned int binCounts[3][numBins];
+    for(int a=0; a<3; ++a)
+    {
+        for(unsigned int b=0; b<numBins; ++b) binCounts[a][b] = 0;
+    }
+
+    for(int i=istart; i<=iend; ++i)
+    {
+        unsigned int p = _primitiveIndices[i];
+        const osg::Vec3& center = _centers[p];
+        const osg::BoundingBox& bb = _primitiveBoundingBoxes[p];
+        for(int a=0; a<3; ++a)
+        {
+            unsigned int b = minimum(static_cast<unsigned int>((center[a]-centerBound._min[a])*scale[a]), numBins-1);
+            ++binCounts[a][b];
+            binBounds[a][b].expandBy(bb);
+        }
+    }
+
+    unsigned int numTriangles = (iend-istart)+1;
+    float bestCost = FLT_MAX;
+    bool found = false;
+
+    // cost of splitting between each pair of bins, the surface area of each side weighted by its number of triangles.
+    for(int a=0; a<3; ++a)
+    {
+        if (scale[a]==0.0f) continue;
+
+        float rightCosts[numBins];
+        osg::BoundingBox rightBound;
+        unsigned int rightCount = 0;
+        for(unsigned int b=numBins-1; b>0; --b)
+        {
+            rightBound.expandBy(binBounds[a][b]);
+            rightCount += binCounts[a][b];
+            rightCosts[b-1] = rightCount>0 ? halfSurfaceArea(rightBound)*static_cast<float>(rightCount) : 0.0f;
+        }
+
+        osg::BoundingBox leftBound;
+        unsigned int leftCount = 0;
+        for(unsigned int b=0; b<numBins-1; ++b)
+        {
+            leftBound.expandBy(binBounds[a][b]);
+            leftCount += binCounts[a][b];
+            if (leftCount==0 || leftCount==numTriangles) continue;
+
+            float cost = halfSurfaceArea(leftBound)*static_cast<float>(leftCount) + rightCosts[b];
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                axis = a;
+                split = centerBound._min[a] + static_cast<float>(b+1)/scale[a];
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+void BuildKdTree::divideSubtree(const KdTree::BuildOptions& options, Subtree& subtree)
+{
+    // the subtree's root is placed at index 1 as a child index of 0 denotes an absent child.
+    subtree.nodes.reserve((2*_kdTree.getNode(subtree.nodeIndex).second)/options._targetNumTrianglesPerLeaf+2);
+    subtree.nodes.push_back(KdTree::KdNode());
+    subtree.nodes.push_back(_kdTree.getNode(subtree.nodeIndex));
+
+    osg::BoundingBox bb = subtree.bb;
+    divide(options, subtree.nodes, bb, 1, subtree.level);
+}
+
+inline KdTree::value_type remapSubtreeNodeIndex(KdTree::value_type index, int rootIndex, int offset)
+{
+    if (index==0) return 0;
+    if (index==1) return rootIndex;
+    return index+offset;
+}
+
+void BuildKdTree::mergeSubtree(Subtree& subtree)
+{
+    KdTree::KdNodeList& nodes = _kdTree.getNodes();
+
+    // the subtree's nodes after its root are appended, its root replaces the leaf it was divided from.
+    int offset = static_cast<int>(nodes.size())-2;
+    for(unsigned int i=1; i<subtree.nodes.size(); ++i)
+    {
+        KdTree::KdNode node = subtree.nodes[i];
+        if (node.first>=0)
+        {
+            node.first = remapSubtreeNodeIndex(node.first, subtree.nodeIndex, offset);
+            node.second = remapSubtreeNodeIndex(node.second, subtree.nodeIndex, offset);
+        }
+
+        if (i==1) nodes[subtree.nodeIndex] = node;
+        else nodes.push_back(node);
+    }
+
+    KdTree::KdNodeList().swap(subtree.nodes);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // IntersectKdTree
@@ -738,8 +1049,57 @@ bool IntersectKdTree::intersectAndClip(osg::Vec3& s, osg::Vec3& e, const osg::Bo
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _splitHeuristic(SPLIT_AT_MIDPOINT),
+        _parallelBuildThreshold(0)
 {
+    const char* str = getenv("OSG_KDTREE_SPLIT_HEURISTIC");
+    if (str && (strcmp(str,"SAH")==0 || strcmp(str,"sah")==0))
+    {
+        _splitHeuristic = SURFACE_AREA_HEURISTIC;
+    }
+
+    str = getenv("OSG_KDTREE_PARALLEL_BUILD_THRESHOLD");
+    if (str)
+    {
+        _parallelBuildThreshold = atoi(str);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// KdTree::StatsCollector
+
+void KdTree::StatsCollector::built(const KdTree&, const BuildStats& stats)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    ++_numTreesBuilt;
+    _numTrianglesBuilt += stats._numTriangles;
+    _totalBuildTime += stats._buildTime;
+    if (stats._buildTime>_maximumBuildTime) _maximumBuildTime = stats._buildTime;
+}
+
+void KdTree::StatsCollector::intersected(const KdTree&, unsigned int numIntersections, double queryTime)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    ++_numQueries;
+    _numQueryIntersections += numIntersections;
+    _totalQueryTime += queryTime;
+}
+
+void KdTree::StatsCollector::reset()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    _numTreesBuilt = 0;
+    _numTrianglesBuilt = 0;
+    _totalBuildTime = 0.0;
+    _maximumBuildTime = 0.0;
+    _numQueries = 0;
+    _numQueryIntersections = 0;
+    _totalQueryTime = 0.0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -754,12 +1114,15 @@ KdTree::KdTree(const KdTree& rhs, const osg::CopyOp& copyop):
     Shape(rhs, copyop),
     _vertices(rhs._vertices),
     _kdNodes(rhs._kdNodes),
-    _triangles(rhs._triangles)
+    _triangles(rhs._triangles),
+    _statsCallback(rhs._statsCallback)
 {
 }
 
 bool KdTree::build(BuildOptions& options, osg::Geometry* geometry)
 {
+    _statsCallback = options._statsCallback;
+
     BuildKdTree build(*this);
     return build.build(options, geometry);
 }
@@ -774,6 +1137,8 @@ bool KdTree::intersect(const osg::Vec3d& start, const osg::Vec3d& end, LineSegme
 
     unsigned int numIntersectionsBefore = intersections.size();
 
+    osg::Timer_t startTick = _statsCallback.valid() ? osg::Timer::instance()->tick() : 0;
+
     IntersectKdTree intersector(*_vertices,
                                 _kdNodes,
                                 _triangles,
@@ -782,6 +1147,11 @@ bool KdTree::intersect(const osg::Vec3d& start, const osg::Vec3d& end, LineSegme
 
     intersector.intersect(getNode(0), start, end);
 
+    if (_statsCallback.valid())
+    {
+        _statsCallback->intersected(*this, intersections.size()-numIntersectionsBefore, osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick()));
+    }
+
     return numIntersectionsBefore != intersections.size();
 }
 
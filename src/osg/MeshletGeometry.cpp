@@ -0,0 +1,238 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/MeshletGeometry>
+#include <osg/Camera>
+#include <osg/Polytope>
+#include <osg/State>
+#include <osg/Notify>
+
+using namespace osg;
+
+namespace
+{
+
+// Pass the vertex array to a PrimitiveFunctor or PrimitiveIndexFunctor, as done by Geometry::accept(..).
+template<class F>
+bool setFunctorVertexArray(const Array* vertices, F& functor)
+{
+    if (!vertices || vertices->getNumElements()==0) return false;
+
+    switch(vertices->getType())
+    {
+    case(Array::Vec2ArrayType):
+        functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec2*>(vertices->getDataPointer()));
+        return true;
+    case(Array::Vec3ArrayType):
+        functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec3*>(vertices->getDataPointer()));
+        return true;
+    case(Array::Vec4ArrayType):
+        functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec4*>(vertices->getDataPointer()));
+        return true;
+    case(Array::Vec2dArrayType):
+        functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec2d*>(vertices->getDataPointer()));
+        return true;
+    case(Array::Vec3dArrayType):
+        functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec3d*>(vertices->getDataPointer()));
+        return true;
+    case(Array::Vec4dArrayType):
+        functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec4d*>(vertices->getDataPointer()));
+        return true;
+    default:
+        OSG_WARN<<"Warning: MeshletGeometry::accept() cannot handle Vertex Array type"<<vertices->getType()<<std::endl;
+        return false;
+    }
+}
+
+// Project a simplification error measured from the bound to the screen, in pixels, errorScale converting
+// from model units at unit distance. Errors of zero and of the roots' parents are kept as they are, and
+// the error is infinite when the eye is within the bound so the finest meshlets are drawn there.
+inline float projectError(float error, const BoundingSphere& bound, const Vec3& eye, double errorScale, bool perspective)
+{
+    if (error<=0.0f || error==FLT_MAX) return error;
+    if (!perspective) return static_cast<float>(error*errorScale);
+
+    double distance = (bound.center()-eye).length()-bound.radius();
+    if (distance<=0.0) return FLT_MAX;
+    return static_cast<float>(error*errorScale/distance);
+}
+
+}
+
+MeshletGeometry::MeshletGeometry():
+    _errorThreshold(1.0f),
+    _coneCulling(false)
+{
+    setUseDisplayList(false);
+    setUseVertexBufferObjects(true);
+    setDataVariance(STATIC);
+}
+
+MeshletGeometry::MeshletGeometry(const MeshletGeometry& geometry, const CopyOp& copyop):
+    Geometry(geometry, copyop),
+    _meshlets(geometry._meshlets),
+    _errorThreshold(geometry._errorThreshold),
+    _coneCulling(geometry._coneCulling)
+{
+}
+
+MeshletGeometry::~MeshletGeometry()
+{
+}
+
+unsigned int MeshletGeometry::getNumFinestIndices() const
+{
+    const DrawElementsUInt* elements = getElements();
+    if (!elements) return 0;
+
+    for(Meshlets::const_iterator itr = _meshlets.begin(); itr != _meshlets.end(); ++itr)
+    {
+        if (itr->level!=0) return itr->firstIndex;
+    }
+    return static_cast<unsigned int>(elements->size());
+}
+
+unsigned int MeshletGeometry::select(const Matrix& modelView, const Matrix& projection, double viewportHeight, float lodScale, IndexRanges& ranges) const
+{
+    Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(modelView*projection);
+
+    Vec3 eye = Matrix::inverse(modelView).getTrans();
+
+    // an orthographic projection has no perspective divide, so the errors aren't scaled by distance.
+    bool perspective = projection(3,3)==0.0;
+    double errorScale = 0.5*viewportHeight*projection(1,1);
+    if (lodScale>0.0f) errorScale /= lodScale;
+
+    unsigned int numSelected = 0;
+    for(Meshlets::const_iterator itr = _meshlets.begin(); itr != _meshlets.end(); ++itr)
+    {
+        const Meshlet& meshlet = *itr;
+        if (meshlet.numIndices==0) continue;
+
+        if (projectError(meshlet.parentError, meshlet.parentLodBound, eye, errorScale, perspective)<=_errorThreshold) continue;
+        if (projectError(meshlet.error, meshlet.lodBound, eye, errorScale, perspective)>_errorThreshold) continue;
+
+        if (!frustum.contains(meshlet.bound)) continue;
+
+        if (_coneCulling && meshlet.coneCutoff<1.0f)
+        {
+            Vec3 direction = meshlet.bound.center()-eye;
+            if (direction*meshlet.coneAxis >= meshlet.coneCutoff*direction.length()+meshlet.bound.radius()) continue;
+        }
+
+        ++numSelected;
+
+        if (ranges.size()>=2 && ranges[ranges.size()-2]+ranges[ranges.size()-1]==meshlet.firstIndex)
+        {
+            ranges[ranges.size()-1] += meshlet.numIndices;
+        }
+        else
+        {
+            ranges.push_back(meshlet.firstIndex);
+            ranges.push_back(meshlet.numIndices);
+        }
+    }
+
+    return numSelected;
+}
+
+void MeshletGeometry::drawImplementation(RenderInfo& renderInfo) const
+{
+    if (_containsDeprecatedData)
+    {
+        OSG_WARN<<"MeshletGeometry::drawImplementation() unable to render due to deprecated data, call geometry->fixDeprecatedData();"<<std::endl;
+        return;
+    }
+
+    const DrawElementsUInt* elements = getElements();
+    if (!elements || elements->empty()) return;
+
+    State& state = *renderInfo.getState();
+    unsigned int contextID = state.getContextID();
+
+    const Viewport* viewport = state.getCurrentViewport();
+    const Camera* camera = renderInfo.getCurrentCamera();
+    if (!viewport && camera) viewport = camera->getViewport();
+
+    IndexRanges ranges;
+    if (viewport && !_meshlets.empty())
+    {
+        if (select(state.getModelViewMatrix(), state.getProjectionMatrix(), viewport->height(), camera ? camera->getLODScale() : 1.0f, ranges)==0) return;
+    }
+    else
+    {
+        // without a viewport the errors can't be projected, so fall back to the finest level.
+        ranges.push_back(0);
+        ranges.push_back(_meshlets.empty() ? static_cast<unsigned int>(elements->size()) : getNumFinestIndices());
+    }
+
+    bool checkForGLErrors = state.getCheckForGLErrors()==osg::State::ONCE_PER_ATTRIBUTE;
+    if (checkForGLErrors) state.checkGLErrors("start of MeshletGeometry::drawImplementation()");
+
+    drawVertexArraysImplementation(renderInfo);
+
+    if (checkForGLErrors) state.checkGLErrors("MeshletGeometry::drawImplementation() after vertex arrays setup.");
+
+    bool usingVertexBufferObjects = state.useVertexBufferObject(_supportsVertexBufferObjects && _useVertexBufferObjects);
+    GLBufferObject* ebo = usingVertexBufferObjects ? elements->getOrCreateGLBufferObject(contextID) : 0;
+
+    const GLuint* indices = 0;
+    if (ebo)
+    {
+        state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
+        indices = reinterpret_cast<const GLuint*>(ebo->getOffset(elements->getBufferIndex()));
+    }
+    else
+    {
+        if (usingVertexBufferObjects) state.getCurrentVertexArrayState()->unbindElementBufferObject();
+        indices = &elements->front();
+    }
+
+    for(IndexRanges::const_iterator itr = ranges.begin(); itr != ranges.end(); itr += 2)
+    {
+        glDrawElements(GL_TRIANGLES, *(itr+1), GL_UNSIGNED_INT, indices+(*itr));
+    }
+
+    if (!state.useVertexArrayObject(_useVertexArrayObject) || state.getCurrentVertexArrayState()->getRequiresSetArrays())
+    {
+        // unbind the VBO's if any are used.
+        state.unbindVertexBufferObject();
+        state.unbindElementBufferObject();
+    }
+
+    if (checkForGLErrors) state.checkGLErrors("end of MeshletGeometry::drawImplementation().");
+}
+
+void MeshletGeometry::accept(PrimitiveFunctor& functor) const
+{
+    const DrawElementsUInt* elements = getElements();
+    if (!elements || _meshlets.empty()) { Geometry::accept(functor); return; }
+
+    unsigned int numIndices = getNumFinestIndices();
+    if (numIndices==0 || !setFunctorVertexArray(_vertexArray.get(), functor)) return;
+
+    functor.drawElements(GL_TRIANGLES, numIndices, &elements->front());
+}
+
+void MeshletGeometry::accept(PrimitiveIndexFunctor& functor) const
+{
+    const DrawElementsUInt* elements = getElements();
+    if (!elements || _meshlets.empty()) { Geometry::accept(functor); return; }
+
+    unsigned int numIndices = getNumFinestIndices();
+    if (numIndices==0 || !setFunctorVertexArray(_vertexArray.get(), functor)) return;
+
+    functor.drawElements(GL_TRIANGLES, numIndices, &elements->front());
+}
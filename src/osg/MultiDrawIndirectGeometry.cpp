@@ -0,0 +1,437 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/MultiDrawIndirectGeometry>
+#include <osg/GLExtensions>
+#include <osg/State>
+#include <osg/Notify>
+
+#include <algorithm>
+#include <string.h>
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+    #define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+using namespace osg;
+
+namespace
+{
+
+// Slots of the arrays compared between two geometries, the fixed arrays followed by the texture coordinate and vertex attribute arrays.
+enum FixedArraySlots
+{
+    VERTEX_SLOT,
+    NORMAL_SLOT,
+    COLOR_SLOT,
+    SECONDARY_COLOR_SLOT,
+    FOG_COORD_SLOT,
+    NUM_FIXED_SLOTS
+};
+
+const Array* getArraySlot(const Geometry& geometry, unsigned int slot, unsigned int numTexCoordSlots)
+{
+    switch(slot)
+    {
+        case(VERTEX_SLOT): return geometry.getVertexArray();
+        case(NORMAL_SLOT): return geometry.getNormalArray();
+        case(COLOR_SLOT): return geometry.getColorArray();
+        case(SECONDARY_COLOR_SLOT): return geometry.getSecondaryColorArray();
+        case(FOG_COORD_SLOT): return geometry.getFogCoordArray();
+        default: break;
+    }
+
+    slot -= NUM_FIXED_SLOTS;
+    if (slot<numTexCoordSlots) return geometry.getTexCoordArray(slot);
+    return geometry.getVertexAttribArray(slot-numTexCoordSlots);
+}
+
+void setArraySlot(Geometry& geometry, unsigned int slot, unsigned int numTexCoordSlots, Array* array)
+{
+    switch(slot)
+    {
+        case(VERTEX_SLOT): geometry.setVertexArray(array); return;
+        case(NORMAL_SLOT): geometry.setNormalArray(array); return;
+        case(COLOR_SLOT): geometry.setColorArray(array); return;
+        case(SECONDARY_COLOR_SLOT): geometry.setSecondaryColorArray(array); return;
+        case(FOG_COORD_SLOT): geometry.setFogCoordArray(array); return;
+        default: break;
+    }
+
+    slot -= NUM_FIXED_SLOTS;
+    if (slot<numTexCoordSlots) geometry.setTexCoordArray(slot, array);
+    else geometry.setVertexAttribArray(slot-numTexCoordSlots, array);
+}
+
+unsigned int getNumTexCoordSlots(const Geometry& lhs, const Geometry& rhs)
+{
+    return static_cast<unsigned int>(std::max(lhs.getTexCoordArrayList().size(), rhs.getTexCoordArrayList().size()));
+}
+
+unsigned int getNumArraySlots(const Geometry& lhs, const Geometry& rhs)
+{
+    return NUM_FIXED_SLOTS + getNumTexCoordSlots(lhs, rhs) +
+           static_cast<unsigned int>(std::max(lhs.getVertexAttribArrayList().size(), rhs.getVertexAttribArrayList().size()));
+}
+
+bool isCompatibleArray(const Array* pooled, const Array* source, bool batchEmpty, unsigned int numVertices)
+{
+    if (!source) return batchEmpty || pooled==0;
+    if (!batchEmpty && !pooled) return false;
+
+    if (source->getBinding()!=Array::BIND_PER_VERTEX || source->getNumElements()!=numVertices) return false;
+    if (source->getUserData()!=0 && dynamic_cast<const IndexArray*>(source->getUserData())!=0) return false;
+
+    if (!pooled) return true;
+
+    return pooled->getType()==source->getType() &&
+           pooled->getDataSize()==source->getDataSize() &&
+           pooled->getNormalize()==source->getNormalize() &&
+           pooled->getPreserveDataType()==source->getPreserveDataType();
+}
+
+void appendArray(Array& pooled, const Array& source)
+{
+    unsigned int offset = pooled.getTotalDataSize();
+    pooled.resizeArray(pooled.getNumElements()+source.getNumElements());
+    if (source.getTotalDataSize()>0)
+    {
+        memcpy(static_cast<char*>(const_cast<GLvoid*>(pooled.getDataPointer()))+offset, source.getDataPointer(), source.getTotalDataSize());
+    }
+    pooled.dirty();
+}
+
+bool isListMode(GLenum mode)
+{
+    return mode==GL_POINTS || mode==GL_LINES || mode==GL_TRIANGLES;
+}
+
+}
+
+MultiDrawIndirectGeometry::MultiDrawIndirectGeometry():
+    _drawIDAttributeIndex(6),
+    _commands(new DrawElementsIndirectCommandArray)
+{
+    setUseDisplayList(false);
+    setUseVertexBufferObjects(true);
+    setDataVariance(STATIC);
+
+    _commands->setBufferObject(new DrawIndirectBufferObject);
+}
+
+MultiDrawIndirectGeometry::MultiDrawIndirectGeometry(const MultiDrawIndirectGeometry& geometry, const CopyOp& copyop):
+    Geometry(geometry, copyop),
+    _drawIDAttributeIndex(geometry._drawIDAttributeIndex),
+    _commands(new DrawElementsIndirectCommandArray(*geometry._commands)),
+    _drawFirstVertices(geometry._drawFirstVertices)
+{
+    _commands->setBufferObject(new DrawIndirectBufferObject);
+}
+
+MultiDrawIndirectGeometry::~MultiDrawIndirectGeometry()
+{
+}
+
+void MultiDrawIndirectGeometry::setDrawIDAttributeIndex(unsigned int index)
+{
+    if (!_drawFirstVertices.empty())
+    {
+        OSG_NOTICE<<"Warning: MultiDrawIndirectGeometry::setDrawIDAttributeIndex("<<index<<") ignored as geometries have already been added."<<std::endl;
+        return;
+    }
+
+    _drawIDAttributeIndex = index;
+}
+
+bool MultiDrawIndirectGeometry::isCompatible(const Geometry& geometry) const
+{
+    if (&geometry==this || geometry.containsDeprecatedData()) return false;
+
+    const Array* vertices = geometry.getVertexArray();
+    if (!vertices || vertices->getNumElements()==0) return false;
+
+    // the draw ID's are assigned per vertex to the draw ID attribute, so it mustn't already be in use.
+    if (_drawIDAttributeIndex!=NO_DRAW_ID_ATTRIBUTE && geometry.getVertexAttribArray(_drawIDAttributeIndex)!=0) return false;
+
+    bool batchEmpty = _drawFirstVertices.empty();
+    unsigned int numVertices = vertices->getNumElements();
+    unsigned int numTexCoordSlots = getNumTexCoordSlots(*this, geometry);
+    unsigned int numSlots = getNumArraySlots(*this, geometry);
+    for(unsigned int slot=0; slot<numSlots; ++slot)
+    {
+        if (_drawIDAttributeIndex!=NO_DRAW_ID_ATTRIBUTE && slot==NUM_FIXED_SLOTS+numTexCoordSlots+_drawIDAttributeIndex) continue;
+
+        if (!isCompatibleArray(getArraySlot(*this, slot, numTexCoordSlots), getArraySlot(geometry, slot, numTexCoordSlots), batchEmpty, numVertices)) return false;
+    }
+
+    if (geometry.getNumPrimitiveSets()==0) return false;
+
+    const DrawElementsUInt* elements = getElements();
+    if (!batchEmpty && !elements) return false;
+
+    GLenum mode = batchEmpty ? geometry.getPrimitiveSet(0)->getMode() : elements->getMode();
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (primitiveSet->getMode()!=mode || primitiveSet->getNumInstances()!=0) return false;
+
+        switch(primitiveSet->getType())
+        {
+            case(PrimitiveSet::DrawArraysPrimitiveType):
+            case(PrimitiveSet::DrawArrayLengthsPrimitiveType):
+            case(PrimitiveSet::DrawElementsUBytePrimitiveType):
+            case(PrimitiveSet::DrawElementsUShortPrimitiveType):
+            case(PrimitiveSet::DrawElementsUIntPrimitiveType):
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool MultiDrawIndirectGeometry::addGeometry(const Geometry& geometry)
+{
+    if (!isCompatible(geometry)) return false;
+
+    GLuint drawID = static_cast<GLuint>(_drawFirstVertices.size());
+    unsigned int numVertices = geometry.getVertexArray()->getNumElements();
+    unsigned int baseVertex = drawID==0 ? 0 : _vertexArray->getNumElements();
+
+    // pool the arrays, copying those of the first geometry and appending those of the following geometries.
+    unsigned int numTexCoordSlots = getNumTexCoordSlots(*this, geometry);
+    unsigned int numSlots = getNumArraySlots(*this, geometry);
+    for(unsigned int slot=0; slot<numSlots; ++slot)
+    {
+        if (_drawIDAttributeIndex!=NO_DRAW_ID_ATTRIBUTE && slot==NUM_FIXED_SLOTS+numTexCoordSlots+_drawIDAttributeIndex) continue;
+
+        const Array* source = getArraySlot(geometry, slot, numTexCoordSlots);
+        if (!source) continue;
+
+        if (drawID==0)
+        {
+            Array* pooled = osg::clone(source, CopyOp::DEEP_COPY_ARRAYS);
+            pooled->setVertexBufferObject(0);
+            pooled->setUserData(0);
+            setArraySlot(*this, slot, numTexCoordSlots, pooled);
+        }
+        else
+        {
+            appendArray(*const_cast<Array*>(getArraySlot(*this, slot, numTexCoordSlots)), *source);
+        }
+    }
+
+    if (_drawIDAttributeIndex!=NO_DRAW_ID_ATTRIBUTE)
+    {
+        UIntArray* drawIDs = dynamic_cast<UIntArray*>(getVertexAttribArray(_drawIDAttributeIndex));
+        if (!drawIDs)
+        {
+            drawIDs = new UIntArray;
+            drawIDs->setBinding(Array::BIND_PER_VERTEX);
+            drawIDs->setPreserveDataType(true);
+            setVertexAttribArray(_drawIDAttributeIndex, drawIDs);
+        }
+        drawIDs->resize(baseVertex+numVertices, drawID);
+        drawIDs->dirty();
+    }
+
+    // pool the primitives as indices rebased onto the pooled arrays, with one command per primitive set or array length.
+    if (drawID==0) addPrimitiveSet(new DrawElementsUInt(geometry.getPrimitiveSet(0)->getMode()));
+
+    DrawElementsUInt& elements = *getElements();
+    DrawElementsIndirectCommandArray& commands = *_commands;
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (primitiveSet->getType()==PrimitiveSet::DrawArrayLengthsPrimitiveType)
+        {
+            const DrawArrayLengths* drawArrayLengths = static_cast<const DrawArrayLengths*>(primitiveSet);
+            GLuint vindex = baseVertex+drawArrayLengths->getFirst();
+            for(DrawArrayLengths::const_iterator itr=drawArrayLengths->begin(); itr!=drawArrayLengths->end(); ++itr)
+            {
+                GLuint firstIndex = static_cast<GLuint>(elements.size());
+                for(GLsizei j=0; j<*itr; ++j) elements.push_back(vindex++);
+                if (*itr>0) commands.push_back(DrawElementsIndirectCommand(static_cast<GLuint>(*itr), firstIndex, drawID));
+            }
+        }
+        else
+        {
+            GLuint firstIndex = static_cast<GLuint>(elements.size());
+            unsigned int numIndices = primitiveSet->getNumIndices();
+            for(unsigned int j=0; j<numIndices; ++j) elements.push_back(baseVertex+primitiveSet->index(j));
+            if (numIndices>0) commands.push_back(DrawElementsIndirectCommand(numIndices, firstIndex, drawID));
+        }
+    }
+
+    _drawFirstVertices.push_back(baseVertex);
+
+    elements.dirty();
+    commands.dirty();
+    dirtyBound();
+
+    return true;
+}
+
+unsigned int MultiDrawIndirectGeometry::getDrawID(unsigned int vertexIndex) const
+{
+    DrawFirstVertices::const_iterator itr = std::upper_bound(_drawFirstVertices.begin(), _drawFirstVertices.end(), vertexIndex);
+    return itr==_drawFirstVertices.begin() ? 0 : static_cast<unsigned int>(itr-_drawFirstVertices.begin())-1;
+}
+
+void MultiDrawIndirectGeometry::setDrawEnabled(unsigned int drawID, bool enabled)
+{
+    GLuint instanceCount = enabled ? 1 : 0;
+    bool modified = false;
+    for(DrawElementsIndirectCommandArray::iterator itr=_commands->begin(); itr!=_commands->end(); ++itr)
+    {
+        if (itr->baseInstance==drawID && itr->instanceCount!=instanceCount)
+        {
+            itr->instanceCount = instanceCount;
+            modified = true;
+        }
+    }
+
+    if (modified) _commands->dirty();
+}
+
+bool MultiDrawIndirectGeometry::getDrawEnabled(unsigned int drawID) const
+{
+    for(DrawElementsIndirectCommandArray::const_iterator itr=_commands->begin(); itr!=_commands->end(); ++itr)
+    {
+        if (itr->baseInstance==drawID) return itr->instanceCount!=0;
+    }
+    return false;
+}
+
+void MultiDrawIndirectGeometry::clear()
+{
+    setVertexArray(0);
+    setNormalArray(0);
+    setColorArray(0);
+    setSecondaryColorArray(0);
+    setFogCoordArray(0);
+    setTexCoordArrayList(ArrayList());
+    setVertexAttribArrayList(ArrayList());
+    removePrimitiveSet(0, getNumPrimitiveSets());
+
+    _commands->clear();
+    _commands->dirty();
+    _drawFirstVertices.clear();
+
+    dirtyBound();
+}
+
+void MultiDrawIndirectGeometry::drawImplementation(RenderInfo& renderInfo) const
+{
+    if (_containsDeprecatedData)
+    {
+        OSG_WARN<<"MultiDrawIndirectGeometry::drawImplementation() unable to render due to deprecated data, call geometry->fixDeprecatedData();"<<std::endl;
+        return;
+    }
+
+    const DrawElementsUInt* elements = getElements();
+    if (_commands->empty() || !elements || elements->empty()) return;
+
+    State& state = *renderInfo.getState();
+    unsigned int contextID = state.getContextID();
+
+    bool checkForGLErrors = state.getCheckForGLErrors()==osg::State::ONCE_PER_ATTRIBUTE;
+    if (checkForGLErrors) state.checkGLErrors("start of MultiDrawIndirectGeometry::drawImplementation()");
+
+    drawVertexArraysImplementation(renderInfo);
+
+    if (checkForGLErrors) state.checkGLErrors("MultiDrawIndirectGeometry::drawImplementation() after vertex arrays setup.");
+
+    GLenum mode = elements->getMode();
+    #if defined(OSG_GLES1_AVAILABLE) || defined(OSG_GLES2_AVAILABLE)
+        if (mode==GL_POLYGON) mode = GL_TRIANGLE_FAN;
+        if (mode==GL_QUAD_STRIP) mode = GL_TRIANGLE_STRIP;
+    #endif
+
+    const GLExtensions* extensions = state.get<GLExtensions>();
+    bool usingVertexBufferObjects = state.useVertexBufferObject(_supportsVertexBufferObjects && _useVertexBufferObjects);
+    GLBufferObject* ebo = usingVertexBufferObjects ? elements->getOrCreateGLBufferObject(contextID) : 0;
+    GLBufferObject* dibo = (ebo && extensions->glMultiDrawElementsIndirect) ? _commands->getOrCreateGLBufferObject(contextID) : 0;
+
+    // the command firstIndex's are relative to the start of the elements, so they must be at the start of their buffer object.
+    if (dibo && ebo->getOffset(elements->getBufferIndex())==0)
+    {
+        state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
+
+        if (dibo->isDirty()) dibo->compileBuffer();
+        else dibo->bindBuffer();
+
+        extensions->glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT,
+                                                (const GLvoid*)(dibo->getOffset(_commands->getBufferIndex())),
+                                                static_cast<GLsizei>(_commands->size()), sizeof(DrawElementsIndirectCommand));
+
+        extensions->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        const GLuint* indices = 0;
+        if (ebo)
+        {
+            state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
+            indices = reinterpret_cast<const GLuint*>(ebo->getOffset(elements->getBufferIndex()));
+        }
+        else
+        {
+            if (usingVertexBufferObjects) state.getCurrentVertexArrayState()->unbindElementBufferObject();
+            indices = &elements->front();
+        }
+
+        // as the indices are rebased onto the pooled arrays, runs of adjacent enabled commands of list primitives are drawn at once.
+        bool mergeCommands = isListMode(mode);
+        DrawElementsIndirectCommandArray::const_iterator itr = _commands->begin();
+        while(itr!=_commands->end())
+        {
+            if (itr->instanceCount==0 || itr->count==0) { ++itr; continue; }
+
+            GLuint firstIndex = itr->firstIndex;
+            GLuint count = itr->count;
+            for(++itr;
+                mergeCommands && itr!=_commands->end() && itr->instanceCount!=0 && itr->firstIndex==firstIndex+count;
+                ++itr)
+            {
+                count += itr->count;
+            }
+
+            glDrawElements(mode, count, GL_UNSIGNED_INT, indices+firstIndex);
+        }
+    }
+
+    if (!state.useVertexArrayObject(_useVertexArrayObject) || state.getCurrentVertexArrayState()->getRequiresSetArrays())
+    {
+        // unbind the VBO's if any are used.
+        state.unbindVertexBufferObject();
+        state.unbindElementBufferObject();
+    }
+
+    if (checkForGLErrors) state.checkGLErrors("end of MultiDrawIndirectGeometry::drawImplementation().");
+}
+
+void MultiDrawIndirectGeometry::resizeGLObjectBuffers(unsigned int maxSize)
+{
+    Geometry::resizeGLObjectBuffers(maxSize);
+
+    _commands->resizeGLObjectBuffers(maxSize);
+}
+
+void MultiDrawIndirectGeometry::releaseGLObjects(State* state) const
+{
+    Geometry::releaseGLObjects(state);
+
+    _commands->releaseGLObjects(state);
+}
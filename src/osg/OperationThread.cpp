@@ -15,6 +15,7 @@
 #include <osg/OperationThread>
 #include <osg/GraphicsContext>
 #include <osg/Notify>
+#include <osg/Math>
 
 using namespace osg;
 using namespace OpenThreads;
@@ -458,3 +459,75 @@ void OperationThread::run()
     OSG_INFO<<"exit loop "<<this<<" isRunning()="<<isRunning()<<std::endl;
 
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//  OperationThreadPool
+//
+
+OperationThreadPool::OperationThreadPool(unsigned int numThreads):
+    osg::Referenced(true),
+    _numThreads(numThreads)
+{
+    _operationQueue = new OperationQueue;
+}
+
+OperationThreadPool::~OperationThreadPool()
+{
+    for(Threads::iterator itr = _threads.begin();
+        itr != _threads.end();
+        ++itr)
+    {
+        (*itr)->cancel();
+    }
+}
+
+ref_ptr<OperationThreadPool>& OperationThreadPool::instance()
+{
+    static ref_ptr<OperationThreadPool> s_operationThreadPool = new OperationThreadPool(static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors()-1, 1)));
+    return s_operationThreadPool;
+}
+
+void OperationThreadPool::setNumThreads(unsigned int numThreads)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadsMutex);
+
+    _numThreads = numThreads;
+
+    while(_threads.size()>_numThreads)
+    {
+        _threads.back()->cancel();
+        _threads.pop_back();
+    }
+}
+
+void OperationThreadPool::startThreads()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadsMutex);
+
+    while(_threads.size()<_numThreads)
+    {
+        ref_ptr<OperationThread> thread = new OperationThread;
+        thread->setOperationQueue(_operationQueue.get());
+        thread->startThread();
+        _threads.push_back(thread);
+    }
+}
+
+void OperationThreadPool::add(Operation* operation)
+{
+    startThreads();
+
+    _operationQueue->add(operation);
+}
+
+void OperationThreadPool::runOperationsUntilCompleted(RefBlockCount* blockCount)
+{
+    ref_ptr<Operation> operation;
+    while((operation = _operationQueue->getNextOperation(false)).valid())
+    {
+        (*operation)(0);
+    }
+
+    if (blockCount) blockCount->block();
+}
@@ -0,0 +1,235 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+#include <osg/Polytope>
+
+// the vectorized paths load the spheres directly as groups of four floats so require float bounding spheres.
+#if defined(OSG_USE_FLOAT_BOUNDINGSPHERE)
+    #if defined(__AVX__)
+        #include <immintrin.h>
+        #define OSG_POLYTOPE_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+        #include <emmintrin.h>
+        #define OSG_POLYTOPE_SSE
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define OSG_POLYTOPE_NEON
+    #endif
+#endif
+
+using namespace osg;
+
+const Polytope::ClippingMask Polytope::OUTSIDE_CLIPPING_SET;
+
+namespace
+{
+
+// the planes selected by a mask, converted to float so they can be splatted across the vector registers.
+struct ActivePlanes
+{
+    ActivePlanes(const Polytope::PlaneList& planeList, Polytope::ClippingMask mask):
+        num(0)
+    {
+        Polytope::ClippingMask selector_mask = 0x1;
+        for(Polytope::PlaneList::const_iterator itr=planeList.begin();
+            itr!=planeList.end() && num<32;
+            ++itr)
+        {
+            if (mask&selector_mask)
+            {
+                const Plane::Vec4_type& v = itr->asVec4();
+                nx[num] = static_cast<float>(v[0]);
+                ny[num] = static_cast<float>(v[1]);
+                nz[num] = static_cast<float>(v[2]);
+                w[num] = static_cast<float>(v[3]);
+                bits[num] = selector_mask;
+                planes[num] = &(*itr);
+                ++num;
+            }
+            selector_mask <<= 1;
+        }
+    }
+
+    unsigned int    num;
+    float           nx[32];
+    float           ny[32];
+    float           nz[32];
+    float           w[32];
+    unsigned int    bits[32];
+    const Plane*    planes[32];
+};
+
+inline Polytope::ClippingMask containsSphere(const ActivePlanes& ap, const BoundingSphere& bs)
+{
+    Polytope::ClippingMask resultMask = 0;
+    for(unsigned int j=0; j<ap.num; ++j)
+    {
+        int res = ap.planes[j]->intersect(bs);
+        if (res<0) return Polytope::OUTSIDE_CLIPPING_SET;
+        else if (res==0) resultMask |= ap.bits[j];
+    }
+    return resultMask;
+}
+
+inline unsigned int storeResults(const unsigned int* outside, const unsigned int* masks, unsigned int num, Polytope::ClippingMask* resultMasks)
+{
+    unsigned int numContained = 0;
+    for(unsigned int k=0; k<num; ++k)
+    {
+        if (outside[k]) resultMasks[k] = Polytope::OUTSIDE_CLIPPING_SET;
+        else
+        {
+            resultMasks[k] = masks[k];
+            ++numContained;
+        }
+    }
+    return numContained;
+}
+
+#if defined(OSG_POLYTOPE_AVX) || defined(OSG_POLYTOPE_SSE)
+
+// load four spheres and transpose them to centre x, y, z and radius registers.
+inline void loadSpheres(const BoundingSphere* spheres, __m128& cx, __m128& cy, __m128& cz, __m128& r)
+{
+    const float* ptr = reinterpret_cast<const float*>(spheres);
+    cx = _mm_loadu_ps(ptr);
+    cy = _mm_loadu_ps(ptr+4);
+    cz = _mm_loadu_ps(ptr+8);
+    r = _mm_loadu_ps(ptr+12);
+    _MM_TRANSPOSE4_PS(cx, cy, cz, r);
+}
+
+#endif
+
+#if defined(OSG_POLYTOPE_AVX)
+
+const unsigned int BLOCK_SIZE = 8;
+
+inline unsigned int containsBlock(const ActivePlanes& ap, const BoundingSphere* spheres, Polytope::ClippingMask* resultMasks)
+{
+    __m128 cx0, cy0, cz0, r0, cx1, cy1, cz1, r1;
+    loadSpheres(spheres, cx0, cy0, cz0, r0);
+    loadSpheres(spheres+4, cx1, cy1, cz1, r1);
+
+    __m256 cx = _mm256_insertf128_ps(_mm256_castps128_ps256(cx0), cx1, 1);
+    __m256 cy = _mm256_insertf128_ps(_mm256_castps128_ps256(cy0), cy1, 1);
+    __m256 cz = _mm256_insertf128_ps(_mm256_castps128_ps256(cz0), cz1, 1);
+    __m256 r = _mm256_insertf128_ps(_mm256_castps128_ps256(r0), r1, 1);
+    __m256 negr = _mm256_sub_ps(_mm256_setzero_ps(), r);
+
+    __m256 outside = _mm256_setzero_ps();
+    __m256 masks = _mm256_setzero_ps();
+    for(unsigned int j=0; j<ap.num; ++j)
+    {
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(ap.nx[j])), _mm256_mul_ps(cy, _mm256_set1_ps(ap.ny[j]))),
+                                 _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(ap.nz[j])), _mm256_set1_ps(ap.w[j])));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, negr, _CMP_LT_OQ));
+        masks = _mm256_or_ps(masks, _mm256_and_ps(_mm256_cmp_ps(d, r, _CMP_LE_OQ), _mm256_castsi256_ps(_mm256_set1_epi32(ap.bits[j]))));
+    }
+
+    unsigned int outsideResults[BLOCK_SIZE];
+    unsigned int maskResults[BLOCK_SIZE];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(outsideResults), _mm256_castps_si256(outside));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maskResults), _mm256_castps_si256(masks));
+    return storeResults(outsideResults, maskResults, BLOCK_SIZE, resultMasks);
+}
+
+#elif defined(OSG_POLYTOPE_SSE)
+
+const unsigned int BLOCK_SIZE = 4;
+
+inline unsigned int containsBlock(const ActivePlanes& ap, const BoundingSphere* spheres, Polytope::ClippingMask* resultMasks)
+{
+    __m128 cx, cy, cz, r;
+    loadSpheres(spheres, cx, cy, cz, r);
+    __m128 negr = _mm_sub_ps(_mm_setzero_ps(), r);
+
+    __m128 outside = _mm_setzero_ps();
+    __m128 masks = _mm_setzero_ps();
+    for(unsigned int j=0; j<ap.num; ++j)
+    {
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(ap.nx[j])), _mm_mul_ps(cy, _mm_set1_ps(ap.ny[j]))),
+                              _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(ap.nz[j])), _mm_set1_ps(ap.w[j])));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negr));
+        masks = _mm_or_ps(masks, _mm_and_ps(_mm_cmple_ps(d, r), _mm_castsi128_ps(_mm_set1_epi32(ap.bits[j]))));
+    }
+
+    unsigned int outsideResults[BLOCK_SIZE];
+    unsigned int maskResults[BLOCK_SIZE];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outsideResults), _mm_castps_si128(outside));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maskResults), _mm_castps_si128(masks));
+    return storeResults(outsideResults, maskResults, BLOCK_SIZE, resultMasks);
+}
+
+#elif defined(OSG_POLYTOPE_NEON)
+
+const unsigned int BLOCK_SIZE = 4;
+
+inline unsigned int containsBlock(const ActivePlanes& ap, const BoundingSphere* spheres, Polytope::ClippingMask* resultMasks)
+{
+    // vld4q de-interleaves the spheres into centre x, y, z and radius registers.
+    float32x4x4_t s = vld4q_f32(reinterpret_cast<const float*>(spheres));
+    float32x4_t negr = vnegq_f32(s.val[3]);
+
+    uint32x4_t outside = vdupq_n_u32(0);
+    uint32x4_t masks = vdupq_n_u32(0);
+    for(unsigned int j=0; j<ap.num; ++j)
+    {
+        float32x4_t d = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(ap.w[j]), s.val[0], ap.nx[j]), s.val[1], ap.ny[j]), s.val[2], ap.nz[j]);
+        outside = vorrq_u32(outside, vcltq_f32(d, negr));
+        masks = vorrq_u32(masks, vandq_u32(vcleq_f32(d, s.val[3]), vdupq_n_u32(ap.bits[j])));
+    }
+
+    unsigned int outsideResults[BLOCK_SIZE];
+    unsigned int maskResults[BLOCK_SIZE];
+    vst1q_u32(outsideResults, outside);
+    vst1q_u32(maskResults, masks);
+    return storeResults(outsideResults, maskResults, BLOCK_SIZE, resultMasks);
+}
+
+#endif
+
+}
+
+unsigned int Polytope::contains(const osg::BoundingSphere* spheres, unsigned int numSpheres, ClippingMask* resultMasks) const
+{
+    ClippingMask currentMask = _maskStack.back();
+    if (!currentMask)
+    {
+        for(unsigned int i=0; i<numSpheres; ++i) resultMasks[i] = 0;
+        return numSpheres;
+    }
+
+    ActivePlanes ap(_planeList, currentMask);
+
+    unsigned int numContained = 0;
+    unsigned int i = 0;
+
+#if defined(OSG_POLYTOPE_AVX) || defined(OSG_POLYTOPE_SSE) || defined(OSG_POLYTOPE_NEON)
+    if (sizeof(BoundingSphere)==4*sizeof(float))
+    {
+        for(; i+BLOCK_SIZE<=numSpheres; i+=BLOCK_SIZE)
+        {
+            numContained += containsBlock(ap, spheres+i, resultMasks+i);
+        }
+    }
+#endif
+
+    // remaining spheres, or all of them when no vectorized path is available.
+    for(; i<numSpheres; ++i)
+    {
+        resultMasks[i] = containsSphere(ap, spheres[i]);
+        if (resultMasks[i]!=OUTSIDE_CLIPPING_SET) ++numContained;
+    }
+
+    return numContained;
+}
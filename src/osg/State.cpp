@@ -38,6 +38,7 @@ using namespace std;
 using namespace osg;
 
 static ApplicationUsageProxy State_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_GL_ERROR_CHECKING <type>","ONCE_PER_ATTRIBUTE | ON | on enables fine grained checking,  ONCE_PER_FRAME enables coarse grained checking");
+static ApplicationUsageProxy State_e1(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_INCREMENTAL_STATESET_APPLY <mode>","ON | OFF - only apply the modes and attributes that differ between successively applied StateSets.");
 
 State::State():
     Referenced(true)
@@ -85,6 +86,15 @@ State::State():
         _checkGLErrors = NEVER_CHECK_GL_ERRORS;
     }
 
+    _useIncrementalStateSetApply = false;
+    _appliedStateSetRecordValid = false;
+
+    str = getenv("OSG_INCREMENTAL_STATESET_APPLY");
+    if (str && (strcmp(str,"ON")==0 || strcmp(str,"on")==0))
+    {
+        _useIncrementalStateSetApply = true;
+    }
+
     _currentActiveTextureUnit=0;
     _currentClientActiveTextureUnit=0;
 
@@ -313,12 +323,15 @@ void State::releaseGLObjects()
     }
 
     _textureAttributeMapList.clear();
+    _appliedStateSetRecordValid = false;
 }
 
 void State::reset()
 {
     OSG_NOTICE<<std::endl<<"State::reset() *************************** "<<std::endl;
 
+    _appliedStateSetRecordValid = false;
+
 #if 1
     for(ModeMap::iterator mitr=_modeMap.begin();
         mitr!=_modeMap.end();
@@ -441,6 +454,7 @@ void State::pushStateSet(const StateSet* dstate)
     _stateStateStack.push_back(dstate);
     if (dstate)
     {
+        _appliedStateSetRecordValid = false;
 
         pushModeList(_modeMap,dstate->getModeList());
 
@@ -492,6 +506,7 @@ void State::popStateSet()
 
     if (dstate)
     {
+        _appliedStateSetRecordValid = false;
 
         popModeList(_modeMap,dstate->getModeList());
 
@@ -625,29 +640,56 @@ void State::apply(const StateSet* dstate)
         const StateSet::TextureModeList& ds_textureModeList = dstate->getTextureModeList();
         const StateSet::TextureAttributeList& ds_textureAttributeList = dstate->getTextureAttributeList();
 
-        unsigned int unit;
-        unsigned int unitMax = maximum(static_cast<unsigned int>(ds_textureModeList.size()),static_cast<unsigned int>(ds_textureAttributeList.size()));
-        unitMax = maximum(static_cast<unsigned int>(unitMax),static_cast<unsigned int>(_textureModeMapList.size()));
-        unitMax = maximum(static_cast<unsigned int>(unitMax),static_cast<unsigned int>(_textureAttributeMapList.size()));
-        for(unit=0;unit<unitMax;++unit)
+        // the previously applied StateSet can only be diffed against once the State's texture unit maps are in place.
+        if (!ds_textureModeList.empty()) getOrCreateTextureModeMap(ds_textureModeList.size()-1);
+        if (!ds_textureAttributeList.empty()) getOrCreateTextureAttributeMap(ds_textureAttributeList.size()-1);
+
+        bool applyIncrementally = _useIncrementalStateSetApply && _appliedStateSetRecordValid;
+
+        // any push, pop or external apply made while applying the StateSet invalidates the record again.
+        _appliedStateSetRecordValid = _useIncrementalStateSetApply;
+        _nextAppliedModeList.clear();
+        _nextAppliedAttributeList.clear();
+
+        if (applyIncrementally)
         {
-            if (unit<ds_textureModeList.size()) applyModeListOnTexUnit(unit,getOrCreateTextureModeMap(unit),ds_textureModeList[unit]);
-            else if (unit<_textureModeMapList.size()) applyModeMapOnTexUnit(unit,_textureModeMapList[unit]);
+            applyTextureStateIncrementally(dstate);
+        }
+        else
+        {
+            unsigned int unit;
+            unsigned int unitMax = maximum(static_cast<unsigned int>(ds_textureModeList.size()),static_cast<unsigned int>(ds_textureAttributeList.size()));
+            unitMax = maximum(static_cast<unsigned int>(unitMax),static_cast<unsigned int>(_textureModeMapList.size()));
+            unitMax = maximum(static_cast<unsigned int>(unitMax),static_cast<unsigned int>(_textureAttributeMapList.size()));
+            for(unit=0;unit<unitMax;++unit)
+            {
+                if (unit<ds_textureModeList.size()) applyModeListOnTexUnit(unit,getOrCreateTextureModeMap(unit),ds_textureModeList[unit]);
+                else if (unit<_textureModeMapList.size()) applyModeMapOnTexUnit(unit,_textureModeMapList[unit]);
 
-            if (unit<ds_textureAttributeList.size()) applyAttributeListOnTexUnit(unit,getOrCreateTextureAttributeMap(unit),ds_textureAttributeList[unit]);
-            else if (unit<_textureAttributeMapList.size()) applyAttributeMapOnTexUnit(unit,_textureAttributeMapList[unit]);
+                if (unit<ds_textureAttributeList.size()) applyAttributeListOnTexUnit(unit,getOrCreateTextureAttributeMap(unit),ds_textureAttributeList[unit]);
+                else if (unit<_textureAttributeMapList.size()) applyAttributeMapOnTexUnit(unit,_textureAttributeMapList[unit]);
+            }
         }
 
         const Program::PerContextProgram* previousLastAppliedProgramObject = _lastAppliedProgramObject;
 
-        applyModeList(_modeMap,dstate->getModeList());
+        if (applyIncrementally) applyModeListIncrementally(dstate->getModeList());
+        else applyModeList(_modeMap,dstate->getModeList());
 #if 1
         pushDefineList(_defineMap, dstate->getDefineList());
 #else
         applyDefineList(_defineMap, dstate->getDefineList());
 #endif
 
-        applyAttributeList(_attributeMap,dstate->getAttributeList());
+        if (applyIncrementally) applyAttributeListIncrementally(dstate->getAttributeList());
+        else applyAttributeList(_attributeMap,dstate->getAttributeList());
+
+        if (_appliedStateSetRecordValid)
+        {
+            if (!applyIncrementally) recordAppliedStateSet(dstate);
+            _appliedModeList.swap(_nextAppliedModeList);
+            _appliedAttributeList.swap(_nextAppliedAttributeList);
+        }
 
         if ((_lastAppliedProgramObject!=0) && (previousLastAppliedProgramObject==_lastAppliedProgramObject) && _defineMap.changed)
         {
@@ -702,6 +744,11 @@ void State::apply()
 
     _currentShaderCompositionUniformList.clear();
 
+    // all the changed modes and attributes are about to be applied, leaving nothing for a following incremental apply to restore.
+    _appliedStateSetRecordValid = _useIncrementalStateSetApply;
+    _appliedModeList.clear();
+    _appliedAttributeList.clear();
+
     // apply all texture state and modes
     unsigned int unit;
     unsigned int unitMax = maximum(_textureModeMapList.size(),_textureAttributeMapList.size());
@@ -739,6 +786,207 @@ void State::apply()
     if (_checkGLErrors==ONCE_PER_ATTRIBUTE) checkGLErrors("end of State::apply()");
 }
 
+void State::recordAppliedStateSet(const StateSet* dstate)
+{
+    const StateSet::TextureModeList& ds_textureModeList = dstate->getTextureModeList();
+    for(unsigned int unit=0; unit<ds_textureModeList.size(); ++unit)
+    {
+        ModeMap& modeMap = _textureModeMapList[unit];
+        for(StateSet::ModeList::const_iterator ds_mitr = ds_textureModeList[unit].begin();
+            ds_mitr != ds_textureModeList[unit].end();
+            ++ds_mitr)
+        {
+            _nextAppliedModeList.push_back(AppliedMode(true, unit, ds_mitr->first, &modeMap[ds_mitr->first]));
+        }
+    }
+
+    const StateSet::TextureAttributeList& ds_textureAttributeList = dstate->getTextureAttributeList();
+    for(unsigned int unit=0; unit<ds_textureAttributeList.size(); ++unit)
+    {
+        AttributeMap& attributeMap = _textureAttributeMapList[unit];
+        for(StateSet::AttributeList::const_iterator ds_aitr = ds_textureAttributeList[unit].begin();
+            ds_aitr != ds_textureAttributeList[unit].end();
+            ++ds_aitr)
+        {
+            _nextAppliedAttributeList.push_back(AppliedAttribute(true, unit, ds_aitr->first, &attributeMap[ds_aitr->first]));
+        }
+    }
+
+    for(StateSet::ModeList::const_iterator ds_mitr = dstate->getModeList().begin();
+        ds_mitr != dstate->getModeList().end();
+        ++ds_mitr)
+    {
+        _nextAppliedModeList.push_back(AppliedMode(false, 0, ds_mitr->first, &_modeMap[ds_mitr->first]));
+    }
+
+    for(StateSet::AttributeList::const_iterator ds_aitr = dstate->getAttributeList().begin();
+        ds_aitr != dstate->getAttributeList().end();
+        ++ds_aitr)
+    {
+        _nextAppliedAttributeList.push_back(AppliedAttribute(false, 0, ds_aitr->first, &_attributeMap[ds_aitr->first]));
+    }
+}
+
+// The incremental apply relies on only the modes and attributes set by the previously applied StateSet being marked as changed,
+// as is the case when nothing has been pushed, popped or applied since. Applying the new StateSet's own lists as
+// applyModeList()/applyAttributeList() do for the entries they have in common with the maps, then restoring the previous
+// StateSet's entries that the new one doesn't set, gives the same result as the full merge with the State's maps.
+
+void State::applyTextureStateIncrementally(const StateSet* dstate)
+{
+    const StateSet::TextureModeList& ds_textureModeList = dstate->getTextureModeList();
+    const StateSet::TextureAttributeList& ds_textureAttributeList = dstate->getTextureAttributeList();
+
+    unsigned int unitMax = maximum(ds_textureModeList.size(), ds_textureAttributeList.size());
+    for(unsigned int unit=0; unit<unitMax; ++unit)
+    {
+        if (unit<ds_textureModeList.size())
+        {
+            ModeMap& modeMap = _textureModeMapList[unit];
+            for(StateSet::ModeList::const_iterator ds_mitr = ds_textureModeList[unit].begin();
+                ds_mitr != ds_textureModeList[unit].end();
+                ++ds_mitr)
+            {
+                ModeStack& ms = modeMap[ds_mitr->first];
+                if (!ms.valueVec.empty() && (ms.valueVec.back() & StateAttribute::OVERRIDE) && !(ds_mitr->second & StateAttribute::PROTECTED))
+                {
+                    if (ms.changed)
+                    {
+                        ms.changed = false;
+                        applyModeOnTexUnit(unit,ds_mitr->first,ms.valueVec.back() & StateAttribute::ON,ms);
+                    }
+                }
+                else if (applyModeOnTexUnit(unit,ds_mitr->first,ds_mitr->second & StateAttribute::ON,ms))
+                {
+                    ms.changed = true;
+                }
+                _nextAppliedModeList.push_back(AppliedMode(true, unit, ds_mitr->first, &ms));
+            }
+        }
+
+        if (unit<ds_textureAttributeList.size())
+        {
+            AttributeMap& attributeMap = _textureAttributeMapList[unit];
+            for(StateSet::AttributeList::const_iterator ds_aitr = ds_textureAttributeList[unit].begin();
+                ds_aitr != ds_textureAttributeList[unit].end();
+                ++ds_aitr)
+            {
+                AttributeStack& as = attributeMap[ds_aitr->first];
+                if (!as.attributeVec.empty() && (as.attributeVec.back().second & StateAttribute::OVERRIDE) && !(ds_aitr->second.second & StateAttribute::PROTECTED))
+                {
+                    if (as.changed)
+                    {
+                        as.changed = false;
+                        applyAttributeOnTexUnit(unit,as.attributeVec.back().first,as);
+                    }
+                }
+                else if (applyAttributeOnTexUnit(unit,ds_aitr->second.first.get(),as))
+                {
+                    as.changed = true;
+                }
+                _nextAppliedAttributeList.push_back(AppliedAttribute(true, unit, ds_aitr->first, &as));
+            }
+        }
+    }
+
+    // restore the texture modes and attributes of the previous StateSet that this one doesn't set.
+    for(AppliedModeList::iterator itr = _appliedModeList.begin();
+        itr != _appliedModeList.end();
+        ++itr)
+    {
+        ModeStack& ms = *(itr->modeStack);
+        if (!itr->textureMode || !ms.changed) continue;
+        if (itr->unit<ds_textureModeList.size() && ds_textureModeList[itr->unit].count(itr->mode)!=0) continue;
+
+        ms.changed = false;
+        if (!ms.valueVec.empty()) applyModeOnTexUnit(itr->unit,itr->mode,ms.valueVec.back() & StateAttribute::ON,ms);
+        else applyModeOnTexUnit(itr->unit,itr->mode,ms.global_default_value,ms);
+    }
+
+    for(AppliedAttributeList::iterator itr = _appliedAttributeList.begin();
+        itr != _appliedAttributeList.end();
+        ++itr)
+    {
+        AttributeStack& as = *(itr->attributeStack);
+        if (!itr->textureAttribute || !as.changed) continue;
+        if (itr->unit<ds_textureAttributeList.size() && ds_textureAttributeList[itr->unit].count(itr->typeMember)!=0) continue;
+
+        as.changed = false;
+        if (!as.attributeVec.empty()) applyAttributeOnTexUnit(itr->unit,as.attributeVec.back().first,as);
+        else applyGlobalDefaultAttributeOnTexUnit(itr->unit,as);
+    }
+}
+
+void State::applyModeListIncrementally(const StateSet::ModeList& modeList)
+{
+    for(StateSet::ModeList::const_iterator ds_mitr = modeList.begin();
+        ds_mitr != modeList.end();
+        ++ds_mitr)
+    {
+        ModeStack& ms = _modeMap[ds_mitr->first];
+        if (!ms.valueVec.empty() && (ms.valueVec.back() & StateAttribute::OVERRIDE) && !(ds_mitr->second & StateAttribute::PROTECTED))
+        {
+            if (ms.changed)
+            {
+                ms.changed = false;
+                applyMode(ds_mitr->first,ms.valueVec.back() & StateAttribute::ON,ms);
+            }
+        }
+        else if (applyMode(ds_mitr->first,ds_mitr->second & StateAttribute::ON,ms))
+        {
+            ms.changed = true;
+        }
+        _nextAppliedModeList.push_back(AppliedMode(false, 0, ds_mitr->first, &ms));
+    }
+
+    for(AppliedModeList::iterator itr = _appliedModeList.begin();
+        itr != _appliedModeList.end();
+        ++itr)
+    {
+        ModeStack& ms = *(itr->modeStack);
+        if (itr->textureMode || !ms.changed || modeList.count(itr->mode)!=0) continue;
+
+        ms.changed = false;
+        if (!ms.valueVec.empty()) applyMode(itr->mode,ms.valueVec.back() & StateAttribute::ON,ms);
+        else applyMode(itr->mode,ms.global_default_value,ms);
+    }
+}
+
+void State::applyAttributeListIncrementally(const StateSet::AttributeList& attributeList)
+{
+    for(StateSet::AttributeList::const_iterator ds_aitr = attributeList.begin();
+        ds_aitr != attributeList.end();
+        ++ds_aitr)
+    {
+        AttributeStack& as = _attributeMap[ds_aitr->first];
+        if (!as.attributeVec.empty() && (as.attributeVec.back().second & StateAttribute::OVERRIDE) && !(ds_aitr->second.second & StateAttribute::PROTECTED))
+        {
+            if (as.changed)
+            {
+                as.changed = false;
+                applyAttribute(as.attributeVec.back().first,as);
+            }
+        }
+        else if (applyAttribute(ds_aitr->second.first.get(),as))
+        {
+            as.changed = true;
+        }
+        _nextAppliedAttributeList.push_back(AppliedAttribute(false, 0, ds_aitr->first, &as));
+    }
+
+    for(AppliedAttributeList::iterator itr = _appliedAttributeList.begin();
+        itr != _appliedAttributeList.end();
+        ++itr)
+    {
+        AttributeStack& as = *(itr->attributeStack);
+        if (itr->textureAttribute || !as.changed || attributeList.count(itr->typeMember)!=0) continue;
+
+        as.changed = false;
+        if (!as.attributeVec.empty()) applyAttribute(as.attributeVec.back().first,as);
+        else applyGlobalDefaultAttribute(as);
+    }
+}
+
 void State::applyShaderComposition()
 {
     if (_shaderCompositionEnabled)
@@ -849,6 +1097,7 @@ void State::haveAppliedMode(ModeMap& modeMap,StateAttribute::GLMode mode,StateAt
 
     // will need to disable this mode on next apply so set it to changed.
     ms.changed = true;
+    _appliedStateSetRecordValid = false;
 }
 
 /** mode has been set externally, update state to reflect this setting.*/
@@ -862,6 +1111,7 @@ void State::haveAppliedMode(ModeMap& modeMap,StateAttribute::GLMode mode)
 
     // will need to disable this mode on next apply so set it to changed.
     ms.changed = true;
+    _appliedStateSetRecordValid = false;
 }
 
 /** attribute has been applied externally, update state to reflect this setting.*/
@@ -875,6 +1125,7 @@ void State::haveAppliedAttribute(AttributeMap& attributeMap,const StateAttribute
 
         // will need to update this attribute on next apply so set it to changed.
         as.changed = true;
+        _appliedStateSetRecordValid = false;
     }
 }
 
@@ -889,6 +1140,7 @@ void State::haveAppliedAttribute(AttributeMap& attributeMap,StateAttribute::Type
 
         // will need to update this attribute on next apply so set it to changed.
         as.changed = true;
+        _appliedStateSetRecordValid = false;
     }
 }
 
@@ -922,6 +1174,8 @@ const StateAttribute* State::getLastAppliedAttribute(const AttributeMap& attribu
 
 void State::dirtyAllModes()
 {
+    _appliedStateSetRecordValid = false;
+
     for(ModeMap::iterator mitr=_modeMap.begin();
         mitr!=_modeMap.end();
         ++mitr)
@@ -950,6 +1204,8 @@ void State::dirtyAllModes()
 
 void State::dirtyAllAttributes()
 {
+    _appliedStateSetRecordValid = false;
+
     for(AttributeMap::iterator aitr=_attributeMap.begin();
         aitr!=_attributeMap.end();
         ++aitr)
@@ -14,25 +14,134 @@
 #include <osg/Stats>
 #include <osg/Notify>
 
+#include <OpenThreads/Thread>
+
+#include <iomanip>
+#include <sstream>
+
 using namespace osg;
 
+namespace
+{
+
+struct AttributeKeyRegistry
+{
+    typedef std::map<std::string, Stats::AttributeKey> KeyMap;
+    typedef std::vector<std::string> NameList;
+
+    OpenThreads::Mutex  _mutex;
+    KeyMap              _keys;
+    NameList            _names;
+};
+
+AttributeKeyRegistry& getAttributeKeyRegistry()
+{
+    static AttributeKeyRegistry s_registry;
+    return s_registry;
+}
+
+// initialize the registry before any threads are started.
+struct InitAttributeKeyRegistry
+{
+    InitAttributeKeyRegistry() { getAttributeKeyRegistry(); }
+};
+
+static InitAttributeKeyRegistry s_initAttributeKeyRegistry;
+
+void writeJSONString(std::ostream& out, const std::string& str)
+{
+    out<<'"';
+    for(std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr)
+    {
+        if (*itr=='"' || *itr=='\\') out<<'\\'<<*itr;
+        else if (static_cast<unsigned char>(*itr)<0x20) out<<' ';
+        else out<<*itr;
+    }
+    out<<'"';
+}
+
+void writeTraceThreadName(std::ostream& out, bool& first, unsigned int tid, const std::string& name)
+{
+    if (!first) out<<","<<std::endl;
+    first = false;
+
+    out<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<tid<<",\"args\":{\"name\":";
+    writeJSONString(out, name);
+    out<<"}}";
+}
+
+void writeTraceSlice(std::ostream& out, bool& first, unsigned int tid, const std::string& name, const std::string& category,
+                     unsigned int frameNumber, double beginTime, double endTime)
+{
+    if (!first) out<<","<<std::endl;
+    first = false;
+
+    out<<"{\"name\":";
+    writeJSONString(out, name);
+    out<<",\"cat\":";
+    writeJSONString(out, category);
+    out<<",\"ph\":\"X\",\"pid\":1,\"tid\":"<<tid
+       <<",\"ts\":"<<beginTime*1.0e6<<",\"dur\":"<<(endTime-beginTime)*1.0e6
+       <<",\"args\":{\"frame\":"<<frameNumber<<"}}";
+}
+
+}
+
+Stats::AttributeKey Stats::getAttributeKey(const std::string& attributeName)
+{
+    AttributeKeyRegistry& registry = getAttributeKeyRegistry();
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(registry._mutex);
+
+    AttributeKeyRegistry::KeyMap::iterator itr = registry._keys.find(attributeName);
+    if (itr != registry._keys.end()) return itr->second;
+
+    AttributeKey key = static_cast<AttributeKey>(registry._names.size());
+    registry._names.push_back(attributeName);
+    registry._keys[attributeName] = key;
+    return key;
+}
+
+std::string Stats::getAttributeName(AttributeKey key)
+{
+    AttributeKeyRegistry& registry = getAttributeKeyRegistry();
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(registry._mutex);
+
+    return key<registry._names.size() ? registry._names[key] : std::string();
+}
+
 Stats::Stats(const std::string& name):
-    _name(name)
+    _name(name),
+    _maximumNumberOfEvents(4096)
 {
     allocate(25);
 }
 
 
 Stats::Stats(const std::string& name, unsigned int numberOfFrames):
-    _name(name)
+    _name(name),
+    _maximumNumberOfEvents(4096)
 {
     allocate(numberOfFrames);
 }
 
+Stats::~Stats()
+{
+    for(unsigned int i=0; i<MAXIMUM_NUMBER_OF_WRITERS; ++i)
+    {
+        delete [] _writerBuffers[i]._records;
+    }
+}
+
 void Stats::allocate(unsigned int numberOfFrames)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
 
+    // discard any records pending for the previous allocation.
+    for(unsigned int i=0; i<MAXIMUM_NUMBER_OF_WRITERS; ++i)
+    {
+        _writerBuffers[i]._readIndex.exchange(_writerBuffers[i]._writeIndex);
+    }
+
     _baseFrameNumber = 0;
     _latestFrameNumber  = 0;
     _attributeMapList.clear();
@@ -40,11 +149,155 @@ void Stats::allocate(unsigned int numberOfFrames)
 }
 
 
-bool Stats::setAttribute(unsigned int frameNumber, const std::string& attributeName, double value)
+bool Stats::setAttribute(unsigned int frameNumber, AttributeKey key, double value)
 {
     if (frameNumber<getEarliestFrameNumber()) return false;
 
+    Record record;
+    record.type = ATTRIBUTE_RECORD;
+    record.frameNumber = frameNumber;
+    record.key = key;
+    record.value = value;
+    record.endTime = 0.0;
+    addRecord(record);
+
+    return true;
+}
+
+void Stats::addEvent(AttributeKey key, double beginTime, double endTime)
+{
+    Record record;
+    record.type = EVENT_RECORD;
+    record.frameNumber = _latestFrameNumber;
+    record.key = key;
+    record.value = beginTime;
+    record.endTime = endTime;
+    addRecord(record);
+}
+
+void Stats::setMaximumNumberOfEvents(unsigned int num)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    _maximumNumberOfEvents = num;
+    while(_events.size()>_maximumNumberOfEvents) _events.pop_front();
+}
+
+void Stats::getEvents(EventList& events) const
+{
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    publishNoMutex();
+
+    events = _events;
+}
+
+Stats::WriterBuffer* Stats::getWriterBuffer()
+{
+    // only OpenThreads::Thread's can be identified, so other threads, such as the main thread, return 0 and apply records under the mutex.
+    OpenThreads::Thread* thread = OpenThreads::Thread::CurrentThread();
+    if (!thread) return 0;
+
+    for(unsigned int i=0; i<MAXIMUM_NUMBER_OF_WRITERS; ++i)
+    {
+        if (_writerBuffers[i]._owner.get()==thread) return &_writerBuffers[i];
+    }
+
+    for(unsigned int i=0; i<MAXIMUM_NUMBER_OF_WRITERS; ++i)
+    {
+        WriterBuffer& writerBuffer = _writerBuffers[i];
+        if (writerBuffer._owner.get()==0 && writerBuffer._owner.assign(thread, 0))
+        {
+            // the records are only read once the write index has been advanced, so can be allocated after claiming the buffer.
+            if (!writerBuffer._records) writerBuffer._records = new Record[WRITER_BUFFER_SIZE];
+            return &writerBuffer;
+        }
+    }
+
+    return 0;
+}
+
+void Stats::addRecord(const Record& record)
+{
+    WriterBuffer* writerBuffer = getWriterBuffer();
+    if (writerBuffer)
+    {
+        unsigned int writeIndex = writerBuffer->_writeIndex;
+        if (writeIndex-static_cast<unsigned int>(writerBuffer->_readIndex) >= static_cast<unsigned int>(WRITER_BUFFER_SIZE))
+        {
+            // nothing has read the stats for a while so the buffer is full, publish the pending records to make space.
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            publishNoMutex();
+        }
+
+        writerBuffer->_records[writeIndex % WRITER_BUFFER_SIZE] = record;
+
+        // the atomic increment publishes the record to the reader.
+        ++(writerBuffer->_writeIndex);
+        return;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    applyNoMutex(record, NO_THREAD_INDEX);
+}
+
+void Stats::publishNoMutex() const
+{
+    Stats* stats = const_cast<Stats*>(this);
+    for(unsigned int i=0; i<MAXIMUM_NUMBER_OF_WRITERS; ++i)
+    {
+        WriterBuffer& writerBuffer = stats->_writerBuffers[i];
+        if (static_cast<unsigned int>(writerBuffer._writeIndex)!=static_cast<unsigned int>(writerBuffer._readIndex))
+        {
+            stats->publishNoMutex(writerBuffer, i);
+        }
+    }
+}
+
+void Stats::publishNoMutex(WriterBuffer& writerBuffer, unsigned int threadIndex)
+{
+    unsigned int writeIndex = writerBuffer._writeIndex;
+    unsigned int readIndex = writerBuffer._readIndex;
+    for(; readIndex!=writeIndex; ++readIndex)
+    {
+        applyNoMutex(writerBuffer._records[readIndex % WRITER_BUFFER_SIZE], threadIndex);
+    }
+
+    // release the records back to the writer.
+    writerBuffer._readIndex.exchange(writeIndex);
+}
+
+void Stats::applyNoMutex(const Record& record, unsigned int threadIndex)
+{
+    if (record.key>=_attributeNames.size())
+    {
+        AttributeKeyRegistry& registry = getAttributeKeyRegistry();
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(registry._mutex);
+        _attributeNames = registry._names;
+    }
+
+    if (record.key>=_attributeNames.size()) return;
+
+    if (record.type==ATTRIBUTE_RECORD)
+    {
+        setAttributeNoMutex(record.frameNumber, _attributeNames[record.key], record.value);
+    }
+    else
+    {
+        Event event;
+        event.frameNumber = record.frameNumber;
+        event.key = record.key;
+        event.beginTime = record.value;
+        event.endTime = record.endTime;
+        event.threadIndex = threadIndex;
+        _events.push_back(event);
+
+        while(_events.size()>_maximumNumberOfEvents) _events.pop_front();
+    }
+}
+
+bool Stats::setAttributeNoMutex(unsigned int frameNumber, const std::string& attributeName, double value)
+{
+    if (frameNumber<getEarliestFrameNumber()) return false;
 
     if (frameNumber>_latestFrameNumber)
     {
@@ -105,6 +358,7 @@ bool Stats::getAveragedAttribute(unsigned int startFrameNumber, unsigned int end
     }
 
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    publishNoMutex();
 
     double total = 0.0;
     double numValidSamples = 0.0;
@@ -146,6 +400,7 @@ const Stats::AttributeMap& Stats::getAttributeMapNoMutex(unsigned int frameNumbe
 void Stats::report(std::ostream& out, const char* indent) const
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    publishNoMutex();
 
     if (indent) out<<indent;
     out<<"Stats "<<_name<<std::endl;
@@ -167,6 +422,7 @@ void Stats::report(std::ostream& out, const char* indent) const
 void Stats::report(std::ostream& out, unsigned int frameNumber, const char* indent) const
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    publishNoMutex();
 
     if (indent) out<<indent;
     out<<"Stats "<<_name<<" FrameNumber "<<frameNumber<<std::endl;
@@ -179,3 +435,70 @@ void Stats::report(std::ostream& out, unsigned int frameNumber, const char* inde
         out<<"    "<<itr->first<<"\t"<<itr->second<<std::endl;
     }
 }
+
+void Stats::writeTrace(std::ostream& out, const StatsList& statsList)
+{
+    static const std::string s_beginTimeSuffix(" begin time");
+    static const std::string s_endTimeSuffix(" end time");
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out<<std::fixed<<std::setprecision(3);
+
+    out<<"{\"traceEvents\":["<<std::endl;
+
+    bool first = true;
+    for(unsigned int i=0; i<statsList.size(); ++i)
+    {
+        const Stats* stats = statsList[i];
+        if (!stats) continue;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats->_mutex);
+        stats->publishNoMutex();
+
+        // each Stats has a block of 100 track id's, the first for its frame attributes and the rest for the threads adding events.
+        unsigned int tid = (i+1)*100;
+        std::ostringstream trackName;
+        trackName<<stats->_name<<" "<<i;
+        writeTraceThreadName(out, first, tid, trackName.str());
+
+        for(unsigned int frameNumber = stats->getEarliestFrameNumber(); frameNumber<=stats->getLatestFrameNumber(); ++frameNumber)
+        {
+            const AttributeMap& attributes = stats->getAttributeMapNoMutex(frameNumber);
+            for(AttributeMap::const_iterator itr = attributes.begin(); itr != attributes.end(); ++itr)
+            {
+                const std::string& attributeName = itr->first;
+                if (attributeName.size()<=s_beginTimeSuffix.size() ||
+                    attributeName.compare(attributeName.size()-s_beginTimeSuffix.size(), s_beginTimeSuffix.size(), s_beginTimeSuffix)!=0) continue;
+
+                std::string sliceName(attributeName, 0, attributeName.size()-s_beginTimeSuffix.size());
+                AttributeMap::const_iterator end_itr = attributes.find(sliceName+s_endTimeSuffix);
+                if (end_itr==attributes.end() || end_itr->second<itr->second) continue;
+
+                writeTraceSlice(out, first, tid, sliceName, stats->_name, frameNumber, itr->second, end_itr->second);
+            }
+        }
+
+        std::vector<bool> threadNamed(MAXIMUM_NUMBER_OF_WRITERS+1, false);
+        for(EventList::const_iterator itr = stats->_events.begin(); itr != stats->_events.end(); ++itr)
+        {
+            unsigned int threadIndex = itr->threadIndex==NO_THREAD_INDEX ? static_cast<unsigned int>(MAXIMUM_NUMBER_OF_WRITERS) : itr->threadIndex;
+            unsigned int eventTid = tid+1+threadIndex;
+            if (!threadNamed[threadIndex])
+            {
+                std::ostringstream threadName;
+                threadName<<stats->_name<<" "<<i<<" thread "<<threadIndex;
+                writeTraceThreadName(out, first, eventTid, threadName.str());
+                threadNamed[threadIndex] = true;
+            }
+
+            const std::string& eventName = itr->key<stats->_attributeNames.size() ? stats->_attributeNames[itr->key] : stats->_name;
+            writeTraceSlice(out, first, eventTid, eventName, stats->_name, itr->frameNumber, itr->beginTime, itr->endTime);
+        }
+    }
+
+    out<<std::endl<<"],\"displayTimeUnit\":\"ms\"}"<<std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
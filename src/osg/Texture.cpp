@@ -185,8 +185,8 @@ InternalPixelRelations compressedInternalFormats[] = {
     , { GL_COMPRESSED_SIGNED_RED_RGTC1_EXT     , GL_RED              , GL_COMPRESSED_SIGNED_RED_RGTC1_EXT           }
  // , { GL_COMPRESSED_RG_RGTC2                 , GL_RG               , GL_COMPRESSED_RG_RGTC2                       }
  // , { GL_COMPRESSED_SIGNED_RG_RGTC2          , GL_RG               , GL_COMPRESSED_SIGNED_RG_RGTC2                }
- // , { GL_COMPRESSED_RGBA_BPTC_UNORM          , GL_RGBA             , GL_COMPRESSED_RGBA_BPTC_UNORM                }
- // , { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM    , GL_RGBA             , GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM          }
+    , { GL_COMPRESSED_RGBA_BPTC_UNORM_ARB      , GL_RGBA             , GL_COMPRESSED_RGBA_BPTC_UNORM_ARB            }
+    , { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB, GL_RGBA             , GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB      }
  // , { GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT    , GL_RGB              , GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT          }
  // , { GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT  , GL_RGB              , GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT        }
 
@@ -318,6 +318,9 @@ void Texture::TextureProfile::computeSize()
         case(GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT): numBitsPerTexel = 8; break;
         case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT):        numBitsPerTexel = 8; break;
 
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB):        numBitsPerTexel = 8; break;
+        case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB):  numBitsPerTexel = 8; break;
+
         case(GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG):  numBitsPerTexel = 2; break;
         case(GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG): numBitsPerTexel = 2; break;
         case(GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG):  numBitsPerTexel = 4; break;
@@ -1611,6 +1614,20 @@ void Texture::computeInternalFormatWithImage(const osg::Image& image) const
             }
             break;
 
+        case(USE_BPTC_COMPRESSION):
+            if (extensions->isTextureCompressionBPTCSupported)
+            {
+                switch(image.getPixelFormat())
+                {
+                    case(3):
+                    case(4):
+                    case(GL_RGB):
+                    case(GL_RGBA):  internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM_ARB; break;
+                    default:        internalFormat = image.getInternalTextureFormat(); break;
+                }
+            }
+            break;
+
         default:
             break;
         }
@@ -1773,6 +1790,8 @@ bool Texture::isCompressedInternalFormat(GLint internalFormat)
         case(GL_COMPRESSED_RED_RGTC1_EXT):
         case(GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT):
         case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT):
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB):
+        case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB):
         case(GL_ETC1_RGB8_OES):
         case(GL_COMPRESSED_RGB8_ETC2):
         case(GL_COMPRESSED_SRGB8_ETC2):
@@ -1816,6 +1835,8 @@ void Texture::getCompressedSize(GLenum internalFormat, GLint width, GLint height
         blockSize = 8;
     else if (internalFormat == GL_COMPRESSED_RED_GREEN_RGTC2_EXT || internalFormat == GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT)
         blockSize = 16;
+    else if (internalFormat == GL_COMPRESSED_RGBA_BPTC_UNORM_ARB || internalFormat == GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB)
+        blockSize = 16;
     else if (internalFormat == GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG || internalFormat == GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG)
     {
          blockSize = 8 * 4; // Pixel by pixel block size for 2bpp
@@ -2109,6 +2130,8 @@ void Texture::applyTexImage2D_load(State& state, GLenum target, const Image* ima
             case(GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2):
             case(GL_COMPRESSED_RGBA8_ETC2_EAC):
             case(GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC):
+            case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB):
+            case(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB):
             case GL_COMPRESSED_RGBA: _internalFormat = GL_RGBA; break;
             case GL_COMPRESSED_ALPHA: _internalFormat = GL_ALPHA; break;
             case GL_COMPRESSED_LUMINANCE: _internalFormat = GL_LUMINANCE; break;
@@ -2174,16 +2197,22 @@ void Texture::applyTexImage2D_load(State& state, GLenum target, const Image* ima
         if (!image->getFileName().empty()) { OSG_NOTICE << "Scaling image '"<<image->getFileName()<<"' from ("<<image->s()<<","<<image->t()<<") to ("<<inwidth<<","<<inheight<<")"<<std::endl; }
         else { OSG_NOTICE << "Scaling image from ("<<image->s()<<","<<image->t()<<") to ("<<inwidth<<","<<inheight<<")"<<std::endl; }
 
-        PixelStorageModes psm;
-        psm.pack_alignment = image->getPacking();
-        psm.pack_row_length = image->getRowLength();
-        psm.unpack_alignment = image->getPacking();
-
-        // rescale the image to the correct size.
-        gluScaleImage(&psm, image->getPixelFormat(),
-                        image->s(),image->t(),image->getDataType(),image->data(),
-                        inwidth,inheight,image->getDataType(),
-                        dataPtr);
+        // rescale the image to the correct size, falling back to GLU for the formats the resampler doesn't support.
+        unsigned int newRowStep = osg::Image::computeRowWidthInBytes(inwidth,image->getPixelFormat(),image->getDataType(),image->getPacking());
+        if (!osg::Image::resampleImageData(image->getPixelFormat(), image->getDataType(),
+                                           image->s(), image->t(), image->data(), image->getRowStepInBytes(),
+                                           inwidth, inheight, dataPtr, newRowStep))
+        {
+            PixelStorageModes psm;
+            psm.pack_alignment = image->getPacking();
+            psm.pack_row_length = image->getRowLength();
+            psm.unpack_alignment = image->getPacking();
+
+            gluScaleImage(&psm, image->getPixelFormat(),
+                            image->s(),image->t(),image->getDataType(),image->data(),
+                            inwidth,inheight,image->getDataType(),
+                            dataPtr);
+        }
 
         rowLength = 0;
     }
@@ -2384,7 +2413,37 @@ void Texture::applyTexImage2D_load(State& state, GLenum target, const Image* ima
         }
         else
         {
-            if ( !compressed_image)
+            if ( !compressed_image && osg::Image::isResampleSupported(image->getPixelFormat(), image->getDataType()))
+            {
+                // generate the mipmaps on the CPU, wrapping the data that would otherwise be passed to the driver.
+                osg::ref_ptr<osg::Image> mipmappedImage = new osg::Image;
+                mipmappedImage->setImage(inwidth, inheight, 1, _internalFormat,
+                                         image->getPixelFormat(), image->getDataType(),
+                                         dataPtr, osg::Image::NO_DELETE, image->getPacking(), rowLength);
+                mipmappedImage->generateMipmaps();
+
+                // the generated levels are tightly packed.
+#if !defined(OSG_GLES1_AVAILABLE) && !defined(OSG_GLES2_AVAILABLE)
+                glPixelStorei(GL_UNPACK_ROW_LENGTH,0);
+#endif
+
+                numMipmapLevels = mipmappedImage->getNumMipmapLevels();
+
+                int width  = inwidth;
+                int height = inheight;
+                for( GLsizei k = 0 ; k < numMipmapLevels ;k++)
+                {
+                    glTexImage2D( target, k, _internalFormat,
+                         width, height, _borderWidth,
+                        (GLenum)image->getPixelFormat(),
+                        (GLenum)image->getDataType(),
+                        mipmappedImage->getMipmapData(k));
+
+                    width = osg::maximum(width>>1, 1);
+                    height = osg::maximum(height>>1, 1);
+                }
+            }
+            else if ( !compressed_image)
             {
                 numMipmapLevels = 0;
 
@@ -2520,15 +2579,21 @@ void Texture::applyTexImage2D_subload(State& state, GLenum target, const Image*
         if (!image->getFileName().empty()) { OSG_NOTICE << "Scaling image '"<<image->getFileName()<<"' from ("<<image->s()<<","<<image->t()<<") to ("<<inwidth<<","<<inheight<<")"<<std::endl; }
         else { OSG_NOTICE << "Scaling image from ("<<image->s()<<","<<image->t()<<") to ("<<inwidth<<","<<inheight<<")"<<std::endl; }
 
-        // rescale the image to the correct size.
-        PixelStorageModes psm;
-        psm.pack_alignment = image->getPacking();
-        psm.unpack_alignment = image->getPacking();
-
-        gluScaleImage(&psm, image->getPixelFormat(),
-                      image->s(),image->t(),image->getDataType(),image->data(),
-                      inwidth,inheight,image->getDataType(),
-                      dataPtr);
+        // rescale the image to the correct size, falling back to GLU for the formats the resampler doesn't support.
+        unsigned int newRowStep = osg::Image::computeRowWidthInBytes(inwidth,image->getPixelFormat(),image->getDataType(),image->getPacking());
+        if (!osg::Image::resampleImageData(image->getPixelFormat(), image->getDataType(),
+                                           image->s(), image->t(), image->data(), image->getRowStepInBytes(),
+                                           inwidth, inheight, dataPtr, newRowStep))
+        {
+            PixelStorageModes psm;
+            psm.pack_alignment = image->getPacking();
+            psm.unpack_alignment = image->getPacking();
+
+            gluScaleImage(&psm, image->getPixelFormat(),
+                          image->s(),image->t(),image->getDataType(),image->data(),
+                          inwidth,inheight,image->getDataType(),
+                          dataPtr);
+        }
 
         rowLength = 0;
     }
@@ -115,6 +115,19 @@ void Animation::setWeight (float weight)
 }
 
 bool Animation::update (double time, int priority)
+{
+    double t;
+    bool playing = computeLocalTime(time, t);
+
+    ChannelList::const_iterator chan;
+    for( chan=_channels.begin(); chan!=_channels.end(); ++chan)
+    {
+        (*chan)->update(t, _weight, priority);
+    }
+    return playing;
+}
+
+bool Animation::computeLocalTime (double time, double& localTime)
 {
     if (!_duration) // if not initialized then do it
         computeDuration();
@@ -127,10 +140,7 @@ bool Animation::update (double time, int priority)
     case ONCE:
         if (t > _originalDuration)
         {
-            for (ChannelList::const_iterator chan = _channels.begin();
-                     chan != _channels.end(); ++chan)
-                (*chan)->update(_originalDuration, _weight, priority);
-
+            localTime = _originalDuration;
             return false;
         }
         break;
@@ -158,11 +168,7 @@ bool Animation::update (double time, int priority)
         break;
     }
 
-    ChannelList::const_iterator chan;
-    for( chan=_channels.begin(); chan!=_channels.end(); ++chan)
-    {
-        (*chan)->update(t, _weight, priority);
-    }
+    localTime = t;
     return true;
 }
 
@@ -14,11 +14,396 @@
 
 #include <osgAnimation/BasicAnimationManager>
 #include <osgAnimation/LinkVisitor>
+#include <osg/OperationThread>
+
+#include <algorithm>
+
+namespace osgAnimation
+{
+
+/** The samples of a channel taken at a uniform rate and quantized, so that the channel is
+  * evaluated by interpolating between the two samples around the time rather than by
+  * searching its keyframes. Quaternions are stored in 48 bits as their three smallest
+  * components, the other types in 16 bits per component over the range of the channel.*/
+class BakedChannel
+{
+public:
+    enum Type
+    {
+        NOT_BAKED,
+        QUAT,
+        VEC3,
+        FLOAT,
+        DOUBLE
+    };
+
+    BakedChannel():
+        _type(NOT_BAKED),
+        _startTime(0.0),
+        _samplesPerSecond(0.0),
+        _numSamples(0),
+        _numComponents(0)
+    {
+        for (int i = 0; i < 3; i++)
+            _offset[i] = _scale[i] = 0.0;
+    }
+
+    bool bake(Channel* channel, double sampleRate);
+
+    Channel* getChannel() const { return _channel.get(); }
+    bool isBaked() const { return _type != NOT_BAKED; }
+
+    /// interpolate between the samples around time and update the channel's target.
+    void update(double time, float weight, int priority) const;
+
+protected:
+
+    void quantize(const std::vector<double>& values);
+    double dequantize(unsigned int sample, unsigned int component) const
+    {
+        return _offset[component] + _scale[component] * _samples[sample*_numComponents + component];
+    }
+
+    static void encodeQuat(const osg::Quat& q, unsigned short* bits);
+    static osg::Quat decodeQuat(const unsigned short* bits);
+
+    osg::ref_ptr<Channel>       _channel;
+    Type                        _type;
+    double                      _startTime;
+    double                      _samplesPerSecond;
+    unsigned int                _numSamples;
+    unsigned int                _numComponents;
+    double                      _offset[3];
+    double                      _scale[3];
+    std::vector<unsigned short> _samples;
+};
+
+/** The baked channels of an animation, in the order of the animation's channels.*/
+class BakedAnimation : public osg::Referenced
+{
+public:
+    BakedAnimation(Animation* animation, double sampleRate):
+        _animation(animation)
+    {
+        const ChannelList& channels = animation->getChannels();
+        _channels.resize(channels.size());
+        for (unsigned int i = 0; i < channels.size(); i++)
+            _channels[i].bake(channels[i].get(), sampleRate);
+    }
+
+    /// return false if channels have been added, removed or replaced since the animation was baked.
+    bool isUpToDate() const
+    {
+        const ChannelList& channels = _animation->getChannels();
+        if (channels.size() != _channels.size())
+            return false;
+        for (unsigned int i = 0; i < channels.size(); i++)
+        {
+            if (channels[i].get() != _channels[i].getChannel())
+                return false;
+        }
+        return true;
+    }
+
+    const BakedChannel& getChannel(unsigned int i) const { return _channels[i]; }
+
+protected:
+
+    virtual ~BakedAnimation() {}
+
+    osg::ref_ptr<Animation>     _animation;
+    std::vector<BakedChannel>   _channels;
+};
+
+}
 
 using namespace osgAnimation;
 
+bool BakedChannel::bake(Channel* channel, double sampleRate)
+{
+    _channel = channel;
+    _type = NOT_BAKED;
+    _samples.clear();
+
+    // step channels keep their discontinuities, so they are evaluated from their keyframes.
+    if (dynamic_cast<QuatStepChannel*>(channel) || dynamic_cast<Vec3StepChannel*>(channel) ||
+        dynamic_cast<FloatStepChannel*>(channel) || dynamic_cast<DoubleStepChannel*>(channel))
+        return false;
+
+    const Sampler* sampler = channel->getSampler();
+    if (!sampler || !sampler->getKeyframeContainer() || sampler->getKeyframeContainer()->size() == 0 || sampleRate <= 0.0)
+        return false;
+
+    Target* target = channel->getTarget();
+    Type type = NOT_BAKED;
+    if (dynamic_cast<QuatTarget*>(target)) { type = QUAT; _numComponents = 3; }
+    else if (dynamic_cast<Vec3Target*>(target)) { type = VEC3; _numComponents = 3; }
+    else if (dynamic_cast<FloatTarget*>(target)) { type = FLOAT; _numComponents = 1; }
+    else if (dynamic_cast<DoubleTarget*>(target)) { type = DOUBLE; _numComponents = 1; }
+    if (type == NOT_BAKED)
+        return false;
+
+    _startTime = channel->getStartTime();
+    double duration = channel->getEndTime() - _startTime;
+    _numSamples = duration > 0.0 ? static_cast<unsigned int>(ceil(duration * sampleRate)) + 1 : 1;
+    _samplesPerSecond = duration > 0.0 ? (_numSamples - 1) / duration : 0.0;
+
+    // sample a copy of the channel, so that the target it animates is left untouched.
+    osg::ref_ptr<Channel> copy = channel->clone();
+    Target* copyTarget = copy->getTarget();
+
+    std::vector<double> values;
+    values.reserve(_numSamples * _numComponents);
+    std::vector<osg::Quat> rotations;
+    for (unsigned int i = 0; i < _numSamples; i++)
+    {
+        double time = _samplesPerSecond > 0.0 ? _startTime + i / _samplesPerSecond : _startTime;
+        copyTarget->reset();
+        copy->update(time, 1.0f, 0);
+        switch (type)
+        {
+            case QUAT:
+                rotations.push_back(static_cast<QuatTarget*>(copyTarget)->getValue());
+                break;
+            case VEC3:
+            {
+                const osg::Vec3& v = static_cast<Vec3Target*>(copyTarget)->getValue();
+                values.push_back(v.x());
+                values.push_back(v.y());
+                values.push_back(v.z());
+                break;
+            }
+            case FLOAT:
+                values.push_back(static_cast<FloatTarget*>(copyTarget)->getValue());
+                break;
+            case DOUBLE:
+                values.push_back(static_cast<DoubleTarget*>(copyTarget)->getValue());
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (type == QUAT)
+    {
+        _samples.resize(_numSamples * 3);
+        for (unsigned int i = 0; i < _numSamples; i++)
+            encodeQuat(rotations[i], &_samples[i*3]);
+    }
+    else
+    {
+        quantize(values);
+    }
+
+    _type = type;
+    return true;
+}
+
+void BakedChannel::quantize(const std::vector<double>& values)
+{
+    for (unsigned int c = 0; c < _numComponents; c++)
+    {
+        double minValue = values[c];
+        double maxValue = values[c];
+        for (unsigned int i = c; i < values.size(); i += _numComponents)
+        {
+            minValue = osg::minimum(minValue, values[i]);
+            maxValue = osg::maximum(maxValue, values[i]);
+        }
+        _offset[c] = minValue;
+        _scale[c] = (maxValue - minValue) / 65535.0;
+    }
+
+    _samples.resize(values.size());
+    for (unsigned int i = 0; i < values.size(); i++)
+    {
+        unsigned int c = i % _numComponents;
+        _samples[i] = _scale[c] > 0.0 ? static_cast<unsigned short>(osg::round((values[i] - _offset[c]) / _scale[c])) : 0;
+    }
+}
+
+static const double SQRT1_2 = 0.70710678118654752440;
+
+// the largest component of a unit quaternion is recovered from the other three, which lie within +/- sqrt(1/2),
+// so those are stored in 15 bits each along with the 2 bit index of the largest.
+void BakedChannel::encodeQuat(const osg::Quat& q, unsigned short* bits)
+{
+    double length = q.length();
+    double v[4] = { q.x(), q.y(), q.z(), q.w() };
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (fabs(v[i]) > fabs(v[largest]))
+            largest = i;
+    }
+    double scale = length > 0.0 ? (v[largest] < 0.0 ? -1.0 : 1.0) / length : 1.0;
+
+    unsigned long long packed = largest;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        double normalized = (v[i] * scale + SQRT1_2) / (2.0 * SQRT1_2);
+        packed = (packed << 15) | static_cast<unsigned long long>(osg::clampBetween(osg::round(normalized * 32767.0), 0.0, 32767.0));
+    }
+
+    bits[0] = static_cast<unsigned short>(packed >> 32);
+    bits[1] = static_cast<unsigned short>(packed >> 16);
+    bits[2] = static_cast<unsigned short>(packed);
+}
+
+osg::Quat BakedChannel::decodeQuat(const unsigned short* bits)
+{
+    unsigned long long packed = (static_cast<unsigned long long>(bits[0]) << 32) | (static_cast<unsigned long long>(bits[1]) << 16) | bits[2];
+    int largest = static_cast<int>(packed >> 45);
+
+    double v[4];
+    double sum = 0.0;
+    int shift = 30;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        v[i] = static_cast<double>((packed >> shift) & 0x7fff) / 32767.0 * (2.0 * SQRT1_2) - SQRT1_2;
+        sum += v[i] * v[i];
+        shift -= 15;
+    }
+    v[largest] = sqrt(osg::maximum(0.0, 1.0 - sum));
+    return osg::Quat(v[0], v[1], v[2], v[3]);
+}
+
+void BakedChannel::update(double time, float weight, int priority) const
+{
+    // skip if weight == 0, as TemplateChannel does
+    if (weight < 1e-4)
+        return;
+
+    double position = (time - _startTime) * _samplesPerSecond;
+    unsigned int i0 = 0;
+    double r = 0.0;
+    if (position >= _numSamples - 1)
+    {
+        i0 = _numSamples - 1;
+    }
+    else if (position > 0.0)
+    {
+        i0 = static_cast<unsigned int>(position);
+        r = position - i0;
+    }
+    unsigned int i1 = osg::minimum(i0 + 1, _numSamples - 1);
+
+    Target* target = _channel->getTarget();
+    switch (_type)
+    {
+        case QUAT:
+        {
+            osg::Quat a = decodeQuat(&_samples[i0*3]);
+            osg::Quat b = decodeQuat(&_samples[i1*3]);
+            if (a.asVec4() * b.asVec4() < 0.0)
+                b = -b;
+            osg::Quat q = a * (1.0 - r) + b * r;
+            double length = q.length();
+            if (length > 0.0)
+                q /= length;
+            static_cast<QuatTarget*>(target)->update(weight, q, priority);
+            break;
+        }
+        case VEC3:
+        {
+            osg::Vec3 v(dequantize(i0, 0) * (1.0 - r) + dequantize(i1, 0) * r,
+                        dequantize(i0, 1) * (1.0 - r) + dequantize(i1, 1) * r,
+                        dequantize(i0, 2) * (1.0 - r) + dequantize(i1, 2) * r);
+            static_cast<Vec3Target*>(target)->update(weight, v, priority);
+            break;
+        }
+        case FLOAT:
+            static_cast<FloatTarget*>(target)->update(weight, static_cast<float>(dequantize(i0, 0) * (1.0 - r) + dequantize(i1, 0) * r), priority);
+            break;
+        case DOUBLE:
+            static_cast<DoubleTarget*>(target)->update(weight, dequantize(i0, 0) * (1.0 - r) + dequantize(i1, 0) * r, priority);
+            break;
+        default:
+            break;
+    }
+}
+
+namespace
+{
+
+// a channel to evaluate this frame, along with the time, weight and priority of its animation.
+struct EvaluationEntry
+{
+    EvaluationEntry(Target* t, Channel* c, const BakedChannel* b, double tm, float w, int p):
+        target(t), channel(c), baked(b), time(tm), weight(w), priority(p) {}
+
+    void evaluate() const
+    {
+        if (baked)
+            baked->update(time, weight, priority);
+        else
+            channel->update(time, weight, priority);
+    }
+
+    Target*             target;
+    Channel*            channel;
+    const BakedChannel* baked;
+    double              time;
+    float               weight;
+    int                 priority;
+};
+
+struct LessTarget
+{
+    bool operator() (const EvaluationEntry& lhs, const EvaluationEntry& rhs) const { return lhs.target < rhs.target; }
+};
+
+typedef std::vector<EvaluationEntry> EvaluationEntries;
+
+// the number of targets an operation takes at a time.
+const unsigned int TARGETS_PER_BLOCK = 32;
+
+struct EvaluateTargetsOperation : public osg::Operation
+{
+    EvaluateTargetsOperation(const EvaluationEntries& entries, const std::vector<unsigned int>& targetOffsets, OpenThreads::Atomic& numBlocksTaken, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("EvaluateAnimationTargets", false),
+        _entries(entries),
+        _targetOffsets(targetOffsets),
+        _numBlocksTaken(numBlocksTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        unsigned int numTargets = _targetOffsets.size() - 1;
+        for(unsigned int block = (++_numBlocksTaken)-1; block*TARGETS_PER_BLOCK<numTargets; block = (++_numBlocksTaken)-1)
+        {
+            unsigned int begin = _targetOffsets[block*TARGETS_PER_BLOCK];
+            unsigned int end = _targetOffsets[osg::minimum((block+1)*TARGETS_PER_BLOCK, numTargets)];
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                _entries[i].evaluate();
+            }
+        }
+
+        _blockCount->completed();
+    }
+
+    const EvaluationEntries&            _entries;
+    const std::vector<unsigned int>&    _targetOffsets;
+    OpenThreads::Atomic&                _numBlocksTaken;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+
+protected:
+
+    EvaluateTargetsOperation& operator = (const EvaluateTargetsOperation&) { return *this; }
+};
+
+}
+
 BasicAnimationManager::BasicAnimationManager()
-: _lastUpdate(0.0)
+: _lastUpdate(0.0),
+  _evaluationMode(KEYFRAMES),
+  _bakeSampleRate(30.0)
 {
 }
 
@@ -26,7 +411,9 @@ BasicAnimationManager::BasicAnimationManager(const BasicAnimationManager& b, con
     osg::Object(b, copyop),
     osg::Callback(b, copyop),
     AnimationManagerBase(b,copyop),
-    _lastUpdate(0.0)
+    _lastUpdate(0.0),
+    _evaluationMode(b._evaluationMode),
+    _bakeSampleRate(b._bakeSampleRate)
 {
 }
 
@@ -34,7 +421,9 @@ BasicAnimationManager::BasicAnimationManager(const AnimationManagerBase& b, cons
 :   osg::Object(b, copyop),
     osg::Callback(b, copyop),
     AnimationManagerBase(b,copyop),
-    _lastUpdate(0.0)
+    _lastUpdate(0.0),
+    _evaluationMode(KEYFRAMES),
+    _bakeSampleRate(30.0)
 {
 }
 
@@ -89,6 +478,12 @@ bool BasicAnimationManager::stopAnimation(Animation* pAnimation)
 
 void BasicAnimationManager::update (double time)
 {
+    if (_evaluationMode == BAKED)
+    {
+        updateBaked(time);
+        return;
+    }
+
     _lastUpdate = time; // keep time of last update
 
     // could filtered with an active flag
@@ -126,6 +521,109 @@ void BasicAnimationManager::update (double time)
 }
 
 
+void BasicAnimationManager::updateBaked (double time)
+{
+    _lastUpdate = time; // keep time of last update
+
+    for (TargetSet::iterator it = _targets.begin(); it != _targets.end(); ++it)
+        (*it).get()->reset();
+
+    // gather the channels to evaluate from high priority to low priority, as update() evaluates them.
+    EvaluationEntries entries;
+    for( AnimationLayers::reverse_iterator iterAnim = _animationsPlaying.rbegin(); iterAnim != _animationsPlaying.rend(); ++iterAnim )
+    {
+        std::vector<int> toremove;
+        int priority = iterAnim->first;
+        AnimationList& list = iterAnim->second;
+        for (unsigned int i = 0; i < list.size(); i++)
+        {
+            Animation* animation = list[i].get();
+            double t;
+            if (!animation->computeLocalTime(time, t))
+                toremove.push_back(i);
+
+            const BakedAnimation* baked = getOrCreateBakedAnimation(animation);
+            const ChannelList& channels = animation->getChannels();
+            for (unsigned int c = 0; c < channels.size(); c++)
+            {
+                const BakedChannel& bakedChannel = baked->getChannel(c);
+                entries.push_back(EvaluationEntry(channels[c]->getTarget(), channels[c].get(), bakedChannel.isBaked() ? &bakedChannel : 0, t, animation->getWeight(), priority));
+            }
+        }
+
+        // remove finished animation
+        while (!toremove.empty())
+        {
+            list.erase(list.begin() + toremove.back());
+            toremove.pop_back();
+        }
+    }
+
+    if (entries.empty())
+        return;
+
+    // group the channels by target, keeping their order within each target so the blending is unchanged.
+    std::stable_sort(entries.begin(), entries.end(), LessTarget());
+    std::vector<unsigned int> targetOffsets;
+    targetOffsets.push_back(0);
+    for (unsigned int i = 1; i < entries.size(); i++)
+    {
+        if (entries[i].target != entries[i-1].target)
+            targetOffsets.push_back(i);
+    }
+    targetOffsets.push_back(entries.size());
+
+    unsigned int numTargets = targetOffsets.size() - 1;
+    unsigned int numBlocks = (numTargets + TARGETS_PER_BLOCK - 1) / TARGETS_PER_BLOCK;
+    if (numBlocks < 2)
+    {
+        for (EvaluationEntries::const_iterator itr = entries.begin(); itr != entries.end(); ++itr)
+            itr->evaluate();
+        return;
+    }
+
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+    unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, numBlocks);
+
+    OpenThreads::Atomic numBlocksTaken;
+    osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+    blockCount->reset();
+
+    for(unsigned int i=0; i<numOperations; ++i)
+    {
+        threadPool->add(new EvaluateTargetsOperation(entries, targetOffsets, numBlocksTaken, blockCount.get()));
+    }
+
+    threadPool->runOperationsUntilCompleted(blockCount.get());
+}
+
+BakedAnimation* BasicAnimationManager::getOrCreateBakedAnimation(Animation* animation)
+{
+    osg::ref_ptr<BakedAnimation>& baked = _bakedAnimations[animation];
+    if (!baked.valid() || !baked->isUpToDate())
+        baked = new BakedAnimation(animation, _bakeSampleRate);
+    return baked.get();
+}
+
+void BasicAnimationManager::setBakeSampleRate(double rate)
+{
+    if (_bakeSampleRate == rate)
+        return;
+    _bakeSampleRate = rate;
+    dirtyBakedAnimations();
+}
+
+void BasicAnimationManager::dirtyBakedAnimations()
+{
+    _bakedAnimations.clear();
+}
+
+void BasicAnimationManager::unregisterAnimation (Animation* animation)
+{
+    _bakedAnimations.erase(animation);
+    AnimationManagerBase::unregisterAnimation(animation);
+}
+
 bool BasicAnimationManager::findAnimation(Animation* pAnimation)
 {
     for( AnimationList::const_iterator iterAnim = _animations.begin(); iterAnim != _animations.end(); ++iterAnim )
@@ -18,8 +18,86 @@
 #include <osgAnimation/BoneMapVisitor>
 #include <osgAnimation/RigGeometry>
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define OSGANIMATION_SKINNING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSGANIMATION_SKINNING_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define OSGANIMATION_SKINNING_NEON
+#endif
+
 using namespace osgAnimation;
 
+namespace
+{
+
+// transform num vertices held in x, y and z streams by the 3x4 matrix m, and scatter them to dst at the given indices.
+inline void skinVertices(const float* m, const float* x, const float* y, const float* z, const unsigned int* indices, unsigned int num, osg::Vec3* dst)
+{
+    unsigned int i = 0;
+
+#if defined(OSGANIMATION_SKINNING_AVX)
+    const unsigned int BLOCK_SIZE = 8;
+    __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]), m3 = _mm256_set1_ps(m[3]);
+    __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]);
+    __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]), m11 = _mm256_set1_ps(m[11]);
+    float rx[BLOCK_SIZE], ry[BLOCK_SIZE], rz[BLOCK_SIZE];
+    for(; i+BLOCK_SIZE<=num; i+=BLOCK_SIZE)
+    {
+        __m256 vx = _mm256_loadu_ps(x+i);
+        __m256 vy = _mm256_loadu_ps(y+i);
+        __m256 vz = _mm256_loadu_ps(z+i);
+        _mm256_storeu_ps(rx, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, m0), _mm256_mul_ps(vy, m1)), _mm256_add_ps(_mm256_mul_ps(vz, m2), m3)));
+        _mm256_storeu_ps(ry, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, m4), _mm256_mul_ps(vy, m5)), _mm256_add_ps(_mm256_mul_ps(vz, m6), m7)));
+        _mm256_storeu_ps(rz, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, m8), _mm256_mul_ps(vy, m9)), _mm256_add_ps(_mm256_mul_ps(vz, m10), m11)));
+        for(unsigned int k=0; k<BLOCK_SIZE; ++k) dst[indices[i+k]].set(rx[k], ry[k], rz[k]);
+    }
+#elif defined(OSGANIMATION_SKINNING_SSE)
+    const unsigned int BLOCK_SIZE = 4;
+    __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+    __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]);
+    __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+    float rx[BLOCK_SIZE], ry[BLOCK_SIZE], rz[BLOCK_SIZE];
+    for(; i+BLOCK_SIZE<=num; i+=BLOCK_SIZE)
+    {
+        __m128 vx = _mm_loadu_ps(x+i);
+        __m128 vy = _mm_loadu_ps(y+i);
+        __m128 vz = _mm_loadu_ps(z+i);
+        _mm_storeu_ps(rx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, m0), _mm_mul_ps(vy, m1)), _mm_add_ps(_mm_mul_ps(vz, m2), m3)));
+        _mm_storeu_ps(ry, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, m4), _mm_mul_ps(vy, m5)), _mm_add_ps(_mm_mul_ps(vz, m6), m7)));
+        _mm_storeu_ps(rz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, m8), _mm_mul_ps(vy, m9)), _mm_add_ps(_mm_mul_ps(vz, m10), m11)));
+        for(unsigned int k=0; k<BLOCK_SIZE; ++k) dst[indices[i+k]].set(rx[k], ry[k], rz[k]);
+    }
+#elif defined(OSGANIMATION_SKINNING_NEON)
+    const unsigned int BLOCK_SIZE = 4;
+    float32x4_t m3 = vdupq_n_f32(m[3]), m7 = vdupq_n_f32(m[7]), m11 = vdupq_n_f32(m[11]);
+    float rx[BLOCK_SIZE], ry[BLOCK_SIZE], rz[BLOCK_SIZE];
+    for(; i+BLOCK_SIZE<=num; i+=BLOCK_SIZE)
+    {
+        float32x4_t vx = vld1q_f32(x+i);
+        float32x4_t vy = vld1q_f32(y+i);
+        float32x4_t vz = vld1q_f32(z+i);
+        vst1q_f32(rx, vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(m3, vx, m[0]), vy, m[1]), vz, m[2]));
+        vst1q_f32(ry, vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(m7, vx, m[4]), vy, m[5]), vz, m[6]));
+        vst1q_f32(rz, vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(m11, vx, m[8]), vy, m[9]), vz, m[10]));
+        for(unsigned int k=0; k<BLOCK_SIZE; ++k) dst[indices[i+k]].set(rx[k], ry[k], rz[k]);
+    }
+#endif
+
+    // remaining vertices, or all of them when no vectorized path is available.
+    for(; i<num; ++i)
+    {
+        dst[indices[i]].set(m[0]*x[i] + m[1]*y[i] + m[2]*z[i] + m[3],
+                            m[4]*x[i] + m[5]*y[i] + m[6]*z[i] + m[7],
+                            m[8]*x[i] + m[9]*y[i] + m[10]*z[i] + m[11]);
+    }
+}
+
+}
+
 RigTransformSoftware::RigTransformSoftware()
 {
     _needInit = true;
@@ -66,6 +144,12 @@ void RigTransformSoftware::operator()(RigGeometry& geom)
     osg::Geometry& destination = geom;
 
     osg::Vec3Array* positionSrc = dynamic_cast<osg::Vec3Array*>(source.getVertexArray());
+    osg::Vec3Array* normalSrc = dynamic_cast<osg::Vec3Array*>(source.getNormalArray());
+
+    // the bone set matrices are shared by the positions and the normals.
+    if (positionSrc || normalSrc)
+        computeBoneSetMatrices(geom.getMatrixFromSkeletonToGeometry(), geom.getInvMatrixFromSkeletonToGeometry());
+
     osg::Vec3Array* positionDst = dynamic_cast<osg::Vec3Array*>(destination.getVertexArray());
     if (positionSrc )
     {
@@ -79,18 +163,14 @@ void RigTransformSoftware::operator()(RigGeometry& geom)
             }
             *positionDst = *positionSrc;
         }
-        if (!positionDst->empty())
+        if (!positionDst->empty() && updateStream(_positionStream, *positionSrc))
         {
-            compute<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                               geom.getInvMatrixFromSkeletonToGeometry(),
-                               &positionSrc->front(),
-                               &positionDst->front());
+            transformStream(_positionStream, true, &positionDst->front());
             positionDst->dirty();
         }
 
     }
 
-    osg::Vec3Array* normalSrc = dynamic_cast<osg::Vec3Array*>(source.getNormalArray());
     osg::Vec3Array* normalDst = dynamic_cast<osg::Vec3Array*>(destination.getNormalArray());
     if (normalSrc )
     {
@@ -104,18 +184,134 @@ void RigTransformSoftware::operator()(RigGeometry& geom)
             }
             *normalDst = *normalSrc;
         }
-        if (!normalDst->empty())
+        if (!normalDst->empty() && updateStream(_normalStream, *normalSrc))
         {
-            computeNormal<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                               geom.getInvMatrixFromSkeletonToGeometry(),
-                               &normalSrc->front(),
-                               &normalDst->front());
+            transformStream(_normalStream, false, &normalDst->front());
             normalDst->dirty();
         }
     }
 
 }
 
+void RigTransformSoftware::computeBoneSetMatrices(const osg::Matrix& transform, const osg::Matrix& invTransform)
+{
+    // each bone usually influences several bone sets, so its matrix is computed once for all of them.
+    _bonePaletteMatrices.resize(_bonePalette.size());
+    for (unsigned int p = 0; p < _bonePalette.size(); p++)
+    {
+        const Bone* bone = _bonePalette[p].get();
+        if (bone)
+            _bonePaletteMatrices[p] = bone->getInvBindMatrixInSkeletonSpace() * bone->getMatrixInSkeletonSpace();
+    }
+
+    bool identityTransform = transform.isIdentity() && invTransform.isIdentity();
+
+    _boneSetMatrices.resize(_boneSetVertexSet.size()*12);
+    unsigned int paletteIndex = 0;
+    for (unsigned int i = 0; i < _boneSetVertexSet.size(); i++)
+    {
+        UniqBoneSetVertexSet& uniq = _boneSetVertexSet[i];
+        const BoneWeightList& bones = uniq.getBones();
+
+        osg::Matrix matrix;
+        if (bones.empty())
+        {
+            OSG_WARN << &uniq << " RigTransformSoftware::UniqBoneSetVertexSet no bones found" << std::endl;
+        }
+        else
+        {
+            // accumulate the weighted bone matrices as UniqBoneSetVertexSet::computeMatrixForVertexSet() does.
+            matrix.set(0, 0, 0, 0,
+                       0, 0, 0, 0,
+                       0, 0, 0, 0,
+                       0, 0, 0, 1);
+            osg::Matrix::value_type* ptrresult = matrix.ptr();
+            for (unsigned int b = 0; b < bones.size(); b++)
+            {
+                unsigned int p = _boneSetPaletteIndices[paletteIndex + b];
+                if (!_bonePalette[p].valid())
+                {
+                    OSG_WARN << &uniq << " RigTransformSoftware::computeMatrixForVertexSet Warning a bone is null, skip it" << std::endl;
+                    continue;
+                }
+                const osg::Matrix::value_type* ptr = _bonePaletteMatrices[p].ptr();
+                osg::Matrix::value_type weight = bones[b].getWeight();
+                for (int r = 0; r < 16; r += 4)
+                {
+                    ptrresult[r+0] += ptr[r+0] * weight;
+                    ptrresult[r+1] += ptr[r+1] * weight;
+                    ptrresult[r+2] += ptr[r+2] * weight;
+                }
+            }
+            if (!identityTransform)
+                matrix = transform * matrix * invTransform;
+        }
+        paletteIndex += bones.size();
+
+        // osg::Matrix post multiplies row vectors, so each output component is a column of the matrix.
+        // the skinning matrices are affine so the projective column is ignored.
+        float* m = &_boneSetMatrices[i*12];
+        for (int c = 0; c < 3; c++)
+        {
+            m[c*4+0] = matrix(0,c);
+            m[c*4+1] = matrix(1,c);
+            m[c*4+2] = matrix(2,c);
+            m[c*4+3] = matrix(3,c);
+        }
+    }
+}
+
+bool RigTransformSoftware::updateStream(Stream& stream, const osg::Vec3Array& source)
+{
+    if (stream.source.get() == &source && stream.modifiedCount == source.getModifiedCount())
+        return !stream.x.empty() || _streamIndices.empty();
+
+    stream.source = &source;
+    stream.modifiedCount = source.getModifiedCount();
+
+    unsigned int numElements = _streamIndices.size();
+    stream.x.resize(numElements);
+    stream.y.resize(numElements);
+    stream.z.resize(numElements);
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+        unsigned int idx = _streamIndices[i];
+        if (idx >= source.size())
+        {
+            OSG_WARN << this << " RigTransformSoftware vertex " << idx << " is influenced by a bone but the source array only has " << source.size() << " elements" << std::endl;
+            stream.x.clear();
+            stream.y.clear();
+            stream.z.clear();
+            return false;
+        }
+        const osg::Vec3& v = source[idx];
+        stream.x[i] = v.x();
+        stream.y[i] = v.y();
+        stream.z[i] = v.z();
+    }
+    return true;
+}
+
+void RigTransformSoftware::transformStream(const Stream& stream, bool applyTranslation, osg::Vec3* dst) const
+{
+    for (unsigned int i = 0; i+1 < _streamOffsets.size(); i++)
+    {
+        unsigned int begin = _streamOffsets[i];
+        unsigned int num = _streamOffsets[i+1] - begin;
+        if (num == 0)
+            continue;
+
+        float m[12];
+        const float* boneSetMatrix = &_boneSetMatrices[i*12];
+        for (int j = 0; j < 12; j++)
+            m[j] = boneSetMatrix[j];
+        if (!applyTranslation)
+            m[3] = m[7] = m[11] = 0.0f;
+
+        skinVertices(m, &stream.x[begin], &stream.y[begin], &stream.z[begin], &_streamIndices[begin], num, dst);
+    }
+}
+
 void RigTransformSoftware::initVertexSetFromBones(const BoneMap& map, const VertexInfluenceSet::UniqVertexSetToBoneSetList& influence)
 {
     _boneSetVertexSet.clear();
@@ -157,4 +353,38 @@ void RigTransformSoftware::initVertexSetFromBones(const BoneMap& map, const Vert
         }
         _boneSetVertexSet[i].getVertexes() = inf.getVertexes();
     }
+
+    // gather the distinct bones into the palette.
+    _bonePalette.clear();
+    _boneSetPaletteIndices.clear();
+    std::map<const Bone*, unsigned int> paletteIndices;
+    for (int i = 0; i < size; i++)
+    {
+        const BoneWeightList& boneList = _boneSetVertexSet[i].getBones();
+        for (unsigned int b = 0; b < boneList.size(); b++)
+        {
+            const Bone* bone = boneList[b].getBone();
+            std::map<const Bone*, unsigned int>::iterator itr = paletteIndices.find(bone);
+            if (itr == paletteIndices.end())
+            {
+                itr = paletteIndices.insert(std::make_pair(bone, static_cast<unsigned int>(_bonePalette.size()))).first;
+                _bonePalette.push_back(bone);
+            }
+            _boneSetPaletteIndices.push_back(itr->second);
+        }
+    }
+
+    // lay the vertices out bone set after bone set for the source streams, which are gathered on the next update.
+    _streamIndices.clear();
+    _streamOffsets.clear();
+    for (int i = 0; i < size; i++)
+    {
+        _streamOffsets.push_back(_streamIndices.size());
+        const VertexList& vertexes = _boneSetVertexSet[i].getVertexes();
+        _streamIndices.insert(_streamIndices.end(), vertexes.begin(), vertexes.end());
+    }
+    _streamOffsets.push_back(_streamIndices.size());
+
+    _positionStream = Stream();
+    _normalStream = Stream();
 }
@@ -14,13 +14,123 @@
 
 #include <osgAnimation/Skeleton>
 #include <osgAnimation/Bone>
+#include <osgAnimation/RigGeometry>
+#include <osgAnimation/RigTransformSoftware>
 #include <osg/Notify>
+#include <osg/OperationThread>
+#include <osg/ApplicationUsage>
+
+#include <string.h>
+#include <stdlib.h>
 
 using namespace osgAnimation;
 
-Skeleton::Skeleton() {}
+static osg::ApplicationUsageProxy Skeleton_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PARALLEL_RIG_GEOMETRY_UPDATE <mode>","ON | OFF - Update the RigGeometry's of a Skeleton in parallel on the OperationThreadPool, defaults to ON.");
+
+static bool getDefaultParallelRigGeometryUpdate()
+{
+    const char* env = getenv("OSG_PARALLEL_RIG_GEOMETRY_UPDATE");
+    return !(env && (strcmp(env,"OFF")==0 || strcmp(env,"Off")==0 || strcmp(env,"off")==0));
+}
+
+Skeleton::Skeleton():
+    _parallelRigGeometryUpdate(getDefaultParallelRigGeometryUpdate()),
+    _deferringRigGeometryUpdates(false)
+{
+}
+
+Skeleton::Skeleton(const Skeleton& b, const osg::CopyOp& copyop) :
+    osg::MatrixTransform(b,copyop),
+    _parallelRigGeometryUpdate(b._parallelRigGeometryUpdate),
+    _deferringRigGeometryUpdates(false)
+{
+}
 
-Skeleton::Skeleton(const Skeleton& b, const osg::CopyOp& copyop) : osg::MatrixTransform(b,copyop) {}
+Skeleton::~Skeleton()
+{
+}
+
+namespace
+{
+
+struct UpdateRigGeometriesOperation : public osg::Operation
+{
+    UpdateRigGeometriesOperation(const std::vector< osg::ref_ptr<RigGeometry> >& geometries, OpenThreads::Atomic& numGeometriesTaken, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("UpdateRigGeometries", false),
+        _geometries(geometries),
+        _numGeometriesTaken(numGeometriesTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        for(unsigned int i = (++_numGeometriesTaken)-1; i<_geometries.size(); i = (++_numGeometriesTaken)-1)
+        {
+            _geometries[i]->update();
+        }
+
+        _blockCount->completed();
+    }
+
+    const std::vector< osg::ref_ptr<RigGeometry> >& _geometries;
+    OpenThreads::Atomic&                            _numGeometriesTaken;
+    osg::ref_ptr<osg::RefBlockCount>                _blockCount;
+
+protected:
+
+    UpdateRigGeometriesOperation& operator = (const UpdateRigGeometriesOperation&) { return *this; }
+};
+
+}
+
+void Skeleton::beginRigGeometryUpdates()
+{
+    _deferringRigGeometryUpdates = _parallelRigGeometryUpdate;
+}
+
+bool Skeleton::deferRigGeometryUpdate(RigGeometry* geom)
+{
+    if (!_deferringRigGeometryUpdates)
+        return false;
+
+    // initializing a RigTransformSoftware and the other implementations touch state shared between geometries.
+    const RigTransformSoftware* rig = dynamic_cast<const RigTransformSoftware*>(geom->getRigTransformImplementation());
+    if (!rig || rig->getNeedInit())
+        return false;
+
+    _deferredRigGeometries.push_back(geom);
+    return true;
+}
+
+void Skeleton::endRigGeometryUpdates()
+{
+    _deferringRigGeometryUpdates = false;
+    if (_deferredRigGeometries.empty())
+        return;
+
+    if (_deferredRigGeometries.size()==1)
+    {
+        _deferredRigGeometries.front()->update();
+    }
+    else
+    {
+        osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+        unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, static_cast<unsigned int>(_deferredRigGeometries.size()));
+
+        OpenThreads::Atomic numGeometriesTaken;
+        osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+        blockCount->reset();
+
+        for(unsigned int i=0; i<numOperations; ++i)
+        {
+            threadPool->add(new UpdateRigGeometriesOperation(_deferredRigGeometries, numGeometriesTaken, blockCount.get()));
+        }
+
+        threadPool->runOperationsUntilCompleted(blockCount.get());
+    }
+
+    _deferredRigGeometries.clear();
+}
 
 Skeleton::UpdateSkeleton::UpdateSkeleton() : _needValidate(true) {}
 
@@ -77,9 +187,10 @@ public:
 
 void Skeleton::UpdateSkeleton::operator()(osg::Node* node, osg::NodeVisitor* nv)
 {
+    Skeleton* skeleton = 0;
     if (nv->getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR)
     {
-        Skeleton* skeleton = dynamic_cast<Skeleton*>(node);
+        skeleton = dynamic_cast<Skeleton*>(node);
         if (_needValidate && skeleton)
         {
             ValidateSkeletonVisitor visitor;
@@ -91,7 +202,15 @@ void Skeleton::UpdateSkeleton::operator()(osg::Node* node, osg::NodeVisitor* nv)
             _needValidate = false;
         }
     }
+
+    // the RigGeometry's are deferred until all the bones of the skeleton have been updated.
+    if (skeleton)
+        skeleton->beginRigGeometryUpdates();
+
     traverse(node,nv);
+
+    if (skeleton)
+        skeleton->endRigGeometryUpdates();
 }
 
 void Skeleton::setDefaultUpdateCallback()
@@ -0,0 +1,1210 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/BlockCompressor>
+
+#include <osg/Notify>
+#include <osg/OperationThread>
+
+#include <OpenThreads/Atomic>
+
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+using namespace osgDB;
+
+namespace
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Shared helpers
+//
+
+enum Encoding
+{
+    ENCODE_BC1,
+    ENCODE_BC1A,
+    ENCODE_BC2,
+    ENCODE_BC3,
+    ENCODE_BC4,
+    ENCODE_BC5,
+    ENCODE_BC7,
+    ENCODE_ETC1,
+    ENCODE_ETC2_RGBA,
+    ENCODE_EAC_R11,
+    ENCODE_EAC_RG11
+};
+
+/** a 4x4 block of RGBA pixels, in rows starting at the lowest address of the image.*/
+struct Block
+{
+    unsigned char rgba[16][4];
+};
+
+inline int clampInt(int v, int minValue, int maxValue) { return v<minValue ? minValue : (v>maxValue ? maxValue : v); }
+
+inline int roundToInt(float v) { return v<0.0f ? int(v-0.5f) : int(v+0.5f); }
+
+inline int squareDistance(const int* lhs, const unsigned char* rhs, unsigned int numComponents)
+{
+    int d = 0;
+    for(unsigned int c=0; c<numComponents; ++c)
+    {
+        int delta = lhs[c]-int(rhs[c]);
+        d += delta*delta;
+    }
+    return d;
+}
+
+/** Fit the line through the points, given as numComponents floats per point, along their principal axis.
+  * Returns false when all the points are the same, with the mean returned in both end points.*/
+bool fitPrincipalAxis(const float* points, unsigned int numPoints, unsigned int numComponents, float* e0, float* e1)
+{
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for(unsigned int i=0; i<numPoints; ++i)
+        for(unsigned int c=0; c<numComponents; ++c) mean[c] += points[i*numComponents+c];
+
+    for(unsigned int c=0; c<numComponents; ++c)
+    {
+        mean[c] /= float(numPoints);
+        e0[c] = e1[c] = mean[c];
+    }
+
+    float covariance[4][4];
+    memset(covariance, 0, sizeof(covariance));
+    for(unsigned int i=0; i<numPoints; ++i)
+    {
+        const float* p = points + i*numComponents;
+        for(unsigned int r=0; r<numComponents; ++r)
+            for(unsigned int c=r; c<numComponents; ++c)
+                covariance[r][c] += (p[r]-mean[r])*(p[c]-mean[c]);
+    }
+    for(unsigned int r=0; r<numComponents; ++r)
+        for(unsigned int c=0; c<r; ++c)
+            covariance[r][c] = covariance[c][r];
+
+    // power iteration, starting from the axis of largest variance.
+    float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    unsigned int largest = 0;
+    for(unsigned int c=1; c<numComponents; ++c)
+        if (covariance[c][c]>covariance[largest][largest]) largest = c;
+
+    if (covariance[largest][largest]<=0.0f) return false;
+
+    axis[largest] = 1.0f;
+    for(unsigned int iteration=0; iteration<8; ++iteration)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float length2 = 0.0f;
+        for(unsigned int r=0; r<numComponents; ++r)
+        {
+            for(unsigned int c=0; c<numComponents; ++c) next[r] += covariance[r][c]*axis[c];
+            length2 += next[r]*next[r];
+        }
+        if (length2<=0.0f) break;
+
+        float inverseLength = 1.0f/sqrtf(length2);
+        for(unsigned int c=0; c<numComponents; ++c) axis[c] = next[c]*inverseLength;
+    }
+
+    float minT = 0.0f, maxT = 0.0f;
+    for(unsigned int i=0; i<numPoints; ++i)
+    {
+        float t = 0.0f;
+        for(unsigned int c=0; c<numComponents; ++c) t += (points[i*numComponents+c]-mean[c])*axis[c];
+        if (i==0 || t<minT) minT = t;
+        if (i==0 || t>maxT) maxT = t;
+    }
+
+    // inset the end points slightly, the extremes are rarely the best fit.
+    float inset = (maxT-minT)/16.0f;
+    minT += inset;
+    maxT -= inset;
+
+    for(unsigned int c=0; c<numComponents; ++c)
+    {
+        e0[c] = mean[c] + axis[c]*maxT;
+        e1[c] = mean[c] + axis[c]*minT;
+    }
+    return true;
+}
+
+/** Least squares fit of the end points given the weight of the first end point of each point,
+  * points with a negative weight are ignored.*/
+bool fitEndPoints(const float* points, const float* weights, unsigned int numPoints, unsigned int numComponents, float* e0, float* e1)
+{
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float y[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for(unsigned int i=0; i<numPoints; ++i)
+    {
+        float w = weights[i];
+        if (w<0.0f) continue;
+
+        a += w*w;
+        b += w*(1.0f-w);
+        c += (1.0f-w)*(1.0f-w);
+        for(unsigned int k=0; k<numComponents; ++k)
+        {
+            x[k] += w*points[i*numComponents+k];
+            y[k] += (1.0f-w)*points[i*numComponents+k];
+        }
+    }
+
+    float determinant = a*c-b*b;
+    if (fabsf(determinant)<1e-6f) return false;
+
+    float inverse = 1.0f/determinant;
+    for(unsigned int k=0; k<numComponents; ++k)
+    {
+        e0[k] = (c*x[k]-b*y[k])*inverse;
+        e1[k] = (a*y[k]-b*x[k])*inverse;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  BC1 colour blocks, also used by BC2 and BC3
+//
+
+inline void expand565(unsigned int color, int* rgb)
+{
+    int r = (color>>11)&31, g = (color>>5)&63, b = color&31;
+    rgb[0] = (r<<3)|(r>>2);
+    rgb[1] = (g<<2)|(g>>4);
+    rgb[2] = (b<<3)|(b>>2);
+}
+
+inline unsigned int quantize565(const float* rgb)
+{
+    int r = clampInt(roundToInt(rgb[0]*31.0f/255.0f), 0, 31);
+    int g = clampInt(roundToInt(rgb[1]*63.0f/255.0f), 0, 63);
+    int b = clampInt(roundToInt(rgb[2]*31.0f/255.0f), 0, 31);
+    return (r<<11)|(g<<5)|b;
+}
+
+struct ColorFit
+{
+    unsigned int    color0;
+    unsigned int    color1;
+    unsigned char   indices[16];
+    int             error;
+};
+
+/** Assign the indices for the end points, which are swapped into the order that selects the
+  * four colour mode, or the three colour and transparent mode when transparent is true.*/
+void evaluateColorEndPoints(const Block& block, const bool* opaque, bool transparent, unsigned int color0, unsigned int color1, ColorFit& fit)
+{
+    if (transparent ? color0>color1 : color0<color1) std::swap(color0, color1);
+
+    bool fourColors = color0>color1;
+    int palette[4][3];
+    expand565(color0, palette[0]);
+    expand565(color1, palette[1]);
+    for(unsigned int c=0; c<3; ++c)
+    {
+        if (fourColors)
+        {
+            palette[2][c] = (2*palette[0][c]+palette[1][c])/3;
+            palette[3][c] = (palette[0][c]+2*palette[1][c])/3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c]+palette[1][c])/2;
+            palette[3][c] = 0;
+        }
+    }
+
+    unsigned int numColors = fourColors ? 4 : 3;
+    fit.color0 = color0;
+    fit.color1 = color1;
+    fit.error = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        if (!opaque[i])
+        {
+            fit.indices[i] = 3;
+            continue;
+        }
+
+        int bestError = squareDistance(palette[0], block.rgba[i], 3);
+        unsigned int bestIndex = 0;
+        for(unsigned int k=1; k<numColors; ++k)
+        {
+            int error = squareDistance(palette[k], block.rgba[i], 3);
+            if (error<bestError) { bestError = error; bestIndex = k; }
+        }
+        fit.indices[i] = bestIndex;
+        fit.error += bestError;
+    }
+}
+
+void encodeColorBlock(const Block& block, bool allowTransparent, unsigned int numIterations, unsigned char* out)
+{
+    bool opaque[16];
+    float points[16*3];
+    unsigned int numOpaque = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        opaque[i] = !allowTransparent || block.rgba[i][3]>=128;
+        if (opaque[i])
+        {
+            for(unsigned int c=0; c<3; ++c) points[numOpaque*3+c] = block.rgba[i][c];
+            ++numOpaque;
+        }
+    }
+
+    bool transparent = numOpaque<16;
+
+    ColorFit best;
+    if (numOpaque==0)
+    {
+        evaluateColorEndPoints(block, opaque, true, 0, 0, best);
+    }
+    else
+    {
+        float e0[3], e1[3];
+        fitPrincipalAxis(points, numOpaque, 3, e0, e1);
+        evaluateColorEndPoints(block, opaque, transparent, quantize565(e0), quantize565(e1), best);
+
+        for(unsigned int iteration=0; iteration<numIterations && best.error>0; ++iteration)
+        {
+            bool fourColors = best.color0>best.color1;
+            float weights[16];
+            float opaquePoints[16*3];
+            unsigned int n = 0;
+            for(unsigned int i=0; i<16; ++i)
+            {
+                if (!opaque[i]) continue;
+
+                switch(best.indices[i])
+                {
+                    case(0): weights[n] = 1.0f; break;
+                    case(1): weights[n] = 0.0f; break;
+                    case(2): weights[n] = fourColors ? 2.0f/3.0f : 0.5f; break;
+                    default: weights[n] = fourColors ? 1.0f/3.0f : -1.0f; break;
+                }
+                for(unsigned int c=0; c<3; ++c) opaquePoints[n*3+c] = block.rgba[i][c];
+                ++n;
+            }
+
+            if (!fitEndPoints(opaquePoints, weights, n, 3, e0, e1)) break;
+
+            ColorFit fit;
+            evaluateColorEndPoints(block, opaque, transparent, quantize565(e0), quantize565(e1), fit);
+            if (fit.error>=best.error) break;
+            best = fit;
+        }
+    }
+
+    unsigned int indices = 0;
+    for(unsigned int i=0; i<16; ++i) indices |= (best.indices[i]<<(i*2));
+
+    out[0] = best.color0&0xff;
+    out[1] = best.color0>>8;
+    out[2] = best.color1&0xff;
+    out[3] = best.color1>>8;
+    out[4] = indices&0xff;
+    out[5] = (indices>>8)&0xff;
+    out[6] = (indices>>16)&0xff;
+    out[7] = indices>>24;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  BC4 single channel blocks, also used by BC3 and BC5
+//
+
+int evaluateChannelEndPoints(const unsigned char* values, int value0, int value1, unsigned char* indices)
+{
+    int palette[8];
+    palette[0] = value0;
+    palette[1] = value1;
+    if (value0>value1)
+    {
+        for(int k=1; k<7; ++k) palette[k+1] = ((7-k)*value0+k*value1)/7;
+    }
+    else
+    {
+        for(int k=1; k<5; ++k) palette[k+1] = ((5-k)*value0+k*value1)/5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    int error = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        int bestError = 65536;
+        for(unsigned int k=0; k<8; ++k)
+        {
+            int delta = palette[k]-int(values[i]);
+            if (delta*delta<bestError) { bestError = delta*delta; indices[i] = k; }
+        }
+        error += bestError;
+    }
+    return error;
+}
+
+void encodeChannelBlock(const unsigned char* values, ImageProcessor::CompressionQuality quality, unsigned char* out)
+{
+    int minValue = 255, maxValue = 0;
+    int minInterior = 255, maxInterior = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        int v = values[i];
+        minValue = osg::minimum(minValue, v);
+        maxValue = osg::maximum(maxValue, v);
+        if (v!=0 && v!=255)
+        {
+            minInterior = osg::minimum(minInterior, v);
+            maxInterior = osg::maximum(maxInterior, v);
+        }
+    }
+
+    unsigned char bestIndices[16];
+    int value0 = maxValue, value1 = minValue;
+    int bestError = evaluateChannelEndPoints(values, value0, value1, bestIndices);
+
+    if (quality>=ImageProcessor::NORMAL && bestError>0)
+    {
+        // try the end points inset by the range that the 8 value mode can't represent exactly.
+        int range = quality>=ImageProcessor::HIGHEST ? 3 : 1;
+        unsigned char indices[16];
+        for(int inset0=0; inset0<=range; ++inset0)
+        {
+            for(int inset1=0; inset1<=range; ++inset1)
+            {
+                int v0 = maxValue-inset0, v1 = minValue+inset1;
+                if ((inset0==0 && inset1==0) || v0<=v1) continue;
+
+                int error = evaluateChannelEndPoints(values, v0, v1, indices);
+                if (error<bestError)
+                {
+                    bestError = error; value0 = v0; value1 = v1;
+                    memcpy(bestIndices, indices, 16);
+                }
+            }
+        }
+
+        // the 6 value mode represents 0 and 255 exactly, so suits blocks with values at the extremes.
+        if (quality>=ImageProcessor::PRODUCTION && minInterior<=maxInterior && (minValue==0 || maxValue==255))
+        {
+            int error = evaluateChannelEndPoints(values, minInterior, maxInterior, indices);
+            if (error<bestError)
+            {
+                bestError = error; value0 = minInterior; value1 = maxInterior;
+                memcpy(bestIndices, indices, 16);
+            }
+        }
+    }
+
+    out[0] = value0;
+    out[1] = value1;
+    unsigned int bits[2] = { 0, 0 };
+    for(unsigned int i=0; i<16; ++i) bits[i/8] |= (bestIndices[i]<<((i%8)*3));
+    for(unsigned int h=0; h<2; ++h)
+    {
+        out[2+h*3] = bits[h]&0xff;
+        out[3+h*3] = (bits[h]>>8)&0xff;
+        out[4+h*3] = (bits[h]>>16)&0xff;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  BC7 mode 6 blocks
+//
+
+const int s_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BPTCFit
+{
+    int             endPoints[2][4];
+    int             pBits[2];
+    unsigned char   indices[16];
+    int             error;
+};
+
+/** Quantize an end point to 7 bits per component plus a p bit shared by all the components.*/
+void quantizeBPTCEndPoint(const float* endPoint, int* quantized, int& pBit)
+{
+    int bestError = 0;
+    for(int p=0; p<2; ++p)
+    {
+        int q[4];
+        int error = 0;
+        for(unsigned int c=0; c<4; ++c)
+        {
+            q[c] = clampInt(roundToInt((endPoint[c]-float(p))*0.5f), 0, 127);
+            float delta = float((q[c]<<1)|p)-endPoint[c];
+            error += int(delta*delta);
+        }
+
+        if (p==0 || error<bestError)
+        {
+            bestError = error;
+            pBit = p;
+            for(unsigned int c=0; c<4; ++c) quantized[c] = q[c];
+        }
+    }
+}
+
+void evaluateBPTCEndPoints(const Block& block, const float* e0, const float* e1, BPTCFit& fit)
+{
+    quantizeBPTCEndPoint(e0, fit.endPoints[0], fit.pBits[0]);
+    quantizeBPTCEndPoint(e1, fit.endPoints[1], fit.pBits[1]);
+
+    int palette[16][4];
+    for(unsigned int c=0; c<4; ++c)
+    {
+        int v0 = (fit.endPoints[0][c]<<1)|fit.pBits[0];
+        int v1 = (fit.endPoints[1][c]<<1)|fit.pBits[1];
+        for(unsigned int k=0; k<16; ++k) palette[k][c] = ((64-s_bc7Weights[k])*v0 + s_bc7Weights[k]*v1 + 32)>>6;
+    }
+
+    fit.error = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        int bestError = squareDistance(palette[0], block.rgba[i], 4);
+        unsigned int bestIndex = 0;
+        for(unsigned int k=1; k<16; ++k)
+        {
+            int error = squareDistance(palette[k], block.rgba[i], 4);
+            if (error<bestError) { bestError = error; bestIndex = k; }
+        }
+        fit.indices[i] = bestIndex;
+        fit.error += bestError;
+    }
+}
+
+class BitWriter
+{
+    public:
+        BitWriter(unsigned char* data): _data(data), _position(0) { memset(_data, 0, 16); }
+
+        void write(unsigned int value, unsigned int numBits)
+        {
+            for(unsigned int i=0; i<numBits; ++i, ++_position)
+            {
+                if ((value>>i)&1) _data[_position>>3] |= (1<<(_position&7));
+            }
+        }
+
+    protected:
+        unsigned char*  _data;
+        unsigned int    _position;
+};
+
+void encodeBPTCBlock(const Block& block, unsigned int numIterations, unsigned char* out)
+{
+    float points[16*4];
+    for(unsigned int i=0; i<16; ++i)
+        for(unsigned int c=0; c<4; ++c) points[i*4+c] = block.rgba[i][c];
+
+    float e0[4], e1[4];
+    fitPrincipalAxis(points, 16, 4, e0, e1);
+
+    BPTCFit best;
+    evaluateBPTCEndPoints(block, e0, e1, best);
+
+    for(unsigned int iteration=0; iteration<numIterations && best.error>0; ++iteration)
+    {
+        float weights[16];
+        for(unsigned int i=0; i<16; ++i) weights[i] = 1.0f - float(s_bc7Weights[best.indices[i]])/64.0f;
+
+        if (!fitEndPoints(points, weights, 16, 4, e0, e1)) break;
+
+        BPTCFit fit;
+        evaluateBPTCEndPoints(block, e0, e1, fit);
+        if (fit.error>=best.error) break;
+        best = fit;
+    }
+
+    // the most significant bit of the first index is implicitly zero, so swap the end points when it is set.
+    if (best.indices[0]>=8)
+    {
+        for(unsigned int c=0; c<4; ++c) std::swap(best.endPoints[0][c], best.endPoints[1][c]);
+        std::swap(best.pBits[0], best.pBits[1]);
+        for(unsigned int i=0; i<16; ++i) best.indices[i] = 15-best.indices[i];
+    }
+
+    BitWriter writer(out);
+    writer.write(1<<6, 7);
+    for(unsigned int c=0; c<4; ++c)
+    {
+        writer.write(best.endPoints[0][c], 7);
+        writer.write(best.endPoints[1][c], 7);
+    }
+    writer.write(best.pBits[0], 1);
+    writer.write(best.pBits[1], 1);
+    writer.write(best.indices[0], 3);
+    for(unsigned int i=1; i<16; ++i) writer.write(best.indices[i], 4);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  ETC1 blocks, which are also valid ETC2 RGB8 blocks
+//
+
+const int s_etcModifiers[8][4] =
+{
+    {  2,   8,  -2,   -8 },
+    {  5,  17,  -5,  -17 },
+    {  9,  29,  -9,  -29 },
+    { 13,  42, -13,  -42 },
+    { 18,  60, -18,  -60 },
+    { 24,  80, -24,  -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+};
+
+/** Pick the modifier table and pixel indices of a sub block, returning the error.*/
+int fitETCSubBlock(const Block& block, const unsigned int* pixels, const int* base, unsigned int& table, unsigned char* indices)
+{
+    int bestTableError = 0;
+    unsigned char tableIndices[16];
+    for(unsigned int t=0; t<8; ++t)
+    {
+        int tableError = 0;
+        for(unsigned int p=0; p<8 && (t==0 || tableError<bestTableError); ++p)
+        {
+            const unsigned char* pixel = block.rgba[pixels[p]];
+            int bestError = 0;
+            for(unsigned int k=0; k<4; ++k)
+            {
+                int color[3];
+                for(unsigned int c=0; c<3; ++c) color[c] = clampInt(base[c]+s_etcModifiers[t][k], 0, 255);
+
+                int error = squareDistance(color, pixel, 3);
+                if (k==0 || error<bestError) { bestError = error; tableIndices[pixels[p]] = k; }
+            }
+            tableError += bestError;
+        }
+
+        if (t==0 || tableError<bestTableError)
+        {
+            bestTableError = tableError;
+            table = t;
+            for(unsigned int p=0; p<8; ++p) indices[pixels[p]] = tableIndices[pixels[p]];
+        }
+    }
+    return bestTableError;
+}
+
+void encodeETCBlock(const Block& block, ImageProcessor::CompressionQuality quality, unsigned char* out)
+{
+    int bestError = -1;
+    unsigned int bestHigh = 0;
+    unsigned char bestIndices[16];
+
+    for(unsigned int flip=0; flip<2; ++flip)
+    {
+        // pixels of the two sub blocks, 2x4 side by side, or 4x2 one above the other when flipped.
+        unsigned int pixels[2][8];
+        float average[2][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+        unsigned int count[2] = { 0, 0 };
+        for(unsigned int y=0; y<4; ++y)
+        {
+            for(unsigned int x=0; x<4; ++x)
+            {
+                unsigned int s = flip ? y/2 : x/2;
+                unsigned int i = y*4+x;
+                pixels[s][count[s]++] = i;
+                for(unsigned int c=0; c<3; ++c) average[s][c] += block.rgba[i][c]/8.0f;
+            }
+        }
+
+        // the differential mode has the more precise base colours, so the individual mode is only tried
+        // when the sub blocks differ by more than the differential mode can represent.
+        bool clamped = false;
+        for(unsigned int c=0; c<3; ++c)
+        {
+            int delta = roundToInt(average[1][c]*31.0f/255.0f)-roundToInt(average[0][c]*31.0f/255.0f);
+            if (delta<-4 || delta>3) clamped = true;
+        }
+
+        for(unsigned int differential=0; differential<2; ++differential)
+        {
+            if (!differential && !clamped && quality<ImageProcessor::PRODUCTION) continue;
+
+            int quantized[2][3];
+            int base[2][3];
+            for(unsigned int c=0; c<3; ++c)
+            {
+                if (differential)
+                {
+                    quantized[0][c] = clampInt(roundToInt(average[0][c]*31.0f/255.0f), 0, 31);
+                    quantized[1][c] = clampInt(roundToInt(average[1][c]*31.0f/255.0f), quantized[0][c]-4, quantized[0][c]+3);
+                    quantized[1][c] = clampInt(quantized[1][c], 0, 31);
+                    for(unsigned int s=0; s<2; ++s) base[s][c] = (quantized[s][c]<<3)|(quantized[s][c]>>2);
+                }
+                else
+                {
+                    for(unsigned int s=0; s<2; ++s)
+                    {
+                        quantized[s][c] = clampInt(roundToInt(average[s][c]*15.0f/255.0f), 0, 15);
+                        base[s][c] = (quantized[s][c]<<4)|quantized[s][c];
+                    }
+                }
+            }
+
+            unsigned int tables[2];
+            unsigned char indices[16];
+            int error = fitETCSubBlock(block, pixels[0], base[0], tables[0], indices) +
+                        fitETCSubBlock(block, pixels[1], base[1], tables[1], indices);
+
+            if (bestError<0 || error<bestError)
+            {
+                bestError = error;
+                memcpy(bestIndices, indices, 16);
+                bestHigh = (tables[0]<<5)|(tables[1]<<2)|(differential<<1)|flip;
+                for(unsigned int c=0; c<3; ++c)
+                {
+                    unsigned int shift = 24-c*8;
+                    if (differential) bestHigh |= (quantized[0][c]<<(shift+3)) | (((quantized[1][c]-quantized[0][c])&7)<<shift);
+                    else bestHigh |= (quantized[0][c]<<(shift+4)) | (quantized[1][c]<<shift);
+                }
+            }
+        }
+    }
+
+    // the pixel indices are stored in columns, with the most significant bits in the upper half.
+    unsigned int low = 0;
+    for(unsigned int y=0; y<4; ++y)
+    {
+        for(unsigned int x=0; x<4; ++x)
+        {
+            unsigned int index = bestIndices[y*4+x];
+            unsigned int bit = x*4+y;
+            low |= ((index>>1)<<(bit+16)) | ((index&1)<<bit);
+        }
+    }
+
+    for(unsigned int i=0; i<4; ++i)
+    {
+        out[i] = (bestHigh>>(24-i*8))&0xff;
+        out[4+i] = (low>>(24-i*8))&0xff;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  EAC blocks, for the alpha of ETC2 RGBA8 and for R11 and RG11
+//
+
+const int s_eacModifiers[16][8] =
+{
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+/** Decode a value of an EAC block, either 8 bit alpha or 11 bit R11.*/
+inline int decodeEAC(int base, int multiplier, int modifier, bool elevenBit)
+{
+    return elevenBit ? clampInt(base*8+4+modifier*multiplier*8, 0, 2047) : clampInt(base+modifier*multiplier, 0, 255);
+}
+
+/** Assign the indices of the pixels, returning the error, or a value of at least bound once the error reaches it.*/
+int evaluateEAC(const int* targets, unsigned int table, int base, int multiplier, bool elevenBit, int bound, unsigned char* indices)
+{
+    int palette[8];
+    for(unsigned int k=0; k<8; ++k) palette[k] = decodeEAC(base, multiplier, s_eacModifiers[table][k], elevenBit);
+
+    int error = 0;
+    for(unsigned int i=0; i<16 && error<bound; ++i)
+    {
+        int bestError = 0;
+        for(unsigned int k=0; k<8; ++k)
+        {
+            int delta = palette[k]-targets[i];
+            if (k==0 || delta*delta<bestError) { bestError = delta*delta; indices[i] = k; }
+        }
+        error += bestError;
+    }
+    return error;
+}
+
+void encodeEACBlock(const unsigned char* values, bool elevenBit, ImageProcessor::CompressionQuality quality, unsigned char* out)
+{
+    // the targets are in the decoded range, 0 to 255 for alpha and 0 to 2047 for R11.
+    int targets[16];
+    int minTarget = 2047, maxTarget = 0;
+    for(unsigned int i=0; i<16; ++i)
+    {
+        targets[i] = elevenBit ? (int(values[i])*2047+127)/255 : int(values[i]);
+        minTarget = osg::minimum(minTarget, targets[i]);
+        maxTarget = osg::maximum(maxTarget, targets[i]);
+    }
+
+    float scale = elevenBit ? 8.0f : 1.0f;
+    float center = elevenBit ? (float(minTarget+maxTarget)*0.5f-4.0f)/8.0f : float(minTarget+maxTarget)*0.5f;
+    int multiplierRange = quality>=ImageProcessor::PRODUCTION ? 1 : 0;
+    int baseRange = quality>=ImageProcessor::HIGHEST ? 1 : 0;
+
+    int bestError = -1;
+    unsigned int bestTable = 0;
+    int bestBase = 0, bestMultiplier = 1;
+    unsigned char bestIndices[16];
+    unsigned char indices[16];
+    for(unsigned int t=0; t<16; ++t)
+    {
+        int span = s_eacModifiers[t][7]-s_eacModifiers[t][3];
+        int multiplier = clampInt(roundToInt(float(maxTarget-minTarget)/(scale*float(span))), 1, 15);
+        float offset = float(s_eacModifiers[t][7]+s_eacModifiers[t][3])*0.5f;
+
+        for(int m=multiplier-multiplierRange; m<=multiplier+multiplierRange; ++m)
+        {
+            if (m<1 || m>15) continue;
+
+            int base = clampInt(roundToInt(center-offset*float(m)), 0, 255);
+            for(int b=base-baseRange; b<=base+baseRange; ++b)
+            {
+                if (b<0 || b>255) continue;
+
+                int error = evaluateEAC(targets, t, b, m, elevenBit, bestError<0 ? INT_MAX : bestError, indices);
+                if (bestError<0 || error<bestError)
+                {
+                    bestError = error; bestTable = t; bestBase = b; bestMultiplier = m;
+                    memcpy(bestIndices, indices, 16);
+                }
+            }
+        }
+        if (bestError==0) break;
+    }
+
+    out[0] = bestBase;
+    out[1] = (bestMultiplier<<4)|bestTable;
+
+    // the 3 bit indices are stored in columns, starting at the most significant bits.
+    unsigned int bits[2] = { 0, 0 };
+    for(unsigned int x=0; x<4; ++x)
+    {
+        for(unsigned int y=0; y<4; ++y)
+        {
+            unsigned int j = x*4+y;
+            bits[j/8] |= bestIndices[y*4+x]<<(21-(j%8)*3);
+        }
+    }
+    for(unsigned int h=0; h<2; ++h)
+    {
+        out[2+h*3] = (bits[h]>>16)&0xff;
+        out[3+h*3] = (bits[h]>>8)&0xff;
+        out[4+h*3] = bits[h]&0xff;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Encoding of whole images
+//
+
+/** an uncompressed mipmap level, with tightly packed RGBA pixels.*/
+struct Level
+{
+    Level(): width(0), height(0) {}
+
+    unsigned int                width;
+    unsigned int                height;
+    std::vector<unsigned char>  rgba;
+};
+
+typedef std::vector<Level> Levels;
+
+unsigned int getBlockSize(Encoding encoding)
+{
+    switch(encoding)
+    {
+        case(ENCODE_BC1):
+        case(ENCODE_BC1A):
+        case(ENCODE_BC4):
+        case(ENCODE_ETC1):
+        case(ENCODE_EAC_R11):
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+struct Encoder
+{
+    Encoding                            encoding;
+    ImageProcessor::CompressionQuality  quality;
+    unsigned int                        channels[2];
+
+    unsigned int getNumIterations() const
+    {
+        switch(quality)
+        {
+            case(ImageProcessor::FASTEST): return 0;
+            case(ImageProcessor::NORMAL): return 1;
+            case(ImageProcessor::PRODUCTION): return 2;
+            default: return 4;
+        }
+    }
+
+    void encodeBlock(const Block& block, unsigned char* out) const
+    {
+        unsigned char values[2][16];
+        for(unsigned int i=0; i<16; ++i)
+        {
+            values[0][i] = block.rgba[i][channels[0]];
+            values[1][i] = block.rgba[i][channels[1]];
+        }
+
+        switch(encoding)
+        {
+            case(ENCODE_BC1):
+                encodeColorBlock(block, false, getNumIterations(), out);
+                break;
+            case(ENCODE_BC1A):
+                encodeColorBlock(block, true, getNumIterations(), out);
+                break;
+            case(ENCODE_BC2):
+                for(unsigned int i=0; i<8; ++i)
+                {
+                    out[i] = ((block.rgba[i*2][3]*15+127)/255) | (((block.rgba[i*2+1][3]*15+127)/255)<<4);
+                }
+                encodeColorBlock(block, false, getNumIterations(), out+8);
+                break;
+            case(ENCODE_BC3):
+                encodeChannelBlock(values[0], quality, out);
+                encodeColorBlock(block, false, getNumIterations(), out+8);
+                break;
+            case(ENCODE_BC4):
+                encodeChannelBlock(values[0], quality, out);
+                break;
+            case(ENCODE_BC5):
+                encodeChannelBlock(values[0], quality, out);
+                encodeChannelBlock(values[1], quality, out+8);
+                break;
+            case(ENCODE_BC7):
+                encodeBPTCBlock(block, getNumIterations(), out);
+                break;
+            case(ENCODE_ETC1):
+                encodeETCBlock(block, quality, out);
+                break;
+            case(ENCODE_ETC2_RGBA):
+                encodeEACBlock(values[0], false, quality, out);
+                encodeETCBlock(block, quality, out+8);
+                break;
+            case(ENCODE_EAC_R11):
+                encodeEACBlock(values[0], true, quality, out);
+                break;
+            case(ENCODE_EAC_RG11):
+                encodeEACBlock(values[0], true, quality, out);
+                encodeEACBlock(values[1], true, quality, out+8);
+                break;
+        }
+    }
+
+    /** Encode a row of blocks, clamping the blocks at the right and top edges of the level to its pixels.*/
+    void encodeBlockRow(const Level& level, unsigned int row, unsigned char* out) const
+    {
+        unsigned int blockSize = getBlockSize(encoding);
+        unsigned int numBlocks = (level.width+3)/4;
+        Block block;
+        for(unsigned int b=0; b<numBlocks; ++b)
+        {
+            for(unsigned int y=0; y<4; ++y)
+            {
+                unsigned int sy = osg::minimum(row*4+y, level.height-1);
+                for(unsigned int x=0; x<4; ++x)
+                {
+                    unsigned int sx = osg::minimum(b*4+x, level.width-1);
+                    memcpy(block.rgba[y*4+x], &level.rgba[(sy*level.width+sx)*4], 4);
+                }
+            }
+            encodeBlock(block, out+b*blockSize);
+        }
+    }
+};
+
+struct BlockRow
+{
+    const Level*    level;
+    unsigned int    row;
+    unsigned char*  out;
+};
+
+typedef std::vector<BlockRow> BlockRows;
+
+struct EncodeBlockRowsOperation : public osg::Operation
+{
+    EncodeBlockRowsOperation(const Encoder& encoder, const BlockRows& rows, OpenThreads::Atomic& numRowsTaken, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("EncodeBlockRows", false),
+        _encoder(encoder),
+        _rows(rows),
+        _numRowsTaken(numRowsTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        for(unsigned int i = (++_numRowsTaken)-1; i<_rows.size(); i = (++_numRowsTaken)-1)
+        {
+            _encoder.encodeBlockRow(*_rows[i].level, _rows[i].row, _rows[i].out);
+        }
+
+        _blockCount->completed();
+    }
+
+    const Encoder&                      _encoder;
+    const BlockRows&                    _rows;
+    OpenThreads::Atomic&                _numRowsTaken;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+
+protected:
+
+    EncodeBlockRowsOperation& operator = (const EncodeBlockRowsOperation&) { return *this; }
+};
+
+bool isSupportedPixelFormat(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_RED):
+        case(GL_RG):
+        case(GL_RGB):
+        case(GL_RGBA):
+        case(GL_BGR):
+        case(GL_BGRA):
+        case(GL_LUMINANCE):
+        case(GL_LUMINANCE_ALPHA):
+        case(GL_ALPHA):
+        case(GL_INTENSITY):
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Convert a level of the image to RGBA, with single component images replicated to RGB, apart from alpha images.*/
+void convertToRGBA(const unsigned char* data, unsigned int rowStep, GLenum pixelFormat, Level& level)
+{
+    unsigned int numComponents = osg::Image::computeNumComponents(pixelFormat);
+    level.rgba.resize(level.width*level.height*4);
+    unsigned char* out = &level.rgba[0];
+    for(unsigned int y=0; y<level.height; ++y)
+    {
+        const unsigned char* in = data + y*rowStep;
+        for(unsigned int x=0; x<level.width; ++x, in+=numComponents, out+=4)
+        {
+            switch(pixelFormat)
+            {
+                case(GL_RGB):             out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = 255; break;
+                case(GL_RGBA):            out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = in[3]; break;
+                case(GL_BGR):             out[0] = in[2]; out[1] = in[1]; out[2] = in[0]; out[3] = 255; break;
+                case(GL_BGRA):            out[0] = in[2]; out[1] = in[1]; out[2] = in[0]; out[3] = in[3]; break;
+                case(GL_RG):              out[0] = in[0]; out[1] = in[1]; out[2] = 0; out[3] = 255; break;
+                case(GL_LUMINANCE_ALPHA): out[0] = out[1] = out[2] = in[0]; out[3] = in[1]; break;
+                case(GL_ALPHA):           out[0] = out[1] = out[2] = 0; out[3] = in[0]; break;
+                case(GL_INTENSITY):       out[0] = out[1] = out[2] = out[3] = in[0]; break;
+                default:                  out[0] = out[1] = out[2] = in[0]; out[3] = 255; break;
+            }
+        }
+    }
+}
+
+void resizeToPowerOfTwoIfRequired(osg::Image& image)
+{
+    int s = osg::Image::computeNearestPowerOfTwo(image.s());
+    int t = osg::Image::computeNearestPowerOfTwo(image.t());
+    if (s!=image.s() || t!=image.t())
+    {
+        image.scaleImage(s, t, image.r());
+    }
+}
+
+}
+
+GLenum BlockCompressor::getCompressedPixelFormat(osg::Texture::InternalFormatMode compressedFormat, GLenum pixelFormat)
+{
+    if (!isSupportedPixelFormat(pixelFormat)) return 0;
+
+    unsigned int numComponents = osg::Image::computeNumComponents(pixelFormat);
+    switch(compressedFormat)
+    {
+        case(osg::Texture::USE_S3TC_DXT1_COMPRESSION):  return numComponents==4 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case(osg::Texture::USE_S3TC_DXT1c_COMPRESSION): return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case(osg::Texture::USE_S3TC_DXT1a_COMPRESSION): return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case(osg::Texture::USE_S3TC_DXT3_COMPRESSION):  return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        case(osg::Texture::USE_S3TC_DXT5_COMPRESSION):  return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case(osg::Texture::USE_RGTC1_COMPRESSION):      return GL_COMPRESSED_RED_RGTC1_EXT;
+        case(osg::Texture::USE_RGTC2_COMPRESSION):      return GL_COMPRESSED_RED_GREEN_RGTC2_EXT;
+        case(osg::Texture::USE_BPTC_COMPRESSION):       return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+        case(osg::Texture::USE_ETC_COMPRESSION):        return GL_ETC1_RGB8_OES;
+        case(osg::Texture::USE_ETC2_COMPRESSION):
+            switch(numComponents)
+            {
+                case(1): return GL_COMPRESSED_R11_EAC;
+                case(2): return GL_COMPRESSED_RG11_EAC;
+                case(3): return GL_COMPRESSED_RGB8_ETC2;
+                default: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+            }
+        default:
+            return 0;
+    }
+}
+
+void BlockCompressor::compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod /*method*/, CompressionQuality quality)
+{
+    if (image.isCompressed() || !image.data()) return;
+
+    GLenum sourceFormat = image.getPixelFormat();
+    GLenum pixelFormat = getCompressedPixelFormat(compressedFormat, sourceFormat);
+    if (pixelFormat==0 || image.getDataType()!=GL_UNSIGNED_BYTE || image.r()!=1)
+    {
+        OSG_WARN<<"BlockCompressor::compress(..) unable to compress image "<<image.getFileName()<<" of pixel format 0x"<<std::hex<<sourceFormat<<", data type 0x"<<image.getDataType()<<std::dec<<" and depth "<<image.r()<<" with mode "<<compressedFormat<<std::endl;
+        return;
+    }
+
+    if (resizeToPowerOfTwo)
+    {
+        // scaling discards any mipmaps, so have them generated again.
+        if (image.isMipmap()) generateMipMap = true;
+        resizeToPowerOfTwoIfRequired(image);
+    }
+
+    Encoder encoder;
+    encoder.quality = quality;
+    encoder.channels[0] = (sourceFormat==GL_ALPHA) ? 3 : 0;
+    encoder.channels[1] = (sourceFormat==GL_LUMINANCE_ALPHA) ? 3 : 1;
+    switch(pixelFormat)
+    {
+        case(GL_COMPRESSED_RGB_S3TC_DXT1_EXT):      encoder.encoding = ENCODE_BC1; break;
+        case(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT):     encoder.encoding = ENCODE_BC1A; break;
+        case(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT):     encoder.encoding = ENCODE_BC2; break;
+        case(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT):     encoder.encoding = ENCODE_BC3; encoder.channels[0] = 3; break;
+        case(GL_COMPRESSED_RED_RGTC1_EXT):          encoder.encoding = ENCODE_BC4; break;
+        case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT):    encoder.encoding = ENCODE_BC5; break;
+        case(GL_COMPRESSED_RGBA_BPTC_UNORM_ARB):    encoder.encoding = ENCODE_BC7; break;
+        case(GL_COMPRESSED_RGBA8_ETC2_EAC):         encoder.encoding = ENCODE_ETC2_RGBA; encoder.channels[0] = 3; break;
+        case(GL_COMPRESSED_R11_EAC):                encoder.encoding = ENCODE_EAC_R11; break;
+        case(GL_COMPRESSED_RG11_EAC):               encoder.encoding = ENCODE_EAC_RG11; break;
+        default:                                    encoder.encoding = ENCODE_ETC1; break;
+    }
+
+    // convert the existing levels to RGBA, then add the generated ones.
+    unsigned int numSourceLevels = image.isMipmap() ? image.getNumMipmapLevels() : 1;
+    unsigned int numLevels = (generateMipMap || image.isMipmap()) ? osg::Image::computeNumberOfMipmapLevels(image.s(), image.t()) : 1;
+    numSourceLevels = osg::minimum(numSourceLevels, numLevels);
+
+    Levels levels(numLevels);
+    for(unsigned int i=0; i<numLevels; ++i)
+    {
+        Level& level = levels[i];
+        level.width = osg::maximum(image.s()>>i, 1);
+        level.height = osg::maximum(image.t()>>i, 1);
+        if (i<numSourceLevels)
+        {
+            unsigned int rowStep = i==0 ? image.getRowStepInBytes() : osg::Image::computeRowWidthInBytes(level.width, sourceFormat, GL_UNSIGNED_BYTE, image.getPacking());
+            convertToRGBA(image.getMipmapData(i), rowStep, sourceFormat, level);
+        }
+        else
+        {
+            const Level& previous = levels[i-1];
+            level.rgba.resize(level.width*level.height*4);
+            osg::Image::resampleImageData(GL_RGBA, GL_UNSIGNED_BYTE, previous.width, previous.height, &previous.rgba[0], previous.width*4,
+                                          level.width, level.height, &level.rgba[0], level.width*4);
+        }
+    }
+
+    unsigned int blockSize = getBlockSize(encoder.encoding);
+    osg::Image::MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(unsigned int i=0; i<numLevels; ++i)
+    {
+        if (i>0) mipmapOffsets.push_back(totalSize);
+        totalSize += ((levels[i].width+3)/4)*((levels[i].height+3)/4)*blockSize;
+    }
+
+    unsigned char* data = new unsigned char[totalSize];
+
+    BlockRows rows;
+    for(unsigned int i=0; i<numLevels; ++i)
+    {
+        unsigned int numBlockRows = (levels[i].height+3)/4;
+        unsigned int rowSize = ((levels[i].width+3)/4)*blockSize;
+        unsigned char* out = data + (i>0 ? mipmapOffsets[i-1] : 0);
+        for(unsigned int r=0; r<numBlockRows; ++r)
+        {
+            BlockRow blockRow;
+            blockRow.level = &levels[i];
+            blockRow.row = r;
+            blockRow.out = out + r*rowSize;
+            rows.push_back(blockRow);
+        }
+    }
+
+    // small images are quicker to encode than to hand to the thread pool.
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+    if (rows.size()<2 || levels[0].width*levels[0].height<=4096 || threadPool->getNumThreads()==0)
+    {
+        for(BlockRows::const_iterator itr = rows.begin(); itr != rows.end(); ++itr)
+        {
+            encoder.encodeBlockRow(*(itr->level), itr->row, itr->out);
+        }
+    }
+    else
+    {
+        unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, static_cast<unsigned int>(rows.size()));
+
+        OpenThreads::Atomic numRowsTaken;
+        osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+        blockCount->reset();
+
+        for(unsigned int i=0; i<numOperations; ++i)
+        {
+            threadPool->add(new EncodeBlockRowsOperation(encoder, rows, numRowsTaken, blockCount.get()));
+        }
+
+        threadPool->runOperationsUntilCompleted(blockCount.get());
+    }
+
+    image.setImage(image.s(), image.t(), 1, pixelFormat, pixelFormat, GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE, 1);
+    image.setMipmapLevels(mipmapOffsets);
+}
+
+void BlockCompressor::generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod /*method*/)
+{
+    if (image.isCompressed() || !image.data()) return;
+
+    if (image.getDataType()!=GL_UNSIGNED_BYTE || image.r()!=1 || !isSupportedPixelFormat(image.getPixelFormat()))
+    {
+        OSG_WARN<<"BlockCompressor::generateMipMap(..) unable to generate mipmaps for image "<<image.getFileName()<<" of pixel format 0x"<<std::hex<<image.getPixelFormat()<<", data type 0x"<<image.getDataType()<<std::dec<<" and depth "<<image.r()<<std::endl;
+        return;
+    }
+
+    if (resizeToPowerOfTwo) resizeToPowerOfTwoIfRequired(image);
+
+    image.generateMipmaps();
+}
@@ -47,6 +47,7 @@ static osg::ApplicationUsageProxy DatabasePager_e0(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_DRAWABLE <mode>","Set the drawable policy for setting of loaded drawable to specified type.  mode can be one of DoNotModify, DisplayList, VBO or VertexArrays>.");
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_ORDERING <mode>","Set the order in which requests are loaded, FrameThenPriority or Priority.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
 
 // Convert function objects that take pointer args into functions that a
@@ -401,15 +402,62 @@ protected:
 //
 struct DatabasePager::SortFileRequestFunctor
 {
+    SortFileRequestFunctor(DatabasePager::RequestOrdering ordering):
+        _ordering(ordering) {}
+
     bool operator() (const osg::ref_ptr<DatabasePager::DatabaseRequest>& lhs,const osg::ref_ptr<DatabasePager::DatabaseRequest>& rhs) const
     {
+        if (_ordering==DatabasePager::ORDER_BY_PRIORITY)
+        {
+            if (lhs->_priorityLastRequest>rhs->_priorityLastRequest) return true;
+            else if (lhs->_priorityLastRequest<rhs->_priorityLastRequest) return false;
+            else return (lhs->_timestampLastRequest>rhs->_timestampLastRequest);
+        }
+
         if (lhs->_timestampLastRequest>rhs->_timestampLastRequest) return true;
         else if (lhs->_timestampLastRequest<rhs->_timestampLastRequest) return false;
         else return (lhs->_priorityLastRequest>rhs->_priorityLastRequest);
     }
+
+    DatabasePager::RequestOrdering _ordering;
 };
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  LatencyHistogram
+//
+void DatabasePager::LatencyHistogram::reset()
+{
+    for(unsigned int i=0; i<NUM_BUCKETS; ++i) _buckets[i] = 0;
+    _numSamples = 0;
+    _totalLatency = 0.0;
+    _maximumLatency = 0.0;
+}
+
+void DatabasePager::LatencyHistogram::addSample(double latency_ms)
+{
+    unsigned int bucket = 0;
+    double upperBound = 1.0;
+    while(bucket<NUM_BUCKETS-1 && latency_ms>=upperBound)
+    {
+        ++bucket;
+        upperBound *= 2.0;
+    }
+
+    ++_buckets[bucket];
+    ++_numSamples;
+    _totalLatency += latency_ms;
+    if (latency_ms>_maximumLatency) _maximumLatency = latency_ms;
+}
+
+double DatabasePager::LatencyHistogram::getBucketUpperBound(unsigned int i) const
+{
+    if (i>=NUM_BUCKETS-1) return DBL_MAX;
+    return static_cast<double>(1u<<i);
+}
+
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -479,6 +527,7 @@ bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
             else
             {
                 invalidate(citr->get());
+                ++_stats._numRequestsCancelled;
 
                 OSG_INFO<<"DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<(*citr)<<std::endl;
                 citr = _requestList.erase(citr);
@@ -552,6 +601,7 @@ void DatabasePager::RequestQueue::remove(DatabasePager::DatabaseRequest* databas
 
 void DatabasePager::RequestQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
 {
+    databaseRequest->_tickQueued = osg::Timer::instance()->tick();
     _requestList.push_back(databaseRequest);
     updateBlock();
 }
@@ -568,7 +618,7 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
 
     if (!_requestList.empty())
     {
-        DatabasePager::SortFileRequestFunctor highPriority;
+        DatabasePager::SortFileRequestFunctor highPriority(_pager->_requestOrdering);
 
         RequestQueue::RequestList::iterator selected_itr = _requestList.end();
 
@@ -591,6 +641,7 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
             else
             {
                 invalidate(citr->get());
+                ++_stats._numRequestsCancelled;
 
                 OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<(*citr)<<std::endl;
                 citr = _requestList.erase(citr);
@@ -604,6 +655,7 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
         {
             databaseRequest = *selected_itr;
             _requestList.erase(selected_itr);
+            _stats._waitLatency.addSample(osg::Timer::instance()->delta_m(databaseRequest->_tickQueued, osg::Timer::instance()->tick()));
             OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
         }
         else
@@ -828,7 +880,8 @@ void DatabasePager::DatabaseThread::run()
                 // need to disable any attempt to use the cache when loading as we're handle this ourselves to avoid threading conflicts
                 {
                     OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-                    databaseRequest->_objectCache = new ObjectCache;
+                    // the request's cache is only filled by this thread, so doesn't need to be sharded.
+                    databaseRequest->_objectCache = new ObjectCache(1);
                     dr_loadOptions->setObjectCache(databaseRequest->_objectCache.get());
                 }
             }
@@ -896,14 +949,33 @@ void DatabasePager::DatabaseThread::run()
         }
 
 
+        // the cache lookups above may have taken a while, so check again that the request
+        // hasn't dropped out of view before committing to the read.
+        if (databaseRequest.valid())
+        {
+            bool requestCurrent = true;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                requestCurrent = databaseRequest->isRequestCurrent(_pager->_frameNumber);
+            }
+
+            if (!requestCurrent)
+            {
+                OSG_INFO<<_name<<": DatabaseRequest dropped out of view before being read, cancelling."<<std::endl;
+
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(read_queue->_requestMutex);
+                ++(read_queue->_stats._numRequestsCancelled);
+                databaseRequest = 0;
+            }
+        }
+
         if (databaseRequest.valid())
         {
 
             // load the data, note safe to write to the databaseRequest since once
             // it is created this thread is the only one to write to the _loadedModel pointer.
             //OSG_NOTICE<<"In DatabasePager thread readNodeFile("<<databaseRequest->_fileName<<")"<<std::endl;
-            //osg::Timer_t before = osg::Timer::instance()->tick();
-
+            osg::Timer_t startReadTick = osg::Timer::instance()->tick();
 
             // assume that readNode is thread safe...
             ReaderWriter::ReadResult rr = readFromFileCache ?
@@ -922,16 +994,30 @@ void DatabasePager::DatabaseThread::run()
                 fileCache->writeNode(*(loadedModel), fileName, dr_loadOptions.get());
             }
 
+            bool loadDiscarded = false;
             {
                 OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                 if ((_pager->_frameNumber-databaseRequest->_frameNumberLastRequest)>1)
                 {
                     OSG_INFO<<_name<<": Warning DatabaseRquest no longer required."<<std::endl;
+                    loadDiscarded = loadedModel.valid();
                     loadedModel = 0;
                 }
             }
 
-            //OSG_NOTICE<<"     node read in "<<osg::Timer::instance()->delta_m(before,osg::Timer::instance()->tick())<<" ms"<<std::endl;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(read_queue->_requestMutex);
+                read_queue->_stats._readLatency.addSample(osg::Timer::instance()->delta_m(startReadTick, osg::Timer::instance()->tick()));
+                if (loadDiscarded) ++(read_queue->_stats._numLoadsDiscarded);
+            }
+
+            osg::ref_ptr<osg::Stats> stats = _pager->_stats;
+            if (stats.valid() && stats->collectStats("paging"))
+            {
+                static const osg::Stats::AttributeKey s_readKey = osg::Stats::getAttributeKey("DatabasePager read");
+                osg::Timer* timer = osg::Timer::instance();
+                stats->addEvent(s_readKey, timer->delta_s(timer->getStartTick(), startReadTick), timer->time_s());
+            }
 
             if (loadedModel.valid())
             {
@@ -1098,6 +1184,13 @@ DatabasePager::DatabasePager()
                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
     }
 
+    _requestOrdering = ORDER_BY_FRAME_THEN_PRIORITY;
+    if( (str = getenv("OSG_DATABASE_PAGER_ORDERING")) != 0)
+    {
+        if (strcmp(str,"Priority")==0) _requestOrdering = ORDER_BY_PRIORITY;
+        else if (strcmp(str,"FrameThenPriority")==0) _requestOrdering = ORDER_BY_FRAME_THEN_PRIORITY;
+    }
+
     // initialize the stats variables
     resetStats();
 
@@ -1177,6 +1270,8 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _doPreCompile = rhs._doPreCompile;
 
+    _requestOrdering = rhs._requestOrdering;
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
 
@@ -1385,6 +1480,30 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+
+    if (_fileRequestQueue.valid())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
+        _fileRequestQueue->_stats.reset();
+    }
+
+    if (_httpRequestQueue.valid())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
+        _httpRequestQueue->_stats.reset();
+    }
+}
+
+void DatabasePager::getFileRequestQueueStats(RequestQueueStats& stats) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
+    stats = _fileRequestQueue->_stats;
+}
+
+void DatabasePager::getHttpRequestQueueStats(RequestQueueStats& stats) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
+    stats = _httpRequestQueue->_stats;
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1746,6 +1865,12 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
     last = osg::Timer::instance()->tick();
 
+    if (!localFileLoadedList.empty() && _stats.valid() && _stats->collectStats("paging"))
+    {
+        osg::Timer* timer = osg::Timer::instance();
+        _stats->addEvent("DatabasePager merge", timer->delta_s(timer->getStartTick(), before), timer->delta_s(timer->getStartTick(), last));
+    }
+
     if (!localFileLoadedList.empty())
     {
         OSG_INFO<<"Done DatabasePager::addLoadedDataToSceneGraph"<<
@@ -14,6 +14,11 @@
 #include <osgDB/ObjectCache>
 #include <osgDB/Options>
 
+#include <osg/Geometry>
+#include <osg/Texture>
+
+#include <set>
+
 using namespace osgDB;
 
 bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair& lhs, const ObjectCache::FileNameOptionsPair& rhs) const
@@ -36,19 +41,306 @@ bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair&
     return lhs.second < rhs.second;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ComputeSizeVisitor
+//
+namespace
+{
+
+// sums the size of the objects in a subgraph and the data they hold, counting each shared object once.
+class ComputeSizeVisitor : public osg::NodeVisitor
+{
+public:
+
+    ComputeSizeVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _sizeInBytes(0) {}
+
+    unsigned long long getSizeInBytes() const { return _sizeInBytes; }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (!addObject(&node, sizeof(osg::Group))) return;
+
+        addStateSet(node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Drawable& drawable)
+    {
+        if (!addObject(&drawable, sizeof(osg::Drawable))) return;
+
+        addStateSet(drawable.getStateSet());
+    }
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        if (!addObject(&geometry, sizeof(osg::Geometry))) return;
+
+        addStateSet(geometry.getStateSet());
+
+        osg::Geometry::ArrayList arrays;
+        geometry.getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+        {
+            addBufferData(itr->get(), sizeof(osg::Array));
+        }
+
+        osg::Geometry::PrimitiveSetList& primitives = geometry.getPrimitiveSetList();
+        for(osg::Geometry::PrimitiveSetList::iterator itr = primitives.begin(); itr != primitives.end(); ++itr)
+        {
+            addBufferData(itr->get(), sizeof(osg::PrimitiveSet));
+        }
+    }
+
+    void addStateSet(osg::StateSet* stateset)
+    {
+        if (!stateset || !addObject(stateset, sizeof(osg::StateSet))) return;
+
+        osg::StateSet::TextureAttributeList& textureAttributes = stateset->getTextureAttributeList();
+        for(osg::StateSet::TextureAttributeList::iterator itr = textureAttributes.begin(); itr != textureAttributes.end(); ++itr)
+        {
+            for(osg::StateSet::AttributeList::iterator aitr = itr->begin(); aitr != itr->end(); ++aitr)
+            {
+                addTexture(dynamic_cast<osg::Texture*>(aitr->second.first.get()));
+            }
+        }
+    }
+
+    void addTexture(osg::Texture* texture)
+    {
+        if (!texture || !addObject(texture, sizeof(osg::Texture))) return;
+
+        for(unsigned int i=0; i<texture->getNumImages(); ++i)
+        {
+            addBufferData(texture->getImage(i), sizeof(osg::Image));
+        }
+    }
+
+    void addBufferData(osg::BufferData* bufferData, unsigned int objectSize)
+    {
+        if (bufferData && addObject(bufferData, objectSize)) _sizeInBytes += bufferData->getTotalDataSize();
+    }
+
+    void addObject(const osg::Object* object)
+    {
+        osg::Object* nonConstObject = const_cast<osg::Object*>(object);
+        if (osg::Node* node = nonConstObject->asNode()) node->accept(*this);
+        else if (osg::StateSet* stateset = dynamic_cast<osg::StateSet*>(nonConstObject)) addStateSet(stateset);
+        else if (osg::Texture* texture = dynamic_cast<osg::Texture*>(nonConstObject)) addTexture(texture);
+        else if (osg::BufferData* bufferData = dynamic_cast<osg::BufferData*>(nonConstObject)) addBufferData(bufferData, sizeof(osg::BufferData));
+        else addObject(object, sizeof(osg::Object));
+    }
+
+protected:
+
+    bool addObject(const osg::Object* object, unsigned int objectSize)
+    {
+        if (!_objects.insert(object).second) return false;
+
+        _sizeInBytes += objectSize;
+        return true;
+    }
+
+    std::set<const osg::Object*>    _objects;
+    unsigned long long              _sizeInBytes;
+};
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // ObjectCache
 //
+static const unsigned int s_defaultNumShards = 16;
+
 ObjectCache::ObjectCache():
-    osg::Referenced(true)
+    osg::Referenced(true),
+    _shards(new Shard[s_defaultNumShards]),
+    _numShards(s_defaultNumShards),
+    _maximumNumObjects(0),
+    _maximumSizeInBytes(0)
 {
 //    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
 }
 
+ObjectCache::ObjectCache(unsigned int numShards):
+    osg::Referenced(true),
+    _shards(new Shard[osg::maximum(numShards, 1u)]),
+    _numShards(osg::maximum(numShards, 1u)),
+    _maximumNumObjects(0),
+    _maximumSizeInBytes(0)
+{
+}
+
 ObjectCache::~ObjectCache()
 {
 //    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
+    delete [] _shards;
+}
+
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName) const
+{
+    if (_numShards==1) return _shards[0];
+
+    // FNV-1a hash of the file name, the Options are compared by value so can't be hashed.
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin(); itr != fileName.end(); ++itr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return _shards[hash % _numShards];
+}
+
+void ObjectCache::touch(Shard& shard, ObjectCacheMap::iterator itr)
+{
+    shard.leastRecentlyUsed.splice(shard.leastRecentlyUsed.end(), shard.leastRecentlyUsed, itr->second.lruItr);
+}
+
+void ObjectCache::insert(Shard& shard, ObjectCacheMap::iterator itr)
+{
+    shard.leastRecentlyUsed.push_back(&(itr->first));
+    itr->second.lruItr = --shard.leastRecentlyUsed.end();
+    shard.cacheStats.sizeInBytes += itr->second.sizeInBytes;
+}
+
+void ObjectCache::erase(Shard& shard, ObjectCacheMap::iterator itr)
+{
+    shard.cacheStats.sizeInBytes -= itr->second.sizeInBytes;
+    shard.leastRecentlyUsed.erase(itr->second.lruItr);
+    shard.objectCache.erase(itr);
+}
+
+void ObjectCache::removeLeastRecentlyUsed(Shard& shard)
+{
+    if (_maximumNumObjects>0)
+    {
+        unsigned int maximumPerShard = osg::maximum((_maximumNumObjects+_numShards-1)/_numShards, 1u);
+        while(shard.objectCache.size()>maximumPerShard)
+        {
+            ObjectCacheMap::iterator itr = shard.objectCache.find(*shard.leastRecentlyUsed.front());
+            OSG_DEBUG<<"Removing least recently used "<<itr->first.first<<" from ObjectCache "<<this<<std::endl;
+            erase(shard, itr);
+            ++shard.cacheStats.numEvictions;
+        }
+    }
+
+    if (_maximumSizeInBytes>0 && !shard.leastRecentlyUsed.empty())
+    {
+        unsigned long long budgetPerShard = (_maximumSizeInBytes+_numShards-1)/_numShards;
+        LeastRecentlyUsedList::iterator litr = shard.leastRecentlyUsed.begin();
+        LeastRecentlyUsedList::iterator newest = --shard.leastRecentlyUsed.end();
+        while(shard.cacheStats.sizeInBytes>budgetPerShard && litr!=newest)
+        {
+            ObjectCacheMap::iterator itr = shard.objectCache.find(**litr);
+            ++litr;
+
+            // removing an object referenced elsewhere wouldn't free its memory, so keep it.
+            if (itr->second.object.valid() && itr->second.object->referenceCount()>1) continue;
+
+            OSG_DEBUG<<"Removing least recently used "<<itr->first.first<<" from ObjectCache "<<this<<" to stay within budget"<<std::endl;
+            erase(shard, itr);
+            ++shard.cacheStats.numEvictions;
+        }
+    }
+}
+
+void ObjectCache::setMaximumNumObjects(unsigned int num)
+{
+    _maximumNumObjects = num;
+
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i].mutex);
+        removeLeastRecentlyUsed(_shards[i]);
+    }
+}
+
+void ObjectCache::setMaximumSizeInBytes(unsigned long long size)
+{
+    _maximumSizeInBytes = size;
+
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i].mutex);
+        removeLeastRecentlyUsed(_shards[i]);
+    }
+}
+
+unsigned long long ObjectCache::getSizeInBytes() const
+{
+    unsigned long long size = 0;
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i].mutex);
+        size += _shards[i].cacheStats.sizeInBytes;
+    }
+    return size;
+}
+
+unsigned long long ObjectCache::computeSizeInBytes(const osg::Object* object) const
+{
+    if (!object) return 0;
+
+    ComputeSizeVisitor csv;
+    csv.addObject(object);
+    return csv.getSizeInBytes();
+}
+
+void ObjectCache::getCacheStats(CacheStats& cacheStats) const
+{
+    cacheStats = CacheStats();
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+        cacheStats.numObjects += static_cast<unsigned int>(shard.objectCache.size());
+        cacheStats.sizeInBytes += shard.cacheStats.sizeInBytes;
+        cacheStats.numHits += shard.cacheStats.numHits;
+        cacheStats.numMisses += shard.cacheStats.numMisses;
+        cacheStats.numEvictions += shard.cacheStats.numEvictions;
+    }
+}
+
+void ObjectCache::resetCacheStats()
+{
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+        shard.cacheStats.numHits = 0;
+        shard.cacheStats.numMisses = 0;
+        shard.cacheStats.numEvictions = 0;
+    }
+    _reportedCacheStats = CacheStats();
+}
+
+void ObjectCache::reportStats(osg::Stats* stats, unsigned int frameNumber)
+{
+    if (!stats) return;
+
+    CacheStats cacheStats;
+    getCacheStats(cacheStats);
+
+    stats->setAttribute(frameNumber, "Object cache objects", static_cast<double>(cacheStats.numObjects));
+    stats->setAttribute(frameNumber, "Object cache size", static_cast<double>(cacheStats.sizeInBytes));
+    stats->setAttribute(frameNumber, "Object cache hits", static_cast<double>(cacheStats.numHits-_reportedCacheStats.numHits));
+    stats->setAttribute(frameNumber, "Object cache misses", static_cast<double>(cacheStats.numMisses-_reportedCacheStats.numMisses));
+    stats->setAttribute(frameNumber, "Object cache evictions", static_cast<double>(cacheStats.numEvictions-_reportedCacheStats.numEvictions));
+
+    _reportedCacheStats = cacheStats;
+}
+
+unsigned int ObjectCache::getNumObjects() const
+{
+    unsigned int num = 0;
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i].mutex);
+        num += static_cast<unsigned int>(_shards[i].objectCache.size());
+    }
+    return num;
 }
 
 void ObjectCache::addObjectCache(ObjectCache* objectCache)
@@ -56,28 +348,68 @@ void ObjectCache::addObjectCache(ObjectCache* objectCache)
     // don't allow a cache to be added to itself.
     if (objectCache==this) return;
 
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
+    for(unsigned int i=0; i<objectCache->_numShards; ++i)
+    {
+        // lock the other ObjectCache's shard to prevent its contents from being modified by other threads while we merge,
+        // then lock each of our shards in turn so that only one of our locks is held at a time.
+        Shard& source = objectCache->_shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(source.mutex);
+
+        OSG_DEBUG<<"Inserting objects to main ObjectCache "<<source.objectCache.size()<<std::endl;
 
-    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
+        for(ObjectCacheMap::iterator itr = source.objectCache.begin();
+            itr != source.objectCache.end();
+            ++itr)
+        {
+            Shard& shard = getShard(itr->first.first);
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(shard.mutex);
 
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
+            std::pair<ObjectCacheMap::iterator, bool> result = shard.objectCache.insert(*itr);
+            if (result.second)
+            {
+                insert(shard, result.first);
+                removeLeastRecentlyUsed(shard);
+            }
+        }
+    }
 }
 
 
 void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[FileNameOptionsPair(filename, osg::clone(options))] = ObjectTimeStampPair(object,timestamp);
+    // estimate the size before locking as it traverses the object.
+    unsigned long long sizeInBytes = computeSizeInBytes(object);
+
+    Shard& shard = getShard(filename);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+    std::pair<ObjectCacheMap::iterator, bool> result = shard.objectCache.insert(ObjectCacheMap::value_type(FileNameOptionsPair(filename, osg::clone(options)), ObjectCacheEntry()));
+    ObjectCacheEntry& entry = result.first->second;
+    entry.object = object;
+    entry.timestamp = timestamp;
+    if (result.second)
+    {
+        entry.sizeInBytes = sizeInBytes;
+        insert(shard, result.first);
+    }
+    else
+    {
+        shard.cacheStats.sizeInBytes = shard.cacheStats.sizeInBytes - entry.sizeInBytes + sizeInBytes;
+        entry.sizeInBytes = sizeInBytes;
+        touch(shard, result.first);
+    }
+
     OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+
+    removeLeastRecentlyUsed(shard);
 }
 
 osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(FileNameOptionsPair(fileName, options));
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+    ObjectCacheMap::iterator itr = shard.objectCache.find(FileNameOptionsPair(fileName, options));
+    if (itr!=shard.objectCache.end())
     {
         osg::ref_ptr<const osgDB::Options> o = itr->first.second;
         if (o.valid())
@@ -88,17 +420,24 @@ osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+        touch(shard, itr);
+        ++shard.cacheStats.numHits;
+        return itr->second.object.get();
+    }
+    else
+    {
+        ++shard.cacheStats.numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
     ObjectCacheMap::iterator itr;
-    itr = _objectCache.find(FileNameOptionsPair(fileName, options));
-    if (itr!=_objectCache.end())
+    itr = shard.objectCache.find(FileNameOptionsPair(fileName, options));
+    if (itr!=shard.objectCache.end())
     {
         osg::ref_ptr<const osgDB::Options> o = itr->first.second;
         if (o.valid())
@@ -109,70 +448,94 @@ osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string&
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+        touch(shard, itr);
+        ++shard.cacheStats.numHits;
+        return itr->second.object.get();
+    }
+    else
+    {
+        ++shard.cacheStats.numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for(unsigned int i=0; i<_numShards; ++i)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(ObjectCacheMap::iterator itr=shard.objectCache.begin();
+            itr!=shard.objectCache.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second.object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second.timestamp = referenceTime;
+            }
         }
     }
 }
 
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+    for(unsigned int i=0; i<_numShards; ++i)
     {
-        if (oitr->second.second<=expiryTime)
-        {
-            _objectCache.erase(oitr++);
-        }
-        else
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+        // Remove expired entries from object cache
+        ObjectCacheMap::iterator oitr = shard.objectCache.begin();
+        while(oitr != shard.objectCache.end())
         {
-            ++oitr;
+            if (oitr->second.timestamp<=expiryTime)
+            {
+                erase(shard, oitr++);
+            }
+            else
+            {
+                ++oitr;
+            }
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(FileNameOptionsPair(fileName, options));
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+    ObjectCacheMap::iterator itr = shard.objectCache.find(FileNameOptionsPair(fileName, options));
+    if (itr!=shard.objectCache.end()) erase(shard, itr);
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(unsigned int i=0; i<_numShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i].mutex);
+        _shards[i].objectCache.clear();
+        _shards[i].leastRecentlyUsed.clear();
+        _shards[i].cacheStats.sizeInBytes = 0;
+    }
 }
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for(unsigned int i=0; i<_numShards; ++i)
     {
-        osg::Object* object = itr->second.first.get();
-        object->releaseGLObjects(state);
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mutex);
+
+        for(ObjectCacheMap::iterator itr = shard.objectCache.begin();
+            itr != shard.objectCache.end();
+            ++itr)
+        {
+            osg::Object* object = itr->second.object.get();
+            object->releaseGLObjects(state);
+        }
     }
 }
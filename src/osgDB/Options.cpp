@@ -24,6 +24,8 @@ Options::Options(const Options& options,const osg::CopyOp& copyop):
     _objectCache(options._objectCache),
     _precisionHint(options._precisionHint),
     _buildKdTreesHint(options._buildKdTreesHint),
+    _imageCompressionHint(options._imageCompressionHint),
+    _precomputeMipmapsHint(options._precomputeMipmapsHint),
     _pluginData(options._pluginData),
     _pluginStringData(options._pluginStringData),
     _findFileCallback(options._findFileCallback),
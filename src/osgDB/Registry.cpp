@@ -17,6 +17,7 @@
 #include <osg/Notify>
 #include <osg/Object>
 #include <osg/Image>
+#include <osg/ImageStream>
 #include <osg/Shader>
 #include <osg/Node>
 #include <osg/Group>
@@ -30,6 +31,9 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/fstream>
 #include <osgDB/Archive>
+#include <osgDB/BlockCompressor>
+
+#include <OpenThreads/Thread>
 
 #include <algorithm>
 #include <set>
@@ -62,18 +66,47 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_OBJECT_CACHE_SIZE <megabytes>","Set the memory budget of the Registry's ObjectCache, evicting the least recently used objects beyond it.");
 
 
 // from MimeTypes.cpp
 extern const char* builtinMimeTypeExtMappings[];
 
 
+// Gives read access to the current snapshot of the ReaderWriterList without taking the _pluginMutex.
+// updateReaderWriterSnapshot() only deletes a replaced snapshot once there are no readers left, so the
+// snapshot, and the ReaderWriters it points to, stay valid for the lifetime of the reader.
+class Registry::ReaderWriterSnapshotReader
+{
+public:
+    ReaderWriterSnapshotReader(const Registry* registry):
+        _numReaders(registry->_numRwSnapshotReaders)
+    {
+        ++_numReaders;
+        _snapshot = static_cast<const Registry::ReaderWriterSnapshot*>(registry->_rwSnapshot.get());
+    }
+
+    ~ReaderWriterSnapshotReader()
+    {
+        --_numReaders;
+    }
+
+    const Registry::ReaderWriterSnapshot& operator * () const { return *_snapshot; }
+    const Registry::ReaderWriterSnapshot* operator -> () const { return _snapshot; }
+
+protected:
+
+    ReaderWriterSnapshotReader& operator = (const ReaderWriterSnapshotReader&) { return *this; }
+
+    OpenThreads::Atomic&                    _numReaders;
+    const Registry::ReaderWriterSnapshot*   _snapshot;
+};
+
 class Registry::AvailableReaderWriterIterator
 {
 public:
-    AvailableReaderWriterIterator(Registry::ReaderWriterList& rwList, OpenThreads::ReentrantMutex& pluginMutex):
-        _rwList(rwList),
-        _pluginMutex(pluginMutex) {}
+    AvailableReaderWriterIterator(Registry* registry):
+        _registry(registry) {}
 
 
     ReaderWriter& operator * () { return *get(); }
@@ -91,20 +124,20 @@ protected:
 
     AvailableReaderWriterIterator& operator = (const AvailableReaderWriterIterator&) { return *this; }
 
-    Registry::ReaderWriterList&     _rwList;
-    OpenThreads::ReentrantMutex&    _pluginMutex;
+    Registry*                       _registry;
 
     std::set<ReaderWriter*>         _rwUsed;
 
     ReaderWriter* get()
     {
-        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
-        Registry::ReaderWriterList::iterator itr=_rwList.begin();
-        for(;itr!=_rwList.end();++itr)
+        // take a fresh snapshot each time, as plugins may have been loaded since the last call.
+        Registry::ReaderWriterSnapshotReader snapshot(_registry);
+        Registry::ReaderWriterSnapshot::const_iterator itr=snapshot->begin();
+        for(;itr!=snapshot->end();++itr)
         {
-            if (_rwUsed.find(itr->get())==_rwUsed.end())
+            if (_rwUsed.find(*itr)==_rwUsed.end())
             {
-                return itr->get();
+                return *itr;
             }
         }
         return 0;
@@ -223,6 +256,8 @@ Registry::Registry()
     // comment out because it was causing problems under OSX - causing it to crash osgconv when constructing ostream in osg::notify().
     // OSG_INFO << "Constructing osg::Registry"<<std::endl;
 
+    _rwSnapshot.assign(new ReaderWriterSnapshot, 0);
+
     _buildKdTreesHint = Options::NO_PREFERENCE;
     _kdTreeBuilder = new osg::KdTreeBuilder;
 
@@ -252,6 +287,13 @@ Registry::Registry()
     // assign ObjectCache.
     _objectCache = new ObjectCache;
 
+    if( (ptr = getenv("OSG_MAX_OBJECT_CACHE_SIZE")) != 0)
+    {
+        double megabytes = osg::asciiToDouble(ptr);
+        _objectCache->setMaximumSizeInBytes(static_cast<unsigned long long>(osg::maximum(megabytes, 0.0)*1024.0*1024.0));
+        OSG_INFO<<"Registry : Maximum object cache size = "<<megabytes<<"MB"<<std::endl;
+    }
+
     _createNodeFromImage = false;
     _openingLibrary = false;
 
@@ -474,6 +516,8 @@ Registry::Registry()
 Registry::~Registry()
 {
     destruct();
+
+    delete static_cast<ReaderWriterSnapshot*>(_rwSnapshot.get());
 }
 
 void Registry::destruct()
@@ -606,6 +650,7 @@ void Registry::addReaderWriter(ReaderWriter* rw)
 
     _rwList.push_back(rw);
 
+    updateReaderWriterSnapshot();
 }
 
 
@@ -621,8 +666,34 @@ void Registry::removeReaderWriter(ReaderWriter* rw)
     if (rwitr!=_rwList.end())
     {
         _rwList.erase(rwitr);
+
+        updateReaderWriterSnapshot();
+    }
+
+}
+
+void Registry::updateReaderWriterSnapshot()
+{
+    ReaderWriterSnapshot* snapshot = new ReaderWriterSnapshot;
+    snapshot->reserve(_rwList.size());
+    for(ReaderWriterList::iterator itr=_rwList.begin();
+        itr!=_rwList.end();
+        ++itr)
+    {
+        snapshot->push_back(itr->get());
     }
 
+    ReaderWriterSnapshot* previous = static_cast<ReaderWriterSnapshot*>(_rwSnapshot.get());
+    _rwSnapshot.assign(snapshot, previous);
+
+    // wait for the readers that may still be using the previous snapshot before deleting it,
+    // readers only hold a snapshot for the duration of a search so this is brief.
+    while(_numRwSnapshotReaders>0)
+    {
+        OpenThreads::Thread::YieldCurrentThread();
+    }
+
+    delete previous;
 }
 
 ImageProcessor* Registry::getImageProcessor()
@@ -634,7 +705,14 @@ ImageProcessor* Registry::getImageProcessor()
             return _ipList.front().get();
         }
     }
-    return getImageProcessorForExtension("nvtt");
+
+    ImageProcessor* ip = getImageProcessorForExtension("nvtt");
+    if (ip) return ip;
+
+    // no plugin is available so fall back to the built in block compressor
+    OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
+    if (_ipList.empty()) _ipList.push_back(new BlockCompressor);
+    return _ipList.front().get();
 }
 
 ImageProcessor* Registry::getImageProcessorForExtension(const std::string& ext)
@@ -862,6 +940,17 @@ DynamicLibrary* Registry::getLibrary(const std::string& fileName)
 
 ReaderWriter* Registry::getReaderWriterForExtension(const std::string& ext)
 {
+    // first search the installed loaders without locking, as loading a file will usually find its plugin already loaded.
+    {
+        ReaderWriterSnapshotReader snapshot(this);
+        for(ReaderWriterSnapshot::const_iterator itr=snapshot->begin();
+            itr!=snapshot->end();
+            ++itr)
+        {
+            if((*itr)->acceptsExtension(ext)) return *itr;
+        }
+    }
+
     // record the existing reader writer.
     std::set<ReaderWriter*> rwOriginal;
 
@@ -1179,7 +1268,7 @@ ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::ReadResult rr = readFunctor.doRead(*itr);
@@ -1272,6 +1361,7 @@ ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFun
         }
 
         ReaderWriter::ReadResult rr = read(readFunctor);
+        _processImagesIfRequired(rr, options);
         if (rr.validObject())
         {
             // search AGAIN for entry in the object cache.
@@ -1300,10 +1390,90 @@ ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFun
     else
     {
         ReaderWriter::ReadResult rr = read(readFunctor);
+        _processImagesIfRequired(rr, options);
         return rr;
     }
 }
 
+namespace
+{
+
+class ProcessImagesVisitor : public osg::NodeVisitor
+{
+public:
+
+    // the images to process, and whether their mipmaps are required.
+    typedef std::map<osg::Image*, bool> Images;
+
+    ProcessImagesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Node& node)
+    {
+        if (node.getStateSet()) apply(*node.getStateSet());
+        traverse(node);
+    }
+
+    void apply(osg::StateSet& stateset)
+    {
+        const osg::StateSet::TextureAttributeList& tal = stateset.getTextureAttributeList();
+        for(unsigned int unit=0; unit<tal.size(); ++unit)
+        {
+            osg::Texture* texture = dynamic_cast<osg::Texture*>(stateset.getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+            if (!texture) continue;
+
+            osg::Texture::FilterMode minFilter = texture->getFilter(osg::Texture::MIN_FILTER);
+            bool mipmapped = minFilter!=osg::Texture::LINEAR && minFilter!=osg::Texture::NEAREST;
+
+            for(unsigned int i=0; i<texture->getNumImages(); ++i)
+            {
+                osg::Image* image = texture->getImage(i);
+                if (image) _images[image] = _images[image] || mipmapped;
+            }
+        }
+    }
+
+    Images _images;
+};
+
+}
+
+void Registry::_processImagesIfRequired(ReaderWriter::ReadResult& result, const Options* options)
+{
+    if (!options) return;
+
+    osg::Texture::InternalFormatMode mode = options->getImageCompressionHint();
+    bool compress = mode!=osg::Texture::USE_IMAGE_DATA_FORMAT && mode!=osg::Texture::USE_USER_DEFINED_FORMAT;
+    bool precomputeMipmaps = options->getPrecomputeMipmapsHint();
+    if (!compress && !precomputeMipmaps) return;
+
+    ProcessImagesVisitor piv;
+    if (result.validImage()) piv._images[result.getImage()] = true;
+    else if (result.validNode()) result.getNode()->accept(piv);
+    else return;
+
+    if (piv._images.empty()) return;
+
+    ImageProcessor* ip = compress ? getImageProcessor() : 0;
+
+    for(ProcessImagesVisitor::Images::iterator itr = piv._images.begin();
+        itr != piv._images.end();
+        ++itr)
+    {
+        osg::Image* image = itr->first;
+        if (image->isCompressed() || dynamic_cast<osg::ImageStream*>(image)) continue;
+
+        // textures can't be given mipmapped images that need to be rescaled to a power of two.
+        bool powerOfTwo = (image->s() & (image->s()-1))==0 && (image->t() & (image->t()-1))==0;
+        if (precomputeMipmaps && itr->second && powerOfTwo && !image->isMipmap() && image->r()==1)
+        {
+            image->generateMipmaps();
+        }
+
+        if (ip) ip->compress(*image, mode, itr->second && !image->isMipmap(), false, ImageProcessor::USE_CPU, ImageProcessor::NORMAL);
+    }
+}
+
 
 ReaderWriter::ReadResult Registry::openArchiveImplementation(const std::string& fileName, ReaderWriter::ArchiveStatus status, unsigned int indexBlockSizeHint, const Options* options)
 {
@@ -1335,7 +1505,7 @@ ReaderWriter::WriteResult Registry::writeObjectImplementation(const Object& obj,
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeObject(obj,fileName,options);
@@ -1381,7 +1551,7 @@ ReaderWriter::WriteResult Registry::writeImageImplementation(const Image& image,
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeImage(image,fileName,options);
@@ -1426,7 +1596,7 @@ ReaderWriter::WriteResult Registry::writeHeightFieldImplementation(const HeightF
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeHeightField(HeightField,fileName,options);
@@ -1483,7 +1653,7 @@ ReaderWriter::WriteResult Registry::writeNodeImplementation(const Node& node,con
     Results results;
 
     // first attempt to write the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeNode(node,fileName,options);
@@ -1529,7 +1699,7 @@ ReaderWriter::WriteResult Registry::writeShaderImplementation(const Shader& shad
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeShader(shader,fileName,options);
@@ -1576,7 +1746,7 @@ ReaderWriter::WriteResult Registry::writeScriptImplementation(const Script& imag
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(this);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeScript(image,fileName,options);
@@ -1709,7 +1879,8 @@ bool Registry::isProtocolRegistered(const std::string& protocol)
 
 void Registry::getReaderWriterListForProtocol(const std::string& protocol, ReaderWriterList& results) const
 {
-    for(ReaderWriterList::const_iterator i = _rwList.begin(); i != _rwList.end(); ++i)
+    ReaderWriterSnapshotReader snapshot(this);
+    for(ReaderWriterSnapshot::const_iterator i = snapshot->begin(); i != snapshot->end(); ++i)
     {        if ((*i)->acceptsProtocol(protocol))
             results.push_back(*i);
     }
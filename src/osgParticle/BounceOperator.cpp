@@ -18,141 +18,215 @@
 
 using namespace osgParticle;
 
-void BounceOperator::handleTriangle( const Domain& domain, Particle* P, double dt )
+void BounceOperator::operateParticles( ParticleSystem* ps, double dt )
 {
-    osg::Vec3 nextpos = P->getPosition() + P->getVelocity() * dt;
-    float distance = domain.plane.distance( P->getPosition() );
-    if ( distance*domain.plane.distance(nextpos)>=0 ) return;
-
-    osg::Vec3 normal = domain.plane.getNormal();
-    float nv = normal * P->getVelocity();
-    osg::Vec3 hitPoint = P->getPosition() - P->getVelocity() * (distance / nv);
+    if ( !isEnabled() ) return;
 
-    float upos = (hitPoint - domain.v1) * domain.s1;
-    float vpos = (hitPoint - domain.v1) * domain.s2;
-    if ( upos<0.0f || vpos<0.0f || (upos + vpos)>1.0f ) return;
-
-    // Compute tangential and normal components of velocity
-    osg::Vec3 vn = normal * nv;
-    osg::Vec3 vt = P->getVelocity() - vn;
+    // the unhandled domains write a notice for each particle, so leave them to the serial path.
+    for ( std::vector<Domain>::const_iterator itr=_domains.begin(); itr!=_domains.end(); ++itr )
+    {
+        if ( itr->type==Domain::POINT_DOMAIN || itr->type==Domain::LINE_DOMAIN || itr->type==Domain::BOX_DOMAIN )
+        {
+            DomainOperator::operateParticles( ps, dt );
+            return;
+        }
+    }
 
-    // Compute new velocity
-    if ( vt.length2()<=_cutoff ) P->setVelocity( vt - vn*_resilience );
-    else P->setVelocity( vt*(1.0f-_friction) - vn*_resilience );
+    if ( !ps->operateParticleArrays(this, dt) ) ps->operateParticlesInParallel( this, dt );
 }
 
-void BounceOperator::handleRectangle( const Domain& domain, Particle* P, double dt )
+void BounceOperator::operateParticleArrays( ParticleSystem::ParticleArrays& arrays, unsigned int begin, unsigned int end, double dt )
 {
-    osg::Vec3 nextpos = P->getPosition() + P->getVelocity() * dt;
-    float distance = domain.plane.distance( P->getPosition() );
-    if ( distance*domain.plane.distance(nextpos)>=0 ) return;
+    for ( unsigned int i=begin; i<end; ++i )
+    {
+        if ( !arrays.alive[i] ) continue;
 
-    osg::Vec3 normal = domain.plane.getNormal();
-    float nv = normal * P->getVelocity();
-    osg::Vec3 hitPoint = P->getPosition() - P->getVelocity() * (distance / nv);
+        osg::Vec3 position( arrays.positionX[i], arrays.positionY[i], arrays.positionZ[i] );
+        osg::Vec3 velocity( arrays.velocityX[i], arrays.velocityY[i], arrays.velocityZ[i] );
+        bool bounced = false;
+        for ( std::vector<Domain>::const_iterator itr=_domains.begin(); itr!=_domains.end(); ++itr )
+        {
+            if ( bounce(*itr, position, velocity, dt) ) bounced = true;
+        }
 
-    float upos = (hitPoint - domain.v1) * domain.s1;
-    float vpos = (hitPoint - domain.v1) * domain.s2;
-    if ( upos<0.0f || upos>1.0f || vpos<0.0f || vpos>1.0f ) return;
+        if ( bounced )
+        {
+            arrays.velocityX[i] = velocity.x();
+            arrays.velocityY[i] = velocity.y();
+            arrays.velocityZ[i] = velocity.z();
+        }
+    }
+}
 
-    // Compute tangential and normal components of velocity
-    osg::Vec3 vn = normal * nv;
-    osg::Vec3 vt = P->getVelocity() - vn;
+void BounceOperator::handleTriangle( const Domain& domain, Particle* P, double dt )
+{
+    bounce( domain, P, dt );
+}
 
-    // Compute new velocity
-    if ( vt.length2()<=_cutoff ) P->setVelocity( vt - vn*_resilience );
-    else P->setVelocity( vt*(1.0f-_friction) - vn*_resilience );
+void BounceOperator::handleRectangle( const Domain& domain, Particle* P, double dt )
+{
+    bounce( domain, P, dt );
 }
 
 void BounceOperator::handlePlane( const Domain& domain, Particle* P, double dt )
 {
-    osg::Vec3 nextpos = P->getPosition() + P->getVelocity() * dt;
-    float distance = domain.plane.distance( P->getPosition() );
-    if ( distance*domain.plane.distance(nextpos)>=0 ) return;
-
-    osg::Vec3 normal = domain.plane.getNormal();
-    float nv = normal * P->getVelocity();
+    bounce( domain, P, dt );
+}
 
-    // Compute tangential and normal components of velocity
-    osg::Vec3 vn = normal * nv;
-    osg::Vec3 vt = P->getVelocity() - vn;
+void BounceOperator::handleSphere( const Domain& domain, Particle* P, double dt )
+{
+    bounce( domain, P, dt );
+}
 
-    // Compute new velocity
-    if ( vt.length2()<=_cutoff ) P->setVelocity( vt - vn*_resilience );
-    else P->setVelocity( vt*(1.0f-_friction) - vn*_resilience );
+void BounceOperator::handleDisk( const Domain& domain, Particle* P, double dt )
+{
+    bounce( domain, P, dt );
 }
 
-void BounceOperator::handleSphere( const Domain& domain, Particle* P, double dt )
+bool BounceOperator::bounce( const Domain& domain, const osg::Vec3& position, osg::Vec3& velocity, double dt ) const
 {
-    osg::Vec3 nextpos = P->getPosition() + P->getVelocity() * dt;
-    float distance1 = (P->getPosition() - domain.v1).length();
-    if ( distance1<=domain.r1 )  // Within the sphere
+    switch ( domain.type )
+    {
+    case Domain::TRI_DOMAIN:
     {
-        float distance2 = (nextpos - domain.v1).length();
-        if ( distance2<=domain.r1 ) return;
+        osg::Vec3 nextpos = position + velocity * dt;
+        float distance = domain.plane.distance( position );
+        if ( distance*domain.plane.distance(nextpos)>=0 ) return false;
 
-        // Bounce back in if going outside
-        osg::Vec3 normal = domain.v1 - P->getPosition(); normal.normalize();
-        float nmag = P->getVelocity() * normal;
+        osg::Vec3 normal = domain.plane.getNormal();
+        float nv = normal * velocity;
+        osg::Vec3 hitPoint = position - velocity * (distance / nv);
+
+        float upos = (hitPoint - domain.v1) * domain.s1;
+        float vpos = (hitPoint - domain.v1) * domain.s2;
+        if ( upos<0.0f || vpos<0.0f || (upos + vpos)>1.0f ) return false;
 
         // Compute tangential and normal components of velocity
-        osg::Vec3 vn = normal * nmag;
-        osg::Vec3 vt = P->getVelocity() - vn;
-        if ( nmag<0 ) vn = -vn;
+        osg::Vec3 vn = normal * nv;
+        osg::Vec3 vt = velocity - vn;
 
         // Compute new velocity
-        float tanscale = (vt.length2()<=_cutoff) ? 1.0f : (1.0f - _friction);
-        P->setVelocity( vt * tanscale + vn * _resilience );
+        if ( vt.length2()<=_cutoff ) velocity = vt - vn*_resilience;
+        else velocity = vt*(1.0f-_friction) - vn*_resilience;
+        return true;
+    }
+    case Domain::RECT_DOMAIN:
+    {
+        osg::Vec3 nextpos = position + velocity * dt;
+        float distance = domain.plane.distance( position );
+        if ( distance*domain.plane.distance(nextpos)>=0 ) return false;
 
-        // Make sure the particle is fixed to stay inside
-        nextpos = P->getPosition() + P->getVelocity() * dt;
-        distance2 = (nextpos - domain.v1).length();
-        if ( distance2>domain.r1 )
-        {
-            normal = domain.v1 - nextpos; normal.normalize();
+        osg::Vec3 normal = domain.plane.getNormal();
+        float nv = normal * velocity;
+        osg::Vec3 hitPoint = position - velocity * (distance / nv);
 
-            osg::Vec3 wishPoint = domain.v1 - normal * (0.999f * domain.r1);
-            P->setVelocity( (wishPoint - P->getPosition()) / dt );
-        }
+        float upos = (hitPoint - domain.v1) * domain.s1;
+        float vpos = (hitPoint - domain.v1) * domain.s2;
+        if ( upos<0.0f || upos>1.0f || vpos<0.0f || vpos>1.0f ) return false;
+
+        // Compute tangential and normal components of velocity
+        osg::Vec3 vn = normal * nv;
+        osg::Vec3 vt = velocity - vn;
+
+        // Compute new velocity
+        if ( vt.length2()<=_cutoff ) velocity = vt - vn*_resilience;
+        else velocity = vt*(1.0f-_friction) - vn*_resilience;
+        return true;
     }
-    else  // Outside the sphere
+    case Domain::PLANE_DOMAIN:
     {
-        float distance2 = (nextpos - domain.v1).length();
-        if ( distance2>domain.r1 ) return;
+        osg::Vec3 nextpos = position + velocity * dt;
+        float distance = domain.plane.distance( position );
+        if ( distance*domain.plane.distance(nextpos)>=0 ) return false;
 
-        // Bounce back out if going inside
-        osg::Vec3 normal = P->getPosition() - domain.v1; normal.normalize();
-        float nmag = P->getVelocity() * normal;
+        osg::Vec3 normal = domain.plane.getNormal();
+        float nv = normal * velocity;
 
         // Compute tangential and normal components of velocity
-        osg::Vec3 vn = normal * nmag;
-        osg::Vec3 vt = P->getVelocity() - vn;
-        if ( nmag<0 ) vn = -vn;
+        osg::Vec3 vn = normal * nv;
+        osg::Vec3 vt = velocity - vn;
 
         // Compute new velocity
-        float tanscale = (vt.length2()<=_cutoff) ? 1.0f : (1.0f - _friction);
-        P->setVelocity( vt * tanscale + vn * _resilience );
+        if ( vt.length2()<=_cutoff ) velocity = vt - vn*_resilience;
+        else velocity = vt*(1.0f-_friction) - vn*_resilience;
+        return true;
     }
-}
+    case Domain::SPHERE_DOMAIN:
+    {
+        osg::Vec3 nextpos = position + velocity * dt;
+        float distance1 = (position - domain.v1).length();
+        if ( distance1<=domain.r1 )  // Within the sphere
+        {
+            float distance2 = (nextpos - domain.v1).length();
+            if ( distance2<=domain.r1 ) return false;
+
+            // Bounce back in if going outside
+            osg::Vec3 normal = domain.v1 - position; normal.normalize();
+            float nmag = velocity * normal;
+
+            // Compute tangential and normal components of velocity
+            osg::Vec3 vn = normal * nmag;
+            osg::Vec3 vt = velocity - vn;
+            if ( nmag<0 ) vn = -vn;
+
+            // Compute new velocity
+            float tanscale = (vt.length2()<=_cutoff) ? 1.0f : (1.0f - _friction);
+            velocity = vt * tanscale + vn * _resilience;
+
+            // Make sure the particle is fixed to stay inside
+            nextpos = position + velocity * dt;
+            distance2 = (nextpos - domain.v1).length();
+            if ( distance2>domain.r1 )
+            {
+                normal = domain.v1 - nextpos; normal.normalize();
+
+                osg::Vec3 wishPoint = domain.v1 - normal * (0.999f * domain.r1);
+                velocity = (wishPoint - position) / dt;
+            }
+        }
+        else  // Outside the sphere
+        {
+            float distance2 = (nextpos - domain.v1).length();
+            if ( distance2>domain.r1 ) return false;
 
-void BounceOperator::handleDisk( const Domain& domain, Particle* P, double dt )
-{
-    osg::Vec3 nextpos = P->getPosition() + P->getVelocity() * dt;
-    float distance = domain.plane.distance( P->getPosition() );
-    if ( distance*domain.plane.distance(nextpos)>=0 ) return;
+            // Bounce back out if going inside
+            osg::Vec3 normal = position - domain.v1; normal.normalize();
+            float nmag = velocity * normal;
 
-    osg::Vec3 normal = domain.plane.getNormal();
-    float nv = normal * P->getVelocity();
-    osg::Vec3 hitPoint = P->getPosition() - P->getVelocity() * (distance / nv);
+            // Compute tangential and normal components of velocity
+            osg::Vec3 vn = normal * nmag;
+            osg::Vec3 vt = velocity - vn;
+            if ( nmag<0 ) vn = -vn;
 
-    float radius = (hitPoint - domain.v1).length();
-    if ( radius>domain.r1 || radius<domain.r2 ) return;
+            // Compute new velocity
+            float tanscale = (vt.length2()<=_cutoff) ? 1.0f : (1.0f - _friction);
+            velocity = vt * tanscale + vn * _resilience;
+        }
+        return true;
+    }
+    case Domain::DISK_DOMAIN:
+    {
+        osg::Vec3 nextpos = position + velocity * dt;
+        float distance = domain.plane.distance( position );
+        if ( distance*domain.plane.distance(nextpos)>=0 ) return false;
 
-    // Compute tangential and normal components of velocity
-    osg::Vec3 vn = normal * nv;
-    osg::Vec3 vt = P->getVelocity() - vn;
+        osg::Vec3 normal = domain.plane.getNormal();
+        float nv = normal * velocity;
+        osg::Vec3 hitPoint = position - velocity * (distance / nv);
 
-    // Compute new velocity
-    if ( vt.length2()<=_cutoff ) P->setVelocity( vt - vn*_resilience );
-    else P->setVelocity( vt*(1.0f-_friction) - vn*_resilience );
+        float radius = (hitPoint - domain.v1).length();
+        if ( radius>domain.r1 || radius<domain.r2 ) return false;
+
+        // Compute tangential and normal components of velocity
+        osg::Vec3 vn = normal * nv;
+        osg::Vec3 vt = velocity - vn;
+
+        // Compute new velocity
+        if ( vt.length2()<=_cutoff ) velocity = vt - vn*_resilience;
+        else velocity = vt*(1.0f-_friction) - vn*_resilience;
+        return true;
+    }
+    default:
+        return false;
+    }
 }
@@ -2,8 +2,21 @@
 #include <osgParticle/ModularProgram>
 #include <osgParticle/Operator>
 #include <osgParticle/Particle>
+#include <osgParticle/ParticleSystem>
 #include <osg/Notify>
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define OSGPARTICLE_FLUIDFRICTION_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSGPARTICLE_FLUIDFRICTION_SSE
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+    // vsqrtq_f32 is only available on AArch64.
+    #include <arm_neon.h>
+    #define OSGPARTICLE_FLUIDFRICTION_NEON
+#endif
+
 osgParticle::FluidFrictionOperator::FluidFrictionOperator():
      Operator(),
      _coeff_A(0),
@@ -54,3 +67,91 @@ void osgParticle::FluidFrictionOperator::operate(Particle* P, double dt)
 
     P->addVelocity(dv);
 }
+
+void osgParticle::FluidFrictionOperator::operateParticles(ParticleSystem* ps, double dt)
+{
+    if (!isEnabled()) return;
+
+    if (!ps->operateParticleArrays(this, dt)) Operator::operateParticles(ps, dt);
+}
+
+void osgParticle::FluidFrictionOperator::operateParticleArrays(ParticleSystem::ParticleArrays& arrays, unsigned int begin, unsigned int end, double dt)
+{
+    // operate() clamps the velocity increment -v*R*massInv*dt/|v| to -v, with R = A*r*|v| + B*r*r*|v|*|v|,
+    // so the increment is -v*min(r*(A + B*r*|v|)*massInv*dt, 1), which needs no division.
+    float* vx = &arrays.velocityX[0];
+    float* vy = &arrays.velocityY[0];
+    float* vz = &arrays.velocityZ[0];
+    const float* radius = &arrays.radius[0];
+    const float* massInv = &arrays.massInv[0];
+    const bool overrideRadius = _ovr_rad > 0;
+    const float fdt = dt;
+
+    unsigned int i = begin;
+
+#if defined(OSGPARTICLE_FLUIDFRICTION_AVX)
+    const unsigned int BLOCK_SIZE = 8;
+    __m256 coeffA = _mm256_set1_ps(_coeff_A), coeffB = _mm256_set1_ps(_coeff_B), one = _mm256_set1_ps(1.0f), sdt = _mm256_set1_ps(fdt);
+    __m256 windX = _mm256_set1_ps(_wind.x()), windY = _mm256_set1_ps(_wind.y()), windZ = _mm256_set1_ps(_wind.z()), ovr = _mm256_set1_ps(_ovr_rad);
+    for(; i+BLOCK_SIZE<=end; i+=BLOCK_SIZE)
+    {
+        __m256 wx = _mm256_sub_ps(_mm256_loadu_ps(vx+i), windX);
+        __m256 wy = _mm256_sub_ps(_mm256_loadu_ps(vy+i), windY);
+        __m256 wz = _mm256_sub_ps(_mm256_loadu_ps(vz+i), windZ);
+        __m256 vm = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(wx, wx), _mm256_mul_ps(wy, wy)), _mm256_mul_ps(wz, wz)));
+        __m256 r = overrideRadius ? ovr : _mm256_loadu_ps(radius+i);
+        __m256 k = _mm256_mul_ps(_mm256_mul_ps(r, _mm256_add_ps(coeffA, _mm256_mul_ps(_mm256_mul_ps(coeffB, r), vm))), _mm256_mul_ps(_mm256_loadu_ps(massInv+i), sdt));
+        k = _mm256_min_ps(k, one);
+        _mm256_storeu_ps(vx+i, _mm256_sub_ps(_mm256_loadu_ps(vx+i), _mm256_mul_ps(wx, k)));
+        _mm256_storeu_ps(vy+i, _mm256_sub_ps(_mm256_loadu_ps(vy+i), _mm256_mul_ps(wy, k)));
+        _mm256_storeu_ps(vz+i, _mm256_sub_ps(_mm256_loadu_ps(vz+i), _mm256_mul_ps(wz, k)));
+    }
+#elif defined(OSGPARTICLE_FLUIDFRICTION_SSE)
+    const unsigned int BLOCK_SIZE = 4;
+    __m128 coeffA = _mm_set1_ps(_coeff_A), coeffB = _mm_set1_ps(_coeff_B), one = _mm_set1_ps(1.0f), sdt = _mm_set1_ps(fdt);
+    __m128 windX = _mm_set1_ps(_wind.x()), windY = _mm_set1_ps(_wind.y()), windZ = _mm_set1_ps(_wind.z()), ovr = _mm_set1_ps(_ovr_rad);
+    for(; i+BLOCK_SIZE<=end; i+=BLOCK_SIZE)
+    {
+        __m128 wx = _mm_sub_ps(_mm_loadu_ps(vx+i), windX);
+        __m128 wy = _mm_sub_ps(_mm_loadu_ps(vy+i), windY);
+        __m128 wz = _mm_sub_ps(_mm_loadu_ps(vz+i), windZ);
+        __m128 vm = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy)), _mm_mul_ps(wz, wz)));
+        __m128 r = overrideRadius ? ovr : _mm_loadu_ps(radius+i);
+        __m128 k = _mm_mul_ps(_mm_mul_ps(r, _mm_add_ps(coeffA, _mm_mul_ps(_mm_mul_ps(coeffB, r), vm))), _mm_mul_ps(_mm_loadu_ps(massInv+i), sdt));
+        k = _mm_min_ps(k, one);
+        _mm_storeu_ps(vx+i, _mm_sub_ps(_mm_loadu_ps(vx+i), _mm_mul_ps(wx, k)));
+        _mm_storeu_ps(vy+i, _mm_sub_ps(_mm_loadu_ps(vy+i), _mm_mul_ps(wy, k)));
+        _mm_storeu_ps(vz+i, _mm_sub_ps(_mm_loadu_ps(vz+i), _mm_mul_ps(wz, k)));
+    }
+#elif defined(OSGPARTICLE_FLUIDFRICTION_NEON)
+    const unsigned int BLOCK_SIZE = 4;
+    float32x4_t coeffA = vdupq_n_f32(_coeff_A), one = vdupq_n_f32(1.0f), ovr = vdupq_n_f32(_ovr_rad);
+    for(; i+BLOCK_SIZE<=end; i+=BLOCK_SIZE)
+    {
+        float32x4_t wx = vsubq_f32(vld1q_f32(vx+i), vdupq_n_f32(_wind.x()));
+        float32x4_t wy = vsubq_f32(vld1q_f32(vy+i), vdupq_n_f32(_wind.y()));
+        float32x4_t wz = vsubq_f32(vld1q_f32(vz+i), vdupq_n_f32(_wind.z()));
+        float32x4_t vm = vsqrtq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(wx, wx), wy, wy), wz, wz));
+        float32x4_t r = overrideRadius ? ovr : vld1q_f32(radius+i);
+        float32x4_t k = vmulq_f32(vmulq_f32(r, vmlaq_f32(coeffA, vmulq_n_f32(r, _coeff_B), vm)), vmulq_n_f32(vld1q_f32(massInv+i), fdt));
+        k = vminq_f32(k, one);
+        vst1q_f32(vx+i, vmlsq_f32(vld1q_f32(vx+i), wx, k));
+        vst1q_f32(vy+i, vmlsq_f32(vld1q_f32(vy+i), wy, k));
+        vst1q_f32(vz+i, vmlsq_f32(vld1q_f32(vz+i), wz, k));
+    }
+#endif
+
+    // remaining particles, or all of them when no vectorized path is available.
+    for(; i<end; ++i)
+    {
+        float wx = vx[i]-_wind.x();
+        float wy = vy[i]-_wind.y();
+        float wz = vz[i]-_wind.z();
+        float vm = sqrtf(wx*wx + wy*wy + wz*wz);
+        float r = overrideRadius ? _ovr_rad : radius[i];
+        float k = osg::minimum(r * (_coeff_A + _coeff_B * r * vm) * massInv[i] * fdt, 1.0f);
+        vx[i] -= wx*k;
+        vy[i] -= wy*k;
+        vz[i] -= wz*k;
+    }
+}
@@ -1,6 +1,9 @@
 #include <osgParticle/ParticleSystem>
+#include <osgParticle/Operator>
 
 #include <vector>
+#include <string.h>
+#include <stdlib.h>
 
 #include <osg/Drawable>
 #include <osg/CopyOp>
@@ -16,6 +19,8 @@
 #include <osg/Program>
 #include <osg/Notify>
 #include <osg/io_utils>
+#include <osg/OperationThread>
+#include <osg/ApplicationUsage>
 
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
@@ -24,6 +29,19 @@
 
 #define USE_LOCAL_SHADERS
 
+static osg::ApplicationUsageProxy ParticleSystem_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PARTICLE_ARRAYS <mode>","ON | OFF - Let the batched particle operators work on a structure of arrays copy of the particles in parallel on the OperationThreadPool, defaults to ON.");
+static osg::ApplicationUsageProxy ParticleSystem_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PARALLEL_PARTICLE_UPDATE <mode>","ON | OFF - Update the particles of a ParticleSystem in parallel on the OperationThreadPool, defaults to ON.");
+
+static bool getDefaultOn(const char* name)
+{
+    const char* env = getenv(name);
+    return !(env && (strcmp(env,"OFF")==0 || strcmp(env,"Off")==0 || strcmp(env,"off")==0));
+}
+
+// the number of particles processed at a time by runParticleRanges(), large enough to amortize taking a range
+// and small enough to balance the load between the threads of the pool.
+static const unsigned int s_numParticlesPerRange = 4096;
+
 static double distance(const osg::Vec3& coord, const osg::Matrix& matrix)
 {
     // copied from CullVisitor.cpp
@@ -55,7 +73,11 @@ osgParticle::ParticleSystem::ParticleSystem()
     _detail(1),
     _sortMode(NO_SORT),
     _visibilityDistance(-1.0),
-    _estimatedMaxNumOfParticles(0)
+    _estimatedMaxNumOfParticles(0),
+    _useParticleArrays(getDefaultOn("OSG_PARTICLE_ARRAYS")),
+    _particleArraysCurrent(false),
+    _particleArraysModified(false),
+    _parallelUpdate(getDefaultOn("OSG_PARALLEL_PARTICLE_UPDATE"))
 {
     // we don't support display lists because particle systems
     // are dynamic, and they always changes between frames
@@ -87,7 +109,11 @@ osgParticle::ParticleSystem::ParticleSystem(const ParticleSystem& copy, const os
     _detail(copy._detail),
     _sortMode(copy._sortMode),
     _visibilityDistance(copy._visibilityDistance),
-    _estimatedMaxNumOfParticles(0)
+    _estimatedMaxNumOfParticles(0),
+    _useParticleArrays(copy._useParticleArrays),
+    _particleArraysCurrent(false),
+    _particleArraysModified(false),
+    _parallelUpdate(copy._parallelUpdate)
 {
 }
 
@@ -110,6 +136,10 @@ osgParticle::Particle* osgParticle::ParticleSystem::createParticle(const osgPart
 
         // remove the pointer from the death stack
         _deadparts.pop();
+
+        // gather the particle into the particle arrays once the emitter has placed and shot it.
+        if (_particleArraysCurrent) _particlesToGather.push_back(static_cast<unsigned int>(P - &_particles[0]));
+
         return P;
 
     }
@@ -126,6 +156,9 @@ osgParticle::Particle* osgParticle::ParticleSystem::createParticle(const osgPart
 
         // add a new particle to the vector
         _particles.push_back(ptemplate? *ptemplate: _def_ptemp);
+
+        if (_particleArraysCurrent) _particlesToGather.push_back(static_cast<unsigned int>(_particles.size()-1));
+
         return &_particles.back();
     }
 }
@@ -152,18 +185,32 @@ void osgParticle::ParticleSystem::update(double dt, osg::NodeVisitor& nv)
         }
     }
 
-    for(unsigned int i=0; i<_particles.size(); ++i)
+    if (_particleArraysCurrent)
     {
-        Particle& particle = _particles[i];
-        if (particle.isAlive())
+        // write back the work of the operators and gather the updated particles in the same pass.
+        gatherParticleArrays();
+        runParticleRanges(UPDATE_PARTICLES_AND_ARRAYS, 0, dt, _parallelUpdate);
+        _particleArraysModified = false;
+    }
+    else if (_parallelUpdate)
+    {
+        runParticleRanges(UPDATE_PARTICLES, 0, dt);
+    }
+    else
+    {
+        for(unsigned int i=0; i<_particles.size(); ++i)
         {
-            if (particle.update(dt, _useShaders))
+            Particle& particle = _particles[i];
+            if (particle.isAlive())
             {
-                update_bounds(particle.getPosition(), particle.getCurrentSize());
-            }
-            else
-            {
-                reuseParticle(i);
+                if (particle.update(dt, _useShaders))
+                {
+                    update_bounds(particle.getPosition(), particle.getCurrentSize());
+                }
+                else
+                {
+                    reuseParticle(i);
+                }
             }
         }
     }
@@ -187,6 +234,9 @@ void osgParticle::ParticleSystem::update(double dt, osg::NodeVisitor& nv)
             }
             std::sort<Particle_vector::iterator>(_particles.begin(), _particles.end());
 
+            // the particle arrays no longer line up with the particles.
+            _particleArraysCurrent = false;
+
             // Repopulate the death stack as it will have been invalidated by the sort.
             unsigned int numDead = _deadparts.size();
             if (numDead>0)
@@ -209,6 +259,268 @@ void osgParticle::ParticleSystem::update(double dt, osg::NodeVisitor& nv)
     dirtyBound();
 }
 
+static inline void copyParticleToArrays(const osgParticle::Particle& particle, osgParticle::ParticleSystem::ParticleArrays& arrays, unsigned int i)
+{
+    const osg::Vec3& position = particle.getPosition();
+    const osg::Vec3& velocity = particle.getVelocity();
+    arrays.positionX[i] = position.x();
+    arrays.positionY[i] = position.y();
+    arrays.positionZ[i] = position.z();
+    arrays.velocityX[i] = velocity.x();
+    arrays.velocityY[i] = velocity.y();
+    arrays.velocityZ[i] = velocity.z();
+    arrays.radius[i] = particle.getRadius();
+    arrays.massInv[i] = particle.getMassInv();
+    arrays.alive[i] = particle.isAlive() ? 1 : 0;
+    arrays.killed[i] = 0;
+}
+
+static inline void copyArraysToParticle(const osgParticle::ParticleSystem::ParticleArrays& arrays, unsigned int i, osgParticle::Particle& particle)
+{
+    particle.setVelocity(osg::Vec3(arrays.velocityX[i], arrays.velocityY[i], arrays.velocityZ[i]));
+    if (arrays.killed[i]) particle.kill();
+}
+
+struct osgParticle::ParticleSystem::ParticleRangeOperation : public osg::Operation
+{
+    struct UpdateResult
+    {
+        UpdateResult(): boundsValid(false) {}
+
+        bool                boundsValid;
+        osg::Vec3           bmin;
+        osg::Vec3           bmax;
+        std::vector<int>    deadParticles;
+    };
+
+    typedef std::vector<UpdateResult> UpdateResults;
+
+    ParticleRangeOperation(ParticleSystem* ps, ParticleRangeMode mode, Operator* op, double dt, UpdateResults& updateResults, OpenThreads::Atomic& numRangesTaken, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("ParticleRange", false),
+        _ps(ps),
+        _mode(mode),
+        _op(op),
+        _dt(dt),
+        _updateResults(updateResults),
+        _numRangesTaken(numRangesTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        unsigned int numParticles = static_cast<unsigned int>(_ps->_particles.size());
+        unsigned int numRanges = (numParticles+s_numParticlesPerRange-1)/s_numParticlesPerRange;
+        for(unsigned int r = (++_numRangesTaken)-1; r<numRanges; r = (++_numRangesTaken)-1)
+        {
+            unsigned int begin = r*s_numParticlesPerRange;
+            unsigned int end = osg::minimum(begin+s_numParticlesPerRange, numParticles);
+            switch(_mode)
+            {
+                case GATHER_PARTICLE_ARRAYS: gather(begin, end); break;
+                case SCATTER_PARTICLE_ARRAYS: scatter(begin, end); break;
+                case OPERATE_PARTICLE_ARRAYS: _op->operateParticleArrays(_ps->_particleArrays, begin, end, _dt); break;
+                case OPERATE_PARTICLES: operate(begin, end); break;
+                case UPDATE_PARTICLES: update(begin, end, _updateResults[r], false); break;
+                case UPDATE_PARTICLES_AND_ARRAYS: update(begin, end, _updateResults[r], true); break;
+            }
+        }
+
+        _blockCount->completed();
+    }
+
+    void gather(unsigned int begin, unsigned int end)
+    {
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            copyParticleToArrays(_ps->_particles[i], _ps->_particleArrays, i);
+        }
+    }
+
+    void scatter(unsigned int begin, unsigned int end)
+    {
+        const ParticleArrays& arrays = _ps->_particleArrays;
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            if (arrays.alive[i]) copyArraysToParticle(arrays, i, _ps->_particles[i]);
+        }
+    }
+
+    void operate(unsigned int begin, unsigned int end)
+    {
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            Particle& particle = _ps->_particles[i];
+            if (particle.isAlive()) _op->operate(&particle, _dt);
+        }
+    }
+
+    void update(unsigned int begin, unsigned int end, UpdateResult& result, bool updateArrays)
+    {
+        ParticleArrays& arrays = _ps->_particleArrays;
+        bool scatterArrays = updateArrays && _ps->_particleArraysModified;
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            Particle& particle = _ps->_particles[i];
+            if (!particle.isAlive()) continue;
+
+            if (scatterArrays) copyArraysToParticle(arrays, i, particle);
+
+            if (particle.update(_dt, _ps->_useShaders))
+            {
+                const osg::Vec3& p = particle.getPosition();
+                float r = particle.getCurrentSize();
+                osg::Vec3 bmin(p.x()-r, p.y()-r, p.z()-r);
+                osg::Vec3 bmax(p.x()+r, p.y()+r, p.z()+r);
+                if (!result.boundsValid)
+                {
+                    result.bmin = bmin;
+                    result.bmax = bmax;
+                    result.boundsValid = true;
+                }
+                else
+                {
+                    result.bmin.set(osg::minimum(result.bmin.x(), bmin.x()), osg::minimum(result.bmin.y(), bmin.y()), osg::minimum(result.bmin.z(), bmin.z()));
+                    result.bmax.set(osg::maximum(result.bmax.x(), bmax.x()), osg::maximum(result.bmax.y(), bmax.y()), osg::maximum(result.bmax.z(), bmax.z()));
+                }
+            }
+            else
+            {
+                result.deadParticles.push_back(i);
+            }
+
+            if (updateArrays) copyParticleToArrays(particle, arrays, i);
+        }
+    }
+
+    ParticleSystem*                     _ps;
+    ParticleRangeMode                   _mode;
+    Operator*                           _op;
+    double                              _dt;
+    UpdateResults&                      _updateResults;
+    OpenThreads::Atomic&                _numRangesTaken;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+
+protected:
+
+    ParticleRangeOperation& operator = (const ParticleRangeOperation&) { return *this; }
+};
+
+void osgParticle::ParticleSystem::runParticleRanges(ParticleRangeMode mode, Operator* op, double dt, bool parallel)
+{
+    unsigned int numRanges = (static_cast<unsigned int>(_particles.size())+s_numParticlesPerRange-1)/s_numParticlesPerRange;
+    if (numRanges==0) return;
+
+    bool updating = (mode==UPDATE_PARTICLES || mode==UPDATE_PARTICLES_AND_ARRAYS);
+    ParticleRangeOperation::UpdateResults updateResults(updating ? numRanges : 0);
+
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+    unsigned int numOperations = parallel ? osg::minimum(threadPool->getNumThreads()+1, numRanges) : 1;
+
+    OpenThreads::Atomic numRangesTaken;
+    osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+    blockCount->reset();
+
+    if (numOperations==1)
+    {
+        osg::ref_ptr<ParticleRangeOperation> operation = new ParticleRangeOperation(this, mode, op, dt, updateResults, numRangesTaken, blockCount.get());
+        (*operation)(0);
+    }
+    else
+    {
+        for(unsigned int i=0; i<numOperations; ++i)
+        {
+            threadPool->add(new ParticleRangeOperation(this, mode, op, dt, updateResults, numRangesTaken, blockCount.get()));
+        }
+
+        threadPool->runOperationsUntilCompleted(blockCount.get());
+    }
+
+    // merge the bounds and reuse the dead particles in the order of the serial update, as reuseParticle()
+    // is overridden by ConnectedParticleSystem to unlink particles.
+    for(ParticleRangeOperation::UpdateResults::iterator itr = updateResults.begin();
+        itr != updateResults.end();
+        ++itr)
+    {
+        if (itr->boundsValid) update_bounds(itr->bmin, itr->bmax);
+
+        for(std::vector<int>::iterator ditr = itr->deadParticles.begin();
+            ditr != itr->deadParticles.end();
+            ++ditr)
+        {
+            reuseParticle(*ditr);
+        }
+    }
+}
+
+void osgParticle::ParticleSystem::gatherParticleArrays()
+{
+    if (!_particleArraysCurrent)
+    {
+        _particleArrays.resize(_particles.size());
+        runParticleRanges(GATHER_PARTICLE_ARRAYS, 0, 0.0);
+        _particleArraysCurrent = true;
+    }
+    else if (!_particlesToGather.empty())
+    {
+        _particleArrays.resize(_particles.size());
+        for(std::vector<unsigned int>::iterator itr = _particlesToGather.begin();
+            itr != _particlesToGather.end();
+            ++itr)
+        {
+            copyParticleToArrays(_particles[*itr], _particleArrays, *itr);
+        }
+    }
+
+    _particlesToGather.clear();
+}
+
+void osgParticle::ParticleSystem::setUseParticleArrays(bool flag)
+{
+    if (!flag) dirtyParticleArrays();
+
+    _useParticleArrays = flag;
+}
+
+osgParticle::ParticleSystem::ParticleArrays* osgParticle::ParticleSystem::getParticleArrays()
+{
+    if (!_useParticleArrays) return 0;
+
+    gatherParticleArrays();
+    return &_particleArrays;
+}
+
+void osgParticle::ParticleSystem::flushParticleArrays()
+{
+    if (!_particleArraysModified) return;
+
+    runParticleRanges(SCATTER_PARTICLE_ARRAYS, 0, 0.0);
+    _particleArraysModified = false;
+}
+
+void osgParticle::ParticleSystem::dirtyParticleArrays()
+{
+    flushParticleArrays();
+
+    _particleArraysCurrent = false;
+    _particlesToGather.clear();
+}
+
+bool osgParticle::ParticleSystem::operateParticleArrays(Operator* op, double dt)
+{
+    if (!getParticleArrays()) return false;
+
+    runParticleRanges(OPERATE_PARTICLE_ARRAYS, op, dt);
+    _particleArraysModified = true;
+    return true;
+}
+
+void osgParticle::ParticleSystem::operateParticlesInParallel(Operator* op, double dt)
+{
+    dirtyParticleArrays();
+
+    runParticleRanges(OPERATE_PARTICLES, op, dt);
+}
+
 void osgParticle::ParticleSystem::drawImplementation(osg::RenderInfo& renderInfo) const
 {
     if (_particles.size() <= 0) return;
@@ -241,28 +553,27 @@ void osgParticle::ParticleSystem::drawImplementation(osg::RenderInfo& renderInfo
             ad.reserve(_particles.capacity());
         }
 
-        ad.clear();
+        // size the arrays up front and write each attribute in place, rather than growing them a particle at a time.
+        unsigned int numVertices = (static_cast<unsigned int>(_particles.size())+_detail-1)/_detail;
+        ad.resize(numVertices);
+        ad.primitives.clear();
         ad.dirty();
 
-        osg::Vec3Array& vertices = *ad.vertices;
-        osg::Vec3Array& normals = *ad.normals;
-        osg::Vec4Array& colors = *ad.colors;
-        osg::Vec3Array& texcoords = *ad.texcoords3;
-        ArrayData::Primitives& primitives = ad.primitives;
+        osg::Vec3* vertices = &(ad.vertices->front());
+        osg::Vec3* normals = &(ad.normals->front());
+        osg::Vec4* colors = &(ad.colors->front());
+        osg::Vec3* texcoords = &(ad.texcoords3->front());
 
-        for(unsigned int i=0; i<_particles.size(); i+=_detail)
+        for(unsigned int i=0, v=0; v<numVertices; i+=_detail, ++v)
         {
             const Particle* particle = &_particles[i];
-            const osg::Vec4& color = particle->getCurrentColor();
-            const osg::Vec3& pos = particle->getPosition();
-            const osg::Vec3& vel = particle->getVelocity();
-            colors.push_back( color );
-            texcoords.push_back( osg::Vec3(particle->_alive, particle->_current_size, particle->_current_alpha) );
-            normals.push_back(vel);
-            vertices.push_back(pos);
+            vertices[v] = particle->getPosition();
+            normals[v] = particle->getVelocity();
+            colors[v] = particle->getCurrentColor();
+            texcoords[v].set(particle->_alive, particle->_current_size, particle->_current_alpha);
         }
 
-        primitives.push_back(ArrayData::ModeCount(GL_POINTS, vertices.size()));
+        ad.primitives.push_back(ArrayData::ModeCount(GL_POINTS, numVertices));
 
     }
     else
@@ -677,6 +988,25 @@ osg::VertexArrayState* osgParticle::ParticleSystem::createVertexArrayState(osg::
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// ParticleArrays
+//
+void osgParticle::ParticleSystem::ParticleArrays::resize(unsigned int numParticles)
+{
+    positionX.resize(numParticles);
+    positionY.resize(numParticles);
+    positionZ.resize(numParticles);
+    velocityX.resize(numParticles);
+    velocityY.resize(numParticles);
+    velocityZ.resize(numParticles);
+    radius.resize(numParticles);
+    massInv.resize(numParticles);
+    alive.resize(numParticles);
+    killed.resize(numParticles);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////
 //
 // ArrayData
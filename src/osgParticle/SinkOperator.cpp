@@ -20,6 +20,32 @@
 
 using namespace osgParticle;
 
+void SinkOperator::operateParticles( ParticleSystem* ps, double dt )
+{
+    if ( !isEnabled() ) return;
+
+    // the particle arrays don't hold angular velocities, so sink those on the particles themselves.
+    if ( _sinkTarget==SINK_ANGULAR_VELOCITY || !ps->operateParticleArrays(this, dt) )
+        ps->operateParticlesInParallel( this, dt );
+}
+
+void SinkOperator::operateParticleArrays( ParticleSystem::ParticleArrays& arrays, unsigned int begin, unsigned int end, double /*dt*/ )
+{
+    const float* x = (_sinkTarget==SINK_VELOCITY) ? &arrays.velocityX.front() : &arrays.positionX.front();
+    const float* y = (_sinkTarget==SINK_VELOCITY) ? &arrays.velocityY.front() : &arrays.positionY.front();
+    const float* z = (_sinkTarget==SINK_VELOCITY) ? &arrays.velocityZ.front() : &arrays.positionZ.front();
+    for ( unsigned int i=begin; i<end; ++i )
+    {
+        if ( !arrays.alive[i] ) continue;
+
+        osg::Vec3 value( x[i], y[i], z[i] );
+        for ( std::vector<Domain>::const_iterator itr=_domains.begin(); itr!=_domains.end(); ++itr )
+        {
+            if ( mustKill(isInside(*itr, value)) ) arrays.killed[i] = 1;
+        }
+    }
+}
+
 void SinkOperator::beginOperate( Program* prg )
 {
     // Don't transform domains if they are used for sinking velocities
@@ -29,88 +55,95 @@ void SinkOperator::beginOperate( Program* prg )
 
 void SinkOperator::handlePoint( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    const osg::Vec3& value = getValue(P);
-    kill( P, (domain.v1==value) );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handleLineSegment( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    const osg::Vec3& value = getValue(P);
-    osg::Vec3 offset = value - domain.v1, normal = domain.v2 - domain.v1;
-    normal.normalize();
-
-    float diff = fabs(normal*offset - offset.length()) / domain.r1;
-    kill( P, (diff<SINK_EPSILON) );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handleTriangle( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    bool insideDomain = false;
-    const osg::Vec3& value = getValue(P);
-    osg::Vec3 offset = value - domain.v1;
-    if ( offset*domain.plane.getNormal()>SINK_EPSILON )
-        insideDomain = false;
-    else
-    {
-        float upos = offset * domain.s1;
-        float vpos = offset * domain.s2;
-        insideDomain = !(upos<0.0f || vpos<0.0f || (upos+vpos)>1.0f);
-    }
-    kill( P, insideDomain );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handleRectangle( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    bool insideDomain = false;
-    const osg::Vec3& value = getValue(P);
-    osg::Vec3 offset = value - domain.v1;
-    if ( offset*domain.plane.getNormal()>SINK_EPSILON )
-        insideDomain = false;
-    else
-    {
-        float upos = offset * domain.s1;
-        float vpos = offset * domain.s2;
-        insideDomain = !(upos<0.0f || upos>1.0f || vpos<0.0f || vpos>1.0f);
-    }
-    kill( P, insideDomain );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handlePlane( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    const osg::Vec3& value = getValue(P);
-    bool insideDomain = (domain.plane.getNormal()*value>=-domain.plane[3]);
-    kill( P, insideDomain );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handleSphere( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    const osg::Vec3& value = getValue(P);
-    float r = (value - domain.v1).length();
-    kill( P, (r<=domain.r1) );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handleBox( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    const osg::Vec3& value = getValue(P);
-    bool insideDomain = !(
-        (value.x() < domain.v1.x()) || (value.x() > domain.v2.x()) ||
-        (value.y() < domain.v1.y()) || (value.y() > domain.v2.y()) ||
-        (value.z() < domain.v1.z()) || (value.z() > domain.v2.z())
-    );
-    kill( P, insideDomain );
+    kill( P, isInside(domain, getValue(P)) );
 }
 
 void SinkOperator::handleDisk( const Domain& domain, Particle* P, double /*dt*/ )
 {
-    bool insideDomain = false;
-    const osg::Vec3& value = getValue(P);
-    osg::Vec3 offset = value - domain.v1;
-    if ( offset*domain.v2>SINK_EPSILON )
-        insideDomain = false;
-    else
+    kill( P, isInside(domain, getValue(P)) );
+}
+
+bool SinkOperator::isInside( const Domain& domain, const osg::Vec3& value ) const
+{
+    switch ( domain.type )
+    {
+    case Domain::POINT_DOMAIN:
+        return domain.v1==value;
+    case Domain::LINE_DOMAIN:
+    {
+        osg::Vec3 offset = value - domain.v1, normal = domain.v2 - domain.v1;
+        normal.normalize();
+
+        float diff = fabs(normal*offset - offset.length()) / domain.r1;
+        return diff<SINK_EPSILON;
+    }
+    case Domain::TRI_DOMAIN:
     {
+        osg::Vec3 offset = value - domain.v1;
+        if ( offset*domain.plane.getNormal()>SINK_EPSILON ) return false;
+
+        float upos = offset * domain.s1;
+        float vpos = offset * domain.s2;
+        return !(upos<0.0f || vpos<0.0f || (upos+vpos)>1.0f);
+    }
+    case Domain::RECT_DOMAIN:
+    {
+        osg::Vec3 offset = value - domain.v1;
+        if ( offset*domain.plane.getNormal()>SINK_EPSILON ) return false;
+
+        float upos = offset * domain.s1;
+        float vpos = offset * domain.s2;
+        return !(upos<0.0f || upos>1.0f || vpos<0.0f || vpos>1.0f);
+    }
+    case Domain::PLANE_DOMAIN:
+        return domain.plane.getNormal()*value>=-domain.plane[3];
+    case Domain::SPHERE_DOMAIN:
+        return (value - domain.v1).length()<=domain.r1;
+    case Domain::BOX_DOMAIN:
+        return !(
+            (value.x() < domain.v1.x()) || (value.x() > domain.v2.x()) ||
+            (value.y() < domain.v1.y()) || (value.y() > domain.v2.y()) ||
+            (value.z() < domain.v1.z()) || (value.z() > domain.v2.z())
+        );
+    case Domain::DISK_DOMAIN:
+    {
+        osg::Vec3 offset = value - domain.v1;
+        if ( offset*domain.v2>SINK_EPSILON ) return false;
+
         float length = offset.length();
-        insideDomain = (length<=domain.r1 && length>=domain.r2);
+        return (length<=domain.r1 && length>=domain.r2);
+    }
+    default:
+        return false;
     }
-    kill( P, insideDomain );
 }
@@ -0,0 +1,142 @@
+#ifndef OSG2_MAPPEDFILESTREAMBUFFER
+#define OSG2_MAPPEDFILESTREAMBUFFER
+
+#include <osg/Notify>
+#include <streambuf>
+#include <string>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+    #include <osgDB/ConvertUTF>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/** Read only stream buffer over a memory mapped file, so that reads from the stream are plain copies out of the mapping
+  * rather than going through the file buffer and system calls of a std::ifstream.*/
+class MappedFileStreamBuffer : public std::streambuf
+{
+public:
+    MappedFileStreamBuffer():
+        _data(0),
+        _size(0)
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        ,_mapping(NULL)
+#endif
+    {}
+
+    virtual ~MappedFileStreamBuffer() { close(); }
+
+    bool open( const std::string& fileName )
+    {
+        close();
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #ifdef OSG_USE_UTF8_FILENAME
+        HANDLE file = CreateFileW( osgDB::convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    #else
+        HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    #endif
+        if ( file==INVALID_HANDLE_VALUE ) return false;
+
+        LARGE_INTEGER fileSize;
+        if ( GetFileSizeEx(file, &fileSize) && fileSize.QuadPart>0 )
+        {
+            _mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+            if ( _mapping!=NULL )
+            {
+                _data = static_cast<char*>( MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) );
+                if ( _data ) _size = static_cast<size_t>(fileSize.QuadPart);
+                else { CloseHandle(_mapping); _mapping = NULL; }
+            }
+        }
+        CloseHandle( file );
+#else
+        int fd = ::open( fileName.c_str(), O_RDONLY );
+        if ( fd<0 ) return false;
+
+        struct stat fileStat;
+        if ( fstat(fd, &fileStat)==0 && fileStat.st_size>0 )
+        {
+            void* data = mmap( 0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( data!=MAP_FAILED )
+            {
+                _data = static_cast<char*>( data );
+                _size = static_cast<size_t>( fileStat.st_size );
+            #ifdef MADV_SEQUENTIAL
+                madvise( data, _size, MADV_SEQUENTIAL );
+            #endif
+            }
+        }
+        ::close( fd );
+#endif
+
+        if ( !_data )
+        {
+            OSG_INFO<<"MappedFileStreamBuffer: unable to memory map "<<fileName<<std::endl;
+            return false;
+        }
+
+        setg( _data, _data, _data+_size );
+        return true;
+    }
+
+    void close()
+    {
+        if ( !_data ) return;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        UnmapViewOfFile( _data );
+        CloseHandle( _mapping );
+        _mapping = NULL;
+#else
+        munmap( _data, _size );
+#endif
+        _data = 0;
+        _size = 0;
+        setg( 0, 0, 0 );
+    }
+
+    bool isOpen() const { return _data!=0; }
+
+protected:
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+    {
+        off_type base = 0;
+        if ( dir==std::ios_base::cur ) base = gptr()-eback();
+        else if ( dir==std::ios_base::end ) base = static_cast<off_type>(_size);
+        return seekpos( pos_type(base+off), which );
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which )
+    {
+        off_type offset = pos;
+        if ( !_data || !(which & std::ios_base::in) || offset<0 || offset>static_cast<off_type>(_size) ) return pos_type(off_type(-1));
+        setg( _data, _data+offset, _data+_size );
+        return pos;
+    }
+
+    virtual std::streamsize showmanyc()
+    {
+        return gptr()<egptr() ? static_cast<std::streamsize>(egptr()-gptr()) : -1;
+    }
+
+    char*   _data;
+    size_t  _size;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    HANDLE  _mapping;
+#endif
+
+private:
+    MappedFileStreamBuffer( const MappedFileStreamBuffer& );
+    MappedFileStreamBuffer& operator=( const MappedFileStreamBuffer& );
+};
+
+#endif
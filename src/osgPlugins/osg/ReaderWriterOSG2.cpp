@@ -20,6 +20,7 @@
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
 #include "XmlStreamOperator.h"
+#include "MappedFileStreamBuffer.h"
 
 using namespace osgDB;
 
@@ -128,6 +129,7 @@ public:
         supportsOption( "Ascii", "Import/Export option: Force reading/writing ascii file" );
         supportsOption( "XML", "Import/Export option: Force reading/writing XML file" );
         supportsOption( "ForceReadingImage", "Import option: Load an empty image instead if required file missed" );
+        supportsOption( "MemoryMapping=<true/false>", "Import option: Memory map binary files rather than reading them through a file stream, defaults to true" );
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
         supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
@@ -174,6 +176,13 @@ public:
         return local_opt.release();
     }
 
+    bool useMemoryMapping( const Options* options, std::ios::openmode mode ) const
+    {
+        // only binary files are mapped, text files may need the line ending translation done by the file stream.
+        if ( (mode & std::ios::binary)==0 ) return false;
+        return !options || options->getPluginStringData("MemoryMapping")!="false";
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,6 +191,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt, mode) )
+        {
+            MappedFileStreamBuffer buffer;
+            if ( buffer.open(fileName) )
+            {
+                std::istream istream( &buffer );
+                return readObject( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -213,6 +232,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt, mode) )
+        {
+            MappedFileStreamBuffer buffer;
+            if ( buffer.open(fileName) )
+            {
+                std::istream istream( &buffer );
+                return readImage( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -244,6 +273,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt, mode) )
+        {
+            MappedFileStreamBuffer buffer;
+            if ( buffer.open(fileName) )
+            {
+                std::istream istream( &buffer );
+                return readNode( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
@@ -35,13 +35,25 @@ DisplacementMappingTechnique::~DisplacementMappingTechnique()
 {
 }
 
-void DisplacementMappingTechnique::init(int /*dirtyMask*/, bool /*assumeMultiThreaded*/)
+void DisplacementMappingTechnique::init(int /*dirtyMask*/, bool assumeMultiThreaded)
 {
     if (!_terrainTile) return;
     if (!_terrainTile->getTerrain()) return;
 
     GeometryPool* geometryPool = _terrainTile->getTerrain()->getGeometryPool();
-    _transform = geometryPool->getTileSubgraph(_terrainTile);
+    osg::ref_ptr<osg::MatrixTransform> transform = geometryPool->getTileSubgraph(_terrainTile);
+
+    if (assumeMultiThreaded)
+    {
+        // other threads may be traversing the current _transform so request that the new one gets swapped in on next frame.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_transformMutex);
+        _newTransform = transform;
+        _terrainTile->getTerrain()->updateTerrainTileOnNextFrame(_terrainTile);
+    }
+    else
+    {
+        _transform = transform;
+    }
 
     // set tile as no longer dirty.
     _terrainTile->setDirtyMask(0);
@@ -51,6 +63,13 @@ void DisplacementMappingTechnique::update(osgUtil::UpdateVisitor* uv)
 {
     if (_terrainTile) _terrainTile->osg::Group::traverse(*uv);
 
+    if (_newTransform.valid())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_transformMutex);
+        _transform = _newTransform;
+        _newTransform = 0;
+    }
+
     if (_transform.valid()) _transform->accept(*uv);
 }
 
@@ -107,4 +126,6 @@ void DisplacementMappingTechnique::releaseGLObjects(osg::State* state) const
 //      OSG_NOTICE<<"DisplacementMappingTechnique::releaseGLObjects()"<<std::endl;
         _transform->releaseGLObjects(state);
     }
+
+    if (_newTransform.valid()) _newTransform->releaseGLObjects(state);
 }
@@ -132,7 +132,7 @@ osg::ref_ptr<SharedGeometry> GeometryPool::getOrCreateGeometry(osgTerrain::Terra
 
 
     int nx = key.nx;
-    int ny = key.nx;
+    int ny = key.ny;
 
     int numVerticesMainBody = nx * ny;
     int numVerticesSkirt = (nx)*2 + (ny)*2;
@@ -395,6 +395,13 @@ osg::ref_ptr<SharedGeometry> GeometryPool::getOrCreateGeometry(osgTerrain::Terra
         }
     }
 
+    osg::BoundingBox normalBoundingBox;
+    for(osg::Vec3Array::const_iterator itr = normals->begin(); itr != normals->end(); ++itr)
+    {
+        normalBoundingBox.expandBy(*itr);
+    }
+    geometry->setNormalBoundingBox(normalBoundingBox);
+
     // double tileWidth = (bottom_right-bottom_left).length();
     // double skirtHeight = tileWidth*0.05;
 
@@ -458,56 +465,8 @@ osg::ref_ptr<osg::MatrixTransform> GeometryPool::getTileSubgraph(osgTerrain::Ter
         }
     }
 
-    osg::Vec3Array* shared_vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
-    osg::Vec3Array* shared_normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
-    osg::FloatArray* heights = hf ? hf->getFloatArray() : 0;
-    const SharedGeometry::VertexToHeightFieldMapping& vthfm = geometry->getVertexToHeightFieldMapping();
-
-    if (hf && shared_vertices && shared_normals && (shared_vertices->size()==shared_normals->size()))
-    {
-        if (vthfm.size()==shared_vertices->size())
-        {
-            // Using cache VertexArray
-            unsigned int numVertices = shared_vertices->size();
-            osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
-            vertices->resize(numVertices);
-
-            for(unsigned int i=0; i<numVertices; ++i)
-            {
-                unsigned int hi = vthfm[i];
-                (*vertices)[i] = (*shared_vertices)[i] + (*shared_normals)[i] * (*heights)[hi];
-            }
-
-            hfDrawable->setVertices(vertices.get());
-        }
-        else
-        {
-            // Setting local bounding
-            unsigned int nr = hf->getNumRows();
-            unsigned int nc = hf->getNumColumns();
-
-            osg::BoundingBox bb;
-
-            for(unsigned int r=0; r<nr; ++r)
-            {
-                for(unsigned int c=0; c<nc; ++c)
-                {
-                    unsigned int i = r*nc+c;
-                    float h = (*heights)[i];
-                    const osg::Vec3& v = (*shared_vertices)[i];
-                    const osg::Vec3& n = (*shared_normals)[i];
-
-                    const osg::Vec3 vt(v+n*h);
-                    bb.expandBy(vt);
-                }
-            }
-            hfDrawable->setInitialBound(bb);
-            // OSG_NOTICE<<"Assigning initial bound ("<<bb.xMin()<<", "<<bb.xMax()<<") ,  ("<<bb.yMin()<<", "<<bb.yMax()<<") ("<<bb.zMin()<<", "<<bb.zMax()<<")"<< std::endl;
-            // bb = hfDrawable->getBoundingBox();
-            //OSG_NOTICE<<"         getBoundingBox ("<<bb.xMin()<<", "<<bb.xMax()<<") ,  ("<<bb.yMin()<<", "<<bb.yMax()<<") ("<<bb.zMin()<<", "<<bb.zMax()<<")"<< std::endl;
-
-        }
-    }
+    // the displaced vertices are only computed on demand by HeightFieldDrawable::getOrCreateVertices(),
+    // the bounding box is computed from the SharedGeometry and the range of heights.
 
     osg::ref_ptr<osg::StateSet> stateset = transform->getOrCreateStateSet();
 
@@ -606,7 +565,7 @@ void GeometryPool::applyLayers(osgTerrain::TerrainTile* tile, osg::StateSet* sta
 
             const void* dataPtr = hfl->getHeightField()->getFloatArray()->getDataPointer();
 
-            image->setImage(hfl->getNumRows(), hfl->getNumColumns(), 1,
+            image->setImage(hfl->getNumColumns(), hfl->getNumRows(), 1,
                       GL_LUMINANCE32F_ARB,
                       GL_LUMINANCE, GL_FLOAT,
                       reinterpret_cast<unsigned char*>(const_cast<void*>(dataPtr)),
@@ -784,7 +743,8 @@ SharedGeometry::SharedGeometry(const SharedGeometry& rhs,const osg::CopyOp& copy
     _colorArray(rhs._colorArray),
     _texcoordArray(rhs._texcoordArray),
     _drawElements(rhs._drawElements),
-    _vertexToHeightFieldMapping(rhs._vertexToHeightFieldMapping)
+    _vertexToHeightFieldMapping(rhs._vertexToHeightFieldMapping),
+    _normalBoundingBox(rhs._normalBoundingBox)
 {
 //    setSupportsDisplayList(false);
 }
@@ -1059,14 +1019,96 @@ void HeightFieldDrawable::accept(osg::Drawable::ConstAttributeFunctor& caf) cons
     if (_geometry) _geometry->accept(caf);
 }
 
+const osg::Vec3Array* HeightFieldDrawable::getOrCreateVertices() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_verticesMutex);
+
+    if (_vertices.valid() || !_geometry || !_heightField) return _vertices.get();
+
+    const osg::Vec3Array* shared_vertices = dynamic_cast<const osg::Vec3Array*>(_geometry->getVertexArray());
+    const osg::Vec3Array* shared_normals = dynamic_cast<const osg::Vec3Array*>(_geometry->getNormalArray());
+    const osg::FloatArray* heights = _heightField->getFloatArray();
+    const SharedGeometry::VertexToHeightFieldMapping& vthfm = _geometry->getVertexToHeightFieldMapping();
+
+    if (!shared_vertices || !shared_normals || !heights ||
+        shared_vertices->size()!=shared_normals->size() ||
+        vthfm.size()!=shared_vertices->size())
+    {
+        return 0;
+    }
+
+    unsigned int numVertices = shared_vertices->size();
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->resize(numVertices);
+
+    for(unsigned int i=0; i<numVertices; ++i)
+    {
+        unsigned int hi = vthfm[i];
+        (*vertices)[i] = (*shared_vertices)[i] + (*shared_normals)[i] * (*heights)[hi];
+    }
+
+    _vertices = vertices;
+
+    return _vertices.get();
+}
+
+osg::BoundingBox HeightFieldDrawable::computeBoundingBox() const
+{
+    osg::BoundingBox bb;
+    if (!_geometry) return bb;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_verticesMutex);
+        if (_vertices.valid())
+        {
+            for(osg::Vec3Array::const_iterator itr = _vertices->begin(); itr != _vertices->end(); ++itr)
+            {
+                bb.expandBy(*itr);
+            }
+            return bb;
+        }
+    }
+
+    const osg::FloatArray* heights = _heightField.valid() ? _heightField->getFloatArray() : 0;
+    const osg::BoundingBox& normalBB = _geometry->getNormalBoundingBox();
+    if (!heights || heights->empty() || !normalBB.valid())
+    {
+        return osg::Drawable::computeBoundingBox();
+    }
+
+    float minHeight = FLT_MAX;
+    float maxHeight = -FLT_MAX;
+    for(osg::FloatArray::const_iterator itr = heights->begin(); itr != heights->end(); ++itr)
+    {
+        minHeight = osg::minimum(minHeight, *itr);
+        maxHeight = osg::maximum(maxHeight, *itr);
+    }
+
+    // each vertex is displaced by normal*height, so bound the displacement along each axis
+    // by the extremes of the products of the normal and height ranges.
+    const osg::BoundingBox& vertexBB = _geometry->getBoundingBox();
+    for(unsigned int i=0; i<3; ++i)
+    {
+        float d0 = normalBB._min[i]*minHeight;
+        float d1 = normalBB._min[i]*maxHeight;
+        float d2 = normalBB._max[i]*minHeight;
+        float d3 = normalBB._max[i]*maxHeight;
+        bb._min[i] = vertexBB._min[i] + osg::minimum(osg::minimum(d0, d1), osg::minimum(d2, d3));
+        bb._max[i] = vertexBB._max[i] + osg::maximum(osg::maximum(d0, d1), osg::maximum(d2, d3));
+    }
+
+    return bb;
+}
+
 void HeightFieldDrawable::accept(osg::PrimitiveFunctor& pf) const
 {
     // use the cached vertex positions for PrimitiveFunctor operations
     if (!_geometry) return;
 
-    if (_vertices.valid())
+    const osg::Vec3Array* vertices = getOrCreateVertices();
+    if (vertices)
     {
-        pf.setVertexArray(_vertices->size(), &((*_vertices)[0]));
+        pf.setVertexArray(vertices->size(), &((*vertices)[0]));
 
         const osg::DrawElementsUShort* deus = dynamic_cast<const osg::DrawElementsUShort*>(_geometry->getDrawElements());
         if (deus)
@@ -1090,9 +1132,12 @@ void HeightFieldDrawable::accept(osg::PrimitiveFunctor& pf) const
 
 void HeightFieldDrawable::accept(osg::PrimitiveIndexFunctor& pif) const
 {
-    if (_vertices.valid())
+    if (!_geometry) return;
+
+    const osg::Vec3Array* vertices = getOrCreateVertices();
+    if (vertices)
     {
-        pif.setVertexArray(_vertices->size(), &((*_vertices)[0]));
+        pif.setVertexArray(vertices->size(), &((*vertices)[0]));
 
         const osg::DrawElementsUShort* deus = dynamic_cast<const osg::DrawElementsUShort*>(_geometry->getDrawElements());
         if (deus)
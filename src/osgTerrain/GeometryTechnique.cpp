@@ -28,7 +28,8 @@
 
 using namespace osgTerrain;
 
-GeometryTechnique::GeometryTechnique()
+GeometryTechnique::GeometryTechnique():
+    _useGeometryPool(false)
 {
     setFilterBias(0);
     setFilterWidth(0.1);
@@ -37,7 +38,8 @@ GeometryTechnique::GeometryTechnique()
 }
 
 GeometryTechnique::GeometryTechnique(const GeometryTechnique& gt,const osg::CopyOp& copyop):
-    TerrainTechnique(gt,copyop)
+    TerrainTechnique(gt,copyop),
+    _useGeometryPool(gt._useGeometryPool)
 {
     setFilterBias(gt._filterBias);
     setFilterWidth(gt._filterWidth);
@@ -107,45 +109,55 @@ void GeometryTechnique::init(int dirtyMask, bool assumeMultiThreaded)
 
     osg::ref_ptr<BufferData> buffer = new BufferData;
 
-    Locator* masterLocator = computeMasterLocator();
-
-    osg::Vec3d centerModel = computeCenterModel(*buffer, masterLocator);
-
-    if ((dirtyMask & TerrainTile::IMAGERY_DIRTY)==0)
+    if (canUseGeometryPool())
     {
-        generateGeometry(*buffer, masterLocator, centerModel);
+        // share the grid geometry with all the other tiles of the same resolution, the pool applies the layers.
+        GeometryPool* geometryPool = _terrainTile->getTerrain()->getGeometryPool();
+        buffer->_transform = geometryPool->getTileSubgraph(_terrainTile);
+        if (buffer->_transform.valid()) applyTransparency(*buffer);
+    }
+    else
+    {
+        Locator* masterLocator = computeMasterLocator();
+
+        osg::Vec3d centerModel = computeCenterModel(*buffer, masterLocator);
 
         osg::ref_ptr<BufferData> read_buffer = _currentBufferData;
 
-        osg::StateSet* stateset = read_buffer->_geode->getStateSet();
-        if (stateset)
+        if ((dirtyMask & TerrainTile::IMAGERY_DIRTY)==0 && read_buffer.valid() && read_buffer->_geode.valid())
         {
-            // OSG_NOTICE<<"Reusing StateSet"<<std::endl;
-            buffer->_geode->setStateSet(stateset);
+            generateGeometry(*buffer, masterLocator, centerModel);
+
+            osg::StateSet* stateset = read_buffer->_geode->getStateSet();
+            if (stateset)
+            {
+                // OSG_NOTICE<<"Reusing StateSet"<<std::endl;
+                buffer->_geode->setStateSet(stateset);
+            }
+            else
+            {
+                applyColorLayers(*buffer);
+                applyTransparency(*buffer);
+            }
         }
         else
         {
+            generateGeometry(*buffer, masterLocator, centerModel);
             applyColorLayers(*buffer);
             applyTransparency(*buffer);
         }
     }
-    else
-    {
-        generateGeometry(*buffer, masterLocator, centerModel);
-        applyColorLayers(*buffer);
-        applyTransparency(*buffer);
-    }
 
     if (buffer->_transform.valid()) buffer->_transform->setThreadSafeRefUnref(true);
 
-    if (!_currentBufferData || !assumeMultiThreaded)
+    if (!assumeMultiThreaded || !_terrainTile->getTerrain())
     {
-        // no currentBufferData so we must be the first init to be applied
+        // we're in the traversal, or there is no Terrain to request an update from, so apply the buffer immediately.
         _currentBufferData = buffer;
     }
     else
     {
-        // there is already an active _currentBufferData so we'll request that this gets swapped on next frame.
+        // other threads may be traversing the _currentBufferData so we'll request that this gets swapped on next frame.
         _newBufferData = buffer;
         if (_terrainTile->getTerrain()) _terrainTile->getTerrain()->updateTerrainTileOnNextFrame(_terrainTile);
     }
@@ -1416,21 +1428,46 @@ void GeometryTechnique::applyTransparency(BufferData& buffer)
 
     if (enableBlending)
     {
-        osg::StateSet* stateset = buffer._geode->getOrCreateStateSet();
+        osg::StateSet* stateset = buffer._geode.valid() ? buffer._geode->getOrCreateStateSet() : buffer._transform->getOrCreateStateSet();
         stateset->setMode(GL_BLEND, osg::StateAttribute::ON);
         stateset->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
     }
 
 }
 
+bool GeometryTechnique::canUseGeometryPool() const
+{
+    if (!_useGeometryPool) return false;
+
+    const Terrain* terrain = _terrainTile->getTerrain();
+    if (!terrain || !terrain->getGeometryPool()) return false;
+
+    if (terrain->getSampleRatio()!=1.0f || terrain->getVerticalScale()!=1.0f || terrain->getEqualizeBoundaries()) return false;
+
+    const HeightFieldLayer* hfl = dynamic_cast<const HeightFieldLayer*>(_terrainTile->getElevationLayer());
+    if (!hfl || !hfl->getHeightField()) return false;
+
+    for(unsigned int layerNum=0; layerNum<_terrainTile->getNumColorLayers(); ++layerNum)
+    {
+        if (dynamic_cast<const ContourLayer*>(_terrainTile->getColorLayer(layerNum))) return false;
+    }
+
+    return true;
+}
+
 void GeometryTechnique::update(osgUtil::UpdateVisitor* uv)
 {
     if (_terrainTile) _terrainTile->osg::Group::traverse(*uv);
 
-    if (_newBufferData.valid())
+    // if an init is running on another thread leave the swap to the update that init will request.
+    if (_newBufferData.valid() && _writeBufferMutex.trylock()==0)
     {
-        _currentBufferData = _newBufferData;
-        _newBufferData = 0;
+        if (_newBufferData.valid())
+        {
+            _currentBufferData = _newBufferData;
+            _newBufferData = 0;
+        }
+        _writeBufferMutex.unlock();
     }
 }
 
@@ -1454,7 +1491,7 @@ void GeometryTechnique::traverse(osg::NodeVisitor& nv)
     // if app traversal update the frame count.
     if (nv.getVisitorType()==osg::NodeVisitor::UPDATE_VISITOR)
     {
-        if (_terrainTile->getDirty()) _terrainTile->init(_terrainTile->getDirtyMask(), false);
+        if (_terrainTile->getDirty()) _terrainTile->requestInit(_terrainTile->getDirtyMask());
 
         osgUtil::UpdateVisitor* uv = nv.asUpdateVisitor();
         if (uv)
@@ -1477,7 +1514,7 @@ void GeometryTechnique::traverse(osg::NodeVisitor& nv)
     if (_terrainTile->getDirty())
     {
         OSG_INFO<<"******* Doing init ***********"<<std::endl;
-        _terrainTile->init(_terrainTile->getDirtyMask(), false);
+        _terrainTile->requestInit(_terrainTile->getDirtyMask());
     }
 
     if (_currentBufferData.valid())
@@ -13,6 +13,7 @@
 
 #include <osgTerrain/Terrain>
 #include <osgUtil/UpdateVisitor>
+#include <osg/observer_ptr>
 
 #include <iterator>
 
@@ -25,7 +26,9 @@ Terrain::Terrain():
     _sampleRatio(1.0),
     _verticalScale(1.0),
     _blendingPolicy(TerrainTile::INHERIT),
-    _equalizeBoundaries(false)
+    _equalizeBoundaries(false),
+    _initializeTilesAsynchronously(false),
+    _maximumNumTilesUpdatedPerFrame(0)
 {
     setNumChildrenRequiringUpdateTraversal(1);
     _geometryPool = new GeometryPool;
@@ -38,6 +41,9 @@ Terrain::Terrain(const Terrain& ts, const osg::CopyOp& copyop):
     _blendingPolicy(ts._blendingPolicy),
     _equalizeBoundaries(ts._equalizeBoundaries),
     _geometryPool(ts._geometryPool),
+    _initializeTilesAsynchronously(ts._initializeTilesAsynchronously),
+    _tileInitializationThreadPool(ts._tileInitializationThreadPool),
+    _maximumNumTilesUpdatedPerFrame(ts._maximumNumTilesUpdatedPerFrame),
     _terrainTechnique(ts._terrainTechnique)
 {
     setNumChildrenRequiringUpdateTraversal(getNumChildrenRequiringUpdateTraversal()+1);
@@ -99,7 +105,9 @@ void Terrain::traverse(osg::NodeVisitor& nv)
             TerrainTileList tiles;
             {
                 OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_mutex);
-                for(TerrainTileSet::iterator itr = _updateTerrainTileSet.begin(); itr !=_updateTerrainTileSet.end(); ++itr)
+                unsigned int numTiles = 0;
+                TerrainTileSet::iterator itr = _updateTerrainTileSet.begin();
+                for(; itr !=_updateTerrainTileSet.end() && (_maximumNumTilesUpdatedPerFrame==0 || numTiles<_maximumNumTilesUpdatedPerFrame); ++itr, ++numTiles)
                 {
                     // take a reference first to make sure that the referenceCount can be safely read without another thread decrementing it to zero.
                     (*itr)->ref();
@@ -110,7 +118,9 @@ void Terrain::traverse(osg::NodeVisitor& nv)
                     // use unref_nodelete to avoid any issues when the *itr TerrainTile has been deleted by another thread while this for loop has been running.
                     (*itr)->unref_nodelete();
                 }
-                _updateTerrainTileSet.clear();
+
+                // leave any tiles beyond the per frame budget to the following frames.
+                _updateTerrainTileSet.erase(_updateTerrainTileSet.begin(), itr);
             }
 
             for(TerrainTileList::iterator itr = tiles.begin();
@@ -145,6 +155,68 @@ void Terrain::updateTerrainTileOnNextFrame(TerrainTile* terrainTile)
     _updateTerrainTileSet.insert(terrainTile);
 }
 
+namespace osgTerrain
+{
+
+class InitTerrainTileOperation : public osg::Operation
+{
+    public:
+
+        InitTerrainTileOperation(Terrain* terrain, TerrainTile* terrainTile):
+            osg::Operation("InitTerrainTile", false),
+            _terrain(terrain),
+            _terrainTile(terrainTile) {}
+
+        virtual void operator () (osg::Object*)
+        {
+            osg::ref_ptr<Terrain> terrain;
+            if (!_terrain.lock(terrain)) return;
+
+            // take the dirty mask so that requests made from now on queue a new init.
+            int dirtyMask = TerrainTile::NOT_DIRTY;
+            {
+                OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(terrain->_mutex);
+                Terrain::TerrainTileDirtyMaskMap::iterator itr = terrain->_pendingTileInitMap.find(_terrainTile.get());
+                if (itr == terrain->_pendingTileInitMap.end()) return;
+
+                dirtyMask = itr->second;
+                terrain->_pendingTileInitMap.erase(itr);
+            }
+
+            // only initialize tiles that are still part of the scene graph.
+            if (_terrainTile->referenceCount()>1 && _terrainTile->getTerrain()==terrain.get())
+            {
+                _terrainTile->init(dirtyMask, true);
+            }
+        }
+
+    protected:
+
+        osg::observer_ptr<Terrain>      _terrain;
+        osg::ref_ptr<TerrainTile>       _terrainTile;
+};
+
+}
+
+void Terrain::requestTileInit(TerrainTile* terrainTile, int dirtyMask)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_mutex);
+
+        TerrainTileDirtyMaskMap::iterator itr = _pendingTileInitMap.find(terrainTile);
+        if (itr != _pendingTileInitMap.end())
+        {
+            itr->second |= dirtyMask;
+            return;
+        }
+
+        _pendingTileInitMap[terrainTile] = dirtyMask;
+    }
+
+    osg::OperationThreadPool* pool = _tileInitializationThreadPool.valid() ? _tileInitializationThreadPool.get() : osg::OperationThreadPool::instance().get();
+    pool->add(new InitTerrainTileOperation(this, terrainTile));
+}
+
 
 TerrainTile* Terrain::getTile(const TileID& tileID)
 {
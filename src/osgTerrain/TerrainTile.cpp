@@ -140,7 +140,7 @@ void TerrainTile::traverse(osg::NodeVisitor& nv)
             }
         }
 
-        init(getDirtyMask(), false);
+        requestInit(getDirtyMask());
 
         _hasBeenTraversal = true;
     }
@@ -164,20 +164,24 @@ void TerrainTile::traverse(osg::NodeVisitor& nv)
     }
 }
 
-void TerrainTile::init(int dirtyMask, bool assumeMultiThreaded)
+void TerrainTile::createTerrainTechnique()
 {
-    if (!_terrainTechnique)
+    if (_terrainTechnique.valid()) return;
+
+    if (_terrain && _terrain->getTerrainTechniquePrototype())
     {
-        if (_terrain && _terrain->getTerrainTechniquePrototype())
-        {
-            osg::ref_ptr<osg::Object> object = _terrain->getTerrainTechniquePrototype()->clone(osg::CopyOp::DEEP_COPY_ALL);
-            setTerrainTechnique(dynamic_cast<TerrainTechnique*>(object.get()));
-        }
-        else
-        {
-            setTerrainTechnique(new GeometryTechnique);
-        }
+        osg::ref_ptr<osg::Object> object = _terrain->getTerrainTechniquePrototype()->clone(osg::CopyOp::DEEP_COPY_ALL);
+        setTerrainTechnique(dynamic_cast<TerrainTechnique*>(object.get()));
     }
+    else
+    {
+        setTerrainTechnique(new GeometryTechnique);
+    }
+}
+
+void TerrainTile::init(int dirtyMask, bool assumeMultiThreaded)
+{
+    createTerrainTechnique();
 
     if (_terrainTechnique.valid())
     {
@@ -185,6 +189,26 @@ void TerrainTile::init(int dirtyMask, bool assumeMultiThreaded)
     }
 }
 
+void TerrainTile::requestInit(int dirtyMask)
+{
+    if (!_terrain || !_terrain->getInitializeTilesAsynchronously())
+    {
+        init(dirtyMask, false);
+        return;
+    }
+
+    // assigning the technique and clearing the dirty mask adjust the update traversal counts, which isn't
+    // thread safe, so do both here rather than leave them to the init on the thread pool.
+    createTerrainTechnique();
+
+    dirtyMask |= getDirtyMask();
+    if (dirtyMask==NOT_DIRTY) return;
+
+    setDirtyMask(NOT_DIRTY);
+
+    _terrain->requestTileInit(this, dirtyMask);
+}
+
 void TerrainTile::setTerrainTechnique(TerrainTechnique* terrainTechnique)
 {
     if (_terrainTechnique == terrainTechnique) return;
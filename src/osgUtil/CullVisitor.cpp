@@ -13,6 +13,7 @@
 #include <osg/Transform>
 #include <osg/Projection>
 #include <osg/Geode>
+#include <osg/Switch>
 #include <osg/LOD>
 #include <osg/Billboard>
 #include <osg/LightSource>
@@ -26,18 +27,25 @@
 #include <osg/LineSegment>
 #include <osg/TemplatePrimitiveFunctor>
 #include <osg/Geometry>
+#include <osg/OperationThread>
+#include <osg/ApplicationUsage>
 #include <osg/io_utils>
 
 #include <osgUtil/CullVisitor>
 
 #include <float.h>
+#include <stdlib.h>
 #include <algorithm>
+#include <typeinfo>
 
 #include <osg/Timer>
 
 using namespace osg;
 using namespace osgUtil;
 
+static osg::ApplicationUsageProxy CullVisitor_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PARALLEL_CULL_THRESHOLD <num>","Set the number of children a Group must have before they are culled in parallel, 0 disables parallel culling.");
+static osg::ApplicationUsageProxy CullVisitor_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BATCH_CULL_THRESHOLD <num>","Set the number of children a Group must have before their bounding spheres are culled in a single batched pass, 0 disables batched culling.");
+
 inline float MAX_F(float a, float b)
     { return a>b?a:b; }
 inline int EQUAL_F(float a, float b)
@@ -52,9 +60,19 @@ CullVisitor::CullVisitor():
     _computed_znear(FLT_MAX),
     _computed_zfar(-FLT_MAX),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _parallelCullThreshold(0),
+    _maximumNumParallelCullTasks(0),
+    _batchCullDepth(0),
+    _batchCullThreshold(32)
 {
     _identifier = new Identifier;
+
+    const char* str = getenv("OSG_PARALLEL_CULL_THRESHOLD");
+    if (str) _parallelCullThreshold = atoi(str);
+
+    str = getenv("OSG_BATCH_CULL_THRESHOLD");
+    if (str) _batchCullThreshold = atoi(str);
 }
 
 CullVisitor::CullVisitor(const CullVisitor& rhs):
@@ -68,7 +86,11 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _computed_zfar(-FLT_MAX),
     _currentReuseRenderLeafIndex(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
-    _identifier(rhs._identifier)
+    _identifier(rhs._identifier),
+    _parallelCullThreshold(rhs._parallelCullThreshold),
+    _maximumNumParallelCullTasks(rhs._maximumNumParallelCullTasks),
+    _batchCullDepth(0),
+    _batchCullThreshold(rhs._batchCullThreshold)
 {
 }
 
@@ -133,6 +155,14 @@ void CullVisitor::reset()
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
+
+    // the parallel cull visitors' RenderLeaf are merged into our StateGraph, so recycle them on the same frame boundary as ours.
+    for(CullVisitorList::iterator itr = _parallelCullVisitors.begin();
+        itr != _parallelCullVisitors.end();
+        ++itr)
+    {
+        (*itr)->reset();
+    }
 }
 
 float CullVisitor::getDistanceToEyePoint(const Vec3& pos, bool withLODScale) const
@@ -1224,7 +1254,26 @@ void CullVisitor::apply(Group& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (_parallelCullThreshold>0 &&
+        node.getNumChildren()>=_parallelCullThreshold &&
+        !node.getCullCallback() &&
+        (getTraversalMode()==TRAVERSE_ALL_CHILDREN || getTraversalMode()==TRAVERSE_ACTIVE_CHILDREN) &&
+        typeid(node)==typeid(osg::Group))
+    {
+        parallelCullChildren(node);
+    }
+    else if (_batchCullThreshold>0 &&
+             node.getNumChildren()>=_batchCullThreshold &&
+             !node.getCullCallback() &&
+             (getTraversalMode()==TRAVERSE_ALL_CHILDREN || getTraversalMode()==TRAVERSE_ACTIVE_CHILDREN) &&
+             typeid(node)==typeid(osg::Group))
+    {
+        batchCullChildren(node);
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     // pop the node's state off the render graph stack.
     if (node_state) popStateSet();
@@ -1233,6 +1282,302 @@ void CullVisitor::apply(Group& node)
     popCurrentMask();
 }
 
+namespace
+{
+
+// Geode, Transform (other than Camera), Group, Switch and LOD are all culled against their bounding sphere before anything else is
+// done with them, while Drawables, Cameras and the positional state, projection and occluder nodes are not culled at all.
+inline bool isBatchCullable(const osg::Node& node)
+{
+    if (node.asGeode()) return true;
+    if (node.asTransform()) return node.asCamera()==0;
+
+    const std::type_info& type = typeid(node);
+    return type==typeid(osg::Group) || type==typeid(osg::Switch) || type==typeid(osg::LOD);
+}
+
+}
+
+void CullVisitor::batchCullChildren(osg::Group& group)
+{
+    unsigned int numChildren = group.getNumChildren();
+
+    unsigned int depth = _batchCullDepth++;
+    if (_batchCullBuffers.size()<=depth) _batchCullBuffers.resize(depth+1);
+
+    // only children that start by culling their own bounding sphere can be culled ahead of being visited,
+    // the rest are given a sphere that is never culled so they are traversed as usual.
+    {
+        std::vector<osg::BoundingSphere>& spheres = _batchCullBuffers[depth]._spheres;
+        spheres.resize(numChildren);
+        for(unsigned int i=0; i<numChildren; ++i)
+        {
+            const osg::Node* child = group.getChild(i);
+            if (child->isCullingActive() && isBatchCullable(*child))
+            {
+                spheres[i] = child->getBound();
+            }
+            else
+            {
+                spheres[i].set(osg::BoundingSphere::vec_type(0.0f,0.0f,0.0f), FLT_MAX);
+            }
+        }
+
+        _batchCullBuffers[depth]._resultMasks.resize(numChildren);
+        getCurrentCullingSet().isCulled(&spheres.front(), numChildren, &(_batchCullBuffers[depth]._resultMasks.front()));
+    }
+
+    for(unsigned int i=0; i<numChildren; ++i)
+    {
+        // the buffers may be reallocated by nested batch culls, so always access them by index.
+        osg::Polytope::ClippingMask resultMask = _batchCullBuffers[depth]._resultMasks[i];
+        if (resultMask==osg::Polytope::OUTSIDE_CLIPPING_SET) continue;
+
+        // pass on the frustum planes the child still intersects so its own cull test skips the others.
+        getCurrentCullingSet().getFrustum().setResultMask(resultMask);
+        getCurrentCullingSet().getFrustum().pushCurrentMask();
+
+        group.getChild(i)->accept(*this);
+
+        getCurrentCullingSet().getFrustum().popCurrentMask();
+    }
+
+    --_batchCullDepth;
+}
+
+namespace
+{
+
+struct ParallelCullOperation : public osg::Operation
+{
+    ParallelCullOperation(CullVisitor* cv, osg::Group* group, unsigned int startChild, unsigned int endChild, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("ParallelCull", false),
+        _cullVisitor(cv),
+        _group(group),
+        _startChild(startChild),
+        _endChild(endChild),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        for(unsigned int i=_startChild; i<_endChild; ++i)
+        {
+            _group->getChild(i)->accept(*_cullVisitor);
+        }
+
+        _blockCount->completed();
+    }
+
+    CullVisitor*                        _cullVisitor;
+    osg::Group*                         _group;
+    unsigned int                        _startChild;
+    unsigned int                        _endChild;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+};
+
+}
+
+void CullVisitor::parallelCullChildren(osg::Group& group)
+{
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+
+    unsigned int numChildren = group.getNumChildren();
+    unsigned int numTasks = _maximumNumParallelCullTasks>0 ? _maximumNumParallelCullTasks : threadPool->getNumThreads()+1;
+    if (numTasks>numChildren) numTasks = numChildren;
+
+    if (numTasks<2)
+    {
+        traverse(group);
+        return;
+    }
+
+    // bounding volumes are computed lazily, which isn't safe to do from several threads at once,
+    // so make sure that the whole subgraph is up to date before handing it out.
+    group.getBound();
+
+    while(_parallelCullVisitors.size()<numTasks)
+    {
+        osg::ref_ptr<CullVisitor> cv = clone();
+        cv->_parallelCullThreshold = 0;
+        cv->setStateGraph(new StateGraph);
+        cv->setRenderStage(new RenderStage);
+        _parallelCullVisitors.push_back(cv);
+    }
+
+    osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numTasks);
+    blockCount->reset();
+
+    for(unsigned int i=0; i<numTasks; ++i)
+    {
+        CullVisitor* cv = _parallelCullVisitors[i].get();
+        setUpParallelCullVisitor(*cv);
+
+        threadPool->add(new ParallelCullOperation(cv, &group, (i*numChildren)/numTasks, ((i+1)*numChildren)/numTasks, blockCount.get()));
+    }
+
+    threadPool->runOperationsUntilCompleted(blockCount.get());
+
+    // merge in child order so that the StateGraph and RenderBin contents are the same as a serial traversal would create.
+    for(unsigned int i=0; i<numTasks; ++i)
+    {
+        mergeParallelCullVisitor(*_parallelCullVisitors[i]);
+    }
+}
+
+void CullVisitor::setUpParallelCullVisitor(CullVisitor& cv)
+{
+    // NodeVisitor state
+    cv._traversalMode = _traversalMode;
+    cv._traversalMask = _traversalMask;
+    cv._nodeMaskOverride = _nodeMaskOverride;
+    cv._frameStamp = _frameStamp;
+    cv._nodePath = _nodePath;
+    cv._databaseRequestHandler = _databaseRequestHandler;
+    cv._imageRequestHandler = _imageRequestHandler;
+    cv.setTraversalNumber(getTraversalNumber());
+
+    // CullStack state, copied wholesale so the clone carries on exactly where we are.
+    cv.setCullSettings(*this);
+    cv._occluderList = _occluderList;
+    cv._projectionStack = _projectionStack;
+    cv._modelviewStack = _modelviewStack;
+    cv._MVPW_Stack = _MVPW_Stack;
+    cv._viewportStack = _viewportStack;
+    cv._referenceViewPoints = _referenceViewPoints;
+    cv._eyePointStack = _eyePointStack;
+    cv._viewPointStack = _viewPointStack;
+    cv._clipspaceCullingStack = _clipspaceCullingStack;
+    cv._projectionCullingStack = _projectionCullingStack;
+    cv._modelviewCullingStack = _modelviewCullingStack;
+    cv._index_modelviewCullingStack = _index_modelviewCullingStack;
+    cv._back_modelviewCullingStack = (_index_modelviewCullingStack>0) ? &cv._modelviewCullingStack[_index_modelviewCullingStack-1] : 0;
+    cv._frustumVolume = _frustumVolume;
+    cv._bbCornerNear = _bbCornerNear;
+    cv._bbCornerFar = _bbCornerFar;
+
+    // CullVisitor state
+    cv._renderInfo = _renderInfo;
+    cv._identifier = _identifier;
+    cv._traversalNumber = 0;
+    cv._computed_znear = FLT_MAX;
+    cv._computed_zfar = -FLT_MAX;
+    cv._nearPlaneCandidateMap.clear();
+    cv._farPlaneCandidateMap.clear();
+    cv._renderBinStack.clear();
+    cv._numberOfEncloseOverrideRenderBinDetails = _numberOfEncloseOverrideRenderBinDetails;
+
+    // mirror the path of StateSet from the root of the StateGraph to the current StateGraph.
+    std::vector<const osg::StateSet*> stateSetPath;
+    StateGraph* sg = _currentStateGraph;
+    for(; sg->_parent; sg = sg->_parent)
+    {
+        stateSetPath.push_back(sg->getStateSet());
+    }
+
+    cv._rootStateGraph->setStateSet(sg->getStateSet());
+    cv._currentStateGraph = cv._rootStateGraph.get();
+    for(std::vector<const osg::StateSet*>::reverse_iterator itr = stateSetPath.rbegin();
+        itr != stateSetPath.rend();
+        ++itr)
+    {
+        cv._currentStateGraph = cv._currentStateGraph->find_or_insert(*itr);
+    }
+
+    // mirror the path of RenderBin from the current RenderStage to the current RenderBin.
+    RenderStage* stage = cv._rootRenderStage.get();
+    stage->reset();
+    stage->setCamera(getCurrentRenderStage()->getCamera());
+
+    std::vector<RenderBin*> binPath;
+    for(RenderBin* rb = _currentRenderBin; rb && rb!=rb->getStage(); rb = rb->getParent())
+    {
+        binPath.push_back(rb);
+    }
+
+    cv._currentRenderBin = stage;
+    for(std::vector<RenderBin*>::reverse_iterator itr = binPath.rbegin();
+        itr != binPath.rend();
+        ++itr)
+    {
+        cv._currentRenderBin = cv._currentRenderBin->find_or_insert((*itr)->getBinNum(), (*itr)->getName());
+    }
+}
+
+void CullVisitor::mergeParallelCullVisitor(CullVisitor& cv)
+{
+    StateGraph* rootStateGraph = _currentStateGraph;
+    while(rootStateGraph->_parent) rootStateGraph = rootStateGraph->_parent;
+
+    mergeParallelCullRenderBin(cv._rootRenderStage.get(), getCurrentRenderStage(), rootStateGraph, _traversalNumber);
+    _traversalNumber += cv._traversalNumber;
+
+    getCurrentRenderStage()->mergePositionalStateAndRenderStages(cv._rootRenderStage.get());
+
+    if (cv._computed_znear<_computed_znear) _computed_znear = cv._computed_znear;
+    if (cv._computed_zfar>_computed_zfar) _computed_zfar = cv._computed_zfar;
+
+    _nearPlaneCandidateMap.insert(cv._nearPlaneCandidateMap.begin(), cv._nearPlaneCandidateMap.end());
+    _farPlaneCandidateMap.insert(cv._farPlaneCandidateMap.begin(), cv._farPlaneCandidateMap.end());
+    cv._nearPlaneCandidateMap.clear();
+    cv._farPlaneCandidateMap.clear();
+
+    // drop the clone's references to our matrices and its now empty StateGraph and RenderBin,
+    // its RenderLeaf are kept until reset() as they are now owned by our StateGraph.
+    cv.CullStack::reset();
+    cv._rootStateGraph->prune();
+    cv._rootRenderStage->reset();
+}
+
+void CullVisitor::mergeParallelCullRenderBin(RenderBin* source, RenderBin* target, StateGraph* rootStateGraph, unsigned int traversalNumberOffset)
+{
+    std::vector<const osg::StateSet*> stateSetPath;
+
+    RenderBin::StateGraphList& stateGraphList = source->getStateGraphList();
+    for(RenderBin::StateGraphList::iterator sg_itr = stateGraphList.begin();
+        sg_itr != stateGraphList.end();
+        ++sg_itr)
+    {
+        StateGraph* source_sg = *sg_itr;
+
+        stateSetPath.clear();
+        for(StateGraph* sg = source_sg; sg->_parent; sg = sg->_parent)
+        {
+            stateSetPath.push_back(sg->getStateSet());
+        }
+
+        StateGraph* target_sg = rootStateGraph;
+        for(std::vector<const osg::StateSet*>::reverse_iterator itr = stateSetPath.rbegin();
+            itr != stateSetPath.rend();
+            ++itr)
+        {
+            target_sg = target_sg->find_or_insert(*itr);
+        }
+
+        // as in addDrawable(), only add the StateGraph to the bin when it receives its first leaf.
+        if (target_sg->leaves_empty()) target->addStateGraph(target_sg);
+
+        for(StateGraph::LeafList::iterator leaf_itr = source_sg->_leaves.begin();
+            leaf_itr != source_sg->_leaves.end();
+            ++leaf_itr)
+        {
+            (*leaf_itr)->_traversalNumber += traversalNumberOffset;
+            target_sg->addLeaf(leaf_itr->get());
+        }
+
+        source_sg->_leaves.clear();
+    }
+
+    RenderBin::RenderBinList& binList = source->getRenderBinList();
+    for(RenderBin::RenderBinList::iterator bin_itr = binList.begin();
+        bin_itr != binList.end();
+        ++bin_itr)
+    {
+        RenderBin* target_bin = target->find_or_insert(bin_itr->first, bin_itr->second->getName());
+        if (target_bin) mergeParallelCullRenderBin(bin_itr->second.get(), target_bin, rootStateGraph, traversalNumberOffset);
+    }
+}
+
 void CullVisitor::apply(Transform& node)
 {
     if (isCulled(node)) return;
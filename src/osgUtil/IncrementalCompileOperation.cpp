@@ -706,6 +706,9 @@ void IncrementalCompileOperation::operator () (osg::GraphicsContext* context)
         std::copy(_toCompile.begin(),_toCompile.end(),std::back_inserter<CompileSets>(toCompileCopy));
     }
 
+    osg::Timer_t startCompileTick = osg::Timer::instance()->tick();
+    bool compiling = !toCompileCopy.empty();
+
     if (!toCompileCopy.empty())
     {
         compileSets(toCompileCopy, compileInfo);
@@ -725,6 +728,14 @@ void IncrementalCompileOperation::operator () (osg::GraphicsContext* context)
         }
     }
 
+    osg::ref_ptr<osg::Stats> stats = _stats;
+    if (compiling && stats.valid() && stats->collectStats("compile"))
+    {
+        static const osg::Stats::AttributeKey s_compileKey = osg::Stats::getAttributeKey("Incremental compile");
+        osg::Timer* timer = osg::Timer::instance();
+        stats->addEvent(s_compileKey, timer->delta_s(timer->getStartTick(), startCompileTick), timer->time_s());
+    }
+
     //glFush();
     //glFinish();
 }
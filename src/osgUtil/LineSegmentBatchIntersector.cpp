@@ -0,0 +1,692 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include <osgUtil/LineSegmentBatchIntersector>
+#include <osgUtil/LineSegmentIntersector>
+
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/TriangleFunctor>
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSGUTIL_BATCH_INTERSECTOR_SSE
+#endif
+
+using namespace osgUtil;
+
+namespace LineSegmentBatchIntersectorUtils
+{
+
+const unsigned int NO_INTERSECTION = 0xffffffff;
+
+const unsigned int PACKET_SIZE = 4;
+
+/** Up to four segments in structure of arrays form, as parametric lines start + t*(end-start) with t in the range 0 to tmax.*/
+struct SegmentPacket
+{
+    float           ox[PACKET_SIZE], oy[PACKET_SIZE], oz[PACKET_SIZE];
+    float           dx[PACKET_SIZE], dy[PACKET_SIZE], dz[PACKET_SIZE];
+    float           idx[PACKET_SIZE], idy[PACKET_SIZE], idz[PACKET_SIZE];
+    float           tmax[PACKET_SIZE];
+    unsigned int    localIndex[PACKET_SIZE];
+    unsigned int    mask;
+};
+
+typedef std::vector<SegmentPacket> SegmentPackets;
+
+inline float inverse(float d)
+{
+    // avoid infinities so that the slab tests don't produce NaN's for segments lying in a slab plane.
+    const float minimum = 1e-30f;
+    if (d>=0.0f && d<minimum) d = minimum;
+    else if (d<0.0f && d>-minimum) d = -minimum;
+    return 1.0f/d;
+}
+
+void buildPackets(const LineSegmentBatchIntersector& intersector, const std::vector<unsigned int>& candidates, SegmentPackets& packets)
+{
+    const LineSegmentBatchIntersector::LineSegments& segments = intersector.getLocalSegments();
+
+    packets.resize((candidates.size()+PACKET_SIZE-1)/PACKET_SIZE);
+    for(unsigned int p=0; p<packets.size(); ++p)
+    {
+        SegmentPacket& packet = packets[p];
+        packet.mask = 0;
+        for(unsigned int lane=0; lane<PACKET_SIZE; ++lane)
+        {
+            unsigned int i = p*PACKET_SIZE+lane;
+            if (i<candidates.size())
+            {
+                const LineSegmentBatchIntersector::LineSegment& segment = segments[candidates[i]];
+                osg::Vec3d d = segment.end-segment.start;
+                packet.ox[lane] = segment.start.x(); packet.oy[lane] = segment.start.y(); packet.oz[lane] = segment.start.z();
+                packet.dx[lane] = d.x(); packet.dy[lane] = d.y(); packet.dz[lane] = d.z();
+                packet.idx[lane] = inverse(d.x()); packet.idy[lane] = inverse(d.y()); packet.idz[lane] = inverse(d.z());
+                packet.tmax[lane] = 1.0f;
+                packet.localIndex[lane] = candidates[i];
+                packet.mask |= (1<<lane);
+            }
+            else
+            {
+                // pad the packet by repeating the first segment, the padding lanes are masked out.
+                packet.ox[lane] = packet.ox[0]; packet.oy[lane] = packet.oy[0]; packet.oz[lane] = packet.oz[0];
+                packet.dx[lane] = packet.dx[0]; packet.dy[lane] = packet.dy[0]; packet.dz[lane] = packet.dz[0];
+                packet.idx[lane] = packet.idx[0]; packet.idy[lane] = packet.idy[0]; packet.idz[lane] = packet.idz[0];
+                packet.tmax[lane] = -1.0f;
+                packet.localIndex[lane] = packet.localIndex[0];
+            }
+        }
+    }
+}
+
+#if defined(OSGUTIL_BATCH_INTERSECTOR_SSE)
+
+inline unsigned int intersectsBox(const SegmentPacket& packet, const osg::BoundingBox& bb)
+{
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bb.xMin()), _mm_loadu_ps(packet.ox)), _mm_loadu_ps(packet.idx));
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bb.xMax()), _mm_loadu_ps(packet.ox)), _mm_loadu_ps(packet.idx));
+    __m128 tnear = _mm_min_ps(t1, t2);
+    __m128 tfar = _mm_max_ps(t1, t2);
+
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bb.yMin()), _mm_loadu_ps(packet.oy)), _mm_loadu_ps(packet.idy));
+    t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bb.yMax()), _mm_loadu_ps(packet.oy)), _mm_loadu_ps(packet.idy));
+    tnear = _mm_max_ps(tnear, _mm_min_ps(t1, t2));
+    tfar = _mm_min_ps(tfar, _mm_max_ps(t1, t2));
+
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bb.zMin()), _mm_loadu_ps(packet.oz)), _mm_loadu_ps(packet.idz));
+    t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bb.zMax()), _mm_loadu_ps(packet.oz)), _mm_loadu_ps(packet.idz));
+    tnear = _mm_max_ps(tnear, _mm_min_ps(t1, t2));
+    tfar = _mm_min_ps(tfar, _mm_max_ps(t1, t2));
+
+    tnear = _mm_max_ps(tnear, _mm_setzero_ps());
+    tfar = _mm_min_ps(tfar, _mm_loadu_ps(packet.tmax));
+
+    return static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tnear, tfar))) & packet.mask;
+}
+
+inline unsigned int intersectsTriangle(const SegmentPacket& packet, const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, float* t, float* u, float* v)
+{
+    osg::Vec3 E1 = v1-v0;
+    osg::Vec3 E2 = v2-v0;
+
+    __m128 dx = _mm_loadu_ps(packet.dx), dy = _mm_loadu_ps(packet.dy), dz = _mm_loadu_ps(packet.dz);
+    __m128 e1x = _mm_set1_ps(E1.x()), e1y = _mm_set1_ps(E1.y()), e1z = _mm_set1_ps(E1.z());
+    __m128 e2x = _mm_set1_ps(E2.x()), e2y = _mm_set1_ps(E2.y()), e2z = _mm_set1_ps(E2.z());
+
+    // P = d ^ E2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, e1x), _mm_mul_ps(py, e1y)), _mm_mul_ps(pz, e1z));
+
+    // T = o - v0
+    __m128 tx = _mm_sub_ps(_mm_loadu_ps(packet.ox), _mm_set1_ps(v0.x()));
+    __m128 ty = _mm_sub_ps(_mm_loadu_ps(packet.oy), _mm_set1_ps(v0.y()));
+    __m128 tz = _mm_sub_ps(_mm_loadu_ps(packet.oz), _mm_set1_ps(v0.z()));
+
+    // Q = T ^ E1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+    __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+    __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, tx), _mm_mul_ps(py, ty)), _mm_mul_ps(pz, tz)), inv_det);
+    __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, dx), _mm_mul_ps(qy, dy)), _mm_mul_ps(qz, dz)), inv_det);
+    __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, e2x), _mm_mul_ps(qy, e2y)), _mm_mul_ps(qz, e2z)), inv_det);
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 abs_det = _mm_max_ps(det, _mm_sub_ps(zero, det));
+    __m128 hit = _mm_cmpgt_ps(abs_det, _mm_set1_ps(1e-20f));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(uu, zero));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(vv, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(uu, vv), _mm_set1_ps(1.0f)));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(tt, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(tt, _mm_loadu_ps(packet.tmax)));
+
+    unsigned int hitMask = static_cast<unsigned int>(_mm_movemask_ps(hit)) & packet.mask;
+    if (hitMask)
+    {
+        _mm_storeu_ps(t, tt);
+        _mm_storeu_ps(u, uu);
+        _mm_storeu_ps(v, vv);
+    }
+    return hitMask;
+}
+
+#else
+
+inline unsigned int intersectsBox(const SegmentPacket& packet, const osg::BoundingBox& bb)
+{
+    unsigned int hitMask = 0;
+    for(unsigned int lane=0; lane<PACKET_SIZE; ++lane)
+    {
+        if (!(packet.mask & (1<<lane))) continue;
+
+        float t1 = (bb.xMin()-packet.ox[lane])*packet.idx[lane], t2 = (bb.xMax()-packet.ox[lane])*packet.idx[lane];
+        float tnear = osg::minimum(t1, t2), tfar = osg::maximum(t1, t2);
+
+        t1 = (bb.yMin()-packet.oy[lane])*packet.idy[lane]; t2 = (bb.yMax()-packet.oy[lane])*packet.idy[lane];
+        tnear = osg::maximum(tnear, osg::minimum(t1, t2)); tfar = osg::minimum(tfar, osg::maximum(t1, t2));
+
+        t1 = (bb.zMin()-packet.oz[lane])*packet.idz[lane]; t2 = (bb.zMax()-packet.oz[lane])*packet.idz[lane];
+        tnear = osg::maximum(tnear, osg::minimum(t1, t2)); tfar = osg::minimum(tfar, osg::maximum(t1, t2));
+
+        if (osg::maximum(tnear, 0.0f)<=osg::minimum(tfar, packet.tmax[lane])) hitMask |= (1<<lane);
+    }
+    return hitMask;
+}
+
+inline unsigned int intersectsTriangle(const SegmentPacket& packet, const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, float* t, float* u, float* v)
+{
+    osg::Vec3 E1 = v1-v0;
+    osg::Vec3 E2 = v2-v0;
+
+    unsigned int hitMask = 0;
+    for(unsigned int lane=0; lane<PACKET_SIZE; ++lane)
+    {
+        if (!(packet.mask & (1<<lane))) continue;
+
+        osg::Vec3 d(packet.dx[lane], packet.dy[lane], packet.dz[lane]);
+        osg::Vec3 P = d ^ E2;
+        float det = P * E1;
+        if (det<=1e-20f && det>=-1e-20f) continue;
+
+        float inv_det = 1.0f/det;
+        osg::Vec3 T(packet.ox[lane]-v0.x(), packet.oy[lane]-v0.y(), packet.oz[lane]-v0.z());
+        float uu = (P*T)*inv_det;
+        if (uu<0.0f) continue;
+
+        osg::Vec3 Q = T ^ E1;
+        float vv = (Q*d)*inv_det;
+        if (vv<0.0f || (uu+vv)>1.0f) continue;
+
+        float tt = (Q*E2)*inv_det;
+        if (tt<0.0f || tt>packet.tmax[lane]) continue;
+
+        t[lane] = tt;
+        u[lane] = uu;
+        v[lane] = vv;
+        hitMask |= (1<<lane);
+    }
+    return hitMask;
+}
+
+#endif
+
+/** Record the hits of a packet against a triangle, narrowing the lanes' tmax as the intersection limit allows.*/
+inline void addHits(LineSegmentBatchIntersector& intersector, osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable, SegmentPacket& packet,
+                    unsigned int hitMask, const float* t, const float* u, const float* v,
+                    const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2,
+                    unsigned int i0, unsigned int i1, unsigned int i2, unsigned int primitiveIndex)
+{
+    const LineSegmentBatchIntersector::LineSegments& segments = intersector.getLocalSegments();
+
+    osg::Vec3 normal = (v1-v0)^(v2-v0);
+    normal.normalize();
+
+    for(unsigned int lane=0; lane<PACKET_SIZE; ++lane)
+    {
+        if (!(hitMask & (1<<lane))) continue;
+
+        const LineSegmentBatchIntersector::LineSegment& segment = segments[packet.localIndex[lane]];
+
+        LineSegmentBatchIntersector::Intersection hit;
+        hit.ratio = t[lane];
+        hit.localIntersectionPoint = segment.start + (segment.end-segment.start)*hit.ratio;
+        hit.localIntersectionNormal = normal;
+        hit.indices[0] = i0;
+        hit.indices[1] = i1;
+        hit.indices[2] = i2;
+        hit.ratios[0] = 1.0f-u[lane]-v[lane];
+        hit.ratios[1] = u[lane];
+        hit.ratios[2] = v[lane];
+        hit.primitiveIndex = primitiveIndex;
+
+        double maximumRatio = intersector.addIntersection(iv, drawable, packet.localIndex[lane], hit);
+        if (maximumRatio<static_cast<double>(packet.tmax[lane])) packet.tmax[lane] = static_cast<float>(maximumRatio);
+        if (maximumRatio<0.0) packet.mask &= ~(1<<lane);
+    }
+}
+
+struct KdTreePacketIntersector
+{
+    KdTreePacketIntersector(LineSegmentBatchIntersector& intersector, osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable, const osg::KdTree& kdTree):
+        _intersector(intersector),
+        _iv(iv),
+        _drawable(drawable),
+        _vertices(*kdTree.getVertices()),
+        _nodes(kdTree.getNodes()),
+        _triangles(kdTree.getTriangles()) {}
+
+    void intersect(const osg::KdTree::KdNode& node, SegmentPacket& packet)
+    {
+        if (!packet.mask || !intersectsBox(packet, node.bb)) return;
+
+        if (node.first<0)
+        {
+            int istart = -node.first-1;
+            int iend = istart + node.second;
+
+            float t[PACKET_SIZE], u[PACKET_SIZE], v[PACKET_SIZE];
+            for(int i=istart; i<iend; ++i)
+            {
+                const osg::KdTree::Triangle& tri = _triangles[i];
+                const osg::Vec3& v0 = _vertices[tri.p0];
+                const osg::Vec3& v1 = _vertices[tri.p1];
+                const osg::Vec3& v2 = _vertices[tri.p2];
+
+                unsigned int hitMask = intersectsTriangle(packet, v0, v1, v2, t, u, v);
+                if (hitMask) addHits(_intersector, _iv, _drawable, packet, hitMask, t, u, v, v0, v1, v2, tri.p0, tri.p1, tri.p2, i);
+            }
+        }
+        else
+        {
+            if (node.first>0) intersect(_nodes[node.first], packet);
+            if (node.second>0) intersect(_nodes[node.second], packet);
+        }
+    }
+
+    LineSegmentBatchIntersector&        _intersector;
+    osgUtil::IntersectionVisitor&       _iv;
+    osg::Drawable*                      _drawable;
+    const osg::Vec3Array&               _vertices;
+    const osg::KdTree::KdNodeList&      _nodes;
+    const osg::KdTree::TriangleList&    _triangles;
+
+protected:
+
+    KdTreePacketIntersector& operator = (const KdTreePacketIntersector&) { return *this; }
+};
+
+/** TriangleFunctor operator testing each triangle against all the packets, used for drawables without a KdTree.*/
+struct TrianglePacketIntersector
+{
+    TrianglePacketIntersector():
+        _intersector(0),
+        _iv(0),
+        _drawable(0),
+        _packets(0),
+        _firstVertex(0),
+        _numVertices(0),
+        _index(0) {}
+
+    inline void operator () (const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, bool treatVertexDataAsTemporary)
+    {
+        ++_index;
+
+        if (v0==v1 || v1==v2 || v0==v2) return;
+
+        // vertex indices are only available when the triangle's vertices refer directly to the geometry's vertex array.
+        unsigned int i0 = 0, i1 = 0, i2 = 0;
+        if (!treatVertexDataAsTemporary && _firstVertex)
+        {
+            i0 = static_cast<unsigned int>(&v0-_firstVertex);
+            i1 = static_cast<unsigned int>(&v1-_firstVertex);
+            i2 = static_cast<unsigned int>(&v2-_firstVertex);
+            if (i0>=_numVertices || i1>=_numVertices || i2>=_numVertices) i0 = i1 = i2 = 0;
+        }
+
+        float t[PACKET_SIZE], u[PACKET_SIZE], v[PACKET_SIZE];
+        for(SegmentPackets::iterator itr = _packets->begin();
+            itr != _packets->end();
+            ++itr)
+        {
+            SegmentPacket& packet = *itr;
+            if (!packet.mask) continue;
+
+            unsigned int hitMask = intersectsTriangle(packet, v0, v1, v2, t, u, v);
+            if (hitMask) addHits(*_intersector, *_iv, _drawable, packet, hitMask, t, u, v, v0, v1, v2, i0, i1, i2, _index-1);
+        }
+    }
+
+    LineSegmentBatchIntersector*    _intersector;
+    osgUtil::IntersectionVisitor*   _iv;
+    osg::Drawable*                  _drawable;
+    SegmentPackets*                 _packets;
+    const osg::Vec3*                _firstVertex;
+    unsigned int                    _numVertices;
+    unsigned int                    _index;
+};
+
+inline bool intersects(const osg::BoundingSphere& bs, const osg::BoundingBox& bb)
+{
+    double d2 = 0.0;
+    for(int a=0; a<3; ++a)
+    {
+        double c = bs._center[a];
+        if (c<bb._min[a]) d2 += (bb._min[a]-c)*(bb._min[a]-c);
+        else if (c>bb._max[a]) d2 += (c-bb._max[a])*(c-bb._max[a]);
+    }
+    return d2 <= static_cast<double>(bs._radius)*static_cast<double>(bs._radius);
+}
+
+}
+
+using namespace LineSegmentBatchIntersectorUtils;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  LineSegmentBatchIntersector
+//
+
+LineSegmentBatchIntersector::LineSegmentBatchIntersector(CoordinateFrame cf, IntersectionLimit intersectionLimit):
+    Intersector(cf, intersectionLimit),
+    _parent(0),
+    _activeDepth(0),
+    _enteredIntersector(0),
+    _drawableIntersectionsStart(NO_INTERSECTION)
+{
+}
+
+Intersector* LineSegmentBatchIntersector::clone(osgUtil::IntersectionVisitor& iv)
+{
+    osg::ref_ptr<LineSegmentBatchIntersector> lsbi = new LineSegmentBatchIntersector(MODEL, _intersectionLimit);
+    lsbi->_parent = this;
+    lsbi->setPrecisionHint(getPrecisionHint());
+
+    if (_coordinateFrame==MODEL && iv.getModelMatrix()==0)
+    {
+        lsbi->initActiveSegments(_enteredIntersector, 0);
+    }
+    else
+    {
+        // compute the matrix that takes this Intersector from its CoordinateFrame into the local MODEL coordinate frame
+        // that geometry in the scene graph will always be in.
+        osg::Matrix matrix(LineSegmentIntersector::getTransformation(iv, _coordinateFrame));
+        lsbi->initActiveSegments(_enteredIntersector, &matrix);
+    }
+
+    return lsbi.release();
+}
+
+void LineSegmentBatchIntersector::initActiveSegments(const LineSegmentBatchIntersector* source, const osg::Matrix* matrix)
+{
+    LineSegmentBatchIntersector* root = getRoot();
+    const LineSegments& lineSegments = root->_lineSegments;
+
+    if (root->_lastIntersections.size()!=lineSegments.size()) root->_lastIntersections.resize(lineSegments.size(), NO_INTERSECTION);
+
+    _activeDepth = 0;
+    if (_activeSegmentsStack.empty()) _activeSegmentsStack.resize(1);
+
+    ActiveSegments& active = _activeSegmentsStack[0];
+    active.indices.clear();
+    active.bound.init();
+
+    _localSegments.clear();
+    _segmentIndices.clear();
+
+    // only the segments still active in the subgraph entered by the source intersector need to be carried forward.
+    unsigned int numSegments = source ? source->_activeSegmentsStack[source->_activeDepth].indices.size() : lineSegments.size();
+    _localSegments.reserve(numSegments);
+    _segmentIndices.reserve(numSegments);
+    active.indices.reserve(numSegments);
+
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        unsigned int segmentIndex = source ? source->_segmentIndices[source->_activeSegmentsStack[source->_activeDepth].indices[i]] : i;
+        if (root->getMaximumRatio(segmentIndex)<0.0) continue;
+
+        LineSegment segment = lineSegments[segmentIndex];
+        if (matrix)
+        {
+            segment.start = segment.start * (*matrix);
+            segment.end = segment.end * (*matrix);
+        }
+
+        active.indices.push_back(_localSegments.size());
+        active.bound.expandBy(segment.start);
+        active.bound.expandBy(segment.end);
+
+        _localSegments.push_back(segment);
+        _segmentIndices.push_back(segmentIndex);
+    }
+}
+
+bool LineSegmentBatchIntersector::enter(const osg::Node& node)
+{
+    LineSegmentBatchIntersector* root = getRoot();
+    root->_enteredIntersector = 0;
+
+    // the root intersector entering the top of a traversal starts with all of the segments.
+    if (!_parent && _activeDepth==0) initActiveSegments(0, 0);
+
+    if (_activeSegmentsStack.size()<_activeDepth+2) _activeSegmentsStack.resize(_activeDepth+2);
+
+    const ActiveSegments& current = _activeSegmentsStack[_activeDepth];
+    if (current.indices.empty()) return false;
+
+    const osg::BoundingSphere& bs = node.getBound();
+    bool testSegments = node.isCullingActive() && bs.valid();
+
+    // reject the subgraph against the combined bound of the segments before testing them individually.
+    if (testSegments && !LineSegmentBatchIntersectorUtils::intersects(bs, current.bound)) return false;
+
+    ActiveSegments& next = _activeSegmentsStack[_activeDepth+1];
+    next.indices.clear();
+    next.bound.init();
+
+    for(Indices::const_iterator itr = current.indices.begin();
+        itr != current.indices.end();
+        ++itr)
+    {
+        double maximumRatio = root->getMaximumRatio(_segmentIndices[*itr]);
+        if (maximumRatio<0.0) continue;
+
+        const LineSegment& segment = _localSegments[*itr];
+        if (testSegments && !intersects(segment, maximumRatio, bs)) continue;
+
+        next.indices.push_back(*itr);
+        next.bound.expandBy(segment.start);
+        next.bound.expandBy(segment.end);
+    }
+
+    if (next.indices.empty()) return false;
+
+    ++_activeDepth;
+    root->_enteredIntersector = this;
+    return true;
+}
+
+void LineSegmentBatchIntersector::leave()
+{
+    if (_activeDepth>0) --_activeDepth;
+    getRoot()->_enteredIntersector = 0;
+}
+
+void LineSegmentBatchIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable)
+{
+    LineSegmentBatchIntersector* root = getRoot();
+
+    if (!_parent && _activeDepth==0) initActiveSegments(0, 0);
+
+    const ActiveSegments& current = _activeSegmentsStack[_activeDepth];
+    const osg::BoundingBox& bb = drawable->getBoundingBox();
+    if (current.indices.empty() || !bb.valid() || !bb.intersects(current.bound)) return;
+
+    _candidates.clear();
+    for(Indices::const_iterator itr = current.indices.begin();
+        itr != current.indices.end();
+        ++itr)
+    {
+        double maximumRatio = root->getMaximumRatio(_segmentIndices[*itr]);
+        if (maximumRatio>=0.0 && intersects(_localSegments[*itr], maximumRatio, bb)) _candidates.push_back(*itr);
+    }
+
+    if (_candidates.empty()) return;
+
+    if (iv.getDoDummyTraversal()) return;
+
+    root->_drawableIntersectionsStart = root->_intersections.size();
+
+    SegmentPackets packets;
+    buildPackets(*this, _candidates, packets);
+
+    osg::KdTree* kdTree = iv.getUseKdTreeWhenAvailable() ? dynamic_cast<osg::KdTree*>(drawable->getShape()) : 0;
+    if (kdTree && kdTree->getVertices() && !kdTree->getNodes().empty())
+    {
+        KdTreePacketIntersector kdTreeIntersector(*this, iv, drawable, *kdTree);
+        for(SegmentPackets::iterator itr = packets.begin();
+            itr != packets.end();
+            ++itr)
+        {
+            kdTreeIntersector.intersect(kdTree->getNode(0), *itr);
+        }
+    }
+    else
+    {
+        osg::TriangleFunctor<TrianglePacketIntersector> ti;
+        ti._intersector = this;
+        ti._iv = &iv;
+        ti._drawable = drawable;
+        ti._packets = &packets;
+
+        osg::Geometry* geometry = drawable->asGeometry();
+        osg::Vec3Array* vertices = geometry ? dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray()) : 0;
+        if (vertices && !vertices->empty())
+        {
+            ti._firstVertex = &(vertices->front());
+            ti._numVertices = vertices->size();
+        }
+
+        drawable->accept(ti);
+    }
+
+    root->_drawableIntersectionsStart = NO_INTERSECTION;
+}
+
+void LineSegmentBatchIntersector::reset()
+{
+    Intersector::reset();
+
+    _intersections.clear();
+    _lastIntersections.clear();
+    _matrices.clear();
+    _activeDepth = 0;
+    _enteredIntersector = 0;
+    _drawableIntersectionsStart = NO_INTERSECTION;
+}
+
+void LineSegmentBatchIntersector::sortIntersections()
+{
+    LineSegmentBatchIntersector* root = getRoot();
+    std::sort(root->_intersections.begin(), root->_intersections.end());
+
+    // the intersection limits refer to the intersections by index so need to follow the new order.
+    std::fill(root->_lastIntersections.begin(), root->_lastIntersections.end(), NO_INTERSECTION);
+    for(unsigned int i=0; i<root->_intersections.size(); ++i)
+    {
+        unsigned int segmentIndex = root->_intersections[i].segmentIndex;
+        if (segmentIndex<root->_lastIntersections.size()) root->_lastIntersections[segmentIndex] = i;
+    }
+}
+
+double LineSegmentBatchIntersector::getMaximumRatio(unsigned int segmentIndex) const
+{
+    const LineSegmentBatchIntersector* root = _parent ? _parent : this;
+
+    unsigned int last = segmentIndex<root->_lastIntersections.size() ? root->_lastIntersections[segmentIndex] : NO_INTERSECTION;
+    if (last==NO_INTERSECTION) return 1.0;
+
+    switch(_intersectionLimit)
+    {
+        case LIMIT_ONE: return -1.0;
+        case LIMIT_NEAREST: return root->_intersections[last].ratio;
+        case LIMIT_ONE_PER_DRAWABLE: return last>=root->_drawableIntersectionsStart && root->_drawableIntersectionsStart!=NO_INTERSECTION ? root->_intersections[last].ratio : 1.0;
+        default: return 1.0;
+    }
+}
+
+double LineSegmentBatchIntersector::addIntersection(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable, unsigned int localIndex, Intersection& hit)
+{
+    LineSegmentBatchIntersector* root = getRoot();
+
+    unsigned int segmentIndex = _segmentIndices[localIndex];
+
+    hit.segmentIndex = segmentIndex;
+    hit.drawable = drawable;
+
+    // the matrices are kept by the root intersector so they outlive the IntersectionVisitor's matrix stack.
+    osg::RefMatrix* matrix = iv.getModelMatrix();
+    if (matrix && (root->_matrices.empty() || root->_matrices.back()!=matrix)) root->_matrices.push_back(matrix);
+    hit.matrix = matrix;
+
+    Intersections& intersections = root->_intersections;
+    unsigned int& last = root->_lastIntersections[segmentIndex];
+
+    bool replace = false;
+    switch(_intersectionLimit)
+    {
+        case LIMIT_ONE: if (last!=NO_INTERSECTION) return -1.0; break;
+        case LIMIT_NEAREST: replace = (last!=NO_INTERSECTION); break;
+        case LIMIT_ONE_PER_DRAWABLE: replace = (last!=NO_INTERSECTION && last>=root->_drawableIntersectionsStart); break;
+        default: break;
+    }
+
+    if (replace)
+    {
+        if (hit.ratio<intersections[last].ratio) intersections[last] = hit;
+    }
+    else
+    {
+        last = intersections.size();
+        intersections.push_back(hit);
+    }
+
+    return getMaximumRatio(segmentIndex);
+}
+
+bool LineSegmentBatchIntersector::intersects(const LineSegment& segment, double maximumRatio, const osg::BoundingSphere& bs) const
+{
+    osg::Vec3d d = segment.end-segment.start;
+    osg::Vec3d sc = osg::Vec3d(bs._center)-segment.start;
+
+    // closest point on the segment to the centre of the sphere.
+    double length2 = d.length2();
+    double t = length2>0.0 ? (sc*d)/length2 : 0.0;
+    if (t<0.0) t = 0.0;
+    else if (t>maximumRatio) t = maximumRatio;
+
+    double radius2 = static_cast<double>(bs._radius)*static_cast<double>(bs._radius);
+    return (d*t-sc).length2() <= radius2;
+}
+
+bool LineSegmentBatchIntersector::intersects(const LineSegment& segment, double maximumRatio, const osg::BoundingBox& bb) const
+{
+    double tnear = 0.0;
+    double tfar = maximumRatio;
+    for(int a=0; a<3; ++a)
+    {
+        double s = segment.start[a];
+        double d = segment.end[a]-s;
+        if (d==0.0)
+        {
+            if (s<bb._min[a] || s>bb._max[a]) return false;
+        }
+        else
+        {
+            double t1 = (bb._min[a]-s)/d;
+            double t2 = (bb._max[a]-s)/d;
+            if (t1>t2) std::swap(t1, t2);
+            if (t1>tnear) tnear = t1;
+            if (t2<tfar) tfar = t2;
+            if (tnear>tfar) return false;
+        }
+    }
+    return true;
+}
@@ -14,12 +14,15 @@
 
 #include <cassert>
 #include <limits>
+#include <float.h>
 
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include <iostream>
 
+#include <osg/BoundingBox>
 #include <osg/Geometry>
 #include <osg/Math>
 #include <osg/PrimitiveSet>
@@ -27,6 +30,9 @@
 #include <osg/TriangleLinePointIndexFunctor>
 
 #include <osgUtil/MeshOptimizers>
+#include <osgUtil/Simplifier>
+
+#include <OpenThreads/ScopedLock>
 
 using namespace osg;
 
@@ -389,12 +395,9 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
 
 void IndexMeshVisitor::makeMesh()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        makeMesh(*(*itr));
-    }
+    ObjectList geometries(_geometryList.begin(), _geometryList.end());
+    GeometryProcessor<IndexMeshVisitor, &IndexMeshVisitor::makeMesh> processor(*this);
+    processObjects(geometries, processor);
 }
 
 namespace
@@ -566,79 +569,33 @@ TriangleScore computeTriScores(Vertex& vert, const VertexList& vertices,
     return std::make_pair(bestTri, bestScore);
 }
 
-typedef std::vector<Triangle> TriangleList;
-
-struct TriangleCounterOperator
+// Gather the non degenerate triangles of the primitive sets as a flat
+// list of vertex indices.
+struct TriangleGatherOperator
 {
-    VertexList* vertices;
-    int triangleCount;
-    TriangleCounterOperator() : vertices(0), triangleCount(0) {}
-
-    void doVertex(unsigned p)
-    {
-        if (vertices->size() <= p)
-            vertices->resize(p + 1);
-        (*vertices)[p].trisUsing++;
-    }
+    IndexList triangleIndices;
 
     void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
     {
         if (p1 == p2 || p2 == p3 || p1 == p3)
             return;
-        doVertex(p1);
-        doVertex(p2);
-        doVertex(p3);
-        triangleCount++;
+        triangleIndices.push_back(p1);
+        triangleIndices.push_back(p2);
+        triangleIndices.push_back(p3);
     }
 };
 
-struct TriangleCounter : public TriangleIndexFunctor<TriangleCounterOperator>
-{
-    TriangleCounter(std::vector<Vertex>* vertices_)
-    {
-        vertices = vertices_;
-    }
-};
+typedef TriangleIndexFunctor<TriangleGatherOperator> TriangleGatherer;
 
-// Initialize the vertex triangle lists and the triangle data structures
-struct TriangleAddOperator
+unsigned int computeNumVertices(const IndexList& triangleIndices)
 {
-    VertexList* vertices;
-    std::vector<unsigned>* vertexTris;
-    TriangleList* triangles;
-    int triIdx;
-    TriangleAddOperator() : vertices(0), vertexTris(0), triangles(0), triIdx(0) {}
-
-    void doVertex(unsigned p)
-    {
-        (*vertexTris)[(*vertices)[p].triList + (*vertices)[p].numActiveTris++] = triIdx;
-    }
-
-    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
-    {
-        if (p1 == p2 || p2 == p3 || p1 == p3)
-            return;
-
-        doVertex(p1);
-        doVertex(p2);
-        doVertex(p3);
-        (*triangles)[triIdx].verts[0] = p1;
-        (*triangles)[triIdx].verts[1] = p2;
-        (*triangles)[triIdx].verts[2] = p3;
-        triIdx++;
-    }
-};
-
-struct TriangleAdder : public TriangleIndexFunctor<TriangleAddOperator>
-{
-    TriangleAdder(VertexList* vertices_, std::vector<unsigned>* vertexTris_,
-                  TriangleList* triangles_)
-    {
-        vertices = vertices_;
-        vertexTris = vertexTris_;
-        triangles = triangles_;
-    }
-};
+    unsigned int numVertices = 0;
+    for (IndexList::const_iterator itr = triangleIndices.begin(), end = triangleIndices.end();
+         itr != end;
+         ++itr)
+        numVertices = osg::maximum(numVertices, *itr + 1);
+    return numVertices;
+}
 
 struct CompareTriangle
 {
@@ -738,21 +695,20 @@ void VertexCacheVisitor::optimizeVertices(Geometry& geom)
     geom.dirtyDisplayList();
 }
 
-// The main optimization loop
-void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
-                                              std::vector<unsigned>& vertDrawList)
+namespace
+{
+// Tom Forsyth's algorithm, ordering the triangles given as a flat list
+// of vertex indices.
+void optimizeVertexCacheForsyth(const IndexList& triangleIndices,
+                                std::vector<unsigned>& vertDrawList)
 {
-    Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
     // lists for all the vertices and triangles
-    VertexList vertices;
-    TriangleList triangles;
-    TriangleCounter triCounter(&vertices);
-    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
-             end = primSets.end();
+    VertexList vertices(computeNumVertices(triangleIndices));
+    TriangleList triangles(triangleIndices.size() / 3);
+    for (IndexList::const_iterator itr = triangleIndices.begin(), end = triangleIndices.end();
          itr != end;
          ++itr)
-        (*itr)->accept(triCounter);
-    triangles.resize(triCounter.triangleCount);
+        vertices[*itr].trisUsing++;
     // Get total of triangles used by all the vertices
     size_t vertTrisSize = 0;
     for (VertexList::iterator itr = vertices.begin(), end = vertices.end();
@@ -764,12 +720,15 @@ void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
     }
     // Store for lists of triangles (indices) used by the vertices
     std::vector<unsigned> vertTriListStore(vertTrisSize);
-    TriangleAdder triAdder(&vertices, &vertTriListStore, &triangles);
-    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
-             end = primSets.end();
-         itr != end;
-         ++itr)
-        (*itr)->accept(triAdder);
+    for (unsigned triIdx = 0; triIdx < triangles.size(); ++triIdx)
+    {
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            unsigned p = triangleIndices[triIdx * 3 + i];
+            vertTriListStore[vertices[p].triList + vertices[p].numActiveTris++] = triIdx;
+            triangles[triIdx].verts[i] = p;
+        }
+    }
     // Set up initial scores for vertices and triangles
     for (VertexList::iterator itr = vertices.begin(), end = vertices.end();
          itr != end;
@@ -863,15 +822,27 @@ void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
         }
      }
 }
+}
+
+// The main optimization loop
+void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
+                                              std::vector<unsigned>& vertDrawList)
+{
+    Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    TriangleGatherer gatherer;
+    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
+             end = primSets.end();
+         itr != end;
+         ++itr)
+        (*itr)->accept(gatherer);
+    optimizeVertexCacheForsyth(gatherer.triangleIndices, vertDrawList);
+}
 
 void VertexCacheVisitor::optimizeVertices()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        optimizeVertices(*(*itr));
-    }
+    ObjectList geometries(_geometryList.begin(), _geometryList.end());
+    GeometryProcessor<VertexCacheVisitor, &VertexCacheVisitor::optimizeVertices> processor(*this);
+    processObjects(geometries, processor);
 }
 
 VertexCacheMissVisitor::VertexCacheMissVisitor(unsigned cacheSize)
@@ -1095,12 +1066,9 @@ struct VertexReorder : public TriangleLinePointIndexFunctor<osgUtil::VertexReord
 
 void VertexAccessOrderVisitor::optimizeOrder()
 {
-    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
-         itr != end;
-         ++itr)
-    {
-        optimizeOrder(*(*itr));
-    }
+    ObjectList geometries(_geometryList.begin(), _geometryList.end());
+    GeometryProcessor<VertexAccessOrderVisitor, &VertexAccessOrderVisitor::optimizeOrder> processor(*this);
+    processObjects(geometries, processor);
 }
 
 template<typename DE>
@@ -1235,4 +1203,1083 @@ void SharedArrayOptimizer::deduplicateUVs(osg::Geometry& geometry)
     }
 }
 
+namespace
+{
+// Return true if the geometry only has indexed surface primitives, as
+// required to reorder its triangles.
+bool isIndexedSurfaceMesh(Geometry& geom)
+{
+    Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    if (primSets.empty())
+        return false;
+    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
+             end = primSets.end();
+         itr != end;
+         ++itr)
+    {
+        switch ((*itr)->getMode())
+        {
+        case(PrimitiveSet::TRIANGLES):
+        case(PrimitiveSet::TRIANGLE_STRIP):
+        case(PrimitiveSet::TRIANGLE_FAN):
+        case(PrimitiveSet::QUADS):
+        case(PrimitiveSet::QUAD_STRIP):
+        case(PrimitiveSet::POLYGON):
+            break;
+        default:
+            return false;
+        }
+        PrimitiveSet::Type type = (*itr)->getType();
+        if (type != PrimitiveSet::DrawElementsUBytePrimitiveType
+            && type != PrimitiveSet::DrawElementsUShortPrimitiveType
+            && type != PrimitiveSet::DrawElementsUIntPrimitiveType)
+            return false;
+    }
+    return true;
+}
+
+// Compressed sparse row adjacency from each vertex to the triangles
+// that use it, the triangles of vertex v are
+// triangles[offsets[v]] to triangles[offsets[v+1]-1].
+struct VertexTriangleAdjacency
+{
+    VertexTriangleAdjacency(const IndexList& triangleIndices, unsigned int numVertices)
+        : offsets(numVertices + 1, 0), triangles(triangleIndices.size())
+    {
+        for (IndexList::const_iterator itr = triangleIndices.begin(), end = triangleIndices.end();
+             itr != end;
+             ++itr)
+            ++offsets[*itr + 1];
+        for (unsigned int v = 0; v < numVertices; ++v)
+            offsets[v + 1] += offsets[v];
+        IndexList fill(offsets.begin(), offsets.end() - 1);
+        for (unsigned int i = 0; i < triangleIndices.size(); ++i)
+            triangles[fill[triangleIndices[i]]++] = i / 3;
+    }
+
+    unsigned int valence(unsigned int v) const { return offsets[v + 1] - offsets[v]; }
+
+    IndexList offsets;
+    IndexList triangles;
+};
+
+// Tipsify, ordering the triangles given as a flat list of vertex
+// indices. The triangles around a fanning vertex are emitted, then the
+// next fanning vertex is chosen from those just emitted, preferring the
+// vertex that will still be in the cache once its remaining triangles
+// have been emitted, or from a stack of recently used vertices when
+// they have no triangles left.
+void optimizeVertexCacheTipsify(const IndexList& triangleIndices, unsigned int cacheSize,
+                                IndexList& vertDrawList)
+{
+    unsigned int numVertices = computeNumVertices(triangleIndices);
+    unsigned int numTriangles = triangleIndices.size() / 3;
+    VertexTriangleAdjacency adjacency(triangleIndices, numVertices);
+
+    // number of triangles not yet emitted that use each vertex
+    IndexList liveTriangles(numVertices);
+    for (unsigned int v = 0; v < numVertices; ++v)
+        liveTriangles[v] = adjacency.valence(v);
+
+    // the time at which each vertex entered the cache
+    IndexList cacheTimeStamps(numVertices, 0);
+    unsigned int timeStamp = cacheSize + 1;
+
+    std::vector<bool> emitted(numTriangles, false);
+    IndexList deadEndStack;
+    IndexList candidates;
+    unsigned int nextCandidate = 0;
+
+    vertDrawList.clear();
+    vertDrawList.reserve(numTriangles * 3);
+
+    const unsigned int invalidVertex = std::numeric_limits<unsigned int>::max();
+    unsigned int fanningVertex = numVertices > 0 ? 0 : invalidVertex;
+    while (fanningVertex != invalidVertex)
+    {
+        candidates.clear();
+        for (unsigned int t = adjacency.offsets[fanningVertex];
+             t < adjacency.offsets[fanningVertex + 1];
+             ++t)
+        {
+            unsigned int tri = adjacency.triangles[t];
+            if (emitted[tri])
+                continue;
+            emitted[tri] = true;
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                unsigned int v = triangleIndices[tri * 3 + i];
+                vertDrawList.push_back(v);
+                deadEndStack.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (timeStamp - cacheTimeStamps[v] > cacheSize)
+                    cacheTimeStamps[v] = timeStamp++;
+            }
+        }
+
+        // choose the next fanning vertex from the vertices just used
+        fanningVertex = invalidVertex;
+        int bestPriority = -1;
+        for (IndexList::iterator itr = candidates.begin(), end = candidates.end();
+             itr != end;
+             ++itr)
+        {
+            unsigned int v = *itr;
+            if (liveTriangles[v] == 0)
+                continue;
+            int priority = 0;
+            if (timeStamp - cacheTimeStamps[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = timeStamp - cacheTimeStamps[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanningVertex = v;
+            }
+        }
+
+        // dead end, so fall back to a recently used vertex, then to the
+        // next vertex in input order with triangles left.
+        while (fanningVertex == invalidVertex && !deadEndStack.empty())
+        {
+            unsigned int v = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[v] > 0)
+                fanningVertex = v;
+        }
+        while (fanningVertex == invalidVertex && nextCandidate < numVertices)
+        {
+            if (liveTriangles[nextCandidate] > 0)
+                fanningVertex = nextCandidate;
+            ++nextCandidate;
+        }
+    }
+}
+
+// Model of a FIFO post-transform cache using time stamps, so a vertex
+// is in the cache if fewer than cacheSize vertices have been added
+// since it was.
+struct TimeStampCache
+{
+    TimeStampCache(unsigned int numVertices, unsigned int cacheSize_)
+        : cacheSize(cacheSize_), timeStamp(cacheSize_ + 1), timeStamps(numVertices, 0)
+    {
+    }
+
+    unsigned int addTriangle(const unsigned int* verts)
+    {
+        unsigned int misses = 0;
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            if (timeStamp - timeStamps[verts[i]] > cacheSize)
+            {
+                timeStamps[verts[i]] = timeStamp++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void clear()
+    {
+        timeStamp += cacheSize + 1;
+    }
+
+    unsigned int cacheSize;
+    unsigned int timeStamp;
+    IndexList timeStamps;
+};
+
+struct OverdrawCluster
+{
+    unsigned int start;
+    unsigned int end;
+    float sortKey;
+
+    bool operator < (const OverdrawCluster& rhs) const
+    {
+        return sortKey > rhs.sortKey;
+    }
+};
+
+// Reorder the clusters of the vertex cache optimized triangles so that
+// those facing away from the centre of the mesh, which tend to occlude
+// the others, are drawn first. The order is first split where all the
+// vertices of a triangle miss the cache, then each part is split
+// further where the miss rate so far is within threshold of the miss
+// rate of the whole part.
+void optimizeOverdraw(IndexList& vertDrawList, const std::vector<Vec3>& positions,
+                      unsigned int cacheSize, float threshold)
+{
+    unsigned int numTriangles = vertDrawList.size() / 3;
+    if (numTriangles < 2)
+        return;
+
+    TimeStampCache cache(positions.size(), cacheSize);
+    IndexList hardBoundaries;
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        if (cache.addTriangle(&vertDrawList[t * 3]) == 3 || t == 0)
+            hardBoundaries.push_back(t);
+    }
+    hardBoundaries.push_back(numTriangles);
+
+    std::vector<OverdrawCluster> clusters;
+    for (unsigned int h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        unsigned int start = hardBoundaries[h];
+        unsigned int end = hardBoundaries[h + 1];
+
+        cache.clear();
+        unsigned int clusterMisses = 0;
+        for (unsigned int t = start; t < end; ++t)
+            clusterMisses += cache.addTriangle(&vertDrawList[t * 3]);
+        float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+        cache.clear();
+        unsigned int runningMisses = 0;
+        unsigned int runningTriangles = 0;
+        OverdrawCluster cluster;
+        cluster.start = start;
+        cluster.sortKey = 0.0f;
+        for (unsigned int t = start; t < end; ++t)
+        {
+            runningMisses += cache.addTriangle(&vertDrawList[t * 3]);
+            ++runningTriangles;
+            if (float(runningMisses) / float(runningTriangles) <= clusterThreshold)
+            {
+                cluster.end = t + 1;
+                clusters.push_back(cluster);
+                cluster.start = t + 1;
+                cache.clear();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+        if (cluster.start < end)
+        {
+            cluster.end = end;
+            clusters.push_back(cluster);
+        }
+    }
+
+    if (clusters.size() < 2)
+        return;
+
+    // area weighted centroids and normals of the mesh and the clusters
+    Vec3 meshCentroid;
+    float meshArea = 0.0f;
+    std::vector<Vec3> clusterCentroids(clusters.size());
+    std::vector<Vec3> clusterNormals(clusters.size());
+    for (unsigned int c = 0; c < clusters.size(); ++c)
+    {
+        Vec3 centroid;
+        Vec3 normal;
+        float area = 0.0f;
+        for (unsigned int t = clusters[c].start; t < clusters[c].end; ++t)
+        {
+            const Vec3& p0 = positions[vertDrawList[t * 3]];
+            const Vec3& p1 = positions[vertDrawList[t * 3 + 1]];
+            const Vec3& p2 = positions[vertDrawList[t * 3 + 2]];
+            Vec3 n = (p1 - p0) ^ (p2 - p0);
+            float a = n.length();
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        clusterCentroids[c] = area > 0.0f ? centroid / area : Vec3();
+        clusterNormals[c] = normal;
+        clusterNormals[c].normalize();
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    for (unsigned int c = 0; c < clusters.size(); ++c)
+        clusters[c].sortKey = (clusterCentroids[c] - meshCentroid) * clusterNormals[c];
+
+    std::stable_sort(clusters.begin(), clusters.end());
+
+    IndexList sorted;
+    sorted.reserve(vertDrawList.size());
+    for (std::vector<OverdrawCluster>::iterator itr = clusters.begin(), end = clusters.end();
+         itr != end;
+         ++itr)
+        sorted.insert(sorted.end(), vertDrawList.begin() + itr->start * 3, vertDrawList.begin() + itr->end * 3);
+    vertDrawList.swap(sorted);
+}
+
+// Copy the positions of a Vec3Array or Vec3dArray vertex array.
+bool getPositions(const Geometry& geom, std::vector<Vec3>& positions)
+{
+    const Vec3Array* vec3Array = dynamic_cast<const Vec3Array*>(geom.getVertexArray());
+    if (vec3Array)
+    {
+        positions.assign(vec3Array->begin(), vec3Array->end());
+        return true;
+    }
+    const Vec3dArray* vec3dArray = dynamic_cast<const Vec3dArray*>(geom.getVertexArray());
+    if (vec3dArray)
+    {
+        positions.resize(vec3dArray->size());
+        for (unsigned int i = 0; i < vec3dArray->size(); ++i)
+            positions[i] = (*vec3dArray)[i];
+        return true;
+    }
+    return false;
+}
+}
+
+MeshOptimizationVisitor::Statistics::Statistics()
+{
+    reset();
+}
+
+void MeshOptimizationVisitor::Statistics::reset()
+{
+    numGeometries = 0;
+    trianglesBefore = 0;
+    verticesBefore = 0;
+    missesBefore = 0;
+    trianglesAfter = 0;
+    verticesAfter = 0;
+    missesAfter = 0;
+}
+
+MeshOptimizationVisitor::MeshOptimizationVisitor(Optimizer* optimizer, unsigned int stages)
+    : GeometryCollector(optimizer, Optimizer::INDEX_MESH),
+      _stages(stages),
+      _vertexCacheAlgorithm(FORSYTH),
+      _cacheSize(16),
+      _overdrawThreshold(1.05f),
+      _collectStatistics(false)
+{
+}
+
+void MeshOptimizationVisitor::optimize(Geometry& geom)
+{
+    VertexCacheMissVisitor missesBefore(_cacheSize);
+    unsigned int verticesBefore = 0;
+    if (_collectStatistics)
+    {
+        missesBefore.doGeometry(geom);
+        verticesBefore = geom.getVertexArray() ? geom.getVertexArray()->getNumElements() : 0;
+    }
+
+    if (_stages & INDEX_MESH_STAGE)
+    {
+        IndexMeshVisitor imv(_optimizer);
+        imv.makeMesh(geom);
+    }
+
+    if (_stages & (VERTEX_CACHE_STAGE | OVERDRAW_STAGE))
+    {
+        optimizeTriangleOrder(geom);
+    }
+
+    if (_stages & VERTEX_FETCH_STAGE)
+    {
+        VertexAccessOrderVisitor vaov(_optimizer);
+        vaov.optimizeOrder(geom);
+    }
+
+    if (_collectStatistics)
+    {
+        VertexCacheMissVisitor missesAfter(_cacheSize);
+        missesAfter.doGeometry(geom);
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+        ++_statistics.numGeometries;
+        _statistics.trianglesBefore += missesBefore.triangles;
+        _statistics.verticesBefore += verticesBefore;
+        _statistics.missesBefore += missesBefore.misses;
+        _statistics.trianglesAfter += missesAfter.triangles;
+        _statistics.verticesAfter += geom.getVertexArray() ? geom.getVertexArray()->getNumElements() : 0;
+        _statistics.missesAfter += missesAfter.misses;
+    }
+}
+
+void MeshOptimizationVisitor::optimizeTriangleOrder(Geometry& geom)
+{
+    Array* vertArray = geom.getVertexArray();
+    if (!vertArray)
+        return;
+    unsigned vertArraySize = vertArray->getNumElements();
+    // If all the vertices fit in the cache, there's no point in
+    // doing this optimization.
+    if (vertArraySize <= 16)
+        return;
+    if (!isIndexedSurfaceMesh(geom))
+        return;
+
+    Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    TriangleGatherer gatherer;
+    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
+             end = primSets.end();
+         itr != end;
+         ++itr)
+        (*itr)->accept(gatherer);
+    if (computeNumVertices(gatherer.triangleIndices) > vertArraySize)
+        return;
+
+    IndexList newVertList;
+    if (_stages & VERTEX_CACHE_STAGE)
+    {
+        if (_vertexCacheAlgorithm == TIPSIFY)
+            optimizeVertexCacheTipsify(gatherer.triangleIndices, _cacheSize, newVertList);
+        else
+            optimizeVertexCacheForsyth(gatherer.triangleIndices, newVertList);
+    }
+    else
+    {
+        newVertList.swap(gatherer.triangleIndices);
+    }
+
+    std::vector<Vec3> positions;
+    if ((_stages & OVERDRAW_STAGE) && getPositions(geom, positions))
+    {
+        optimizeOverdraw(newVertList, positions, _cacheSize, _overdrawThreshold);
+    }
+
+    Geometry::PrimitiveSetList newPrims;
+    if (vertArraySize < 65536)
+    {
+        osg::DrawElementsUShort* elements = new DrawElementsUShort(GL_TRIANGLES);
+        elements->reserve(newVertList.size());
+        for (IndexList::iterator itr = newVertList.begin(),
+                 end = newVertList.end();
+             itr != end;
+             ++itr)
+            elements->push_back((GLushort)*itr);
+        if (geom.getUseVertexBufferObjects())
+        {
+            elements->setElementBufferObject(new ElementBufferObject);
+        }
+        newPrims.push_back(elements);
+    }
+    else
+    {
+        osg::DrawElementsUInt* elements
+            = new DrawElementsUInt(GL_TRIANGLES, newVertList.begin(),
+                                   newVertList.end());
+        if (geom.getUseVertexBufferObjects())
+        {
+            elements->setElementBufferObject(new ElementBufferObject);
+        }
+        newPrims.push_back(elements);
+    }
+
+    geom.setPrimitiveSetList(newPrims);
+    geom.dirtyDisplayList();
+}
+
+void MeshOptimizationVisitor::optimize()
+{
+    ObjectList geometries(_geometryList.begin(), _geometryList.end());
+    GeometryProcessor<MeshOptimizationVisitor, &MeshOptimizationVisitor::optimize> processor(*this);
+    processObjects(geometries, processor);
+}
+
+
+namespace
+{
+// Append the elements of a source array of the same type to the visited
+// array, either all of them or those selected by the indices.
+class ArrayAppender : public osg::ArrayVisitor
+{
+public:
+    ArrayAppender(const Array& source, const IndexList* indices = 0)
+        : _source(source), _indices(indices)
+    {
+    }
+
+    const Array& _source;
+    const IndexList* _indices;
+
+    template<class T>
+    inline void append(T& array)
+    {
+        if (_source.getType() != array.getType())
+            return;
+        const T& source = static_cast<const T&>(_source);
+        if (_indices)
+        {
+            array.reserve(array.size() + _indices->size());
+            for (IndexList::const_iterator itr = _indices->begin(), end = _indices->end();
+                 itr != end;
+                 ++itr)
+                array.push_back(source[*itr]);
+        }
+        else
+        {
+            array.insert(array.end(), source.begin(), source.end());
+        }
+    }
+
+    virtual void apply(osg::Array&) {}
+    virtual void apply(osg::ByteArray& array) { append(array); }
+    virtual void apply(osg::ShortArray& array) { append(array); }
+    virtual void apply(osg::IntArray& array) { append(array); }
+    virtual void apply(osg::UByteArray& array) { append(array); }
+    virtual void apply(osg::UShortArray& array) { append(array); }
+    virtual void apply(osg::UIntArray& array) { append(array); }
+    virtual void apply(osg::FloatArray& array) { append(array); }
+    virtual void apply(osg::DoubleArray& array) { append(array); }
+
+    virtual void apply(osg::Vec2Array& array) { append(array); }
+    virtual void apply(osg::Vec3Array& array) { append(array); }
+    virtual void apply(osg::Vec4Array& array) { append(array); }
+
+    virtual void apply(osg::Vec4ubArray& array) { append(array); }
+
+    virtual void apply(osg::Vec2bArray& array) { append(array); }
+    virtual void apply(osg::Vec3bArray& array) { append(array); }
+    virtual void apply(osg::Vec4bArray& array) { append(array); }
+
+    virtual void apply(osg::Vec2sArray& array) { append(array); }
+    virtual void apply(osg::Vec3sArray& array) { append(array); }
+    virtual void apply(osg::Vec4sArray& array) { append(array); }
+
+    virtual void apply(osg::Vec2dArray& array) { append(array); }
+    virtual void apply(osg::Vec3dArray& array) { append(array); }
+    virtual void apply(osg::Vec4dArray& array) { append(array); }
+
+    virtual void apply(osg::MatrixfArray& array) { append(array); }
+
+protected:
+    ArrayAppender& operator = (const ArrayAppender&) { return *this; }
+};
+
+// The arrays of a geometry are addressed by slot, the vertex, normal,
+// color, secondary color and fog coord arrays followed by the texture
+// coordinate and vertex attribute arrays.
+const unsigned int NUM_FIXED_ARRAY_SLOTS = 5;
+
+unsigned int getNumArraySlots(const Geometry& geom)
+{
+    return NUM_FIXED_ARRAY_SLOTS + geom.getNumTexCoordArrays() + geom.getNumVertexAttribArrays();
+}
+
+Array* getArraySlot(Geometry& geom, unsigned int slot)
+{
+    switch (slot)
+    {
+    case 0: return geom.getVertexArray();
+    case 1: return geom.getNormalArray();
+    case 2: return geom.getColorArray();
+    case 3: return geom.getSecondaryColorArray();
+    case 4: return geom.getFogCoordArray();
+    default: break;
+    }
+    slot -= NUM_FIXED_ARRAY_SLOTS;
+    if (slot < geom.getNumTexCoordArrays())
+        return geom.getTexCoordArray(slot);
+    return geom.getVertexAttribArray(slot - geom.getNumTexCoordArrays());
+}
+
+void setArraySlot(Geometry& geom, unsigned int slot, unsigned int numTexCoordArrays, Array* array)
+{
+    switch (slot)
+    {
+    case 0: geom.setVertexArray(array); return;
+    case 1: geom.setNormalArray(array); return;
+    case 2: geom.setColorArray(array); return;
+    case 3: geom.setSecondaryColorArray(array); return;
+    case 4: geom.setFogCoordArray(array); return;
+    default: break;
+    }
+    slot -= NUM_FIXED_ARRAY_SLOTS;
+    if (slot < numTexCoordArrays)
+        geom.setTexCoordArray(slot, array);
+    else
+        geom.setVertexAttribArray(slot - numTexCoordArrays, array);
+}
+
+// Copy the per vertex elements of the array selected by the indices to
+// a new array of the same type, arrays bound overall are shared.
+Array* createArraySubset(Array* array, const IndexList& indices)
+{
+    if (!array || array->getBinding() == Array::BIND_OVERALL)
+        return array;
+    Array* subset = static_cast<Array*>(array->cloneType());
+    subset->setBinding(array->getBinding());
+    subset->setNormalize(array->getNormalize());
+    ArrayAppender appender(*array, &indices);
+    subset->accept(appender);
+    return subset;
+}
+
+// Record the largest error of the edges collapsed by the Simplifier.
+class SimplificationErrorCallback : public Simplifier::ContinueSimplificationCallback
+{
+public:
+    SimplificationErrorCallback() : _maximumError(0.0f) {}
+
+    virtual bool continueSimplification(const Simplifier& simplifier, float nextError,
+                                        unsigned int numOriginalPrimitives, unsigned int numRemainingPrimitives) const
+    {
+        if (!simplifier.continueSimplificationImplementation(nextError, numOriginalPrimitives, numRemainingPrimitives))
+            return false;
+        // edges that can't be collapsed, such as those on the locked boundary, have an error of FLT_MAX.
+        if (nextError < FLT_MAX)
+            _maximumError = osg::maximum(_maximumError, nextError);
+        return true;
+    }
+
+    mutable float _maximumError;
+};
+
+// Split the triangles, given as a flat list of vertex indices, into
+// meshlets of at most maximumVertices vertices and maximumTriangles
+// triangles. Each meshlet is grown from a seed triangle by adding the
+// adjacent triangle that adds the fewest new vertices, then the one
+// nearest the centroid of the meshlet, and the next seed is taken from
+// the triangles left adjacent to the meshlet so that consecutive
+// meshlets are neighbours.
+void buildMeshlets(const IndexList& triangleIndices, const Vec3Array& positions,
+                   unsigned int maximumVertices, unsigned int maximumTriangles,
+                   std::vector<IndexList>& meshlets)
+{
+    unsigned int numTriangles = triangleIndices.size() / 3;
+    if (numTriangles == 0)
+        return;
+    unsigned int numVertices = computeNumVertices(triangleIndices);
+    VertexTriangleAdjacency adjacency(triangleIndices, numVertices);
+
+    maximumVertices = osg::maximum(maximumVertices, 3u);
+    maximumTriangles = osg::maximum(maximumTriangles, 1u);
+
+    const unsigned int invalid = std::numeric_limits<unsigned int>::max();
+    std::vector<bool> emitted(numTriangles, false);
+    IndexList vertexStamp(numVertices, invalid);
+    IndexList candidateStamp(numTriangles, invalid);
+    IndexList candidates;
+    unsigned int nextSeed = 0;
+
+    for (unsigned int meshletIndex = 0; ; ++meshletIndex)
+    {
+        unsigned int triangle = invalid;
+        for (IndexList::iterator itr = candidates.begin(), end = candidates.end(); itr != end; ++itr)
+        {
+            if (!emitted[*itr])
+            {
+                triangle = *itr;
+                break;
+            }
+        }
+        if (triangle == invalid)
+        {
+            while (nextSeed < numTriangles && emitted[nextSeed])
+                ++nextSeed;
+            if (nextSeed == numTriangles)
+                break;
+            triangle = nextSeed;
+        }
+        candidates.clear();
+
+        IndexList meshlet;
+        unsigned int meshletVertices = 0;
+        Vec3 centroidSum;
+        for (;;)
+        {
+            emitted[triangle] = true;
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                unsigned int v = triangleIndices[triangle * 3 + i];
+                meshlet.push_back(v);
+                if (vertexStamp[v] != meshletIndex)
+                {
+                    vertexStamp[v] = meshletIndex;
+                    ++meshletVertices;
+                    centroidSum += positions[v];
+                }
+                for (unsigned int j = adjacency.offsets[v]; j < adjacency.offsets[v + 1]; ++j)
+                {
+                    unsigned int t = adjacency.triangles[j];
+                    if (!emitted[t] && candidateStamp[t] != meshletIndex)
+                    {
+                        candidateStamp[t] = meshletIndex;
+                        candidates.push_back(t);
+                    }
+                }
+            }
+            if (meshlet.size() / 3 >= maximumTriangles)
+                break;
+
+            Vec3 centroid = centroidSum / float(meshletVertices);
+            unsigned int best = invalid;
+            unsigned int bestNewVertices = 4;
+            float bestDistance = FLT_MAX;
+            for (unsigned int i = 0; i < candidates.size();)
+            {
+                unsigned int t = candidates[i];
+                if (emitted[t])
+                {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                ++i;
+                const unsigned int* tri = &triangleIndices[t * 3];
+                unsigned int newVertices = (vertexStamp[tri[0]] != meshletIndex)
+                    + (vertexStamp[tri[1]] != meshletIndex)
+                    + (vertexStamp[tri[2]] != meshletIndex);
+                if (meshletVertices + newVertices > maximumVertices || newVertices > bestNewVertices)
+                    continue;
+                float distance = ((positions[tri[0]] + positions[tri[1]] + positions[tri[2]]) / 3.0f - centroid).length2();
+                if (newVertices < bestNewVertices || distance < bestDistance)
+                {
+                    best = t;
+                    bestNewVertices = newVertices;
+                    bestDistance = distance;
+                }
+            }
+            if (best == invalid)
+                break;
+            triangle = best;
+        }
+        meshlets.push_back(IndexList());
+        meshlets.back().swap(meshlet);
+    }
+}
+
+// Append a meshlet's triangles to the elements, and compute its
+// bounding sphere and the cone enclosing its triangle normals.
+unsigned int addMeshlet(const IndexList& triangles, const Vec3Array& positions,
+                        unsigned int level, float error, const BoundingSphere& lodBound,
+                        MeshletGeometry::Meshlets& meshlets, IndexList& elements)
+{
+    MeshletGeometry::Meshlet meshlet;
+    meshlet.firstIndex = elements.size();
+    meshlet.numIndices = triangles.size();
+    meshlet.level = level;
+    meshlet.error = error;
+    elements.insert(elements.end(), triangles.begin(), triangles.end());
+
+    IndexList vertices(triangles);
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    meshlet.numVertices = vertices.size();
+
+    BoundingBox bb;
+    for (IndexList::iterator itr = vertices.begin(), end = vertices.end(); itr != end; ++itr)
+        bb.expandBy(positions[*itr]);
+    float radius2 = 0.0f;
+    for (IndexList::iterator itr = vertices.begin(), end = vertices.end(); itr != end; ++itr)
+        radius2 = osg::maximum(radius2, (positions[*itr] - bb.center()).length2());
+    meshlet.bound.set(bb.center(), sqrtf(radius2));
+    meshlet.lodBound = lodBound.valid() ? lodBound : meshlet.bound;
+
+    std::vector<Vec3> normals;
+    Vec3 axis;
+    for (unsigned int i = 0; i + 2 < triangles.size(); i += 3)
+    {
+        const Vec3& p0 = positions[triangles[i]];
+        Vec3 normal = (positions[triangles[i + 1]] - p0) ^ (positions[triangles[i + 2]] - p0);
+        if (normal.normalize() > 0.0f)
+        {
+            normals.push_back(normal);
+            axis += normal;
+        }
+    }
+    if (axis.normalize() > 0.0f)
+    {
+        float minDot = 1.0f;
+        for (std::vector<Vec3>::iterator itr = normals.begin(), end = normals.end(); itr != end; ++itr)
+            minDot = osg::minimum(minDot, *itr * axis);
+        // cones approaching a hemisphere hardly ever cull, so are left disabled.
+        if (minDot > 0.1f)
+        {
+            meshlet.coneAxis = axis;
+            meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+        }
+    }
+
+    meshlets.push_back(meshlet);
+    return meshlets.size() - 1;
+}
+
+// Group the meshlets into groups of up to groupSize meshlets, growing
+// each group from a seed by adding the meshlet that shares the most
+// vertex positions with those already in it, so that the least
+// boundary is locked when the group is simplified.
+void groupMeshlets(const IndexList& meshletIndices, const MeshletGeometry::Meshlets& meshlets,
+                   const IndexList& elements, const Vec3Array& positions, unsigned int groupSize,
+                   std::vector<IndexList>& groups)
+{
+    unsigned int numMeshlets = meshletIndices.size();
+
+    // pairs of position and meshlet, sorted so that the meshlets sharing a position are adjacent.
+    typedef std::pair<Vec3, unsigned int> PositionMeshlet;
+    std::vector<PositionMeshlet> positionMeshlets;
+    for (unsigned int m = 0; m < numMeshlets; ++m)
+    {
+        const MeshletGeometry::Meshlet& meshlet = meshlets[meshletIndices[m]];
+        IndexList vertices(elements.begin() + meshlet.firstIndex,
+                           elements.begin() + meshlet.firstIndex + meshlet.numIndices);
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        for (IndexList::iterator itr = vertices.begin(), end = vertices.end(); itr != end; ++itr)
+            positionMeshlets.push_back(PositionMeshlet(positions[*itr], m));
+    }
+    std::sort(positionMeshlets.begin(), positionMeshlets.end());
+
+    typedef std::map<std::pair<unsigned int, unsigned int>, unsigned int> SharedCounts;
+    SharedCounts sharedCounts;
+    for (unsigned int i = 0; i < positionMeshlets.size();)
+    {
+        unsigned int j = i + 1;
+        while (j < positionMeshlets.size() && positionMeshlets[j].first == positionMeshlets[i].first)
+            ++j;
+        for (unsigned int a = i; a < j; ++a)
+            for (unsigned int b = a + 1; b < j; ++b)
+                if (positionMeshlets[a].second != positionMeshlets[b].second)
+                    ++sharedCounts[std::make_pair(positionMeshlets[a].second, positionMeshlets[b].second)];
+        i = j;
+    }
+
+    typedef std::vector<std::pair<unsigned int, unsigned int> > Neighbours;
+    std::vector<Neighbours> neighbours(numMeshlets);
+    for (SharedCounts::iterator itr = sharedCounts.begin(), end = sharedCounts.end(); itr != end; ++itr)
+    {
+        neighbours[itr->first.first].push_back(std::make_pair(itr->first.second, itr->second));
+        neighbours[itr->first.second].push_back(std::make_pair(itr->first.first, itr->second));
+    }
+
+    std::vector<bool> grouped(numMeshlets, false);
+    for (unsigned int seed = 0; seed < numMeshlets; ++seed)
+    {
+        if (grouped[seed])
+            continue;
+
+        IndexList group(1, seed);
+        grouped[seed] = true;
+        std::map<unsigned int, unsigned int> candidates;
+        for (unsigned int m = seed; ;)
+        {
+            for (Neighbours::iterator itr = neighbours[m].begin(), end = neighbours[m].end(); itr != end; ++itr)
+                if (!grouped[itr->first])
+                    candidates[itr->first] += itr->second;
+            if (group.size() >= groupSize)
+                break;
+
+            m = numMeshlets;
+            unsigned int bestShared = 0;
+            for (std::map<unsigned int, unsigned int>::iterator itr = candidates.begin(), end = candidates.end(); itr != end; ++itr)
+            {
+                if (!grouped[itr->first] && itr->second > bestShared)
+                {
+                    m = itr->first;
+                    bestShared = itr->second;
+                }
+            }
+            if (m == numMeshlets)
+                break;
+            group.push_back(m);
+            grouped[m] = true;
+        }
+
+        groups.push_back(IndexList());
+        for (IndexList::iterator itr = group.begin(), end = group.end(); itr != end; ++itr)
+            groups.back().push_back(meshletIndices[*itr]);
+    }
+}
+}
+
+MeshletVisitor::MeshletVisitor(Optimizer* optimizer)
+    : GeometryCollector(optimizer, Optimizer::INDEX_MESH),
+      _maximumVertices(64),
+      _maximumTriangles(124),
+      _groupSize(4),
+      _minimumReduction(0.85f),
+      _maximumLevels(16)
+{
+}
+
+MeshletGeometry* MeshletVisitor::createMeshletGeometry(const Geometry& geom) const
+{
+    if (!dynamic_cast<const Vec3Array*>(geom.getVertexArray()))
+        return 0;
+
+    ref_ptr<Geometry> work = new Geometry(geom, CopyOp::DEEP_COPY_ARRAYS | CopyOp::DEEP_COPY_PRIMITIVES);
+    IndexMeshVisitor imv(_optimizer);
+    imv.makeMesh(*work);
+    if (!isIndexedSurfaceMesh(*work))
+        return 0;
+
+    Vec3Array* positions = dynamic_cast<Vec3Array*>(work->getVertexArray());
+    if (!positions)
+        return 0;
+    unsigned int numVertices = positions->size();
+    unsigned int numSlots = getNumArraySlots(*work);
+    unsigned int numTexCoordArrays = work->getNumTexCoordArrays();
+    for (unsigned int slot = 0; slot < numSlots; ++slot)
+    {
+        Array* array = getArraySlot(*work, slot);
+        if (array && array->getBinding() != Array::BIND_OVERALL && array->getNumElements() != numVertices)
+            return 0;
+    }
+
+    TriangleGatherer gatherer;
+    Geometry::PrimitiveSetList& primSets = work->getPrimitiveSetList();
+    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(), end = primSets.end();
+         itr != end;
+         ++itr)
+        (*itr)->accept(gatherer);
+    if (gatherer.triangleIndices.empty() || computeNumVertices(gatherer.triangleIndices) > numVertices)
+        return 0;
+
+    MeshletGeometry::Meshlets meshlets;
+    IndexList elements;
+    IndexList pending;
+
+    std::vector<IndexList> clusters;
+    buildMeshlets(gatherer.triangleIndices, *positions, _maximumVertices, _maximumTriangles, clusters);
+    for (std::vector<IndexList>::iterator itr = clusters.begin(), end = clusters.end(); itr != end; ++itr)
+        pending.push_back(addMeshlet(*itr, *positions, 0, 0.0f, BoundingSphere(), meshlets, elements));
+
+    Simplifier simplifier(0.5, FLT_MAX);
+    simplifier.setSmoothing(false);
+    simplifier.setDoTriStrip(false);
+    ref_ptr<SimplificationErrorCallback> errorCallback = new SimplificationErrorCallback;
+    simplifier.setContinueSimplificationCallback(errorCallback.get());
+
+    unsigned int level = 0;
+    for (; pending.size() > 1 && level < _maximumLevels; ++level)
+    {
+        std::vector<IndexList> groups;
+        groupMeshlets(pending, meshlets, elements, *positions, _groupSize, groups);
+
+        IndexList nextPending;
+        IndexList deferred;
+        for (std::vector<IndexList>::iterator gitr = groups.begin(), gend = groups.end(); gitr != gend; ++gitr)
+        {
+            const IndexList& group = *gitr;
+
+            IndexList groupTriangles;
+            float childError = 0.0f;
+            for (IndexList::const_iterator itr = group.begin(), end = group.end(); itr != end; ++itr)
+            {
+                const MeshletGeometry::Meshlet& meshlet = meshlets[*itr];
+                groupTriangles.insert(groupTriangles.end(), elements.begin() + meshlet.firstIndex,
+                                      elements.begin() + meshlet.firstIndex + meshlet.numIndices);
+                childError = osg::maximum(childError, meshlet.error);
+            }
+
+            // simplify a copy of the group's vertices, with the triangles reindexed to match.
+            IndexList groupVertices(groupTriangles);
+            std::sort(groupVertices.begin(), groupVertices.end());
+            groupVertices.erase(std::unique(groupVertices.begin(), groupVertices.end()), groupVertices.end());
+
+            ref_ptr<Geometry> groupGeometry = new Geometry;
+            for (unsigned int slot = 0; slot < numSlots; ++slot)
+                setArraySlot(*groupGeometry, slot, numTexCoordArrays, createArraySubset(getArraySlot(*work, slot), groupVertices));
+            DrawElementsUInt* groupElements = new DrawElementsUInt(GL_TRIANGLES);
+            groupElements->reserve(groupTriangles.size());
+            for (IndexList::iterator itr = groupTriangles.begin(), end = groupTriangles.end(); itr != end; ++itr)
+                groupElements->push_back(std::lower_bound(groupVertices.begin(), groupVertices.end(), *itr) - groupVertices.begin());
+            groupGeometry->addPrimitiveSet(groupElements);
+
+            errorCallback->_maximumError = 0.0f;
+            simplifier.simplify(*groupGeometry);
+
+            TriangleGatherer simplified;
+            Geometry::PrimitiveSetList& groupPrimSets = groupGeometry->getPrimitiveSetList();
+            for (Geometry::PrimitiveSetList::iterator itr = groupPrimSets.begin(), end = groupPrimSets.end();
+                 itr != end;
+                 ++itr)
+                (*itr)->accept(simplified);
+            const Vec3Array* groupPositions = dynamic_cast<const Vec3Array*>(groupGeometry->getVertexArray());
+
+            // the meshlets of groups that can't be simplified enough are regrouped with their
+            // neighbours at the next level, and are left as roots if no group can be simplified.
+            if (!groupPositions || simplified.triangleIndices.empty()
+                || simplified.triangleIndices.size() > groupTriangles.size() * _minimumReduction)
+            {
+                deferred.insert(deferred.end(), group.begin(), group.end());
+                continue;
+            }
+
+            // the error and bound of the group enclose those of its meshlets, so that the
+            // projected error increases monotonically from the leaves to the roots.
+            float error = childError + errorCallback->_maximumError;
+            BoundingSphere lodBound;
+            for (IndexList::const_iterator itr = group.begin(), end = group.end(); itr != end; ++itr)
+                lodBound.expandBy(meshlets[*itr].lodBound);
+            for (IndexList::const_iterator itr = group.begin(), end = group.end(); itr != end; ++itr)
+            {
+                meshlets[*itr].parentError = error;
+                meshlets[*itr].parentLodBound = lodBound;
+            }
+
+            unsigned int base = positions->size();
+            for (unsigned int slot = 0; slot < numSlots; ++slot)
+            {
+                Array* array = getArraySlot(*work, slot);
+                if (array && array->getBinding() != Array::BIND_OVERALL)
+                {
+                    ArrayAppender appender(*getArraySlot(*groupGeometry, slot));
+                    array->accept(appender);
+                }
+            }
+
+            clusters.clear();
+            buildMeshlets(simplified.triangleIndices, *groupPositions, _maximumVertices, _maximumTriangles, clusters);
+            for (std::vector<IndexList>::iterator itr = clusters.begin(), end = clusters.end(); itr != end; ++itr)
+            {
+                for (IndexList::iterator iitr = itr->begin(), iend = itr->end(); iitr != iend; ++iitr)
+                    *iitr += base;
+                nextPending.push_back(addMeshlet(*itr, *positions, level + 1, error, lodBound, meshlets, elements));
+            }
+        }
+
+        if (nextPending.empty())
+            break;
+        // the deferred meshlets seed the next groups, so that they are grouped with their neighbours.
+        deferred.insert(deferred.end(), nextPending.begin(), nextPending.end());
+        pending.swap(deferred);
+    }
+
+    OSG_INFO << "MeshletVisitor: " << gatherer.triangleIndices.size() / 3 << " triangles split into "
+             << meshlets.size() << " meshlets over " << level + 1 << " levels" << std::endl;
+
+    MeshletGeometry* meshletGeometry = new MeshletGeometry;
+    meshletGeometry->setName(geom.getName());
+    meshletGeometry->setStateSet(const_cast<StateSet*>(geom.getStateSet()));
+    for (unsigned int slot = 0; slot < numSlots; ++slot)
+        setArraySlot(*meshletGeometry, slot, numTexCoordArrays, getArraySlot(*work, slot));
+    meshletGeometry->addPrimitiveSet(new DrawElementsUInt(GL_TRIANGLES, elements.begin(), elements.end()));
+    meshletGeometry->setMeshlets(meshlets);
+    return meshletGeometry;
+}
+
+void MeshletVisitor::build(Geometry& geom)
+{
+    ref_ptr<MeshletGeometry> meshletGeometry = createMeshletGeometry(geom);
+    if (!meshletGeometry)
+        return;
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_meshletGeometriesMutex);
+    _meshletGeometries[&geom] = meshletGeometry;
+}
+
+void MeshletVisitor::build()
+{
+    ObjectList geometries(_geometryList.begin(), _geometryList.end());
+    GeometryProcessor<MeshletVisitor, &MeshletVisitor::build> processor(*this);
+    processObjects(geometries, processor);
+
+    // the parents are only changed once all the geometries are built, as they may be shared.
+    for (MeshletGeometryMap::iterator itr = _meshletGeometries.begin(), end = _meshletGeometries.end();
+         itr != end;
+         ++itr)
+    {
+        ref_ptr<Geometry> geom = itr->first;
+        Node::ParentList parents = geom->getParents();
+        for (Node::ParentList::iterator pitr = parents.begin(), pend = parents.end(); pitr != pend; ++pitr)
+            (*pitr)->replaceChild(geom.get(), itr->second.get());
+    }
+    _meshletGeometries.clear();
+}
+
 }
@@ -33,8 +33,11 @@
 #include <osg/ImageStream>
 #include <osg/Timer>
 #include <osg/TexMat>
+#include <osg/OperationThread>
 #include <osg/io_utils>
 
+#include <OpenThreads/Atomic>
+
 #include <osgUtil/TransformAttributeFunctor>
 #include <osgUtil/TriStripVisitor>
 #include <osgUtil/Tessellator>
@@ -50,11 +53,130 @@
 
 using namespace osgUtil;
 
+static osg::ApplicationUsageProxy Optimizer_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_USE_THREAD_POOL <mode>","ON | OFF - Distribute the per Geometry optimization passes across the OperationThreadPool, defaults to ON.");
+
+Optimizer::Optimizer():
+    _useThreadPool(true)
+{
+    const char* env = getenv("OSG_OPTIMIZER_USE_THREAD_POOL");
+    if (env && (strcmp(env,"OFF")==0 || strcmp(env,"Off")==0 || strcmp(env,"off")==0)) _useThreadPool = false;
+}
+
 void Optimizer::reset()
 {
 }
 
-static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES  | TRISTRIP_GEOMETRY | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
+namespace
+{
+
+// records the time taken by an optimization pass from construction to destruction.
+class PassTimer
+{
+public:
+    PassTimer(Optimizer::PassTimings& passTimings, const char* name):
+        _passTimings(passTimings),
+        _name(name),
+        _startTick(osg::Timer::instance()->tick()) {}
+
+    ~PassTimer()
+    {
+        double time = osg::Timer::instance()->delta_m(_startTick, osg::Timer::instance()->tick());
+        _passTimings.push_back(Optimizer::PassTiming(_name, time));
+        OSG_INFO<<"Optimizer::optimize() "<<_name<<" took "<<time<<"ms"<<std::endl;
+    }
+
+protected:
+
+    PassTimer& operator = (const PassTimer&) { return *this; }
+
+    Optimizer::PassTimings& _passTimings;
+    const char*             _name;
+    osg::Timer_t            _startTick;
+};
+
+struct ProcessObjectsOperation : public osg::Operation
+{
+    ProcessObjectsOperation(const BaseOptimizerVisitor::ObjectList& objects, BaseOptimizerVisitor::ObjectProcessor& processor, OpenThreads::Atomic& numObjectsTaken, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("ProcessOptimizerObjects", false),
+        _objects(objects),
+        _processor(processor),
+        _numObjectsTaken(numObjectsTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        // take objects one at a time so that expensive objects don't leave the other threads idle.
+        for(unsigned int i = (++_numObjectsTaken)-1; i<_objects.size(); i = (++_numObjectsTaken)-1)
+        {
+            _processor.process(*_objects[i]);
+        }
+
+        _blockCount->completed();
+    }
+
+    const BaseOptimizerVisitor::ObjectList&     _objects;
+    BaseOptimizerVisitor::ObjectProcessor&      _processor;
+    OpenThreads::Atomic&                        _numObjectsTaken;
+    osg::ref_ptr<osg::RefBlockCount>            _blockCount;
+
+protected:
+
+    ProcessObjectsOperation& operator = (const ProcessObjectsOperation&) { return *this; }
+};
+
+}
+
+void BaseOptimizerVisitor::processObjects(const ObjectList& objects, ObjectProcessor& processor)
+{
+    if (!_useThreadPool || objects.size()<2)
+    {
+        for(ObjectList::const_iterator itr = objects.begin();
+            itr != objects.end();
+            ++itr)
+        {
+            processor.process(**itr);
+        }
+        return;
+    }
+
+    // decide which objects share data before processing any of them, as processing can change what is shared.
+    ObjectList independentObjects;
+    ObjectList sharedObjects;
+    for(ObjectList::const_iterator itr = objects.begin();
+        itr != objects.end();
+        ++itr)
+    {
+        if (processor.sharesData(**itr)) sharedObjects.push_back(*itr);
+        else independentObjects.push_back(*itr);
+    }
+
+    if (!independentObjects.empty())
+    {
+        osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+        unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, static_cast<unsigned int>(independentObjects.size()));
+
+        OpenThreads::Atomic numObjectsTaken;
+        osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+        blockCount->reset();
+
+        for(unsigned int i=0; i<numOperations; ++i)
+        {
+            threadPool->add(new ProcessObjectsOperation(independentObjects, processor, numObjectsTaken, blockCount.get()));
+        }
+
+        threadPool->runOperationsUntilCompleted(blockCount.get());
+    }
+
+    for(ObjectList::const_iterator itr = sharedObjects.begin();
+        itr != sharedObjects.end();
+        ++itr)
+    {
+        processor.process(**itr);
+    }
+}
+
+static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES  | TRISTRIP_GEOMETRY | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS | MULTI_DRAW_INDIRECT | REDUCE_OVERDRAW");
 
 void Optimizer::optimize(osg::Node* node)
 {
@@ -136,6 +258,12 @@ void Optimizer::optimize(osg::Node* node)
 
         if(str.find("~BUFFER_OBJECT_SETTINGS")!=std::string::npos) options ^= BUFFER_OBJECT_SETTINGS;
         else if(str.find("BUFFER_OBJECT_SETTINGS")!=std::string::npos) options |= BUFFER_OBJECT_SETTINGS;
+
+        if(str.find("~MULTI_DRAW_INDIRECT")!=std::string::npos) options ^= MULTI_DRAW_INDIRECT;
+        else if(str.find("MULTI_DRAW_INDIRECT")!=std::string::npos) options |= MULTI_DRAW_INDIRECT;
+
+        if(str.find("~REDUCE_OVERDRAW")!=std::string::npos) options ^= REDUCE_OVERDRAW;
+        else if(str.find("REDUCE_OVERDRAW")!=std::string::npos) options |= REDUCE_OVERDRAW;
     }
     else
     {
@@ -150,6 +278,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 {
     StatsVisitor stats;
 
+    _passTimings.clear();
+
     if (osg::getNotifyLevel()>=osg::INFO)
     {
         node->accept(stats);
@@ -160,6 +290,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & STATIC_OBJECT_DETECTION)
     {
+        PassTimer passTimer(_passTimings, "STATIC_OBJECT_DETECTION");
+
         StaticObjectDetectionVisitor sodv;
         node->accept(sodv);
     }
@@ -167,6 +299,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & TESSELLATE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing TESSELLATE_GEOMETRY"<<std::endl;
+        PassTimer passTimer(_passTimings, "TESSELLATE_GEOMETRY");
 
         TessellateVisitor tsv;
         node->accept(tsv);
@@ -175,6 +308,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & REMOVE_LOADED_PROXY_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_LOADED_PROXY_NODES"<<std::endl;
+        PassTimer passTimer(_passTimings, "REMOVE_LOADED_PROXY_NODES");
 
         RemoveLoadedProxyNodesVisitor rlpnv(this);
         node->accept(rlpnv);
@@ -185,6 +319,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & COMBINE_ADJACENT_LODS)
     {
         OSG_INFO<<"Optimizer::optimize() doing COMBINE_ADJACENT_LODS"<<std::endl;
+        PassTimer passTimer(_passTimings, "COMBINE_ADJACENT_LODS");
 
         CombineLODsVisitor clv(this);
         node->accept(clv);
@@ -194,6 +329,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & OPTIMIZE_TEXTURE_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing OPTIMIZE_TEXTURE_SETTINGS"<<std::endl;
+        PassTimer passTimer(_passTimings, "OPTIMIZE_TEXTURE_SETTINGS");
 
         TextureVisitor tv(true,true, // unref image
                           false,false, // client storage
@@ -205,6 +341,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & SHARE_DUPLICATE_STATE)
     {
         OSG_INFO<<"Optimizer::optimize() doing SHARE_DUPLICATE_STATE"<<std::endl;
+        PassTimer passTimer(_passTimings, "SHARE_DUPLICATE_STATE");
 
         bool combineDynamicState = false;
         bool combineStaticState = true;
@@ -218,6 +355,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & TEXTURE_ATLAS_BUILDER)
     {
         OSG_INFO<<"Optimizer::optimize() doing TEXTURE_ATLAS_BUILDER"<<std::endl;
+        PassTimer passTimer(_passTimings, "TEXTURE_ATLAS_BUILDER");
 
         // traverse the scene collecting textures into texture atlas.
         TextureAtlasVisitor tav(this);
@@ -237,6 +375,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & COPY_SHARED_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing COPY_SHARED_NODES"<<std::endl;
+        PassTimer passTimer(_passTimings, "COPY_SHARED_NODES");
 
         CopySharedSubgraphsVisitor cssv(this);
         node->accept(cssv);
@@ -246,6 +385,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & FLATTEN_STATIC_TRANSFORMS)
     {
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS"<<std::endl;
+        PassTimer passTimer(_passTimings, "FLATTEN_STATIC_TRANSFORMS");
 
         int i=0;
         bool result = false;
@@ -267,6 +407,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS)
     {
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS"<<std::endl;
+        PassTimer passTimer(_passTimings, "FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS");
 
         // now combine any adjacent static transforms.
         FlattenStaticTransformsDuplicatingSharedSubgraphsVisitor fstdssv(this);
@@ -277,20 +418,16 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MERGE_GEODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEODES"<<std::endl;
-
-        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        PassTimer passTimer(_passTimings, "MERGE_GEODES");
 
         MergeGeodesVisitor visitor;
         node->accept(visitor);
-
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-
-        OSG_INFO<<"MERGE_GEODES took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
     }
 
     if (options & MAKE_FAST_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MAKE_FAST_GEOMETRY"<<std::endl;
+        PassTimer passTimer(_passTimings, "MAKE_FAST_GEOMETRY");
 
         MakeFastGeometryVisitor mgv(this);
         node->accept(mgv);
@@ -299,23 +436,22 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MERGE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEOMETRY"<<std::endl;
-
-        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        PassTimer passTimer(_passTimings, "MERGE_GEOMETRY");
 
         MergeGeometryVisitor mgv(this);
         mgv.setTargetMaximumNumberOfVertices(10000);
+        mgv.setUseThreadPool(_useThreadPool);
         node->accept(mgv);
-
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-
-        OSG_INFO<<"MERGE_GEOMETRY took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
+        mgv.mergeCollectedGeodes();
     }
 
     if (options & TRISTRIP_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing TRISTRIP_GEOMETRY"<<std::endl;
+        PassTimer passTimer(_passTimings, "TRISTRIP_GEOMETRY");
 
         TriStripVisitor tsv(this);
+        tsv.setUseThreadPool(_useThreadPool);
         node->accept(tsv);
         tsv.stripify();
     }
@@ -323,6 +459,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & REMOVE_REDUNDANT_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_REDUNDANT_NODES"<<std::endl;
+        PassTimer passTimer(_passTimings, "REMOVE_REDUNDANT_NODES");
 
         RemoveEmptyNodesVisitor renv(this);
         node->accept(renv);
@@ -336,6 +473,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & FLATTEN_BILLBOARDS)
     {
+        PassTimer passTimer(_passTimings, "FLATTEN_BILLBOARDS");
+
         FlattenBillboardVisitor fbv(this);
         node->accept(fbv);
         fbv.process();
@@ -344,39 +483,51 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & SPATIALIZE_GROUPS)
     {
         OSG_INFO<<"Optimizer::optimize() doing SPATIALIZE_GROUPS"<<std::endl;
+        PassTimer passTimer(_passTimings, "SPATIALIZE_GROUPS");
 
         SpatializeGroupsVisitor sv(this);
         node->accept(sv);
         sv.divide();
     }
 
-    if (options & INDEX_MESH)
+    if (options & (INDEX_MESH | VERTEX_POSTTRANSFORM | REDUCE_OVERDRAW | VERTEX_PRETRANSFORM))
     {
-        OSG_INFO<<"Optimizer::optimize() doing INDEX_MESH"<<std::endl;
-        IndexMeshVisitor imv(this);
-        node->accept(imv);
-        imv.makeMesh();
-    }
+        // run the mesh optimizations as one pass over each geometry, in the order INDEX_MESH, VERTEX_POSTTRANSFORM,
+        // REDUCE_OVERDRAW then VERTEX_PRETRANSFORM.
+        unsigned int stages = 0;
+        if (options & INDEX_MESH) stages |= MeshOptimizationVisitor::INDEX_MESH_STAGE;
+        if (options & VERTEX_POSTTRANSFORM) stages |= MeshOptimizationVisitor::VERTEX_CACHE_STAGE;
+        if (options & REDUCE_OVERDRAW) stages |= MeshOptimizationVisitor::OVERDRAW_STAGE;
+        if (options & VERTEX_PRETRANSFORM) stages |= MeshOptimizationVisitor::VERTEX_FETCH_STAGE;
 
-    if (options & VERTEX_POSTTRANSFORM)
-    {
-        OSG_INFO<<"Optimizer::optimize() doing VERTEX_POSTTRANSFORM"<<std::endl;
-        VertexCacheVisitor vcv;
-        node->accept(vcv);
-        vcv.optimizeVertices();
+        OSG_INFO<<"Optimizer::optimize() doing INDEX_MESH, VERTEX_POSTTRANSFORM, REDUCE_OVERDRAW and/or VERTEX_PRETRANSFORM"<<std::endl;
+        PassTimer passTimer(_passTimings, "MESH_OPTIMIZATION");
+        MeshOptimizationVisitor mov(this, stages);
+        mov.setUseThreadPool(_useThreadPool);
+        mov.setCollectStatistics(osg::isNotifyEnabled(osg::INFO));
+        node->accept(mov);
+        mov.optimize();
+
+        if (mov.getCollectStatistics())
+        {
+            const MeshOptimizationVisitor::Statistics& statistics = mov.getStatistics();
+            OSG_INFO<<"    "<<statistics.numGeometries<<" geometries, ACMR "<<statistics.getACMRBefore()<<" -> "<<statistics.getACMRAfter()
+                    <<", ATVR "<<statistics.getATVRBefore()<<" -> "<<statistics.getATVRAfter()<<std::endl;
+        }
     }
 
-    if (options & VERTEX_PRETRANSFORM)
+    if (options & MULTI_DRAW_INDIRECT)
     {
-        OSG_INFO<<"Optimizer::optimize() doing VERTEX_PRETRANSFORM"<<std::endl;
-        VertexAccessOrderVisitor vaov;
-        node->accept(vaov);
-        vaov.optimizeOrder();
+        OSG_INFO<<"Optimizer::optimize() doing MULTI_DRAW_INDIRECT"<<std::endl;
+        PassTimer passTimer(_passTimings, "MULTI_DRAW_INDIRECT");
+        MultiDrawIndirectVisitor mdiv(this);
+        node->accept(mdiv);
     }
 
     if (options & BUFFER_OBJECT_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
+        PassTimer passTimer(_passTimings, "BUFFER_OBJECT_SETTINGS");
         BufferObjectVisitor bov(true, true, true, true, true, false);
         node->accept(bov);
     }
@@ -1776,6 +1927,55 @@ bool isAbleToMerge(const osg::Geometry& g1, const osg::Geometry& g2)
     return true;
 }
 
+void Optimizer::MergeGeometryVisitor::apply(osg::Geode& geode)
+{
+    if (_useThreadPool) _geodes.push_back(&geode);
+    else mergeGeode(geode);
+}
+
+namespace
+{
+
+struct MergeGeodeProcessor : public BaseOptimizerVisitor::ObjectProcessor
+{
+    MergeGeodeProcessor(Optimizer::MergeGeometryVisitor& visitor): _visitor(visitor) {}
+
+    virtual bool sharesData(osg::Object& object)
+    {
+        osg::Geode& geode = static_cast<osg::Geode&>(object);
+
+        // removing drawables from a geode can change the culling and occluder counts of its parents.
+        if (geode.getNumParents()>1 || geode.getNumChildrenWithCullingDisabled()>0 || geode.getNumChildrenWithOccluderNodes()>0) return true;
+
+        for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+        {
+            osg::Drawable* drawable = geode.getDrawable(i);
+            if (drawable->getNumParents()>1) return true;
+
+            osg::Geometry* geometry = drawable->asGeometry();
+            if (geometry && Optimizer::MergeGeometryVisitor::geometryContainsSharedArrays(*geometry)) return true;
+        }
+        return false;
+    }
+
+    virtual void process(osg::Object& object) { _visitor.mergeGeode(static_cast<osg::Geode&>(object)); }
+
+    Optimizer::MergeGeometryVisitor& _visitor;
+
+protected:
+
+    MergeGeodeProcessor& operator = (const MergeGeodeProcessor&) { return *this; }
+};
+
+}
+
+void Optimizer::MergeGeometryVisitor::mergeCollectedGeodes()
+{
+    MergeGeodeProcessor processor(*this);
+    processObjects(_geodes, processor);
+    _geodes.clear();
+}
+
 bool Optimizer::MergeGeometryVisitor::mergeGeode(osg::Geode& geode)
 {
     if (!isOperationPermissibleForObject(&geode)) return false;
@@ -2554,6 +2754,123 @@ bool Optimizer::MergeGeometryVisitor::mergePrimitive(osg::DrawElementsUInt& lhs,
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Pack static geometries into multi draw indirect batches
+//
+
+namespace
+{
+    struct MultiDrawIndirectBatch
+    {
+        typedef std::vector< osg::ref_ptr<osg::Drawable> > DrawableList;
+
+        osg::ref_ptr<osg::MultiDrawIndirectGeometry>    geometry;
+        DrawableList                                    sources;
+    };
+}
+
+void Optimizer::MultiDrawIndirectVisitor::apply(osg::Geode& geode)
+{
+    if (!isOperationPermissibleForObject(&geode)) return;
+
+    packGeode(geode);
+}
+
+bool Optimizer::MultiDrawIndirectVisitor::packGeode(osg::Geode& geode)
+{
+    if (geode.getNumDrawables()<2 || geode.getNumDrawables()<_minimumNumberOfDraws) return false;
+
+    typedef MultiDrawIndirectBatch::DrawableList DrawableList;
+    typedef std::vector<MultiDrawIndirectBatch> BatchList;
+
+    BatchList batches;
+    DrawableList standardDrawables;
+
+    for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+    {
+        osg::Drawable* drawable = geode.getDrawable(i);
+        osg::Geometry* geometry = drawable ? drawable->asGeometry() : 0;
+        if (!geometry ||
+            dynamic_cast<osg::MultiDrawIndirectGeometry*>(geometry)!=0 ||
+            geometry->getDataVariance()==osg::Object::DYNAMIC ||
+            geometry->getUpdateCallback() || geometry->getEventCallback() || geometry->getCullCallback() || geometry->getDrawCallback() ||
+            !isOperationPermissibleForObject(geometry))
+        {
+            if (drawable) standardDrawables.push_back(drawable);
+            continue;
+        }
+
+        unsigned int numVertices = geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0;
+
+        MultiDrawIndirectBatch* batch = 0;
+        for(BatchList::iterator itr=batches.begin(); itr!=batches.end() && !batch; ++itr)
+        {
+            osg::MultiDrawIndirectGeometry* mdig = itr->geometry.get();
+            if (mdig->getStateSet()==geometry->getStateSet() &&
+                mdig->getVertexArray()->getNumElements()+numVertices<=_maximumNumberOfVertices &&
+                mdig->isCompatible(*geometry))
+            {
+                batch = &(*itr);
+            }
+        }
+
+        if (!batch)
+        {
+            osg::ref_ptr<osg::MultiDrawIndirectGeometry> mdig = new osg::MultiDrawIndirectGeometry;
+            mdig->setDrawIDAttributeIndex(_drawIDAttributeIndex);
+            if (numVertices>_maximumNumberOfVertices || !mdig->isCompatible(*geometry))
+            {
+                standardDrawables.push_back(drawable);
+                continue;
+            }
+
+            mdig->setStateSet(geometry->getStateSet());
+            batches.push_back(MultiDrawIndirectBatch());
+            batch = &batches.back();
+            batch->geometry = mdig;
+        }
+
+        batch->geometry->addGeometry(*geometry);
+        batch->sources.push_back(drawable);
+    }
+
+    unsigned int numBatches = 0;
+    for(BatchList::iterator itr=batches.begin(); itr!=batches.end(); ++itr)
+    {
+        if (itr->sources.size()>=2 && itr->sources.size()>=_minimumNumberOfDraws) ++numBatches;
+    }
+
+    if (numBatches==0) return false;
+
+    geode.removeDrawables(0, geode.getNumDrawables());
+
+    for(DrawableList::iterator itr=standardDrawables.begin(); itr!=standardDrawables.end(); ++itr)
+    {
+        geode.addDrawable(itr->get());
+    }
+
+    for(BatchList::iterator itr=batches.begin(); itr!=batches.end(); ++itr)
+    {
+        if (itr->sources.size()>=2 && itr->sources.size()>=_minimumNumberOfDraws)
+        {
+            OSG_INFO<<"MultiDrawIndirectVisitor packed "<<itr->sources.size()<<" geometries into a batch of "
+                    <<itr->geometry->getVertexArray()->getNumElements()<<" vertices"<<std::endl;
+            geode.addDrawable(itr->geometry.get());
+        }
+        else
+        {
+            for(DrawableList::iterator ditr=itr->sources.begin(); ditr!=itr->sources.end(); ++ditr)
+            {
+                geode.addDrawable(ditr->get());
+            }
+        }
+    }
+
+    return true;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  Spatialize the scene to accelerate culling
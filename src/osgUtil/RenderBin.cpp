@@ -22,6 +22,7 @@
 #include <osg/AlphaFunc>
 
 #include <algorithm>
+#include <float.h>
 
 using namespace osg;
 using namespace osgUtil;
@@ -38,6 +39,7 @@ class RenderBinPrototypeList : osg::depends_on<OpenThreads::Mutex*, osg::Referen
             add("SORT_BACK_TO_FRONT",new RenderBin(RenderBin::SORT_BACK_TO_FRONT));
             add("SORT_FRONT_TO_BACK",new RenderBin(RenderBin::SORT_FRONT_TO_BACK));
             add("TraversalOrderBin",new RenderBin(RenderBin::TRAVERSAL_ORDER));
+            add("StateKeySortedBin",new RenderBin(RenderBin::SORT_BY_STATE_KEY));
         }
 
         void add(const std::string& name, RenderBin* bin)
@@ -75,7 +77,13 @@ RenderBin* RenderBin::createRenderBin(const std::string& binName)
     if (list)
     {
         RenderBin* prototype = getRenderBinPrototype(binName);
-        if (prototype) return dynamic_cast<RenderBin*>(prototype->clone(osg::CopyOp::DEEP_COPY_ALL));
+        if (prototype)
+        {
+            RenderBin* rb = dynamic_cast<RenderBin*>(prototype->clone(osg::CopyOp::DEEP_COPY_ALL));
+            // record the name so that an equivalent bin can be created from this one, as required when merging parallel culls.
+            if (rb) rb->setName(binName);
+            return rb;
+        }
     }
 
     OSG_WARN <<"Warning: RenderBin \""<<binName<<"\" implementation not found, using default RenderBin as a fallback."<<std::endl;
@@ -113,7 +121,7 @@ void RenderBin::removeRenderBinPrototype(RenderBin* proto)
 
 static bool s_defaultBinSortModeInitialized = false;
 static RenderBin::SortMode s_defaultBinSortMode = RenderBin::SORT_BY_STATE;
-static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT");
+static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT | TRAVERSAL_ORDER | SORT_BY_STATE_KEY");
 
 void RenderBin::setDefaultRenderBinSortMode(RenderBin::SortMode mode)
 {
@@ -136,6 +144,7 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
             else if (strcmp(str,"SORT_FRONT_TO_BACK")==0) s_defaultBinSortMode = RenderBin::SORT_FRONT_TO_BACK;
             else if (strcmp(str,"SORT_BACK_TO_FRONT")==0) s_defaultBinSortMode = RenderBin::SORT_BACK_TO_FRONT;
             else if (strcmp(str,"TRAVERSAL_ORDER")==0) s_defaultBinSortMode = RenderBin::TRAVERSAL_ORDER;
+            else if (strcmp(str,"SORT_BY_STATE_KEY")==0) s_defaultBinSortMode = RenderBin::SORT_BY_STATE_KEY;
         }
     }
 
@@ -250,6 +259,9 @@ void RenderBin::sortImplementation()
         case(TRAVERSAL_ORDER):
             sortTraversalOrder();
             break;
+        case(SORT_BY_STATE_KEY):
+            sortByStateKey();
+            break;
     }
 }
 
@@ -346,6 +358,170 @@ void RenderBin::sortTraversalOrder()
     std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
 }
 
+namespace
+{
+
+// find the attribute that will be applied for a StateGraph, ignoring override values which are rare enough not to matter for sorting.
+const osg::StateAttribute* findStateGraphAttribute(const StateGraph* sg, osg::StateAttribute::Type type, bool textureAttribute)
+{
+    for(; sg; sg = sg->_parent)
+    {
+        const osg::StateSet* ss = sg->getStateSet();
+        if (ss)
+        {
+            const osg::StateAttribute* sa = textureAttribute ? ss->getTextureAttribute(0, type) : ss->getAttribute(type);
+            if (sa) return sa;
+        }
+    }
+    return 0;
+}
+
+inline uint64_t rankOf(const std::vector<const osg::StateAttribute*>& sortedAttributes, const osg::StateAttribute* sa)
+{
+    uint64_t rank = std::lower_bound(sortedAttributes.begin(), sortedAttributes.end(), sa) - sortedAttributes.begin();
+    return rank<0xffff ? rank : 0xffff;
+}
+
+// stable least significant digit radix sort on the _key member, skipping the passes where all keys share the same digit.
+template<class T>
+void radixSortByKey(std::vector<T>& list, std::vector<T>& scratch)
+{
+    const unsigned int numPasses = 8;
+    const unsigned int numBuckets = 256;
+
+    unsigned int numItems = list.size();
+    if (numItems<2) return;
+
+    unsigned int counts[numPasses][numBuckets];
+    memset(counts, 0, sizeof(counts));
+    for(unsigned int i=0; i<numItems; ++i)
+    {
+        uint64_t key = list[i]._key;
+        for(unsigned int pass=0; pass<numPasses; ++pass)
+        {
+            ++counts[pass][(key>>(pass*8)) & 0xff];
+        }
+    }
+
+    scratch.resize(numItems);
+    T* source = &list.front();
+    T* destination = &scratch.front();
+
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        unsigned int shift = pass*8;
+        if (counts[pass][(source[0]._key>>shift) & 0xff]==numItems) continue;
+
+        unsigned int offsets[numBuckets];
+        unsigned int total = 0;
+        for(unsigned int b=0; b<numBuckets; ++b)
+        {
+            offsets[b] = total;
+            total += counts[pass][b];
+        }
+
+        for(unsigned int i=0; i<numItems; ++i)
+        {
+            destination[offsets[(source[i]._key>>shift) & 0xff]++] = source[i];
+        }
+
+        std::swap(source, destination);
+    }
+
+    if (source!=&list.front()) list.swap(scratch);
+}
+
+}
+
+void RenderBin::sortByStateKey()
+{
+    _renderLeafList.clear();
+    _sortKeyLeafList.clear();
+
+    // rank the programs and textures used so they can be packed into 16 bits each.
+    std::vector<const osg::StateAttribute*> programs;
+    std::vector<const osg::StateAttribute*> textures;
+    programs.reserve(_stateGraphList.size());
+    textures.reserve(_stateGraphList.size());
+
+    float minDepth = FLT_MAX;
+    float maxDepth = -FLT_MAX;
+    bool detectedNaN = false;
+
+    StateGraphList::iterator itr;
+    for(itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr)
+    {
+        programs.push_back(findStateGraphAttribute(*itr, osg::StateAttribute::PROGRAM, false));
+        textures.push_back(findStateGraphAttribute(*itr, osg::StateAttribute::TEXTURE, true));
+
+        for(StateGraph::LeafList::iterator dw_itr = (*itr)->_leaves.begin();
+            dw_itr != (*itr)->_leaves.end();
+            ++dw_itr)
+        {
+            float depth = (*dw_itr)->_depth;
+            if (osg::isNaN(depth)) detectedNaN = true;
+            else
+            {
+                if (depth<minDepth) minDepth = depth;
+                if (depth>maxDepth) maxDepth = depth;
+            }
+        }
+    }
+
+    std::vector<const osg::StateAttribute*> sortedPrograms(programs);
+    std::sort(sortedPrograms.begin(), sortedPrograms.end());
+    sortedPrograms.erase(std::unique(sortedPrograms.begin(), sortedPrograms.end()), sortedPrograms.end());
+
+    std::vector<const osg::StateAttribute*> sortedTextures(textures);
+    std::sort(sortedTextures.begin(), sortedTextures.end());
+    sortedTextures.erase(std::unique(sortedTextures.begin(), sortedTextures.end()), sortedTextures.end());
+
+    float depthScale = (maxDepth>minDepth) ? 65535.0f/(maxDepth-minDepth) : 0.0f;
+
+    // build the key for each leaf.
+    unsigned int stateGraphIndex = 0;
+    for(itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr, ++stateGraphIndex)
+    {
+        uint64_t stateKey = (rankOf(sortedPrograms, programs[stateGraphIndex])<<48) |
+                            (rankOf(sortedTextures, textures[stateGraphIndex])<<32) |
+                            (static_cast<uint64_t>(stateGraphIndex<0xffff ? stateGraphIndex : 0xffff)<<16);
+
+        for(StateGraph::LeafList::iterator dw_itr = (*itr)->_leaves.begin();
+            dw_itr != (*itr)->_leaves.end();
+            ++dw_itr)
+        {
+            RenderLeaf* leaf = dw_itr->get();
+            if (osg::isNaN(leaf->_depth)) continue;
+
+            unsigned int quantizedDepth = static_cast<unsigned int>((leaf->_depth-minDepth)*depthScale);
+
+            SortKeyLeaf skl;
+            skl._key = stateKey | (quantizedDepth<0xffff ? quantizedDepth : 0xffff);
+            skl._leaf = leaf;
+            _sortKeyLeafList.push_back(skl);
+        }
+    }
+
+    radixSortByKey(_sortKeyLeafList, _sortKeyLeafScratchList);
+
+    _renderLeafList.reserve(_sortKeyLeafList.size());
+    for(SortKeyLeafList::iterator skl_itr = _sortKeyLeafList.begin();
+        skl_itr != _sortKeyLeafList.end();
+        ++skl_itr)
+    {
+        _renderLeafList.push_back(skl_itr->_leaf);
+    }
+
+    if (detectedNaN) OSG_NOTICE<<"Warning: RenderBin::sortByStateKey() detected NaN depth values, database may be corrupted."<<std::endl;
+
+    // empty the render graph list to prevent it being drawn along side the render leaf list (see drawImplementation.)
+    _stateGraphList.clear();
+}
+
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
 {
     _renderLeafList.clear();
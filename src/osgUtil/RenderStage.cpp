@@ -129,6 +129,48 @@ RenderStage::~RenderStage()
 {
 }
 
+void RenderStage::mergePositionalStateAndRenderStages(RenderStage* rs)
+{
+    if (!rs || rs==this) return;
+
+    PositionalStateContainer* source = rs->_renderStageLighting.get();
+    if (source)
+    {
+        PositionalStateContainer* target = getPositionalStateContainer();
+
+        target->_attrList.insert(target->_attrList.end(), source->_attrList.begin(), source->_attrList.end());
+
+        for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator itr = source->_texAttrListMap.begin();
+            itr != source->_texAttrListMap.end();
+            ++itr)
+        {
+            PositionalStateContainer::AttrMatrixList& attrList = target->_texAttrListMap[itr->first];
+            attrList.insert(attrList.end(), itr->second.begin(), itr->second.end());
+        }
+
+        source->reset();
+    }
+
+    for(RenderStageList::iterator pre_itr = rs->_preRenderList.begin();
+        pre_itr != rs->_preRenderList.end();
+        ++pre_itr)
+    {
+        if (source && pre_itr->second->getInheritedPositionalStateContainer()==source) pre_itr->second->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        addPreRenderStage(pre_itr->second.get(), pre_itr->first);
+    }
+
+    for(RenderStageList::iterator post_itr = rs->_postRenderList.begin();
+        post_itr != rs->_postRenderList.end();
+        ++post_itr)
+    {
+        if (source && post_itr->second->getInheritedPositionalStateContainer()==source) post_itr->second->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        addPostRenderStage(post_itr->second.get(), post_itr->first);
+    }
+
+    rs->_preRenderList.clear();
+    rs->_postRenderList.clear();
+}
+
 void RenderStage::reset()
 {
     _stageDrawnThisFrame = false;
@@ -12,6 +12,8 @@
 */
 
 #include <osg/TriangleIndexFunctor>
+#include <osg/OperationThread>
+#include <osg/Notify>
 
 #include <osgUtil/Simplifier>
 
@@ -23,6 +25,9 @@
 #include <algorithm>
 
 #include <iterator>
+#include <string.h>
+
+#include <OpenThreads/Atomic>
 
 using namespace osgUtil;
 
@@ -1721,13 +1726,845 @@ void EdgeCollapse::copyBackToGeometry()
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+//
+// Quadric error metric engine, after "Surface Simplification Using Quadric
+// Error Metrics" by Garland and Heckbert, using half edge collapses so that
+// the kept vertices retain all their original attributes.
+//
+namespace
+{
+
+typedef Simplifier::IndexList IndexList;
+
+// Sum of the squared distances to a set of planes, each weighted by the
+// area of the triangle it came from, held as the upper half of a
+// symmetric 4x4 matrix along with the total weight.
+struct Quadric
+{
+    Quadric():
+        a2(0.0), ab(0.0), ac(0.0), ad(0.0),
+        b2(0.0), bc(0.0), bd(0.0),
+        c2(0.0), cd(0.0),
+        d2(0.0), w(0.0) {}
+
+    Quadric(const osg::Vec3d& n, double d, double weight):
+        a2(n.x()*n.x()*weight), ab(n.x()*n.y()*weight), ac(n.x()*n.z()*weight), ad(n.x()*d*weight),
+        b2(n.y()*n.y()*weight), bc(n.y()*n.z()*weight), bd(n.y()*d*weight),
+        c2(n.z()*n.z()*weight), cd(n.z()*d*weight),
+        d2(d*d*weight), w(weight) {}
+
+    Quadric& operator += (const Quadric& rhs)
+    {
+        a2 += rhs.a2; ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+        b2 += rhs.b2; bc += rhs.bc; bd += rhs.bd;
+        c2 += rhs.c2; cd += rhs.cd;
+        d2 += rhs.d2; w += rhs.w;
+        return *this;
+    }
+
+    double evaluate(const osg::Vec3d& p) const
+    {
+        double x = p.x(), y = p.y(), z = p.z();
+        return a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x
+             + b2*y*y + 2.0*bc*y*z + 2.0*bd*y
+             + c2*z*z + 2.0*cd*z
+             + d2;
+    }
+
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, w;
+};
+
+// root mean square distance of p from the planes of the two quadrics.
+inline float computeError(const Quadric& q0, const Quadric& q1, const osg::Vec3d& p)
+{
+    double w = q0.w + q1.w;
+    if (w<=0.0) return 0.0f;
+
+    double e = (q0.evaluate(p) + q1.evaluate(p))/w;
+    return e>0.0 ? static_cast<float>(sqrt(e)) : 0.0f;
+}
+
+class CopyVertexArrayToPositionsVisitor : public osg::ArrayVisitor
+{
+    public:
+        CopyVertexArrayToPositionsVisitor(std::vector<osg::Vec3d>& positions):
+            _positions(positions),
+            _valid(false) {}
+
+        template<class A>
+        void copy2(const A& array)
+        {
+            _positions.resize(array.size());
+            for(unsigned int i=0;i<array.size();++i) _positions[i].set(array[i].x(), array[i].y(), 0.0);
+            _valid = true;
+        }
+
+        template<class A>
+        void copy3(const A& array)
+        {
+            _positions.resize(array.size());
+            for(unsigned int i=0;i<array.size();++i) _positions[i].set(array[i].x(), array[i].y(), array[i].z());
+            _valid = true;
+        }
+
+        template<class A>
+        void copy4(const A& array)
+        {
+            _positions.resize(array.size());
+            for(unsigned int i=0;i<array.size();++i) _positions[i].set(array[i].x()/array[i].w(), array[i].y()/array[i].w(), array[i].z()/array[i].w());
+            _valid = true;
+        }
+
+        virtual void apply(osg::Vec2Array& array) { copy2(array); }
+        virtual void apply(osg::Vec3Array& array) { copy3(array); }
+        virtual void apply(osg::Vec4Array& array) { copy4(array); }
+        virtual void apply(osg::Vec2dArray& array) { copy2(array); }
+        virtual void apply(osg::Vec3dArray& array) { copy3(array); }
+        virtual void apply(osg::Vec4dArray& array) { copy4(array); }
+
+        std::vector<osg::Vec3d>&    _positions;
+        bool                        _valid;
+
+    protected:
+
+        CopyVertexArrayToPositionsVisitor& operator = (const CopyVertexArrayToPositionsVisitor&) { return *this; }
+};
+
+struct CollectTriangleIndices
+{
+    IndexList* _indices;
+
+    CollectTriangleIndices(): _indices(0) {}
+
+    inline void operator () (unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        _indices->push_back(p1);
+        _indices->push_back(p2);
+        _indices->push_back(p3);
+    }
+};
+
+typedef std::vector<const osg::Array*> ArrayList;
+
+// orders vertex indices by the values of all their per vertex attributes.
+struct VertexLess
+{
+    VertexLess(const ArrayList& arrays): _arrays(arrays) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        for(ArrayList::const_iterator itr = _arrays.begin(); itr != _arrays.end(); ++itr)
+        {
+            int result = (*itr)->compare(lhs, rhs);
+            if (result!=0) return result<0;
+        }
+        return lhs<rhs;
+    }
+
+    bool equal(unsigned int lhs, unsigned int rhs) const
+    {
+        for(ArrayList::const_iterator itr = _arrays.begin(); itr != _arrays.end(); ++itr)
+        {
+            if ((*itr)->compare(lhs, rhs)!=0) return false;
+        }
+        return true;
+    }
+
+    const ArrayList& _arrays;
+
+protected:
+
+    VertexLess& operator = (const VertexLess&) { return *this; }
+};
+
+enum VertexFlags
+{
+    VERTEX_LOCKED = 0x1,    // on the boundary of the mesh or protected, can only be kept
+    VERTEX_FROZEN = 0x2,    // shared between partitions, can neither be kept nor removed
+    VERTEX_REMOVED = 0x4
+};
+
+// The mesh held in flat arrays indexed by the original vertex indices.
+// Triangles hold the current vertex of each of their corners, and the
+// triangles of a vertex are found through the compressed sparse row
+// adjacency of the original vertices merged into it, which form a
+// circular list through chain.
+struct QuadricMesh
+{
+    std::vector<osg::Vec3d>     positions;
+    std::vector<Quadric>        quadrics;
+    IndexList                   triangles;
+    std::vector<unsigned char>  triangleAlive;
+    IndexList                   offsets;
+    IndexList                   vertexTriangles;
+    IndexList                   chain;
+    IndexList                   versions;
+    std::vector<unsigned char>  flags;
+};
+
+struct Collapse
+{
+    float           error;
+    unsigned int    remove;
+    unsigned int    keep;
+    unsigned int    removeVersion;
+    unsigned int    keepVersion;
+
+    // reversed so that the std heap functions keep the smallest error at the front.
+    bool operator < (const Collapse& rhs) const { return error > rhs.error; }
+};
+
+struct GlobalContinue
+{
+    GlobalContinue(const Simplifier& simplifier, unsigned int numOriginalPrimitives):
+        _simplifier(simplifier),
+        _numOriginalPrimitives(numOriginalPrimitives) {}
+
+    bool operator() (float error, unsigned int numRemainingPrimitives) const
+    {
+        return _simplifier.continueSimplification(error, _numOriginalPrimitives, numRemainingPrimitives);
+    }
+
+    const Simplifier&   _simplifier;
+    unsigned int        _numOriginalPrimitives;
+
+protected:
+
+    GlobalContinue& operator = (const GlobalContinue&) { return *this; }
+};
+
+struct PartitionContinue
+{
+    PartitionContinue(float maximumError, float targetNumPrimitives):
+        _maximumError(maximumError),
+        _targetNumPrimitives(targetNumPrimitives) {}
+
+    bool operator() (float error, unsigned int numRemainingPrimitives) const
+    {
+        return error<=_maximumError && static_cast<float>(numRemainingPrimitives)>_targetNumPrimitives;
+    }
+
+    float _maximumError;
+    float _targetNumPrimitives;
+};
+
+// Collapses the edges of a set of triangles of a QuadricMesh in order of
+// quadric error. Stale heap entries are detected through the versions of
+// their vertices and discarded when they reach the front of the heap.
+class QuadricCollapser
+{
+public:
+
+    QuadricCollapser(QuadricMesh& mesh):
+        _mesh(mesh),
+        _numRemaining(0) {}
+
+    unsigned int getNumRemaining() const { return _numRemaining; }
+
+    void init(const IndexList& triangleIds)
+    {
+        typedef std::pair<unsigned int, unsigned int> Edge;
+        std::vector<Edge> edges;
+        edges.reserve(triangleIds.size()*3);
+
+        _numRemaining = 0;
+        for(IndexList::const_iterator itr = triangleIds.begin(); itr != triangleIds.end(); ++itr)
+        {
+            if (!_mesh.triangleAlive[*itr]) continue;
+            ++_numRemaining;
+
+            const unsigned int* corners = &_mesh.triangles[(*itr)*3];
+            for(unsigned int c=0; c<3; ++c)
+            {
+                unsigned int a = corners[c], b = corners[(c+1)%3];
+                edges.push_back(a<b ? Edge(a,b) : Edge(b,a));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        _heap.clear();
+        for(std::vector<Edge>::iterator itr = edges.begin(); itr != edges.end(); ++itr)
+        {
+            addCollapse(itr->first, itr->second);
+        }
+        std::make_heap(_heap.begin(), _heap.end());
+    }
+
+    template<class C>
+    void run(const C& shouldContinue)
+    {
+        while(!_heap.empty())
+        {
+            Collapse collapse = _heap.front();
+            if (!isCurrent(collapse))
+            {
+                std::pop_heap(_heap.begin(), _heap.end());
+                _heap.pop_back();
+                continue;
+            }
+
+            if (!shouldContinue(collapse.error, _numRemaining)) break;
+
+            std::pop_heap(_heap.begin(), _heap.end());
+            _heap.pop_back();
+
+            if (canCollapse(collapse.remove, collapse.keep)) collapseEdge(collapse.remove, collapse.keep);
+        }
+    }
+
+protected:
+
+    QuadricCollapser& operator = (const QuadricCollapser&) { return *this; }
+
+    bool isCurrent(const Collapse& collapse) const
+    {
+        return _mesh.versions[collapse.remove]==collapse.removeVersion &&
+               _mesh.versions[collapse.keep]==collapse.keepVersion &&
+               (_mesh.flags[collapse.remove] & VERTEX_REMOVED)==0 &&
+               (_mesh.flags[collapse.keep] & VERTEX_REMOVED)==0;
+    }
+
+    bool isRemovable(unsigned int remove, unsigned int keep) const
+    {
+        return (_mesh.flags[remove] & (VERTEX_LOCKED|VERTEX_FROZEN|VERTEX_REMOVED))==0 &&
+               (_mesh.flags[keep] & (VERTEX_FROZEN|VERTEX_REMOVED))==0;
+    }
+
+    // push the cheaper of the allowed directions of the edge onto the heap.
+    void addCollapse(unsigned int a, unsigned int b)
+    {
+        bool removeA = isRemovable(a, b);
+        bool removeB = isRemovable(b, a);
+        if (!removeA && !removeB) return;
+
+        float errorA = removeA ? computeError(_mesh.quadrics[a], _mesh.quadrics[b], _mesh.positions[b]) : FLT_MAX;
+        float errorB = removeB ? computeError(_mesh.quadrics[a], _mesh.quadrics[b], _mesh.positions[a]) : FLT_MAX;
+
+        Collapse collapse;
+        if (removeA && (!removeB || errorA<=errorB))
+        {
+            collapse.error = errorA;
+            collapse.remove = a;
+            collapse.keep = b;
+        }
+        else
+        {
+            collapse.error = errorB;
+            collapse.remove = b;
+            collapse.keep = a;
+        }
+        collapse.removeVersion = _mesh.versions[collapse.remove];
+        collapse.keepVersion = _mesh.versions[collapse.keep];
+        _heap.push_back(collapse);
+    }
+
+    void gatherTriangles(unsigned int v, IndexList& result) const
+    {
+        result.clear();
+        unsigned int m = v;
+        do
+        {
+            for(unsigned int i = _mesh.offsets[m]; i < _mesh.offsets[m+1]; ++i)
+            {
+                unsigned int t = _mesh.vertexTriangles[i];
+                if (_mesh.triangleAlive[t]) result.push_back(t);
+            }
+            m = _mesh.chain[m];
+        } while(m!=v);
+    }
+
+    void gatherNeighbours(unsigned int v, const IndexList& triangleIds, IndexList& result) const
+    {
+        result.clear();
+        for(IndexList::const_iterator itr = triangleIds.begin(); itr != triangleIds.end(); ++itr)
+        {
+            const unsigned int* corners = &_mesh.triangles[(*itr)*3];
+            for(unsigned int c=0; c<3; ++c)
+            {
+                if (corners[c]!=v) result.push_back(corners[c]);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+
+    bool contains(unsigned int t, unsigned int v) const
+    {
+        const unsigned int* corners = &_mesh.triangles[t*3];
+        return corners[0]==v || corners[1]==v || corners[2]==v;
+    }
+
+    // check that collapsing remove into keep leaves a manifold mesh, the
+    // link condition, and that none of the remaining triangles flip over.
+    bool canCollapse(unsigned int remove, unsigned int keep)
+    {
+        gatherTriangles(remove, _removeTriangles);
+
+        unsigned int numShared = 0;
+        for(IndexList::const_iterator itr = _removeTriangles.begin(); itr != _removeTriangles.end(); ++itr)
+        {
+            if (contains(*itr, keep)) ++numShared;
+        }
+        if (numShared==0) return false;
+
+        gatherTriangles(keep, _keepTriangles);
+        gatherNeighbours(remove, _removeTriangles, _removeNeighbours);
+        gatherNeighbours(keep, _keepTriangles, _keepNeighbours);
+
+        unsigned int numCommon = 0;
+        IndexList::const_iterator ritr = _removeNeighbours.begin();
+        IndexList::const_iterator kitr = _keepNeighbours.begin();
+        while(ritr != _removeNeighbours.end() && kitr != _keepNeighbours.end())
+        {
+            if (*ritr<*kitr) ++ritr;
+            else if (*kitr<*ritr) ++kitr;
+            else { ++numCommon; ++ritr; ++kitr; }
+        }
+        if (numCommon!=numShared) return false;
+
+        const osg::Vec3d& keepPosition = _mesh.positions[keep];
+        for(IndexList::const_iterator itr = _removeTriangles.begin(); itr != _removeTriangles.end(); ++itr)
+        {
+            if (contains(*itr, keep)) continue;
+
+            const unsigned int* corners = &_mesh.triangles[(*itr)*3];
+            const osg::Vec3d& p0 = _mesh.positions[corners[0]];
+            const osg::Vec3d& p1 = _mesh.positions[corners[1]];
+            const osg::Vec3d& p2 = _mesh.positions[corners[2]];
+            osg::Vec3d before = (p1-p0)^(p2-p0);
+
+            const osg::Vec3d& q0 = corners[0]==remove ? keepPosition : p0;
+            const osg::Vec3d& q1 = corners[1]==remove ? keepPosition : p1;
+            const osg::Vec3d& q2 = corners[2]==remove ? keepPosition : p2;
+            osg::Vec3d after = (q1-q0)^(q2-q0);
+
+            if (before*after<=0.0) return false;
+        }
+
+        return true;
+    }
+
+    // collapse remove into keep, relies on _removeTriangles from canCollapse().
+    void collapseEdge(unsigned int remove, unsigned int keep)
+    {
+        for(IndexList::const_iterator itr = _removeTriangles.begin(); itr != _removeTriangles.end(); ++itr)
+        {
+            unsigned int* corners = &_mesh.triangles[(*itr)*3];
+            if (corners[0]==keep || corners[1]==keep || corners[2]==keep)
+            {
+                _mesh.triangleAlive[*itr] = 0;
+                --_numRemaining;
+            }
+            else
+            {
+                for(unsigned int c=0; c<3; ++c)
+                {
+                    if (corners[c]==remove) corners[c] = keep;
+                }
+            }
+        }
+
+        _mesh.quadrics[keep] += _mesh.quadrics[remove];
+        std::swap(_mesh.chain[remove], _mesh.chain[keep]);
+        _mesh.flags[remove] |= VERTEX_REMOVED;
+        ++_mesh.versions[remove];
+        ++_mesh.versions[keep];
+
+        gatherTriangles(keep, _keepTriangles);
+        gatherNeighbours(keep, _keepTriangles, _keepNeighbours);
+        for(IndexList::const_iterator itr = _keepNeighbours.begin(); itr != _keepNeighbours.end(); ++itr)
+        {
+            std::size_t size = _heap.size();
+            addCollapse(keep, *itr);
+            if (_heap.size()!=size) std::push_heap(_heap.begin(), _heap.end());
+        }
+    }
+
+    QuadricMesh&            _mesh;
+    unsigned int            _numRemaining;
+    std::vector<Collapse>   _heap;
+
+    IndexList               _removeTriangles;
+    IndexList               _keepTriangles;
+    IndexList               _removeNeighbours;
+    IndexList               _keepNeighbours;
+};
+
+struct CentroidLess
+{
+    CentroidLess(const std::vector<osg::Vec3d>& centroids, unsigned int axis): _centroids(centroids), _axis(axis) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const { return _centroids[lhs][_axis] < _centroids[rhs][_axis]; }
+
+    const std::vector<osg::Vec3d>&  _centroids;
+    unsigned int                    _axis;
+
+protected:
+
+    CentroidLess& operator = (const CentroidLess&) { return *this; }
+};
+
+// split the triangles at the median of the longest axis of their centroids until there are at most partitionSize in each partition.
+void partitionTriangles(IndexList::iterator begin, IndexList::iterator end, const std::vector<osg::Vec3d>& centroids, unsigned int partitionSize, std::vector<IndexList>& partitions)
+{
+    if (static_cast<unsigned int>(end-begin)<=partitionSize)
+    {
+        partitions.push_back(IndexList(begin, end));
+        return;
+    }
+
+    osg::BoundingBoxd bb;
+    for(IndexList::iterator itr = begin; itr != end; ++itr) bb.expandBy(centroids[*itr]);
+
+    osg::Vec3d size = bb._max-bb._min;
+    unsigned int axis = size.x()>=size.y() ? (size.x()>=size.z() ? 0 : 2) : (size.y()>=size.z() ? 1 : 2);
+
+    IndexList::iterator middle = begin + (end-begin)/2;
+    std::nth_element(begin, middle, end, CentroidLess(centroids, axis));
+
+    partitionTriangles(begin, middle, centroids, partitionSize, partitions);
+    partitionTriangles(middle, end, centroids, partitionSize, partitions);
+}
+
+void simplifyPartition(QuadricMesh& mesh, const IndexList& partition, float maximumError, float sampleRatio)
+{
+    unsigned int numBorderTriangles = 0;
+    for(IndexList::const_iterator itr = partition.begin(); itr != partition.end(); ++itr)
+    {
+        const unsigned int* corners = &mesh.triangles[(*itr)*3];
+        if ((mesh.flags[corners[0]] | mesh.flags[corners[1]] | mesh.flags[corners[2]]) & VERTEX_FROZEN) ++numBorderTriangles;
+    }
+
+    // the triangles on the border can't be removed until the final pass, so don't ask the rest of the partition to make up for them.
+    float target = sampleRatio*static_cast<float>(partition.size()) + (1.0f-sampleRatio)*static_cast<float>(numBorderTriangles);
+
+    QuadricCollapser collapser(mesh);
+    collapser.init(partition);
+    collapser.run(PartitionContinue(maximumError, target));
+}
+
+struct SimplifyPartitionsOperation : public osg::Operation
+{
+    SimplifyPartitionsOperation(QuadricMesh& mesh, const std::vector<IndexList>& partitions, float maximumError, float sampleRatio, OpenThreads::Atomic& numPartitionsTaken, osg::RefBlockCount* blockCount):
+        osg::Referenced(true),
+        osg::Operation("SimplifyPartitions", false),
+        _mesh(mesh),
+        _partitions(partitions),
+        _maximumError(maximumError),
+        _sampleRatio(sampleRatio),
+        _numPartitionsTaken(numPartitionsTaken),
+        _blockCount(blockCount) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        // the partitions only share frozen vertices, which are neither read nor written by the collapses.
+        for(unsigned int i = (++_numPartitionsTaken)-1; i<_partitions.size(); i = (++_numPartitionsTaken)-1)
+        {
+            simplifyPartition(_mesh, _partitions[i], _maximumError, _sampleRatio);
+        }
+
+        _blockCount->completed();
+    }
+
+    QuadricMesh&                        _mesh;
+    const std::vector<IndexList>&       _partitions;
+    float                               _maximumError;
+    float                               _sampleRatio;
+    OpenThreads::Atomic&                _numPartitionsTaken;
+    osg::ref_ptr<osg::RefBlockCount>    _blockCount;
+
+protected:
+
+    SimplifyPartitionsOperation& operator = (const SimplifyPartitionsOperation&) { return *this; }
+};
+
+void simplifyPartitions(QuadricMesh& mesh, unsigned int numTriangles, unsigned int partitionSize, float maximumError, float sampleRatio)
+{
+    std::vector<osg::Vec3d> centroids(numTriangles);
+    IndexList triangleIds(numTriangles);
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        const unsigned int* corners = &mesh.triangles[t*3];
+        centroids[t] = (mesh.positions[corners[0]]+mesh.positions[corners[1]]+mesh.positions[corners[2]])/3.0;
+        triangleIds[t] = t;
+    }
+
+    std::vector<IndexList> partitions;
+    partitionTriangles(triangleIds.begin(), triangleIds.end(), centroids, partitionSize, partitions);
+
+    // freeze the vertices used by more than one partition.
+    const unsigned int unassigned = 0xffffffff;
+    IndexList vertexPartition(mesh.positions.size(), unassigned);
+    for(unsigned int p=0; p<partitions.size(); ++p)
+    {
+        for(IndexList::const_iterator itr = partitions[p].begin(); itr != partitions[p].end(); ++itr)
+        {
+            for(unsigned int c=0; c<3; ++c)
+            {
+                unsigned int v = mesh.triangles[(*itr)*3+c];
+                if (vertexPartition[v]==unassigned) vertexPartition[v] = p;
+                else if (vertexPartition[v]!=p) mesh.flags[v] |= VERTEX_FROZEN;
+            }
+        }
+    }
+
+    osg::OperationThreadPool* threadPool = osg::OperationThreadPool::instance().get();
+    unsigned int numOperations = osg::minimum(threadPool->getNumThreads()+1, static_cast<unsigned int>(partitions.size()));
+
+    OpenThreads::Atomic numPartitionsTaken;
+    osg::ref_ptr<osg::RefBlockCount> blockCount = new osg::RefBlockCount(numOperations);
+    blockCount->reset();
+
+    for(unsigned int i=0; i<numOperations; ++i)
+    {
+        threadPool->add(new SimplifyPartitionsOperation(mesh, partitions, maximumError, sampleRatio, numPartitionsTaken, blockCount.get()));
+    }
+
+    threadPool->runOperationsUntilCompleted(blockCount.get());
+
+    for(std::vector<unsigned char>::iterator itr = mesh.flags.begin(); itr != mesh.flags.end(); ++itr)
+    {
+        *itr &= ~VERTEX_FROZEN;
+    }
+
+    OSG_INFO<<"Simplifier: simplified "<<partitions.size()<<" partitions on "<<numOperations<<" threads"<<std::endl;
+}
+
+void collectPerVertexArrays(osg::Geometry& geometry, std::vector<osg::Array*>& arrays)
+{
+    arrays.push_back(geometry.getVertexArray());
+
+    for(unsigned int ti=0;ti<geometry.getNumTexCoordArrays();++ti)
+    {
+        if (geometry.getTexCoordArray(ti)) arrays.push_back(geometry.getTexCoordArray(ti));
+    }
+
+    if (geometry.getNormalArray() && geometry.getNormalArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        arrays.push_back(geometry.getNormalArray());
+
+    if (geometry.getColorArray() && geometry.getColorArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        arrays.push_back(geometry.getColorArray());
+
+    if (geometry.getSecondaryColorArray() && geometry.getSecondaryColorArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        arrays.push_back(geometry.getSecondaryColorArray());
+
+    if (geometry.getFogCoordArray() && geometry.getFogCoordArray()->getBinding()==osg::Array::BIND_PER_VERTEX)
+        arrays.push_back(geometry.getFogCoordArray());
+
+    for(unsigned int vi=0;vi<geometry.getNumVertexAttribArrays();++vi)
+    {
+        if (geometry.getVertexAttribArray(vi) && geometry.getVertexAttribArray(vi)->getBinding()==osg::Array::BIND_PER_VERTEX)
+            arrays.push_back(geometry.getVertexAttribArray(vi));
+    }
+}
+
+// Down sample the geometry with the quadric error metric engine, returns
+// false, leaving the geometry untouched, if its arrays can't be handled.
+bool simplifyUsingQuadrics(const Simplifier& simplifier, osg::Geometry& geometry, const IndexList& protectedPoints, unsigned int partitionSize)
+{
+    if (!geometry.getVertexArray()) return false;
+
+    QuadricMesh mesh;
+    CopyVertexArrayToPositionsVisitor copyVertexArrayToPositions(mesh.positions);
+    geometry.getVertexArray()->accept(copyVertexArrayToPositions);
+    if (!copyVertexArrayToPositions._valid) return false;
+
+    if (geometry.containsSharedArrays())
+    {
+        OSG_INFO<<"Simplifier::simplify(..): Duplicate shared arrays"<<std::endl;
+        geometry.duplicateSharedArrays();
+    }
+
+    unsigned int numVertices = static_cast<unsigned int>(mesh.positions.size());
+
+    std::vector<osg::Array*> arrays;
+    collectPerVertexArrays(geometry, arrays);
+    for(std::vector<osg::Array*>::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        if ((*itr)->getNumElements()<numVertices) return false;
+    }
+
+    // weld the vertices with identical attributes, so that the triangles
+    // of a mesh drawn with separate arrays still connect up.
+    IndexList canonical(numVertices);
+    {
+        ArrayList constArrays(arrays.begin(), arrays.end());
+        VertexLess vertexLess(constArrays);
+
+        IndexList order(numVertices);
+        for(unsigned int i=0; i<numVertices; ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), vertexLess);
+
+        for(unsigned int i=0; i<numVertices; )
+        {
+            unsigned int j = i+1;
+            while(j<numVertices && vertexLess.equal(order[i], order[j])) ++j;
+            for(unsigned int k=i; k<j; ++k) canonical[order[k]] = order[i];
+            i = j;
+        }
+    }
+
+    osg::TriangleIndexFunctor<CollectTriangleIndices> collectTriangles;
+    IndexList indices;
+    collectTriangles._indices = &indices;
+    geometry.accept(collectTriangles);
+
+    mesh.triangles.reserve(indices.size());
+    for(IndexList::const_iterator itr = indices.begin(); itr != indices.end(); itr += 3)
+    {
+        if (*itr>=numVertices || *(itr+1)>=numVertices || *(itr+2)>=numVertices) continue;
+
+        unsigned int a = canonical[*itr], b = canonical[*(itr+1)], c = canonical[*(itr+2)];
+        if (a==b || b==c || c==a) continue;
+
+        mesh.triangles.push_back(a);
+        mesh.triangles.push_back(b);
+        mesh.triangles.push_back(c);
+    }
+
+    unsigned int numTriangles = static_cast<unsigned int>(mesh.triangles.size()/3);
+    if (numTriangles==0) return false;
+
+    mesh.triangleAlive.assign(numTriangles, 1);
+    mesh.quadrics.resize(numVertices);
+    mesh.versions.assign(numVertices, 0);
+    mesh.flags.assign(numVertices, 0);
+    mesh.chain.resize(numVertices);
+    for(unsigned int v=0; v<numVertices; ++v) mesh.chain[v] = v;
+
+    // vertex to triangle adjacency.
+    mesh.offsets.assign(numVertices+1, 0);
+    for(IndexList::const_iterator itr = mesh.triangles.begin(); itr != mesh.triangles.end(); ++itr) ++mesh.offsets[*itr+1];
+    for(unsigned int v=0; v<numVertices; ++v) mesh.offsets[v+1] += mesh.offsets[v];
+    mesh.vertexTriangles.resize(mesh.triangles.size());
+    {
+        IndexList fill(mesh.offsets.begin(), mesh.offsets.end()-1);
+        for(unsigned int i=0; i<mesh.triangles.size(); ++i) mesh.vertexTriangles[fill[mesh.triangles[i]]++] = i/3;
+    }
+
+    // accumulate the area weighted plane of each triangle into its vertices.
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        const unsigned int* corners = &mesh.triangles[t*3];
+        const osg::Vec3d& p0 = mesh.positions[corners[0]];
+        osg::Vec3d normal = (mesh.positions[corners[1]]-p0)^(mesh.positions[corners[2]]-p0);
+        double length = normal.length();
+        if (length<=0.0) continue;
+
+        normal /= length;
+        Quadric quadric(normal, -(normal*p0), 0.5*length);
+        for(unsigned int c=0; c<3; ++c) mesh.quadrics[corners[c]] += quadric;
+    }
+
+    // lock the vertices on the boundary, or on non manifold edges, of the mesh.
+    {
+        typedef std::pair<unsigned int, unsigned int> Edge;
+        std::vector<Edge> edges;
+        edges.reserve(mesh.triangles.size());
+        for(unsigned int t=0; t<numTriangles; ++t)
+        {
+            const unsigned int* corners = &mesh.triangles[t*3];
+            for(unsigned int c=0; c<3; ++c)
+            {
+                unsigned int a = corners[c], b = corners[(c+1)%3];
+                edges.push_back(a<b ? Edge(a,b) : Edge(b,a));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for(std::vector<Edge>::iterator itr = edges.begin(); itr != edges.end(); )
+        {
+            std::vector<Edge>::iterator next = itr+1;
+            while(next != edges.end() && *next==*itr) ++next;
+            if (next-itr!=2)
+            {
+                mesh.flags[itr->first] |= VERTEX_LOCKED;
+                mesh.flags[itr->second] |= VERTEX_LOCKED;
+            }
+            itr = next;
+        }
+    }
+
+    for(IndexList::const_iterator itr = protectedPoints.begin(); itr != protectedPoints.end(); ++itr)
+    {
+        if (*itr<numVertices) mesh.flags[canonical[*itr]] |= VERTEX_LOCKED;
+    }
+
+    if (partitionSize>0 && numTriangles>2*partitionSize && !simplifier.getContinueSimplificationCallback())
+    {
+        simplifyPartitions(mesh, numTriangles, partitionSize, simplifier.getMaximumError(), simplifier.getSampleRatio());
+    }
+
+    IndexList triangleIds(numTriangles);
+    for(unsigned int t=0; t<numTriangles; ++t) triangleIds[t] = t;
+
+    QuadricCollapser collapser(mesh);
+    collapser.init(triangleIds);
+    collapser.run(GlobalContinue(simplifier, numTriangles));
+
+    OSG_INFO<<"Simplifier, in = "<<numTriangles<<"\tout = "<<collapser.getNumRemaining()<<std::endl;
+
+    // compact the per vertex arrays down to the vertices still in use, which keep their original order.
+    const unsigned int unused = 0xffffffff;
+    IndexList remap(numVertices, unused);
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        if (!mesh.triangleAlive[t]) continue;
+        for(unsigned int c=0; c<3; ++c) remap[mesh.triangles[t*3+c]] = 0;
+    }
+
+    IndexList used;
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        if (remap[v]!=unused)
+        {
+            remap[v] = static_cast<unsigned int>(used.size());
+            used.push_back(v);
+        }
+    }
+
+    for(std::vector<osg::Array*>::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        osg::Array* array = *itr;
+        unsigned int elementSize = array->getElementSize();
+        unsigned char* data = static_cast<unsigned char*>(const_cast<GLvoid*>(array->getDataPointer()));
+        for(unsigned int i=0; i<used.size(); ++i)
+        {
+            if (used[i]!=i) memcpy(data+i*elementSize, data+used[i]*elementSize, elementSize);
+        }
+        array->resizeArray(static_cast<unsigned int>(used.size()));
+        array->dirty();
+    }
+
+    osg::DrawElementsUInt* primitives = new osg::DrawElementsUInt(GL_TRIANGLES);
+    primitives->reserve(collapser.getNumRemaining()*3);
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        if (!mesh.triangleAlive[t]) continue;
+        for(unsigned int c=0; c<3; ++c) primitives->push_back(remap[mesh.triangles[t*3+c]]);
+    }
+
+    geometry.getPrimitiveSetList().clear();
+    geometry.addPrimitiveSet(primitives);
+    geometry.dirtyBound();
+
+    return true;
+}
+
+}
+
 Simplifier::Simplifier(double sampleRatio, double maximumError, double maximumLength):
             osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
             _sampleRatio(sampleRatio),
             _maximumError(maximumError),
             _maximumLength(maximumLength),
             _triStrip(true),
-            _smoothing(true)
+            _smoothing(true),
+            _useQuadricErrorMetric(true),
+            _partitionSize(65536)
 
 {
 }
@@ -1747,6 +2584,21 @@ void Simplifier::simplify(osg::Geometry& geometry, const IndexList& protectedPoi
 
     bool downSample = requiresDownSampling();
 
+    if (downSample && _useQuadricErrorMetric && simplifyUsingQuadrics(*this, geometry, protectedPoints, _partitionSize))
+    {
+        if (_smoothing)
+        {
+            osgUtil::SmoothingVisitor::smooth(geometry);
+        }
+
+        if (_triStrip)
+        {
+            osgUtil::TriStripVisitor stripper;
+            stripper.stripify(geometry);
+        }
+        return;
+    }
+
     EdgeCollapse ec;
     ec.setComputeErrorMetricUsingLength(!downSample);
     ec.setGeometry(&geometry, protectedPoints);
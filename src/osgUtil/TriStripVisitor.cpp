@@ -618,15 +618,9 @@ void TriStripVisitor::mergeTriangleStrips(osg::Geometry::PrimitiveSetList& primi
 
 void TriStripVisitor::stripify()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        stripify(*(*itr));
-
-        // osgUtil::SmoothingVisitor sv;
-        // sv.smooth(*(*itr));
-    }
+    ObjectList geometries(_geometryList.begin(), _geometryList.end());
+    GeometryProcessor<TriStripVisitor, &TriStripVisitor::stripify> processor(*this);
+    processObjects(geometries, processor);
 }
 
 void TriStripVisitor::apply(Geometry& geom)
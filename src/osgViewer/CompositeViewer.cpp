@@ -627,6 +627,8 @@ void CompositeViewer::realize()
     // attach contexts to _incrementalCompileOperation if attached.
     if (_incrementalCompileOperation) _incrementalCompileOperation->assignContexts(contexts);
 
+    assignViewerStats();
+
     bool grabFocus = true;
     if (grabFocus)
     {
@@ -1304,6 +1306,11 @@ void CompositeViewer::updateTraversal()
     osgDB::Registry::instance()->updateTimeStampOfObjectsInCacheWithExternalReferences(*getFrameStamp());
     osgDB::Registry::instance()->removeExpiredObjectsInCache(*getFrameStamp());
 
+    if (getViewerStats() && getViewerStats()->collectStats("paging") && osgDB::Registry::instance()->getObjectCache())
+    {
+        osgDB::Registry::instance()->getObjectCache()->reportStats(getViewerStats(), getFrameStamp()->getFrameNumber());
+    }
+
 
     if (_incrementalCompileOperation.valid())
     {
@@ -35,6 +35,38 @@ using namespace osgViewer;
 //#define DEBUG_MESSAGE OSG_NOTICE
 #define DEBUG_MESSAGE OSG_DEBUG
 
+namespace
+{
+
+// interned keys of the attributes set every frame, so the cull and draw threads don't look up the names each time.
+struct RendererStatsKeys
+{
+    RendererStatsKeys():
+        gpuDrawBeginTime(osg::Stats::getAttributeKey("GPU draw begin time")),
+        gpuDrawEndTime(osg::Stats::getAttributeKey("GPU draw end time")),
+        gpuDrawTimeTaken(osg::Stats::getAttributeKey("GPU draw time taken")),
+        cullTraversalBeginTime(osg::Stats::getAttributeKey("Cull traversal begin time")),
+        cullTraversalEndTime(osg::Stats::getAttributeKey("Cull traversal end time")),
+        cullTraversalTimeTaken(osg::Stats::getAttributeKey("Cull traversal time taken")),
+        drawTraversalBeginTime(osg::Stats::getAttributeKey("Draw traversal begin time")),
+        drawTraversalEndTime(osg::Stats::getAttributeKey("Draw traversal end time")),
+        drawTraversalTimeTaken(osg::Stats::getAttributeKey("Draw traversal time taken")) {}
+
+    osg::Stats::AttributeKey gpuDrawBeginTime;
+    osg::Stats::AttributeKey gpuDrawEndTime;
+    osg::Stats::AttributeKey gpuDrawTimeTaken;
+    osg::Stats::AttributeKey cullTraversalBeginTime;
+    osg::Stats::AttributeKey cullTraversalEndTime;
+    osg::Stats::AttributeKey cullTraversalTimeTaken;
+    osg::Stats::AttributeKey drawTraversalBeginTime;
+    osg::Stats::AttributeKey drawTraversalEndTime;
+    osg::Stats::AttributeKey drawTraversalTimeTaken;
+};
+
+static const RendererStatsKeys s_statsKeys;
+
+}
+
 OpenGLQuerySupport::OpenGLQuerySupport():
     _extensions(0)
 {
@@ -85,9 +117,9 @@ void EXTQuerySupport::checkQuery(osg::Stats* stats, osg::State* /*state*/,
             double estimatedEndTime = (_previousQueryTime + currentTime) * 0.5;
             double estimatedBeginTime = estimatedEndTime - timeElapsedSeconds;
 
-            stats->setAttribute(itr->second, "GPU draw begin time", estimatedBeginTime);
-            stats->setAttribute(itr->second, "GPU draw end time", estimatedEndTime);
-            stats->setAttribute(itr->second, "GPU draw time taken", timeElapsedSeconds);
+            stats->setAttribute(itr->second, s_statsKeys.gpuDrawBeginTime, estimatedBeginTime);
+            stats->setAttribute(itr->second, s_statsKeys.gpuDrawEndTime, estimatedEndTime);
+            stats->setAttribute(itr->second, s_statsKeys.gpuDrawTimeTaken, timeElapsedSeconds);
 
 
             itr = _queryFrameNumberList.erase(itr);
@@ -269,10 +301,10 @@ void ARBQuerySupport::checkQuery(osg::Stats* stats, osg::State* state,
             else
                 endTime = gpuTick
                     - double(gpuTimestamp - endTimestamp) * 1e-9;
-            stats->setAttribute(itr->frameNumber, "GPU draw begin time",
+            stats->setAttribute(itr->frameNumber, s_statsKeys.gpuDrawBeginTime,
                                 beginTime);
-            stats->setAttribute(itr->frameNumber, "GPU draw end time", endTime);
-            stats->setAttribute(itr->frameNumber, "GPU draw time taken",
+            stats->setAttribute(itr->frameNumber, s_statsKeys.gpuDrawEndTime, endTime);
+            stats->setAttribute(itr->frameNumber, s_statsKeys.gpuDrawTimeTaken,
                                 timeElapsedSeconds);
             itr = _queryFrameList.erase(itr);
             _availableQueryObjects.push_back(queries);
@@ -672,9 +704,9 @@ void Renderer::cull()
         {
             DEBUG_MESSAGE<<"Collecting rendering stats"<<std::endl;
 
-            stats->setAttribute(frameNumber, "Cull traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
-            stats->setAttribute(frameNumber, "Cull traversal end time", osg::Timer::instance()->delta_s(_startTick, afterCullTick));
-            stats->setAttribute(frameNumber, "Cull traversal time taken", osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+            stats->setAttribute(frameNumber, s_statsKeys.cullTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
+            stats->setAttribute(frameNumber, s_statsKeys.cullTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterCullTick));
+            stats->setAttribute(frameNumber, s_statsKeys.cullTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
         }
 
         if (stats && stats->collectStats("scene"))
@@ -790,9 +822,9 @@ void Renderer::draw()
 
         if (stats && stats->collectStats("rendering"))
         {
-            stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
-            stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
-            stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+            stats->setAttribute(frameNumber, s_statsKeys.drawTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
+            stats->setAttribute(frameNumber, s_statsKeys.drawTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
+            stats->setAttribute(frameNumber, s_statsKeys.drawTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
         }
 
         sceneView->clearReferencesToDependentCameras();
@@ -900,13 +932,13 @@ void Renderer::cull_draw()
     {
         DEBUG_MESSAGE<<"Collecting rendering stats"<<std::endl;
 
-        stats->setAttribute(frameNumber, "Cull traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
-        stats->setAttribute(frameNumber, "Cull traversal end time", osg::Timer::instance()->delta_s(_startTick, afterCullTick));
-        stats->setAttribute(frameNumber, "Cull traversal time taken", osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+        stats->setAttribute(frameNumber, s_statsKeys.cullTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
+        stats->setAttribute(frameNumber, s_statsKeys.cullTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterCullTick));
+        stats->setAttribute(frameNumber, s_statsKeys.cullTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
 
-        stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
-        stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
-        stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+        stats->setAttribute(frameNumber, s_statsKeys.drawTraversalBeginTime, osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
+        stats->setAttribute(frameNumber, s_statsKeys.drawTraversalEndTime, osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
+        stats->setAttribute(frameNumber, s_statsKeys.drawTraversalTimeTaken, osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
     }
 
     DEBUG_MESSAGE<<"end cull_draw() "<<this<<std::endl;
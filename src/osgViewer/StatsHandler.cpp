@@ -13,7 +13,9 @@
 
 #include <sstream>
 #include <iomanip>
+#include <fstream>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <osg/io_utils>
 
@@ -24,6 +26,11 @@
 
 #include <osg/PolygonMode>
 #include <osg/Geometry>
+#include <osg/ApplicationUsage>
+
+#include <osgDB/fstream>
+
+static osg::ApplicationUsageProxy StatsHandler_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_STATS_TRACE_FILE <filename>","File the StatsHandler writes the stats timeline to, in Chrome trace event format, defaults to osgstats_trace.json.");
 
 namespace osgViewer
 {
@@ -32,6 +39,7 @@ namespace osgViewer
 StatsHandler::StatsHandler():
     _keyEventTogglesOnScreenStats('s'),
     _keyEventPrintsOutStats('S'),
+    _keyEventWritesOutTrace('T'),
     _statsType(NO_STATS),
     _initialized(false),
     _threadingModel(ViewerBase::SingleThreaded),
@@ -104,6 +112,8 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                             viewer->getViewerStats()->collectStats("frame_rate",false);
                             viewer->getViewerStats()->collectStats("event",false);
                             viewer->getViewerStats()->collectStats("update",false);
+                            viewer->getViewerStats()->collectStats("paging",false);
+                            viewer->getViewerStats()->collectStats("compile",false);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -150,6 +160,8 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
 
                             viewer->getViewerStats()->collectStats("event",true);
                             viewer->getViewerStats()->collectStats("update",true);
+                            viewer->getViewerStats()->collectStats("paging",true);
+                            viewer->getViewerStats()->collectStats("compile",true);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -240,6 +252,38 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                 }
                 return true;
             }
+            if (ea.getKey()==_keyEventWritesOutTrace)
+            {
+                if (viewer && viewer->getViewerStats())
+                {
+                    osg::Stats::StatsList statsList;
+                    statsList.push_back(viewer->getViewerStats());
+
+                    osgViewer::ViewerBase::Cameras cameras;
+                    collectWhichCamerasToRenderStatsFor(viewer, cameras);
+                    for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
+                        itr != cameras.end();
+                        ++itr)
+                    {
+                        if ((*itr)->getStats()) statsList.push_back((*itr)->getStats());
+                    }
+
+                    const char* str = getenv("OSG_STATS_TRACE_FILE");
+                    std::string fileName = str ? str : "osgstats_trace.json";
+
+                    osgDB::ofstream fout(fileName.c_str());
+                    if (fout)
+                    {
+                        osg::Stats::writeTrace(fout, statsList);
+                        OSG_NOTICE<<"Stats trace written to "<<fileName<<std::endl;
+                    }
+                    else
+                    {
+                        OSG_NOTICE<<"Unable to write stats trace to "<<fileName<<std::endl;
+                    }
+                }
+                return true;
+            }
             break;
         }
         case(osgGA::GUIEventAdapter::RESIZE):
@@ -1729,6 +1773,7 @@ void StatsHandler::getUsage(osg::ApplicationUsage& usage) const
 {
     usage.addKeyboardMouseBinding(_keyEventTogglesOnScreenStats,"On screen stats.");
     usage.addKeyboardMouseBinding(_keyEventPrintsOutStats,"Output stats to console.");
+    usage.addKeyboardMouseBinding(_keyEventWritesOutTrace,"Output stats timeline to trace file.");
 }
 
 }
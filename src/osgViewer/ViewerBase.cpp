@@ -681,6 +681,25 @@ void ViewerBase::setIncrementalCompileOperation(osgUtil::IncrementalCompileOpera
 
 
     if (_incrementalCompileOperation) _incrementalCompileOperation->assignContexts(contexts);
+
+    assignViewerStats();
+}
+
+void ViewerBase::assignViewerStats()
+{
+    osg::Stats* stats = getViewerStats();
+
+    Scenes scenes;
+    getScenes(scenes,false);
+    for(Scenes::iterator itr = scenes.begin();
+        itr != scenes.end();
+        ++itr)
+    {
+        osgDB::DatabasePager* dp = (*itr)->getDatabasePager();
+        if (dp) dp->setStats(stats);
+    }
+
+    if (_incrementalCompileOperation) _incrementalCompileOperation->setStats(stats);
 }
 
 int ViewerBase::run()
@@ -56,6 +56,8 @@ USE_SERIALIZER_WRAPPER(LOD)
 USE_SERIALIZER_WRAPPER(LogicOp)
 USE_SERIALIZER_WRAPPER(Material)
 USE_SERIALIZER_WRAPPER(MatrixTransform)
+USE_SERIALIZER_WRAPPER(MeshletGeometry)
+USE_SERIALIZER_WRAPPER(MultiDrawIndirectGeometry)
 USE_SERIALIZER_WRAPPER(Multisample)
 USE_SERIALIZER_WRAPPER(Node)
 USE_SERIALIZER_WRAPPER(NodeCallback)
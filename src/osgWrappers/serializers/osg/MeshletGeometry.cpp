@@ -0,0 +1,74 @@
+#include <osg/MeshletGeometry>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+static void readBound( osgDB::InputStream& is, osg::BoundingSphere& bound )
+{
+    osg::Vec3 center; float radius = 0.0f;
+    is >> center >> radius;
+    bound.set( center, radius );
+}
+
+static void writeBound( osgDB::OutputStream& os, const osg::BoundingSphere& bound )
+{
+    os << osg::Vec3(bound.center()) << static_cast<float>(bound.radius());
+}
+
+// _meshlets
+static bool checkMeshlets( const osg::MeshletGeometry& geom )
+{
+    return geom.getMeshlets().size()>0;
+}
+
+static bool readMeshlets( osgDB::InputStream& is, osg::MeshletGeometry& geom )
+{
+    osg::MeshletGeometry::Meshlets meshlets;
+    unsigned int size = is.readSize(); is >> is.BEGIN_BRACKET;
+    for ( unsigned int i=0; i<size; ++i )
+    {
+        osg::MeshletGeometry::Meshlet meshlet;
+        is >> meshlet.firstIndex >> meshlet.numIndices >> meshlet.numVertices >> meshlet.level;
+        readBound( is, meshlet.bound );
+        is >> meshlet.coneAxis >> meshlet.coneCutoff >> meshlet.error;
+        readBound( is, meshlet.lodBound );
+        is >> meshlet.parentError;
+        readBound( is, meshlet.parentLodBound );
+
+        // the roots' parent error may not survive a round trip through ascii exactly.
+        if ( meshlet.parentError>=FLT_MAX*0.999f ) meshlet.parentError = FLT_MAX;
+        meshlets.push_back( meshlet );
+    }
+    is >> is.END_BRACKET;
+    geom.setMeshlets( meshlets );
+    return true;
+}
+
+static bool writeMeshlets( osgDB::OutputStream& os, const osg::MeshletGeometry& geom )
+{
+    const osg::MeshletGeometry::Meshlets& meshlets = geom.getMeshlets();
+    os.writeSize(meshlets.size()); os << os.BEGIN_BRACKET << std::endl;
+    for ( osg::MeshletGeometry::Meshlets::const_iterator itr=meshlets.begin();
+          itr!=meshlets.end(); ++itr )
+    {
+        os << itr->firstIndex << itr->numIndices << itr->numVertices << itr->level;
+        writeBound( os, itr->bound );
+        os << itr->coneAxis << itr->coneCutoff << itr->error;
+        writeBound( os, itr->lodBound );
+        os << itr->parentError;
+        writeBound( os, itr->parentLodBound );
+        os << std::endl;
+    }
+    os << os.END_BRACKET << std::endl;
+    return true;
+}
+
+REGISTER_OBJECT_WRAPPER( MeshletGeometry,
+                         new osg::MeshletGeometry,
+                         osg::MeshletGeometry,
+                         "osg::Object osg::Drawable osg::Geometry osg::MeshletGeometry" )
+{
+    ADD_FLOAT_SERIALIZER( ErrorThreshold, 1.0f );  // _errorThreshold
+    ADD_BOOL_SERIALIZER( ConeCulling, false );  // _coneCulling
+    ADD_USER_SERIALIZER( Meshlets );  // _meshlets
+}
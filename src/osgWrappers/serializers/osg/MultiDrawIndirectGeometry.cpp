@@ -0,0 +1,83 @@
+#include <osg/MultiDrawIndirectGeometry>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+// _commands
+static bool checkCommands( const osg::MultiDrawIndirectGeometry& geom )
+{
+    return geom.getCommands()->size()>0;
+}
+
+static bool readCommands( osgDB::InputStream& is, osg::MultiDrawIndirectGeometry& geom )
+{
+    osg::DrawElementsIndirectCommandArray& commands = *geom.getCommands();
+    commands.clear();
+
+    unsigned int size = is.readSize(); is >> is.BEGIN_BRACKET;
+    for ( unsigned int i=0; i<size; ++i )
+    {
+        osg::DrawElementsIndirectCommand command;
+        is >> command.count >> command.instanceCount >> command.firstIndex >> command.baseVertex >> command.baseInstance;
+        commands.push_back( command );
+    }
+    is >> is.END_BRACKET;
+    commands.dirty();
+    return true;
+}
+
+static bool writeCommands( osgDB::OutputStream& os, const osg::MultiDrawIndirectGeometry& geom )
+{
+    const osg::DrawElementsIndirectCommandArray& commands = *geom.getCommands();
+    os.writeSize(commands.size()); os << os.BEGIN_BRACKET << std::endl;
+    for ( osg::DrawElementsIndirectCommandArray::const_iterator itr=commands.begin();
+          itr!=commands.end(); ++itr )
+    {
+        os << itr->count << itr->instanceCount << itr->firstIndex << itr->baseVertex << itr->baseInstance << std::endl;
+    }
+    os << os.END_BRACKET << std::endl;
+    return true;
+}
+
+// _drawFirstVertices
+static bool checkDrawFirstVertices( const osg::MultiDrawIndirectGeometry& geom )
+{
+    return geom.getDrawFirstVertices().size()>0;
+}
+
+static bool readDrawFirstVertices( osgDB::InputStream& is, osg::MultiDrawIndirectGeometry& geom )
+{
+    osg::MultiDrawIndirectGeometry::DrawFirstVertices drawFirstVertices;
+    unsigned int size = is.readSize(); is >> is.BEGIN_BRACKET;
+    for ( unsigned int i=0; i<size; ++i )
+    {
+        unsigned int firstVertex = 0; is >> firstVertex;
+        drawFirstVertices.push_back( firstVertex );
+    }
+    is >> is.END_BRACKET;
+    geom.setDrawFirstVertices( drawFirstVertices );
+    return true;
+}
+
+static bool writeDrawFirstVertices( osgDB::OutputStream& os, const osg::MultiDrawIndirectGeometry& geom )
+{
+    const osg::MultiDrawIndirectGeometry::DrawFirstVertices& drawFirstVertices = geom.getDrawFirstVertices();
+    os.writeSize(drawFirstVertices.size()); os << os.BEGIN_BRACKET << std::endl;
+    for ( osg::MultiDrawIndirectGeometry::DrawFirstVertices::const_iterator itr=drawFirstVertices.begin();
+          itr!=drawFirstVertices.end(); ++itr )
+    {
+        os << *itr;
+    }
+    os << std::endl << os.END_BRACKET << std::endl;
+    return true;
+}
+
+REGISTER_OBJECT_WRAPPER( MultiDrawIndirectGeometry,
+                         new osg::MultiDrawIndirectGeometry,
+                         osg::MultiDrawIndirectGeometry,
+                         "osg::Object osg::Drawable osg::Geometry osg::MultiDrawIndirectGeometry" )
+{
+    ADD_UINT_SERIALIZER( DrawIDAttributeIndex, 6 );  // _drawIDAttributeIndex
+    ADD_USER_SERIALIZER( DrawFirstVertices );  // _drawFirstVertices
+    ADD_USER_SERIALIZER( Commands );  // _commands
+}
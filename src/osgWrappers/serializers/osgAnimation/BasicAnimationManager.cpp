@@ -11,6 +11,14 @@ REGISTER_OBJECT_WRAPPER( osgAnimation_BasicAnimationManager,
                          osgAnimation::BasicAnimationManager,
                          "osg::Object osg::NodeCallback osgAnimation::AnimationManagerBase osgAnimation::BasicAnimationManager" )
 {
+    {
+        UPDATE_TO_VERSION_SCOPED( 146 )
+        BEGIN_ENUM_SERIALIZER( EvaluationMode, KEYFRAMES );
+            ADD_ENUM_VALUE( KEYFRAMES );
+            ADD_ENUM_VALUE( BAKED );
+        END_ENUM_SERIALIZER();  // _evaluationMode
+        ADD_DOUBLE_SERIALIZER( BakeSampleRate, 30.0 );  // _bakeSampleRate
+    }
 }
 
 #undef OBJECT_CAST
@@ -41,4 +41,9 @@ REGISTER_OBJECT_WRAPPER( osgTerrain_GeometryTechnique,
     ADD_FLOAT_SERIALIZER( FilterBias, 0.0f );  // _filterBias
     ADD_FLOAT_SERIALIZER( FilterWidth, 0.1f );  // _filterWidth
     ADD_USER_SERIALIZER( FilterMatrix );  // _filterMatrix
+
+    {
+        UPDATE_TO_VERSION_SCOPED( 146 )
+        ADD_BOOL_SERIALIZER( UseGeometryPool, false );  // _useGeometryPool
+    }
 }
@@ -17,4 +17,10 @@ REGISTER_OBJECT_WRAPPER( osgTerrain_Terrain,
         ADD_ENUM_CLASS_VALUE( osgTerrain::TerrainTile, ENABLE_BLENDING );
         ADD_ENUM_CLASS_VALUE( osgTerrain::TerrainTile, ENABLE_BLENDING_WHEN_ALPHA_PRESENT );
     END_ENUM_SERIALIZER();  // BlendingPolicy
+
+    {
+        UPDATE_TO_VERSION_SCOPED( 146 )
+        ADD_BOOL_SERIALIZER( InitializeTilesAsynchronously, false );  // _initializeTilesAsynchronously
+        ADD_UINT_SERIALIZER( MaximumNumTilesUpdatedPerFrame, 0u );  // _maximumNumTilesUpdatedPerFrame
+    }
 }